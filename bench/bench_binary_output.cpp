@@ -0,0 +1,131 @@
+// Size and round-trip cost of the --binary result format against the JSON
+// formats on synthetic rows shaped like a busy host: a few thousand
+// processes, a handful of users and types, and paths that share directories.
+
+#include "bench_util.h"
+#include "binary_output.h"
+#include "output_formatter.h"
+#include "output_sink.h"
+
+#include <cstdlib>
+#include <string>
+
+using namespace lsofwin_bench;
+
+namespace {
+
+lsofwin::HandleList make_rows(size_t count) {
+    static const char* const users[] = { "NT AUTHORITY\\SYSTEM", "NT AUTHORITY\\LOCAL SERVICE",
+                                         "HOST\\user", "HOST\\svc_backup" };
+    static const char* const dirs[] = {
+        "C:\\Windows\\System32\\", "C:\\Windows\\System32\\en-US\\",
+        "C:\\Users\\user\\AppData\\Local\\Temp\\", "C:\\ProgramData\\Vendor\\Logs\\",
+        "C:\\Program Files\\Vendor\\Product\\bin\\", "\\Device\\NamedPipe\\",
+    };
+    lsofwin::HandleList rows;
+    rows.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        size_t proc = i / 400;
+        lsofwin::HandleInfo h;
+        h.pid = static_cast<uint32_t>(4 + proc * 4);
+        h.process_name = "process" + std::to_string(proc % 300) + ".exe";
+        h.user = users[proc % 4];
+        h.handle_value = 4 + (i % 400) * 4;
+        switch (i % 5) {
+        case 0:
+            h.handle_type = "Key";
+            h.object_name = "\\REGISTRY\\MACHINE\\SOFTWARE\\Vendor\\Key" + std::to_string(i % 97);
+            break;
+        case 1:
+            h.handle_type = "Event";
+            break;
+        default:
+            h.handle_type = "File";
+            h.object_name = std::string(dirs[i % 6]) + "file" + std::to_string(i % 5000) + ".dat";
+            break;
+        }
+        rows.push_back(std::move(h));
+    }
+    return rows;
+}
+
+size_t discard_size(const lsofwin::HandleList& rows,
+    std::unique_ptr<lsofwin::OutputSink> (*make_sink)(lsofwin::OutputBuffer&)) {
+    size_t bytes = 0;
+    lsofwin::OutputBuffer out([&](const char*, size_t n) { bytes += n; });
+    auto sink = make_sink(out);
+    for (const auto& h : rows) sink->write(h);
+    sink->finish();
+    return bytes;
+}
+
+} // anonymous namespace
+
+int main(int argc, char* argv[]) {
+    size_t count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+    auto rows = make_rows(count);
+
+    print_header("encode");
+    size_t json_bytes = 0, ndjson_bytes = 0, binary_bytes = 0;
+    {
+        Timer timer;
+        json_bytes = discard_size(rows, lsofwin::make_json_array_sink);
+        print_result("JSON array sink", rows.size(), timer.elapsed_ms());
+    }
+    {
+        Timer timer;
+        ndjson_bytes = discard_size(rows, lsofwin::make_ndjson_sink);
+        print_result("NDJSON sink", rows.size(), timer.elapsed_ms());
+    }
+    {
+        Timer timer;
+        binary_bytes = discard_size(rows, lsofwin::make_binary_sink);
+        print_result("binary sink", rows.size(), timer.elapsed_ms());
+    }
+
+    std::string bytes = lsofwin::format_binary(rows);
+    lsofwin::BinaryResultReader reader;
+    std::string error;
+
+    print_header("decode");
+    {
+        Timer timer;
+        if (!reader.open(bytes.data(), bytes.size(), error)) {
+            std::printf("    open failed: %s\n", error.c_str());
+            return 1;
+        }
+        print_result("reader open", 1, timer.elapsed_ms());
+    }
+    {
+        size_t total = 0;
+        Timer timer;
+        for (size_t i = 0; i < reader.row_count(); ++i) {
+            total += reader.pid(i) + reader.type(i).size() + reader.name_leaf(i).size();
+        }
+        print_result("column views (pid, type, leaf)", reader.row_count(), timer.elapsed_ms());
+        do_not_optimize(total);
+    }
+    lsofwin::HandleList decoded(reader.row_count());
+    {
+        Timer timer;
+        for (size_t i = 0; i < decoded.size(); ++i) reader.row(i, decoded[i]);
+        print_result("materialize HandleInfo rows", decoded.size(), timer.elapsed_ms());
+    }
+
+    bool same = lsofwin::format_json(decoded) == lsofwin::format_json(rows);
+    for (size_t i = 0; same && i < rows.size(); ++i) {
+        same = decoded[i].handle_value == rows[i].handle_value;
+    }
+
+    std::printf("\n== size ==\n");
+    std::printf("%-44s %12zu bytes %8.1f B/row\n", "JSON array", json_bytes,
+        static_cast<double>(json_bytes) / rows.size());
+    std::printf("%-44s %12zu bytes %8.1f B/row\n", "NDJSON", ndjson_bytes,
+        static_cast<double>(ndjson_bytes) / rows.size());
+    std::printf("%-44s %12zu bytes %8.1f B/row\n", "binary", binary_bytes,
+        static_cast<double>(binary_bytes) / rows.size());
+    std::printf("%-44s %12.1fx\n", "JSON array / binary",
+        static_cast<double>(json_bytes) / binary_bytes);
+    std::printf("%-44s %12s\n", "round trip", same ? "identical" : "MISMATCH");
+    return same ? 0 : 1;
+}
@@ -0,0 +1,202 @@
+// Table and JSON formatting of synthetic HandleInfo rows: the original
+// ostringstream/setw/std::to_string formatter with its per-character
+// json_escape, versus the OutputBuffer sinks (std::to_chars, direct padding,
+// SSE2 escape scanning) formatting into a string and into a discarding sink.
+
+#include "bench_util.h"
+#include "json_escape.h"
+#include "output_formatter.h"
+#include "output_sink.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iomanip>
+#include <sstream>
+#include <string>
+
+using namespace lsofwin_bench;
+
+namespace {
+
+lsofwin::HandleList make_rows(size_t count) {
+    lsofwin::HandleList rows;
+    rows.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        lsofwin::HandleInfo h;
+        h.pid = static_cast<uint32_t>(4 + (i / 400) * 4);
+        h.process_name = "process" + std::to_string(i / 400) + ".exe";
+        h.user = (i / 400) % 3 ? "HOST\\user" : "NT AUTHORITY\\SYSTEM";
+        h.handle_type = i % 4 ? "File" : "Key";
+        h.object_name = i % 4 ? "C:\\Users\\user\\AppData\\Local\\Temp\\file" + std::to_string(i) + ".tmp"
+                              : "\\REGISTRY\\MACHINE\\SOFTWARE\\Vendor\\Key" + std::to_string(i % 977);
+        rows.push_back(std::move(h));
+    }
+    return rows;
+}
+
+// --- The original formatter (colors disabled) ---
+
+std::string legacy_format_table(const lsofwin::HandleList& handles) {
+    size_t w_cmd = 7, w_pid = 3, w_user = 4, w_type = 4;
+    for (const auto& h : handles) {
+        w_cmd  = (std::max)(w_cmd,  h.process_name.size());
+        w_pid  = (std::max)(w_pid,  std::to_string(h.pid).size());
+        w_user = (std::max)(w_user, h.user.size());
+        w_type = (std::max)(w_type, h.handle_type.size());
+    }
+    w_cmd  = (std::min)(w_cmd,  (size_t)25);
+    w_user = (std::min)(w_user, (size_t)30);
+    w_type = (std::min)(w_type, (size_t)20);
+
+    std::ostringstream oss;
+    oss << std::left
+        << std::setw(static_cast<int>(w_cmd + 2))  << "COMMAND"
+        << std::setw(static_cast<int>(w_pid + 2))  << "PID"
+        << std::setw(static_cast<int>(w_user + 2)) << "USER"
+        << std::setw(static_cast<int>(w_type + 2)) << "TYPE"
+        << "NAME" << "\n";
+    for (const auto& h : handles) {
+        std::string cmd = h.process_name;
+        if (cmd.size() > w_cmd) cmd = cmd.substr(0, w_cmd - 1) + "~";
+        std::string user = h.user;
+        if (user.size() > w_user) user = user.substr(0, w_user - 1) + "~";
+        std::string type = h.handle_type;
+        if (type.size() > w_type) type = type.substr(0, w_type - 1) + "~";
+        oss << std::left
+            << std::setw(static_cast<int>(w_cmd + 2))  << cmd
+            << std::setw(static_cast<int>(w_pid + 2))  << h.pid
+            << std::setw(static_cast<int>(w_user + 2)) << user
+            << std::setw(static_cast<int>(w_type + 2)) << type
+            << h.object_name << "\n";
+    }
+    return oss.str();
+}
+
+std::string legacy_json_escape(const std::string& s) {
+    std::string result;
+    result.reserve(s.size() + 8);
+    for (char c : s) {
+        switch (c) {
+        case '"':  result += "\\\""; break;
+        case '\\': result += "\\\\"; break;
+        case '\b': result += "\\b";  break;
+        case '\f': result += "\\f";  break;
+        case '\n': result += "\\n";  break;
+        case '\r': result += "\\r";  break;
+        case '\t': result += "\\t";  break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20) {
+                char buf[8];
+                snprintf(buf, sizeof(buf), "\\u%04x", static_cast<unsigned char>(c));
+                result += buf;
+            }
+            else {
+                result += c;
+            }
+            break;
+        }
+    }
+    return result;
+}
+
+std::string legacy_format_json(const lsofwin::HandleList& handles) {
+    std::ostringstream oss;
+    oss << "[\n";
+    for (size_t i = 0; i < handles.size(); ++i) {
+        const auto& h = handles[i];
+        oss << "  {\n"
+            << "    \"command\": \"" << legacy_json_escape(h.process_name) << "\",\n"
+            << "    \"pid\": " << h.pid << ",\n"
+            << "    \"user\": \"" << legacy_json_escape(h.user) << "\",\n"
+            << "    \"type\": \"" << legacy_json_escape(h.handle_type) << "\",\n"
+            << "    \"name\": \"" << legacy_json_escape(h.object_name) << "\"\n"
+            << "  }";
+        if (i + 1 < handles.size()) oss << ",";
+        oss << "\n";
+    }
+    oss << "]\n";
+    return oss.str();
+}
+
+// Stream every row through a sink whose flush discards the bytes
+size_t stream_to_discard(const lsofwin::HandleList& rows, bool json) {
+    size_t bytes = 0;
+    lsofwin::OutputBuffer out([&](const char*, size_t n) { bytes += n; });
+    auto sink = json ? lsofwin::make_json_array_sink(out) : lsofwin::make_table_sink(out, 1000);
+    for (const auto& h : rows) sink->write(h);
+    sink->finish();
+    return bytes;
+}
+
+} // anonymous namespace
+
+int main(int argc, char* argv[]) {
+    size_t count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+    auto rows = make_rows(count);
+
+    print_header("table output");
+    {
+        Timer timer;
+        auto s = legacy_format_table(rows);
+        print_result("before: ostringstream + setw", rows.size(), timer.elapsed_ms());
+        do_not_optimize(s.size());
+    }
+    {
+        Timer timer;
+        auto s = lsofwin::format_table(rows);
+        print_result("after: format_table into string", rows.size(), timer.elapsed_ms());
+        do_not_optimize(s.size());
+    }
+    {
+        Timer timer;
+        size_t bytes = stream_to_discard(rows, false);
+        print_result("after: streamed table sink", rows.size(), timer.elapsed_ms());
+        do_not_optimize(bytes);
+    }
+
+    print_header("JSON output");
+    {
+        Timer timer;
+        auto s = legacy_format_json(rows);
+        print_result("before: ostringstream + char escape", rows.size(), timer.elapsed_ms());
+        do_not_optimize(s.size());
+    }
+    {
+        Timer timer;
+        auto s = lsofwin::format_json(rows);
+        print_result("after: format_json into string", rows.size(), timer.elapsed_ms());
+        do_not_optimize(s.size());
+        if (s != legacy_format_json(rows)) {
+            std::printf("    MISMATCH against the original JSON output\n");
+            return 1;
+        }
+    }
+    {
+        Timer timer;
+        size_t bytes = stream_to_discard(rows, true);
+        print_result("after: streamed JSON sink", rows.size(), timer.elapsed_ms());
+        do_not_optimize(bytes);
+    }
+
+    print_header("json_escape on object names");
+    {
+        size_t total = 0;
+        Timer timer;
+        for (const auto& h : rows) total += legacy_json_escape(h.object_name).size();
+        print_result("before: per-character copy", rows.size(), timer.elapsed_ms());
+        do_not_optimize(total);
+    }
+    {
+        std::string out;
+        size_t total = 0;
+        Timer timer;
+        for (const auto& h : rows) {
+            out.clear();
+            lsofwin::append_json_escaped(out, h.object_name);
+            total += out.size();
+        }
+        print_result("after: SSE2 scan + bulk copy", rows.size(), timer.elapsed_ms());
+        do_not_optimize(total);
+    }
+    return 0;
+}
@@ -0,0 +1,175 @@
+// Memory and iteration cost of 1M result rows held as a HandleList (four
+// std::strings per row) versus a HandleTable (process table, interned string
+// arena, id columns). Heap use is counted by replacing global operator new.
+
+#include "bench_util.h"
+#include "handle_info.h"
+#include "handle_table.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <vector>
+
+using namespace lsofwin_bench;
+
+namespace {
+
+std::atomic<uint64_t> g_allocations{ 0 };
+std::atomic<int64_t> g_live_bytes{ 0 };
+
+// Each block carries its size in front so delete can account for it
+constexpr size_t HeaderSize = alignof(std::max_align_t);
+
+} // anonymous namespace
+
+void* operator new(size_t size) {
+    void* p = std::malloc(size + HeaderSize);
+    if (!p) throw std::bad_alloc();
+    *static_cast<size_t*>(p) = size;
+    ++g_allocations;
+    g_live_bytes += static_cast<int64_t>(size);
+    return static_cast<char*>(p) + HeaderSize;
+}
+
+void operator delete(void* p) noexcept {
+    if (!p) return;
+    char* block = static_cast<char*>(p) - HeaderSize;
+    g_live_bytes -= static_cast<int64_t>(*reinterpret_cast<size_t*>(block));
+    std::free(block);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    operator delete(p);
+}
+
+namespace {
+
+struct Process {
+    uint32_t pid;
+    std::string name;
+    std::string user;
+};
+
+struct Input {
+    std::vector<Process> processes;
+    std::vector<std::string> types;
+    std::vector<std::string> names;     // One per row, as resolve() would return
+};
+
+Input make_input(size_t rows) {
+    static const char* const users[] = { "NT AUTHORITY\\SYSTEM", "NT AUTHORITY\\LOCAL SERVICE",
+                                         "HOST\\user", "HOST\\svc_backup" };
+    static const char* const dirs[] = {
+        "C:\\Windows\\System32\\", "C:\\Windows\\System32\\en-US\\",
+        "C:\\Users\\user\\AppData\\Local\\Temp\\", "C:\\ProgramData\\Vendor\\Logs\\",
+        "\\Device\\HarddiskVolume3\\Program Files\\Vendor\\", "\\REGISTRY\\MACHINE\\SOFTWARE\\Vendor\\",
+    };
+    Input in;
+    in.types = { "File", "Key", "Event", "Section", "Mutant" };
+    for (size_t p = 0; p < rows / 400 + 1; ++p) {
+        in.processes.push_back(Process{ static_cast<uint32_t>(4 + p * 4),
+            "process" + std::to_string(p % 300) + ".exe", users[p % 4] });
+    }
+    in.names.reserve(rows);
+    for (size_t i = 0; i < rows; ++i) {
+        in.names.push_back(i % 5 == 2 ? std::string()
+            : std::string(dirs[i % 6]) + "item" + std::to_string(i % 20000) + ".dat");
+    }
+    return in;
+}
+
+struct HeapDelta {
+    HeapDelta() : allocations(g_allocations.load()), live(g_live_bytes.load()) {}
+
+    void print(const char* name) const {
+        std::printf("%-44s %12llu allocs %10.1f MiB live\n", name,
+            static_cast<unsigned long long>(g_allocations.load() - allocations),
+            static_cast<double>(g_live_bytes.load() - live) / (1024.0 * 1024.0));
+    }
+
+    uint64_t allocations;
+    int64_t live;
+};
+
+} // anonymous namespace
+
+int main(int argc, char* argv[]) {
+    size_t count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+    Input in = make_input(count);
+
+    print_header("build");
+    lsofwin::HandleList list;
+    HeapDelta list_heap;
+    {
+        Timer timer;
+        list.reserve(count);
+        for (size_t i = 0; i < count; ++i) {
+            const auto& p = in.processes[i / 400];
+            lsofwin::HandleInfo h;
+            h.pid = p.pid;
+            h.process_name = p.name;
+            h.user = p.user;
+            h.handle_type = in.types[i % in.types.size()];
+            h.object_name = in.names[i];
+            h.handle_value = 4 + (i % 400) * 4;
+            list.push_back(std::move(h));
+        }
+        print_result("HandleList (vector of strings)", count, timer.elapsed_ms());
+    }
+
+    lsofwin::HandleTable table;
+    HeapDelta table_heap;
+    {
+        Timer timer;
+        table.reserve(count);
+        for (size_t i = 0; i < count; ++i) {
+            const auto& p = in.processes[i / 400];
+            uint32_t process = table.add_process(p.pid, p.name, p.user);
+            table.add(process, in.types[i % in.types.size()], in.names[i], 4 + (i % 400) * 4);
+        }
+        print_result("HandleTable (interned, columnar)", count, timer.elapsed_ms());
+    }
+
+    std::printf("\n== heap after build ==\n");
+    list_heap.print("HandleList");
+    table_heap.print("HandleTable"); // Started after the list was built
+    std::printf("%-44s %23.1f MiB\n", "HandleTable::memory_bytes()",
+        static_cast<double>(table.memory_bytes()) / (1024.0 * 1024.0));
+
+    print_header("iterate");
+    {
+        uint64_t total = 0;
+        Timer timer;
+        for (const auto& h : list) total += h.pid + h.object_name.size() + h.process_name.size();
+        print_result("HandleList: pid + name + command", count, timer.elapsed_ms());
+        do_not_optimize(total);
+    }
+    {
+        uint64_t total = 0;
+        Timer timer;
+        for (auto row : table) total += row.pid() + row.object_name().size() + row.process_name().size();
+        print_result("HandleTable rows: pid + name + command", count, timer.elapsed_ms());
+        do_not_optimize(total);
+    }
+    {
+        size_t files = 0;
+        Timer timer;
+        for (const auto& h : list) files += h.handle_type == "File";
+        print_result("HandleList: count type == File", count, timer.elapsed_ms());
+        do_not_optimize(files);
+    }
+    {
+        size_t files = 0;
+        Timer timer;
+        uint32_t file_id = table.strings().size();
+        for (uint32_t id = 0; id < table.strings().size(); ++id) {
+            if (table.strings().view(id) == "File") file_id = id;
+        }
+        for (uint32_t type : table.type_column()) files += type == file_id;
+        print_result("HandleTable: count type column == File id", count, timer.elapsed_ms());
+        do_not_optimize(files);
+    }
+    return 0;
+}
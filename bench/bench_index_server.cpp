@@ -0,0 +1,158 @@
+// Query latency of the --serve index on 1M synthetic handles in 2,500
+// processes: exact-path and PID lookups, a query that has to scan every row,
+// and the exact-path query as a client round trip over the local
+// socket. For scale, one full enumeration of the same source is timed too.
+
+#include "bench_util.h"
+#include "filter_expr.h"
+#include "handle_enumerator.h"
+#include "index_server.h"
+
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace lsofwin_bench;
+
+namespace {
+
+constexpr uint32_t HandlesPerProcess = 400;
+
+class SyntheticSource : public lsofwin::HandleSource {
+public:
+    explicit SyntheticSource(size_t handles) {
+        for (size_t i = 0; i < handles; ++i) {
+            lsofwin::RawHandle raw;
+            raw.pid = static_cast<uint32_t>(4 + (i / HandlesPerProcess) * 4);
+            raw.handle_value = 4 + (i % HandlesPerProcess) * 4;
+            raw.object = 0x10000 + i * 16;
+            table_.push_back(raw);
+        }
+    }
+
+    bool snapshot(std::vector<lsofwin::RawHandle>& table) override {
+        table = table_;
+        return true;
+    }
+
+    uint64_t process_start_time(uint32_t pid) override {
+        return 1000 + pid;
+    }
+
+    lsofwin::ProcessInfo process_info(uint32_t pid) override {
+        return lsofwin::ProcessInfo{ "process" + std::to_string(pid % 97) + ".exe", "HOST\\user" };
+    }
+
+    bool resolve(const lsofwin::RawHandle& entry, size_t, uint32_t,
+        lsofwin::ResolvedHandle& out) override {
+        out.type = entry.handle_value % 3 == 0 ? "Key" : "File";
+        out.name = name_of(entry.object);
+        return true;
+    }
+
+    // Every name is shared by 8 handles across different processes
+    static std::string name_of(uintptr_t object) {
+        return "C:\\Program Files\\App" + std::to_string((object / 16) % 50) +
+            "\\lib\\module" + std::to_string((object / 16) % 125000) + ".dll";
+    }
+
+private:
+    std::vector<lsofwin::RawHandle> table_;
+};
+
+lsofwin::FilterOptions regex_query(const std::string& pattern) {
+    lsofwin::FilterOptions opts;
+    opts.filter_file_regexes = { pattern };
+    opts.filter = std::make_shared<lsofwin::FilterExpr>(opts);
+    return opts;
+}
+
+template <typename Fn>
+void time_queries(const char* name, int iterations, Fn&& fn) {
+    size_t rows = 0;
+    Timer timer;
+    for (int i = 0; i < iterations; ++i) rows += fn(i);
+    double ms = timer.elapsed_ms();
+    print_result(name, static_cast<size_t>(iterations), ms);
+    std::printf("    %.1f us/query, %zu rows/query\n", ms * 1000.0 / iterations, rows / iterations);
+}
+
+} // anonymous namespace
+
+int main(int argc, char* argv[]) {
+    size_t count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+    SyntheticSource src(count);
+
+    print_header("baseline");
+    {
+        lsofwin::FilterOptions opts = regex_query("^C:\\\\Program Files\\\\App7\\\\lib\\\\module7\\.dll$");
+        Timer timer;
+        auto rows = lsofwin::enumerate_handles(src, opts);
+        print_result("full scan, exact -f", count, timer.elapsed_ms());
+        do_not_optimize(rows);
+    }
+
+    lsofwin::FilterOptions server_opts;
+    server_opts.repeat_seconds = 3600;
+    lsofwin::IndexServer server(src, server_opts);
+    {
+        Timer timer;
+        server.refresh();
+        print_result("build index (first refresh)", count, timer.elapsed_ms());
+    }
+    {
+        Timer timer;
+        server.refresh();
+        print_result("refresh, no change", count, timer.elapsed_ms());
+    }
+
+    print_header("queries answered from the index");
+    std::string sink;
+    auto answer = [&](std::vector<std::string> args) {
+        sink.clear();
+        std::string error;
+        lsofwin::OutputBuffer out(lsofwin::string_writer(sink), 64 * 1024);
+        server.answer(args, out, error);
+        out.flush();
+        return static_cast<size_t>(std::count(sink.begin(), sink.end(), '\n'));
+    };
+    auto exact_path = [](int i) {
+        return "^c:\\\\program files\\\\app" + std::to_string(i % 50) +
+            "\\\\lib\\\\module" + std::to_string(i) + "\\.dll$";
+    };
+    time_queries("exact path, new pattern each query", 2000, [&](int i) {
+        return answer({ "-f", exact_path(10000 + i), "--ndjson" });
+    });
+    time_queries("exact path, repeated (parse cached)", 20000, [&](int i) {
+        return answer({ "-f", exact_path(i % 100), "--ndjson" });
+    });
+    time_queries("one process (-p)", 2000, [&](int i) {
+        return answer({ "-p", std::to_string(4 + (i % 2500) * 4), "--ndjson" });
+    });
+    time_queries("substring over every row (-f)", 5, [&](int i) {
+        return answer({ "-f", "module1234" + std::to_string(i) + "\\.", "--ndjson" });
+    });
+
+    print_header("client round trip");
+    std::string error;
+#ifdef _WIN32
+    std::string path = "\\\\.\\pipe\\lsofwin-bench";
+#else
+    std::string path = "/tmp/lsofwin-bench.sock";
+#endif
+    lsofwin::LocalListener listener;
+    if (!listener.listen(path, error)) {
+        std::printf("listen failed: %s\n", error.c_str());
+        return 1;
+    }
+    std::thread serving([&] { server.run(listener); });
+    time_queries("exact path via socket, repeated", 20000, [&](int i) {
+        std::string out;
+        lsofwin::query_server(path, { "-f", exact_path(i % 100), "--ndjson" }, lsofwin::string_writer(out), error);
+        return static_cast<size_t>(std::count(out.begin(), out.end(), '\n'));
+    });
+    server.stop();
+    serving.join();
+    return 0;
+}
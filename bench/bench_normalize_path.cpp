@@ -0,0 +1,113 @@
+// NT -> DOS path normalization over millions of synthetic NT object names:
+// the original per-call linear scan over drive targets (minus its
+// GetLogicalDriveStrings/QueryDosDevice syscalls, which only exist on
+// Windows) versus the prebuilt DevicePathMap rewriting in place.
+
+#include "bench_util.h"
+#include "device_path_map.h"
+
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace lsofwin_bench;
+
+namespace {
+
+const char* const components[] = {
+    "Windows", "System32", "Users", "Program Files", "AppData", "Local", "Temp",
+    "Microsoft", "Logs", "en-US", "drivers", "WinSxS", "Documents", "build", "src",
+};
+const char* const leaves[] = {
+    "ntdll.dll", "kernel32.dll", "app.log", "settings.json", "index.dat",
+    "shell32.dll.mui", "report.docx", "cache.db", "trace.etl", "main.cpp",
+};
+
+std::vector<std::string> make_paths(size_t count, uint32_t seed) {
+    std::mt19937 rng(seed);
+    std::vector<std::string> paths;
+    paths.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        std::string p;
+        uint32_t kind = rng() % 100;
+        if (kind < 70) {
+            p = "\\Device\\HarddiskVolume" + std::to_string(1 + rng() % 12);
+        }
+        else if (kind < 80) {
+            p = "\\Device\\Mup\\fileserver" + std::to_string(rng() % 4) + "\\share";
+        }
+        else if (kind < 85) {
+            p = "\\??\\C:";
+        }
+        else {
+            p = "\\REGISTRY\\MACHINE\\SOFTWARE";
+        }
+        size_t depth = 1 + rng() % 6;
+        for (size_t d = 0; d < depth; ++d) {
+            p += '\\';
+            p += components[rng() % (sizeof(components) / sizeof(components[0]))];
+        }
+        p += '\\';
+        p += leaves[rng() % (sizeof(leaves) / sizeof(leaves[0]))];
+        paths.push_back(std::move(p));
+    }
+    return paths;
+}
+
+// Drive table as QueryDosDevice would report it
+std::vector<std::pair<std::string, std::string>> make_drives() {
+    std::vector<std::pair<std::string, std::string>> drives;
+    for (int v = 1; v <= 8; ++v) {
+        drives.emplace_back(std::string(1, static_cast<char>('B' + v)) + ":",
+            "\\Device\\HarddiskVolume" + std::to_string(v));
+    }
+    return drives;
+}
+
+// The original normalize_path() algorithm
+std::string legacy_normalize(const std::string& nt_path,
+    const std::vector<std::pair<std::string, std::string>>& drives) {
+    for (const auto& d : drives) {
+        const std::string& target_str = d.second;
+        if (nt_path.compare(0, target_str.size(), target_str) == 0) {
+            return d.first + nt_path.substr(target_str.size());
+        }
+    }
+    return nt_path;
+}
+
+} // anonymous namespace
+
+int main(int argc, char* argv[]) {
+    size_t count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 2000000;
+    auto paths = make_paths(count, 42);
+    auto drives = make_drives();
+
+    lsofwin::DevicePathMap map;
+    for (const auto& d : drives) map.add(d.second, d.first);
+    for (int v = 9; v <= 12; ++v) {
+        map.add("\\Device\\HarddiskVolume" + std::to_string(v), "C:\\mnt\\vol" + std::to_string(v));
+    }
+    map.add_standard_prefixes();
+
+    print_header("normalize_path over synthetic NT paths");
+
+    {
+        size_t total_len = 0;
+        Timer timer;
+        for (const auto& p : paths) total_len += legacy_normalize(p, drives).size();
+        print_result("legacy linear scan (no syscalls)", paths.size(), timer.elapsed_ms());
+        do_not_optimize(total_len);
+    }
+    {
+        auto work = paths;
+        size_t rewritten = 0;
+        Timer timer;
+        for (auto& p : work) rewritten += map.normalize(p) ? 1 : 0;
+        print_result("DevicePathMap in place", work.size(), timer.elapsed_ms());
+        std::printf("    rewritten=%zu of %zu (%zu rules)\n", rewritten, work.size(), map.size());
+    }
+    return 0;
+}
@@ -0,0 +1,108 @@
+// Output memory and first-row latency on synthetic rows: the original
+// collect-then-format path (whole HandleList, then one std::string from
+// format_output) versus streaming each row through an OutputSink as it is
+// produced. Output goes to the null device so only formatting is measured.
+//
+// Peak RSS only grows, so run one mode per process for clean numbers:
+//     bench_output_stream 1000000 stream
+//     bench_output_stream 1000000 list
+
+#include "bench_util.h"
+#include "output_formatter.h"
+#include "output_sink.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+using namespace lsofwin_bench;
+
+namespace {
+
+#ifdef _WIN32
+const char* const NullDevice = "NUL";
+#else
+const char* const NullDevice = "/dev/null";
+#endif
+
+// Deterministic row i of a synthetic scan: ~400 handles per process
+lsofwin::HandleInfo make_row(size_t i) {
+    lsofwin::HandleInfo h;
+    h.pid = static_cast<uint32_t>(4 + (i / 400) * 4);
+    h.process_name = "process" + std::to_string(i / 400) + ".exe";
+    h.user = (i / 400) % 3 ? "HOST\\user" : "NT AUTHORITY\\SYSTEM";
+    h.handle_type = i % 4 ? "File" : "Key";
+    h.object_name = i % 4 ? "C:\\Users\\user\\AppData\\Local\\Temp\\file" + std::to_string(i) + ".tmp"
+                          : "\\REGISTRY\\MACHINE\\SOFTWARE\\Vendor\\Key" + std::to_string(i % 977);
+    h.handle_value = (i % 400 + 1) * 4;
+    return h;
+}
+
+struct Run {
+    double first_byte_ms = -1;
+    double total_ms = 0;
+    uint64_t bytes = 0;
+};
+
+void run_list(size_t rows, lsofwin::FilterOptions opts, std::FILE* devnull, Run& r) {
+    Timer timer;
+    lsofwin::HandleList list;
+    for (size_t i = 0; i < rows; ++i) list.push_back(make_row(i));
+    std::string text = lsofwin::format_output(list, opts);
+    r.first_byte_ms = timer.elapsed_ms();
+    std::fwrite(text.data(), 1, text.size(), devnull);
+    r.bytes = text.size();
+    r.total_ms = timer.elapsed_ms();
+}
+
+void run_stream(size_t rows, lsofwin::FilterOptions opts, std::FILE* devnull, Run& r) {
+    Timer timer;
+    auto writer = lsofwin::file_writer(devnull);
+    lsofwin::OutputBuffer out([&](const char* data, size_t size) {
+        if (r.first_byte_ms < 0) r.first_byte_ms = timer.elapsed_ms();
+        writer(data, size);
+    }, lsofwin::OutputBuffer::DefaultCapacity, std::chrono::milliseconds(100));
+    auto sink = lsofwin::make_output_sink(out, opts);
+    for (size_t i = 0; i < rows; ++i) sink->write(make_row(i));
+    sink->finish();
+    r.bytes = out.bytes_flushed();
+    r.total_ms = timer.elapsed_ms();
+}
+
+} // anonymous namespace
+
+int main(int argc, char* argv[]) {
+    size_t rows = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+    const char* mode = argc > 2 ? argv[2] : "both";
+    std::FILE* devnull = std::fopen(NullDevice, "wb");
+    if (!devnull) return 1;
+
+    struct Format {
+        const char* name;
+        bool json;
+        bool ndjson;
+    };
+    const Format formats[] = { { "table", false, false }, { "json", true, false }, { "ndjson", false, true } };
+
+    std::printf("rows=%zu  baseline peak RSS %llu KiB\n", rows,
+        static_cast<unsigned long long>(peak_rss_kb()));
+    std::printf("%-8s %-7s %14s %12s %12s %14s\n", "format", "mode", "first_byte_ms",
+        "total_ms", "MiB", "peak_rss_KiB");
+
+    for (const char* m : { "stream", "list" }) {
+        if (std::strcmp(mode, "both") != 0 && std::strcmp(mode, m) != 0) continue;
+        for (const auto& f : formats) {
+            lsofwin::FilterOptions opts;
+            opts.output_json = f.json;
+            opts.output_ndjson = f.ndjson;
+            Run r;
+            if (std::strcmp(m, "stream") == 0) run_stream(rows, opts, devnull, r);
+            else run_list(rows, opts, devnull, r);
+            std::printf("%-8s %-7s %14.2f %12.2f %12.1f %14llu\n", f.name, m, r.first_byte_ms,
+                r.total_ms, static_cast<double>(r.bytes) / (1024.0 * 1024.0),
+                static_cast<unsigned long long>(peak_rss_kb()));
+        }
+    }
+    std::fclose(devnull);
+    return 0;
+}
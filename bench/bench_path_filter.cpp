@@ -0,0 +1,102 @@
+// -f filtering over a synthetic corpus of DOS-style object names: the
+// original std::regex_search with std::regex::icase for every handle versus
+// PathMatcher, for the pattern shapes shown in the -h examples.
+
+#include "bench_util.h"
+#include "path_matcher.h"
+
+#include <cstdlib>
+#include <random>
+#include <regex>
+#include <string>
+#include <vector>
+
+using namespace lsofwin_bench;
+
+namespace {
+
+const char* const components[] = {
+    "Windows", "System32", "Users", "John", "Program Files", "AppData", "Local", "Temp",
+    "Microsoft", "Logs", "en-US", "drivers", "WinSxS", "Documents", "build", "src",
+};
+const char* const leaves[] = {
+    "ntdll.dll", "kernel32.dll", "app.log", "settings.json", "index.dat",
+    "shell32.dll.mui", "report.docx", "cache.db", "trace.txt", "main.cpp", "myfile.docx",
+};
+
+// Mostly file paths, plus the registry keys, pipes and devices that make up
+// the rest of a real handle table
+std::vector<std::string> make_names(size_t count, uint32_t seed) {
+    std::mt19937 rng(seed);
+    std::vector<std::string> names;
+    names.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        std::string n;
+        uint32_t kind = rng() % 100;
+        if (kind < 65) {
+            n = std::string(1, static_cast<char>('C' + rng() % 3)) + ":";
+        }
+        else if (kind < 85) {
+            n = "\\REGISTRY\\MACHINE\\SOFTWARE";
+        }
+        else if (kind < 95) {
+            n = "\\Device\\NamedPipe\\pipe" + std::to_string(rng() % 64);
+            names.push_back(std::move(n));
+            continue;
+        }
+        else {
+            names.push_back("\\Device\\Afd\\Endpoint");
+            continue;
+        }
+        size_t depth = 1 + rng() % 6;
+        for (size_t d = 0; d < depth; ++d) {
+            n += '\\';
+            n += components[rng() % (sizeof(components) / sizeof(components[0]))];
+        }
+        n += '\\';
+        n += leaves[rng() % (sizeof(leaves) / sizeof(leaves[0]))];
+        names.push_back(std::move(n));
+    }
+    return names;
+}
+
+} // anonymous namespace
+
+int main(int argc, char* argv[]) {
+    size_t count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 200000;
+    auto names = make_names(count, 42);
+
+    const char* const patterns[] = {
+        "myfile\\.docx",
+        "\\.log$",
+        "^C:\\\\Windows",
+        "\\.(log|txt)$",
+        "C:\\\\Users\\\\.*\\\\AppData",
+        "REGISTRY",
+        "([a-z])\\1l",
+    };
+
+    for (const char* pattern : patterns) {
+        lsofwin::PathMatcher matcher(pattern);
+        std::string title = std::string("-f \"") + pattern + "\" -> " +
+            lsofwin::PathMatcher::strategy_name(matcher.strategy());
+        print_header(title.c_str());
+
+        size_t regex_hits = 0, matcher_hits = 0;
+        {
+            std::regex re(pattern, std::regex::icase);
+            Timer timer;
+            for (const auto& n : names) regex_hits += std::regex_search(n, re) ? 1 : 0;
+            print_result("std::regex_search icase", names.size(), timer.elapsed_ms());
+        }
+        {
+            Timer timer;
+            for (const auto& n : names) matcher_hits += matcher.matches(n) ? 1 : 0;
+            print_result("PathMatcher", names.size(), timer.elapsed_ms());
+        }
+        std::printf("    matches: std::regex=%zu PathMatcher=%zu%s\n", regex_hits, matcher_hits,
+            regex_hits == matcher_hits ? "" : "  MISMATCH");
+        if (regex_hits != matcher_hits) return 1;
+    }
+    return 0;
+}
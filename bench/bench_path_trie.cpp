@@ -0,0 +1,109 @@
+// +d / +D over millions of synthetic paths: building the PathTrie, subtree
+// and top-level lookups of various sizes, and, for comparison, the linear
+// scans a one-shot run does (DirectoryFilter per name) and that users wrote
+// before (-f "^C:\\Users\\u17\\"). Paths are Windows-style under C:\Users
+// and C:\Program Files, with a POSIX-style share under /srv.
+
+#include "bench_util.h"
+#include "path_matcher.h"
+#include "path_trie.h"
+
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+using namespace lsofwin_bench;
+using lsofwin::PathTrie;
+
+namespace {
+
+std::vector<std::string> make_paths(size_t count) {
+    std::vector<std::string> paths;
+    paths.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        switch (i % 4) {
+        case 0:
+        case 1:
+            paths.push_back("C:\\Users\\u" + std::to_string(i % 200) + "\\AppData\\Local\\app" +
+                std::to_string((i / 200) % 50) + "\\cache\\f" + std::to_string(i) + ".bin");
+            break;
+        case 2:
+            paths.push_back("C:\\Program Files\\Vendor" + std::to_string(i % 40) + "\\bin\\module" +
+                std::to_string(i % 20000) + ".dll");
+            break;
+        default:
+            paths.push_back("/srv/share/d" + std::to_string(i % 1000) + "/f" + std::to_string(i));
+            break;
+        }
+    }
+    return paths;
+}
+
+void time_lookup(const PathTrie& trie, const char* name, const std::string& dir, PathTrie::Scope scope,
+    int iterations) {
+    std::vector<uint32_t> out;
+    Timer timer;
+    for (int i = 0; i < iterations; ++i) {
+        out.clear();
+        trie.lookup(dir, scope, out);
+        do_not_optimize(out.data());
+    }
+    double ms = timer.elapsed_ms();
+    print_result(name, static_cast<uint64_t>(iterations), ms);
+    std::printf("    %zu values, %.1f ns/value\n", out.size(),
+        out.empty() ? 0.0 : ms * 1e6 / iterations / static_cast<double>(out.size()));
+}
+
+} // anonymous namespace
+
+int main(int argc, char* argv[]) {
+    size_t count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 4000000;
+    auto paths = make_paths(count);
+
+    print_header("build");
+    PathTrie trie;
+    {
+        Timer timer;
+        for (size_t i = 0; i < paths.size(); ++i) trie.insert(paths[i], static_cast<uint32_t>(i));
+        print_result("insert", count, timer.elapsed_ms());
+    }
+    std::printf("    %zu nodes, %.1f bytes/path (trie only)\n", trie.node_count(),
+        static_cast<double>(trie.memory_bytes()) / static_cast<double>(count));
+
+    print_header("trie lookups");
+    time_lookup(trie, "+D C:\\Users\\u17 (large subtree)", "C:\\Users\\u17", PathTrie::Scope::Subtree, 20);
+    time_lookup(trie, "+D ...\\u17\\AppData\\Local\\app3 (small)",
+        "c:/users/u17/appdata/local/app3", PathTrie::Scope::Subtree, 20000);
+    time_lookup(trie, "+d ...\\u17\\AppData\\Local\\app3\\cache",
+        "C:\\Users\\u17\\AppData\\Local\\app3\\cache", PathTrie::Scope::Children, 20000);
+    time_lookup(trie, "+d /srv/share/d7", "/srv/share/d7", PathTrie::Scope::Children, 20000);
+    time_lookup(trie, "exact path", paths[12345], PathTrie::Scope::Exact, 200000);
+    time_lookup(trie, "+D C:\\Nowhere (miss)", "C:\\Nowhere", PathTrie::Scope::Subtree, 200000);
+
+    print_header("linear scan over every path");
+    {
+        lsofwin::DirectoryFilter filter("C:\\Users\\u17\\AppData\\Local\\app3", true);
+        size_t matched = 0;
+        Timer timer;
+        for (const auto& p : paths) matched += filter.matches(p);
+        print_result("DirectoryFilter, +D ...\\app3", count, timer.elapsed_ms());
+        std::printf("    %zu matches\n", matched);
+    }
+    {
+        lsofwin::PathMatcher matcher("^C:\\\\Users\\\\u17\\\\AppData\\\\Local\\\\app3\\\\");
+        size_t matched = 0;
+        Timer timer;
+        for (const auto& p : paths) matched += matcher.matches(p);
+        print_result("-f \"^C:\\\\Users\\\\...\\\\app3\\\\\"", count, timer.elapsed_ms());
+        std::printf("    %zu matches (misses the directory itself and / spellings)\n", matched);
+    }
+
+    print_header("erase");
+    {
+        Timer timer;
+        for (size_t i = 0; i < paths.size(); i += 10) trie.erase(paths[i], static_cast<uint32_t>(i));
+        print_result("erase every 10th path", count / 10, timer.elapsed_ms());
+    }
+    std::printf("\npeak RSS %llu KiB\n", static_cast<unsigned long long>(peak_rss_kb()));
+    return 0;
+}
@@ -0,0 +1,129 @@
+// Cost of -r polls against a synthetic 1M-handle source: the table snapshot
+// alone, a full enumerate_handles() per poll (what scripts polling lsofwin
+// paid), the watcher's first poll, and its steady-state polls with and
+// without churn. resolve() and process_info() carry a small fixed cost to
+// stand in for DuplicateHandle / NtQueryObject / OpenProcess.
+
+#include "bench_util.h"
+#include "handle_enumerator.h"
+#include "handle_watcher.h"
+
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+using namespace lsofwin_bench;
+
+namespace {
+
+void spin_ns(uint64_t ns) {
+    Timer t;
+    while (t.elapsed_ms() * 1e6 < static_cast<double>(ns)) {}
+}
+
+class SyntheticSource : public lsofwin::HandleSource {
+public:
+    explicit SyntheticSource(size_t handles) {
+        for (size_t i = 0; i < handles; ++i) {
+            lsofwin::RawHandle raw;
+            raw.pid = static_cast<uint32_t>(4 + (i / 400) * 4);
+            raw.handle_value = 4 + (i % 400) * 4;
+            raw.object = 0x10000 + i * 16;
+            table_.push_back(raw);
+        }
+    }
+
+    // Close `count` handles and open as many new ones, spread over the table
+    void churn(size_t count) {
+        size_t step = table_.size() / (count ? count : 1);
+        for (size_t i = 0; i < count; ++i) {
+            table_[i * step].object = next_object_++;
+        }
+    }
+
+    bool snapshot(std::vector<lsofwin::RawHandle>& table) override {
+        table = table_;
+        return true;
+    }
+
+    uint64_t process_start_time(uint32_t pid) override {
+        return 1000 + pid;
+    }
+
+    lsofwin::ProcessInfo process_info(uint32_t pid) override {
+        ++process_lookups;
+        spin_ns(2000);
+        return lsofwin::ProcessInfo{ "process" + std::to_string(pid) + ".exe", "HOST\\user" };
+    }
+
+    bool resolve(const lsofwin::RawHandle& entry, size_t, uint32_t,
+        lsofwin::ResolvedHandle& out) override {
+        ++resolves;
+        spin_ns(1000);
+        out.type = "File";
+        out.name = "C:\\Users\\user\\AppData\\Local\\Temp\\obj" + std::to_string(entry.object) + ".tmp";
+        return true;
+    }
+
+    uint64_t resolves = 0;
+    uint64_t process_lookups = 0;
+
+private:
+    std::vector<lsofwin::RawHandle> table_;
+    uintptr_t next_object_ = 0x100000000ull;
+};
+
+void report(const char* name, size_t handles, double ms, const SyntheticSource& src,
+    uint64_t resolves_before, size_t events) {
+    print_result(name, handles, ms);
+    std::printf("    resolve calls %llu, events %zu\n",
+        static_cast<unsigned long long>(src.resolves - resolves_before), events);
+}
+
+} // anonymous namespace
+
+int main(int argc, char* argv[]) {
+    size_t count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+    SyntheticSource src(count);
+    lsofwin::FilterOptions opts;
+
+    print_header("one poll");
+    {
+        std::vector<lsofwin::RawHandle> table;
+        Timer timer;
+        src.snapshot(table);
+        print_result("snapshot only", count, timer.elapsed_ms());
+    }
+    {
+        uint64_t before = src.resolves;
+        Timer timer;
+        auto rows = lsofwin::enumerate_handles(src, opts);
+        report("full enumerate_handles()", count, timer.elapsed_ms(), src, before, rows.size());
+    }
+
+    lsofwin::HandleWatcher watcher(src, opts);
+    std::vector<lsofwin::HandleEvent> events;
+    {
+        uint64_t before = src.resolves;
+        Timer timer;
+        watcher.poll(events);
+        report("watcher: first poll", count, timer.elapsed_ms(), src, before, events.size());
+    }
+    for (int i = 0; i < 3; ++i) {
+        events.clear();
+        uint64_t before = src.resolves;
+        Timer timer;
+        watcher.poll(events);
+        report("watcher: steady state, no change", count, timer.elapsed_ms(), src, before, events.size());
+    }
+    for (size_t churn : { 100, 1000 }) {
+        src.churn(churn);
+        events.clear();
+        uint64_t before = src.resolves;
+        Timer timer;
+        watcher.poll(events);
+        std::string name = "watcher: " + std::to_string(churn) + " handles replaced";
+        report(name.c_str(), count, timer.elapsed_ms(), src, before, events.size());
+    }
+    return 0;
+}
@@ -0,0 +1,128 @@
+// --record / --replay on a synthetic 1M-handle source: the cost of recording
+// a scan, the size of the file, and full and filtered scans replayed from the
+// mapped file. resolve() and process_info() carry a small fixed cost to stand
+// in for DuplicateHandle / NtQueryObject / OpenProcess; replay pays none of it.
+
+#include "bench_util.h"
+#include "handle_enumerator.h"
+#include "handle_recording.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+using namespace lsofwin_bench;
+
+namespace {
+
+void spin_ns(uint64_t ns) {
+    Timer t;
+    while (t.elapsed_ms() * 1e6 < static_cast<double>(ns)) {}
+}
+
+class SyntheticSource : public lsofwin::HandleSource {
+public:
+    explicit SyntheticSource(size_t handles) {
+        for (size_t i = 0; i < handles; ++i) {
+            lsofwin::RawHandle raw;
+            raw.pid = static_cast<uint32_t>(4 + (i / 400) * 4);
+            raw.handle_value = 4 + (i % 400) * 4;
+            raw.object = 0x10000 + (i % 250000) * 16;   // Objects shared by four processes
+            raw.type_index = static_cast<uint16_t>(i % 8 == 0 ? 2 : 1);
+            table_.push_back(raw);
+        }
+    }
+
+    bool snapshot(std::vector<lsofwin::RawHandle>& table) override {
+        table = table_;
+        return true;
+    }
+
+    std::vector<std::string> type_names() override { return { "", "File", "Key" }; }
+
+    lsofwin::ProcessInfo process_info(uint32_t pid) override {
+        spin_ns(2000);
+        return lsofwin::ProcessInfo{ "process" + std::to_string(pid) + ".exe", "HOST\\user" };
+    }
+
+    bool resolve(const lsofwin::RawHandle& entry, size_t, uint32_t,
+        lsofwin::ResolvedHandle& out) override {
+        spin_ns(1000);
+        out.type = entry.type_index == 2 ? "Key" : "File";
+        out.name = "C:\\Users\\user\\AppData\\Local\\Temp\\obj" + std::to_string(entry.object) + ".tmp";
+        return true;
+    }
+
+private:
+    std::vector<lsofwin::RawHandle> table_;
+};
+
+void time_replay(lsofwin::ReplayHandleSource& replay, const char* name, const lsofwin::FilterOptions& opts) {
+    size_t rows = 0;
+    Timer timer;
+    lsofwin::stream_handles(replay, opts, [&](const lsofwin::HandleInfo& h) {
+        do_not_optimize(h.object_name.data());
+        ++rows;
+    });
+    print_result(name, replay.handle_count(), timer.elapsed_ms());
+    std::printf("    %zu rows\n", rows);
+}
+
+} // anonymous namespace
+
+int main(int argc, char* argv[]) {
+    size_t count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+    const std::string path = "bench_replay.rec";
+    SyntheticSource src(count);
+    lsofwin::FilterOptions opts;
+
+    print_header("record");
+    {
+        Timer timer;
+        lsofwin::enumerate_handles(src, opts);
+        print_result("scan without --record", count, timer.elapsed_ms());
+    }
+    {
+        std::FILE* file = std::fopen(path.c_str(), "wb");
+        if (!file) return 1;
+        Timer timer;
+        lsofwin::RecordingHandleSource recorder(src);
+        lsofwin::enumerate_handles(recorder, opts);
+        {
+            lsofwin::OutputBuffer out(lsofwin::file_writer(file));
+            recorder.write(out);
+        }
+        std::fclose(file);
+        print_result("scan with --record", count, timer.elapsed_ms());
+    }
+
+    lsofwin::MappedFile mapped;
+    lsofwin::ReplayHandleSource replay;
+    std::string error;
+    if (!mapped.open(path, error) || !replay.open(mapped.data(), mapped.size(), error)) {
+        std::fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+    std::printf("    %zu bytes, %.1f bytes/handle\n", mapped.size(),
+        static_cast<double>(mapped.size()) / static_cast<double>(count));
+
+    print_header("replay");
+    time_replay(replay, "no filter", opts);
+    lsofwin::FilterOptions threads;
+    threads.threads = 0;
+    time_replay(replay, "no filter, -J 0", threads);
+    lsofwin::FilterOptions by_pid;
+    by_pid.filter_pids = { 4000 };
+    time_replay(replay, "-p 4000", by_pid);
+    lsofwin::FilterOptions by_type;
+    by_type.filter_types = { "Key" };
+    time_replay(replay, "-T Key", by_type);
+    lsofwin::FilterOptions by_name;
+    by_name.filter_file_regexes = { "obj1234[0-9]*\\.tmp$" };
+    time_replay(replay, "-f \"obj1234[0-9]*\\.tmp$\"", by_name);
+
+    std::printf("\npeak RSS %llu KiB\n", static_cast<unsigned long long>(peak_rss_kb()));
+    std::remove(path.c_str());
+    return 0;
+}
@@ -0,0 +1,480 @@
+// Component benchmark suite over a deterministic synthetic system (10k
+// processes, 1M handles by default; see workload.h). Each case reports
+// time per operation, heap allocations (global operator new is replaced),
+// bytes allocated, and the peak resident set while it ran, also as growth
+// over the resident set it started with where the peak can be reset (Linux).
+//
+//   bench_suite [--processes N] [--handles N] [--seed N] [--only TEXT]
+//               [--json FILE] [--compare BASELINE.json]
+//
+// --json writes one result per line, so results from two versions can be
+// diffed directly; --compare prints the change against such a file.
+
+#include "bench_util.h"
+#include "workload.h"
+
+#include "binary_output.h"
+#include "cli_parser.h"
+#include "handle_enumerator.h"
+#include "json_escape.h"
+#include "metrics_exporter.h"
+#include "output_formatter.h"
+#include "output_sink.h"
+#include "path_matcher.h"
+#include "path_trie.h"
+#include "scan_stats.h"
+#include "string_search.h"
+#include "type_filter.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <new>
+#include <string>
+#include <vector>
+
+using namespace lsofwin_bench;
+
+namespace {
+
+std::atomic<uint64_t> g_allocations{ 0 };
+std::atomic<uint64_t> g_allocated_bytes{ 0 };
+
+} // anonymous namespace
+
+void* operator new(size_t size) {
+    void* p = std::malloc(size ? size : 1);
+    if (!p) throw std::bad_alloc();
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    g_allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+    return p;
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    std::free(p);
+}
+
+namespace {
+
+struct Result {
+    std::string component;
+    std::string name;
+    uint64_t ops = 0;
+    double total_ms = 0;
+    uint64_t allocations = 0;
+    uint64_t allocated_bytes = 0;
+    uint64_t peak_rss_kb = 0;
+    uint64_t peak_growth_kb = 0;    // Above the resident set when the case started
+
+    double ns_per_op() const { return ops ? total_ms * 1e6 / static_cast<double>(ops) : 0.0; }
+};
+
+class Suite {
+public:
+    explicit Suite(std::string only) : only_(std::move(only)) {}
+
+    // Time fn(), which performs `ops` operations, as one case.
+    void run(const char* component, const std::string& name, uint64_t ops, const std::function<void()>& fn) {
+        if (!only_.empty() && (std::string(component) + "/" + name).find(only_) == std::string::npos) return;
+
+        uint64_t start_rss = reset_peak_rss() ? peak_rss_kb() : 0;
+        uint64_t allocations = g_allocations.load();
+        uint64_t bytes = g_allocated_bytes.load();
+        Timer timer;
+        fn();
+        Result r;
+        r.total_ms = timer.elapsed_ms();
+        r.component = component;
+        r.name = name;
+        r.ops = ops;
+        r.allocations = g_allocations.load() - allocations;
+        r.allocated_bytes = g_allocated_bytes.load() - bytes;
+        r.peak_rss_kb = peak_rss_kb();
+        r.peak_growth_kb = start_rss && r.peak_rss_kb > start_rss ? r.peak_rss_kb - start_rss : 0;
+
+        if (component != last_component_) {
+            std::printf("\n== %s ==\n%-44s %10s %10s %10s %11s %10s %9s %9s\n", component, "case", "ops",
+                "total_ms", "ns/op", "allocs/op", "alloc_MiB", "peak_MiB", "+peak");
+            last_component_ = component;
+        }
+        std::printf("%-44s %10llu %10.2f %10.1f %11.2f %10.1f %9.1f %9.1f\n", name.c_str(),
+            static_cast<unsigned long long>(r.ops), r.total_ms, r.ns_per_op(),
+            r.ops ? static_cast<double>(r.allocations) / static_cast<double>(r.ops) : 0.0,
+            static_cast<double>(r.allocated_bytes) / (1024.0 * 1024.0),
+            static_cast<double>(r.peak_rss_kb) / 1024.0, static_cast<double>(r.peak_growth_kb) / 1024.0);
+        std::fflush(stdout);
+        results_.push_back(std::move(r));
+    }
+
+    const std::vector<Result>& results() const { return results_; }
+
+private:
+    std::string only_;
+    std::string last_component_;
+    std::vector<Result> results_;
+};
+
+std::string json_string(std::string_view s) {
+    std::string out = "\"";
+    lsofwin::append_json_escaped(out, s);
+    return out + "\"";
+}
+
+void write_json(const std::string& path, const WorkloadOptions& w, const std::vector<Result>& results) {
+    std::ofstream out(path, std::ios::binary);
+    out << "{\n  \"schema\": 1,\n"
+        << "  \"workload\": {\"processes\": " << w.processes << ", \"handles\": " << w.handles
+        << ", \"seed\": " << w.seed << "},\n  \"results\": [\n";
+    char num[64];
+    for (size_t i = 0; i < results.size(); ++i) {
+        const auto& r = results[i];
+        out << "    {\"component\": " << json_string(r.component) << ", \"name\": " << json_string(r.name)
+            << ", \"ops\": " << r.ops;
+        std::snprintf(num, sizeof(num), "%.3f", r.total_ms);
+        out << ", \"total_ms\": " << num;
+        std::snprintf(num, sizeof(num), "%.2f", r.ns_per_op());
+        out << ", \"ns_per_op\": " << num << ", \"allocations\": " << r.allocations
+            << ", \"allocated_bytes\": " << r.allocated_bytes << ", \"peak_rss_kb\": " << r.peak_rss_kb
+            << ", \"peak_growth_kb\": " << r.peak_growth_kb << "}"
+            << (i + 1 < results.size() ? ",\n" : "\n");
+    }
+    out << "  ]\n}\n";
+}
+
+// Value of "key": in one line written by write_json(); strings are unescaped.
+std::string json_field(const std::string& line, const char* key) {
+    std::string tag = std::string("\"") + key + "\": ";
+    size_t at = line.find(tag);
+    if (at == std::string::npos) return {};
+    at += tag.size();
+    std::string value;
+    if (line[at] != '"') {
+        while (at < line.size() && line[at] != ',' && line[at] != '}') value += line[at++];
+        return value;
+    }
+    for (++at; at < line.size() && line[at] != '"'; ++at) {
+        if (line[at] == '\\' && at + 1 < line.size()) ++at;
+        value += line[at];
+    }
+    return value;
+}
+
+bool compare(const std::string& path, const std::vector<Result>& results) {
+    std::ifstream in(path);
+    if (!in) {
+        std::fprintf(stderr, "Cannot open %s\n", path.c_str());
+        return false;
+    }
+    std::map<std::string, std::pair<double, double>> baseline; // ns/op, allocs/op
+    for (std::string line; std::getline(in, line);) {
+        if (line.find("\"component\"") == std::string::npos) continue;
+        double ops = std::atof(json_field(line, "ops").c_str());
+        baseline[json_field(line, "component") + "/" + json_field(line, "name")] = {
+            std::atof(json_field(line, "ns_per_op").c_str()),
+            ops > 0 ? std::atof(json_field(line, "allocations").c_str()) / ops : 0.0 };
+    }
+
+    std::printf("\n== compared with %s ==\n%-56s %10s %10s %8s %10s %10s\n", path.c_str(), "case",
+        "old ns/op", "new ns/op", "change", "old al/op", "new al/op");
+    for (const auto& r : results) {
+        std::string key = r.component + "/" + r.name;
+        auto it = baseline.find(key);
+        if (it == baseline.end()) {
+            std::printf("%-56s %10s %10.1f %8s\n", key.c_str(), "-", r.ns_per_op(), "new");
+            continue;
+        }
+        double old_ns = it->second.first;
+        double change = old_ns > 0 ? (r.ns_per_op() - old_ns) * 100.0 / old_ns : 0.0;
+        std::printf("%-56s %10.1f %10.1f %+7.1f%% %10.2f %10.2f\n", key.c_str(), old_ns, r.ns_per_op(), change,
+            it->second.second, r.ops ? static_cast<double>(r.allocations) / static_cast<double>(r.ops) : 0.0);
+    }
+    return true;
+}
+
+// An OutputBuffer target that only counts, so sink cases measure formatting.
+lsofwin::OutputBuffer::FlushFn discard(uint64_t& bytes) {
+    return [&bytes](const char*, size_t size) { bytes += size; };
+}
+
+void bench_cli(Suite& suite) {
+    static const std::vector<std::vector<const char*>> command_lines = {
+        { "lsofwin" },
+        { "lsofwin", "-p", "1234", "-j" },
+        { "lsofwin", "-c", "chrome", "-T", "File,Key", "-J", "0" },
+        { "lsofwin", "-f", "myfile\\.docx" },
+        { "lsofwin", "-f", "\\.(log|txt)$", "--ndjson" },
+        { "lsofwin", "+D", "C:\\Users\\alice", "-t", "2" },
+    };
+    const size_t rounds = 20000;
+    suite.run("cli", "parse_args, 6 typical command lines", rounds * command_lines.size(), [&] {
+        lsofwin::FilterOptions opts;
+        std::string error;
+        for (size_t i = 0; i < rounds; ++i) {
+            for (const auto& argv : command_lines) {
+                lsofwin::parse_args(static_cast<int>(argv.size()), argv.data(), opts, error);
+                do_not_optimize(opts.filter_pids.size());
+            }
+        }
+    });
+}
+
+void bench_filters(Suite& suite, const Workload& w, const lsofwin::HandleList& rows) {
+    const uint64_t n = rows.size();
+    struct Pattern {
+        const char* label;
+        const char* regex;
+        size_t limit;   // std::regex fallbacks only see a prefix of the rows
+    };
+    static const Pattern patterns[] = {
+        { "-f literal \"notes\"", "notes", 0 },
+        { "-f suffix \"\\.dll$\"", "\\.dll$", 0 },
+        { "-f prefix \"^C:\\\\Users\\\\\"", "^C:\\\\Users\\\\", 0 },
+        { "-f DFA \"\\.(log|tmp|json)$\"", "\\.(log|tmp|json)$", 0 },
+        { "-f DFA \"table_[0-9]+\\.mdf\"", "table_[0-9]+\\.mdf", 0 },
+        { "-f std::regex \"(db)\\d+\\\\\\1\" (100k rows)", "(db)\\d+\\\\\\1", 100000 },
+    };
+    for (const auto& p : patterns) {
+        lsofwin::PathMatcher matcher(p.regex);
+        size_t limit = p.limit ? (std::min<size_t>)(p.limit, rows.size()) : rows.size();
+        std::string name = std::string(p.label) + " [" + lsofwin::PathMatcher::strategy_name(matcher.strategy()) + "]";
+        suite.run("filter", name, limit, [&] {
+            size_t matched = 0;
+            for (size_t i = 0; i < limit; ++i) matched += matcher.matches(rows[i].object_name);
+            do_not_optimize(matched);
+        });
+    }
+
+    lsofwin::TypeFilter types({ "File", "Key" }, w.type_names());
+    suite.run("filter", "-T File,Key on raw type index", n, [&] {
+        size_t matched = 0;
+        for (const auto& h : w.handles()) matched += types.check(h.raw.type_index) == lsofwin::TypeFilter::Decision::Match;
+        do_not_optimize(matched);
+    });
+
+    suite.run("filter", "-c chrome on process names", n, [&] {
+        size_t matched = 0;
+        for (const auto& h : rows) matched += lsofwin::contains_icase(h.process_name, "chrome");
+        do_not_optimize(matched);
+    });
+
+    lsofwin::DirectoryFilter dir("C:\\Users\\alice\\AppData", true);
+    suite.run("filter", "+D C:\\Users\\alice\\AppData", n, [&] {
+        size_t matched = 0;
+        for (const auto& h : rows) matched += dir.matches(h.object_name);
+        do_not_optimize(matched);
+    });
+}
+
+void bench_normalize(Suite& suite, const Workload& w) {
+    lsofwin::DevicePathMap map;
+    w.add_device_rules(map);
+    std::vector<std::string> names;
+    names.reserve(w.handles().size());
+    for (const auto& h : w.handles()) names.push_back(h.nt_name);
+    suite.run("normalize", "DevicePathMap::normalize, NT names", names.size(), [&] {
+        size_t rewritten = 0;
+        for (auto& name : names) rewritten += map.normalize(name);
+        do_not_optimize(rewritten);
+    });
+}
+
+void bench_format(Suite& suite, const lsofwin::HandleList& rows) {
+    const uint64_t n = rows.size();
+    suite.run("format", "format_table", n, [&] { do_not_optimize(lsofwin::format_table(rows).size()); });
+    suite.run("format", "format_json", n, [&] { do_not_optimize(lsofwin::format_json(rows).size()); });
+    suite.run("format", "format_ndjson", n, [&] { do_not_optimize(lsofwin::format_ndjson(rows).size()); });
+    suite.run("format", "format_binary", n, [&] { do_not_optimize(lsofwin::format_binary(rows).size()); });
+
+    for (const char* kind : { "table", "ndjson" }) {
+        lsofwin::FilterOptions opts;
+        opts.output_ndjson = std::strcmp(kind, "ndjson") == 0;
+        suite.run("format", std::string("streaming ") + kind + " sink, discarded", n, [&] {
+            uint64_t bytes = 0;
+            lsofwin::OutputBuffer out(discard(bytes));
+            auto sink = lsofwin::make_output_sink(out, opts);
+            for (const auto& h : rows) sink->write(h);
+            sink->finish();
+            do_not_optimize(bytes);
+        });
+    }
+
+    suite.run("json_escape", "append_json_escaped, object names", n, [&] {
+        std::string out;
+        out.reserve(1 << 20);
+        for (const auto& h : rows) {
+            if (out.size() > (1 << 20) - 4096) out.clear();
+            lsofwin::append_json_escaped(out, h.object_name);
+        }
+        do_not_optimize(out.size());
+    });
+}
+
+void bench_scan(Suite& suite, const Workload& w) {
+    const uint64_t n = w.handles().size();
+    WorkloadSource source(w);
+
+    lsofwin::FilterOptions all;
+    suite.run("scan", "enumerate_handles, no filter", n, [&] {
+        do_not_optimize(lsofwin::enumerate_handles(source, all).size());
+    });
+    suite.run("scan", "enumerate_handles, no filter, --stats", n, [&] {
+        lsofwin::ScanStats stats;
+        do_not_optimize(lsofwin::enumerate_handles(source, all, nullptr, &stats).size());
+    });
+    suite.run("scan", "enumerate_handle_table, no filter", n, [&] {
+        do_not_optimize(lsofwin::enumerate_handle_table(source, all).size());
+    });
+
+    lsofwin::FilterOptions files;
+    files.filter_types = { "File" };
+    suite.run("scan", "enumerate_handles, -T File", n, [&] {
+        do_not_optimize(lsofwin::enumerate_handles(source, files).size());
+    });
+
+    lsofwin::FilterOptions by_pid;
+    by_pid.filter_pids = { w.processes()[w.processes().size() / 2].pid };
+    suite.run("scan", "enumerate_handles, -p <one process>", n, [&] {
+        do_not_optimize(lsofwin::enumerate_handles(source, by_pid).size());
+    });
+
+    // One scan for 20 services against the single-process scan above
+    lsofwin::FilterOptions by_pids, by_names;
+    for (size_t i = 0; i < 20; ++i) {
+        const auto& proc = w.processes()[(i * 7919) % w.processes().size()];
+        by_pids.filter_pids.push_back(proc.pid);
+        by_names.filter_process_names.push_back(proc.name);
+    }
+    suite.run("scan", "enumerate_handles, -p <20 processes>", n, [&] {
+        do_not_optimize(lsofwin::enumerate_handles(source, by_pids).size());
+    });
+    suite.run("scan", "enumerate_handles, -c <20 names>", n, [&] {
+        do_not_optimize(lsofwin::enumerate_handles(source, by_names).size());
+    });
+    lsofwin::FilterOptions any = by_pids;
+    any.filter_any = true;
+    any.filter_file_regexes = { "\\.mdf$" };
+    suite.run("scan", "enumerate_handles, --or -p <20> -f \\.mdf$", n, [&] {
+        do_not_optimize(lsofwin::enumerate_handles(source, any).size());
+    });
+
+    // --summary against listing every row and counting afterwards
+    lsofwin::FilterOptions by_process_type;
+    by_process_type.group_by = { lsofwin::GroupKey::Pid, lsofwin::GroupKey::Type };
+    suite.run("scan", "enumerate_handles, then count pid,type", n, [&] {
+        std::map<std::pair<uint32_t, std::string>, uint64_t> groups;
+        for (const auto& h : lsofwin::enumerate_handles(source, all)) ++groups[{ h.pid, h.handle_type }];
+        do_not_optimize(groups.size());
+    });
+    suite.run("scan", "summarize_handles, --group-by pid,type", n, [&] {
+        do_not_optimize(lsofwin::summarize_handles(source, by_process_type).groups);
+    });
+    lsofwin::FilterOptions by_user;
+    by_user.group_by = { lsofwin::GroupKey::User };
+    by_user.summary_top = 10;
+    suite.run("scan", "summarize_handles, --group-by user --top 10", n, [&] {
+        do_not_optimize(lsofwin::summarize_handles(source, by_user).groups);
+    });
+    lsofwin::FilterOptions by_process_type_files = by_process_type;
+    by_process_type_files.filter_file_regexes = { "\\.dll$" };
+    suite.run("scan", "summarize_handles, --summary -f \\.dll$", n, [&] {
+        do_not_optimize(lsofwin::summarize_handles(source, by_process_type_files).groups);
+    });
+
+    // --metrics: one sample (process names cached after the first) and its textfile
+    lsofwin::MetricsExporter exporter(source, all);
+    auto sampled = std::chrono::system_clock::now();
+    suite.run("scan", "MetricsExporter sample + write", n, [&] {
+        sampled += std::chrono::seconds(60);
+        exporter.sample(sampled);
+        uint64_t bytes = 0;
+        lsofwin::OutputBuffer out(discard(bytes));
+        exporter.write(out);
+        do_not_optimize(bytes);
+    });
+
+    lsofwin::FilterOptions ndjson;
+    ndjson.output_ndjson = true;
+    suite.run("scan", "stream_handles into ndjson sink", n, [&] {
+        uint64_t bytes = 0;
+        lsofwin::OutputBuffer out(discard(bytes));
+        auto sink = lsofwin::make_output_sink(out, ndjson);
+        lsofwin::stream_handles(source, ndjson, [&](const lsofwin::HandleInfo& h) { sink->write(h); });
+        sink->finish();
+        do_not_optimize(bytes);
+    });
+
+    // -o without name or user: rows straight from the table, no lookups
+    lsofwin::FilterOptions projected = ndjson;
+    projected.fields = { lsofwin::OutputField::Pid, lsofwin::OutputField::Fd, lsofwin::OutputField::Type };
+    suite.run("scan", "stream_handles into ndjson sink, -o pid,fd,type", n, [&] {
+        uint64_t bytes = 0;
+        lsofwin::OutputBuffer out(discard(bytes));
+        auto sink = lsofwin::make_output_sink(out, projected);
+        lsofwin::stream_handles(source, projected, [&](const lsofwin::HandleInfo& h) { sink->write(h); });
+        sink->finish();
+        do_not_optimize(bytes);
+    });
+}
+
+size_t parse_count(const char* arg, const char* option) {
+    char* end = nullptr;
+    unsigned long long v = std::strtoull(arg, &end, 10);
+    if (end == arg || *end != '\0') {
+        std::fprintf(stderr, "Invalid value for %s: %s\n", option, arg);
+        std::exit(2);
+    }
+    return static_cast<size_t>(v);
+}
+
+} // anonymous namespace
+
+int main(int argc, char* argv[]) {
+    WorkloadOptions wopts;
+    std::string only, json_path, baseline_path;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            std::fprintf(stderr, "Usage: %s [--processes N] [--handles N] [--seed N] [--only TEXT] "
+                "[--json FILE] [--compare BASELINE.json]\n", argv[0]);
+            return 2;
+        }
+        const char* value = argv[++i];
+        if (arg == "--processes") wopts.processes = parse_count(value, "--processes");
+        else if (arg == "--handles") wopts.handles = parse_count(value, "--handles");
+        else if (arg == "--seed") wopts.seed = parse_count(value, "--seed");
+        else if (arg == "--only") only = value;
+        else if (arg == "--json") json_path = value;
+        else if (arg == "--compare") baseline_path = value;
+        else {
+            std::fprintf(stderr, "Unknown option: %s\n", arg.c_str());
+            return 2;
+        }
+    }
+
+    std::printf("workload: %zu processes, %zu handles, seed %llu\n", wopts.processes, wopts.handles,
+        static_cast<unsigned long long>(wopts.seed));
+    Suite suite(only);
+
+    std::unique_ptr<Workload> workload;
+    suite.run("workload", "generate", wopts.handles, [&] { workload = std::make_unique<Workload>(wopts); });
+    if (!workload) workload = std::make_unique<Workload>(wopts);
+    lsofwin::HandleList rows = workload->rows();
+
+    bench_cli(suite);
+    bench_filters(suite, *workload, rows);
+    bench_normalize(suite, *workload);
+    bench_format(suite, rows);
+    bench_scan(suite, *workload);
+
+    if (!json_path.empty()) write_json(json_path, wopts, suite.results());
+    if (!baseline_path.empty() && !compare(baseline_path, suite.results())) return 1;
+    return 0;
+}
@@ -0,0 +1,199 @@
+// Throughput and hang recovery of timed name queries: one thread per query
+// (the original CreateThread/WaitForSingleObject scheme) versus the
+// persistent TimedQueryExecutor. Then a scan over processes holding
+// synchronous pipes that hang, with and without the hang-risk classifier
+// (hang_guard.h), and with --deadline.
+
+#include "bench_util.h"
+#include "handle_enumerator.h"
+#include "timed_query_executor.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdlib>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace lsofwin_bench;
+using std::chrono::milliseconds;
+
+namespace {
+
+// Stand-in for NtQueryObject: a little work, or a block until released.
+struct FakeQuery {
+    std::mutex m;
+    std::condition_variable cv;
+    bool released = false;
+
+    void block() {
+        std::unique_lock<std::mutex> lock(m);
+        cv.wait(lock, [&]() { return released; });
+    }
+    void release_all() {
+        { std::lock_guard<std::mutex> lock(m); released = true; }
+        cv.notify_all();
+    }
+};
+
+uint64_t fake_work(uint64_t seed) {
+    for (int i = 0; i < 64; ++i) seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+    return seed;
+}
+
+// Original scheme: a fresh thread per query, abandoned on timeout.
+bool thread_per_query(const std::shared_ptr<FakeQuery>& fake, bool hang, uint64_t& out,
+    milliseconds timeout) {
+    auto result = std::make_shared<std::promise<uint64_t>>();
+    auto future = result->get_future();
+    std::thread t([fake, hang, result, seed = out]() {
+        if (hang) fake->block();
+        result->set_value(fake_work(seed));
+    });
+    if (future.wait_for(timeout) == std::future_status::timeout) {
+        t.detach();
+        return false;
+    }
+    t.join();
+    out = future.get();
+    return true;
+}
+
+void run_throughput(uint64_t queries) {
+    auto fake = std::make_shared<FakeQuery>();
+
+    {
+        uint64_t v = 1;
+        Timer timer;
+        for (uint64_t i = 0; i < queries; ++i) thread_per_query(fake, false, v, milliseconds(5000));
+        print_result("thread-per-query", queries, timer.elapsed_ms());
+        do_not_optimize(v);
+    }
+    {
+        lsofwin::TimedQueryExecutor exec(1);
+        uint64_t v = 1;
+        Timer timer;
+        for (uint64_t i = 0; i < queries; ++i) {
+            exec.run([&v]() { v = fake_work(v); }, milliseconds(5000));
+        }
+        print_result("persistent executor", queries, timer.elapsed_ms());
+        do_not_optimize(v);
+    }
+}
+
+void run_hang_recovery(uint64_t queries, uint64_t hang_every) {
+    auto fake = std::make_shared<FakeQuery>();
+    const milliseconds timeout(10);
+
+    {
+        uint64_t v = 1, timeouts = 0;
+        Timer timer;
+        for (uint64_t i = 0; i < queries; ++i) {
+            if (!thread_per_query(fake, i % hang_every == 0, v, timeout)) ++timeouts;
+        }
+        print_result("thread-per-query (with hangs)", queries, timer.elapsed_ms());
+        std::printf("    timeouts=%llu\n", static_cast<unsigned long long>(timeouts));
+    }
+    {
+        lsofwin::TimedQueryExecutor exec(1);
+        auto v = std::make_shared<uint64_t>(1);
+        Timer timer;
+        for (uint64_t i = 0; i < queries; ++i) {
+            bool hang = i % hang_every == 0;
+            exec.run([fake, v, hang]() {
+                if (hang) fake->block();
+                *v = fake_work(*v);
+            }, timeout);
+        }
+        print_result("persistent executor (with hangs)", queries, timer.elapsed_ms());
+        auto st = exec.stats();
+        std::printf("    timeouts=%llu workers_started=%llu\n",
+            static_cast<unsigned long long>(st.timed_out),
+            static_cast<unsigned long long>(st.workers_started));
+    }
+    fake->release_all();
+}
+
+// Processes with a few ordinary files and a few synchronous pipes whose
+// name query blocks until the timeout. Naming type index 2 "File" up front
+// turns the classifier on; leaving it unnamed turns it off.
+class PipeHandleSource : public lsofwin::HandleSource {
+public:
+    PipeHandleSource(uint32_t processes, uint32_t pipes, bool classify)
+        : classify_(classify) {
+        for (uint32_t p = 0; p < processes; ++p) {
+            for (uint32_t h = 0; h < 8; ++h) {
+                lsofwin::RawHandle raw;
+                raw.pid = 100 + p * 4;
+                raw.handle_value = 4 + h * 4;
+                raw.type_index = 2;
+                raw.granted_access = h < pipes ? 0x0012019f : 0x00120089;
+                table_.push_back(raw);
+            }
+        }
+    }
+
+    bool snapshot(std::vector<lsofwin::RawHandle>& table) override {
+        table = table_;
+        return true;
+    }
+    std::vector<std::string> type_names() override {
+        return classify_ ? std::vector<std::string>{ "", "", "File" } : std::vector<std::string>{};
+    }
+    lsofwin::ProcessInfo process_info(uint32_t pid) override {
+        return { "svc" + std::to_string(pid) + ".exe", "SYSTEM" };
+    }
+    bool resolve(const lsofwin::RawHandle& entry, size_t index, uint32_t timeout_ms,
+        lsofwin::ResolvedHandle& out) override {
+        out.type = "File";
+        if (entry.granted_access == 0x0012019f) {
+            std::this_thread::sleep_for(milliseconds(timeout_ms));
+            out.timed_out = true;
+            return true;
+        }
+        out.name = "C:\\data\\file" + std::to_string(index) + ".dat";
+        return true;
+    }
+
+private:
+    bool classify_;
+    std::vector<lsofwin::RawHandle> table_;
+};
+
+void run_hang_risk() {
+    const uint32_t processes = 4, pipes = 2;
+    auto scan = [&](const char* label, bool classify, uint32_t deadline_ms) {
+        PipeHandleSource src(processes, pipes, classify);
+        lsofwin::FilterOptions opts;
+        opts.timeout_seconds = 1;
+        opts.deadline_ms = deadline_ms;
+        lsofwin::EnumerationStats stats;
+        Timer timer;
+        auto rows = lsofwin::enumerate_handles(src, opts, &stats);
+        print_result(label, processes * 8, timer.elapsed_ms());
+        std::printf("    rows=%zu resolved=%llu past_deadline=%llu\n", rows.size(),
+            static_cast<unsigned long long>(stats.handles_resolved),
+            static_cast<unsigned long long>(stats.handles_past_deadline));
+    };
+    scan("-t 1, no classifier", false, 0);
+    scan("-t 1, classifier", true, 0);
+    scan("-t 1, no classifier, --deadline 0.5", false, 500);
+}
+
+} // anonymous namespace
+
+int main(int argc, char* argv[]) {
+    uint64_t queries = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 20000;
+
+    print_header("timed query throughput");
+    run_throughput(queries);
+
+    print_header("hang recovery (1 hang per 1000 queries, 10 ms timeout)");
+    run_hang_recovery(queries / 4, 1000);
+
+    print_header("scan: 4 processes x 2 hanging pipes of 8 handles");
+    run_hang_risk();
+    return 0;
+}
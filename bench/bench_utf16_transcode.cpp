@@ -0,0 +1,161 @@
+// UTF-16 -> UTF-8 conversion of kernel object names, as the Windows backend
+// does once per resolved handle: a scalar per-code-point converter run twice
+// (size, then fill into a new string, as with WideCharToMultiByte) followed
+// by the in-place device prefix rewrite, versus the vectorized transcoder and
+// DevicePathMap::normalize() straight from UTF-16 into a reused string.
+// Names come from the synthetic workload, plus all-ASCII and all-CJK sets.
+
+#include "bench_util.h"
+#include "workload.h"
+
+#include "device_path_map.h"
+#include "utf16_transcode.h"
+
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+using namespace lsofwin_bench;
+
+namespace {
+
+// Scalar UTF-8 encoder for one code unit sequence; out == nullptr only counts.
+size_t scalar_utf8(const std::u16string& s, char* out) {
+    size_t n = 0;
+    auto put = [&](uint32_t byte) {
+        if (out) out[n] = static_cast<char>(byte);
+        ++n;
+    };
+    for (size_t i = 0; i < s.size(); ++i) {
+        uint32_t cp = s[i];
+        if (cp >= 0xD800 && cp <= 0xDBFF && i + 1 < s.size() && s[i + 1] >= 0xDC00 && s[i + 1] <= 0xDFFF) {
+            cp = 0x10000 + ((cp - 0xD800) << 10) + (s[i + 1] - 0xDC00);
+            ++i;
+        }
+        else if (cp >= 0xD800 && cp <= 0xDFFF) {
+            cp = 0xFFFD;
+        }
+        if (cp < 0x80) {
+            put(cp);
+        }
+        else if (cp < 0x800) {
+            put(0xC0 | (cp >> 6));
+            put(0x80 | (cp & 0x3F));
+        }
+        else if (cp < 0x10000) {
+            put(0xE0 | (cp >> 12));
+            put(0x80 | ((cp >> 6) & 0x3F));
+            put(0x80 | (cp & 0x3F));
+        }
+        else {
+            put(0xF0 | (cp >> 18));
+            put(0x80 | ((cp >> 12) & 0x3F));
+            put(0x80 | ((cp >> 6) & 0x3F));
+            put(0x80 | (cp & 0x3F));
+        }
+    }
+    return n;
+}
+
+// UTF-8 -> UTF-16 for building the inputs (valid UTF-8 only).
+std::u16string to_utf16(const std::string& s) {
+    std::u16string out;
+    for (size_t i = 0; i < s.size();) {
+        auto c = static_cast<unsigned char>(s[i]);
+        uint32_t cp;
+        size_t len;
+        if (c < 0x80) { cp = c; len = 1; }
+        else if (c < 0xE0) { cp = c & 0x1F; len = 2; }
+        else if (c < 0xF0) { cp = c & 0x0F; len = 3; }
+        else { cp = c & 0x07; len = 4; }
+        for (size_t k = 1; k < len; ++k) cp = (cp << 6) | (static_cast<unsigned char>(s[i + k]) & 0x3F);
+        i += len;
+        if (cp >= 0x10000) {
+            cp -= 0x10000;
+            out += static_cast<char16_t>(0xD800 + (cp >> 10));
+            out += static_cast<char16_t>(0xDC00 + (cp & 0x3FF));
+        }
+        else {
+            out += static_cast<char16_t>(cp);
+        }
+    }
+    return out;
+}
+
+void run_set(const char* title, const std::vector<std::u16string>& names, const lsofwin::DevicePathMap& map) {
+    print_header(title);
+    size_t units = 0;
+    for (const auto& n : names) units += n.size();
+
+    {
+        size_t bytes = 0;
+        Timer timer;
+        for (const auto& n : names) {
+            std::string s(scalar_utf8(n, nullptr), '\0');
+            scalar_utf8(n, &s[0]);
+            map.normalize(s);
+            bytes += s.size();
+        }
+        print_result("scalar two-pass + normalize in place", names.size(), timer.elapsed_ms());
+        do_not_optimize(bytes);
+    }
+    {
+        size_t bytes = 0;
+        Timer timer;
+        for (const auto& n : names) {
+            std::string s;
+            lsofwin::append_utf8(s, n);
+            map.normalize(s);
+            bytes += s.size();
+        }
+        print_result("append_utf8 + normalize in place", names.size(), timer.elapsed_ms());
+        do_not_optimize(bytes);
+    }
+    {
+        size_t bytes = 0;
+        std::string s;
+        Timer timer;
+        for (const auto& n : names) {
+            map.normalize(n, s);
+            bytes += s.size();
+        }
+        print_result("normalize from UTF-16, reused string", names.size(), timer.elapsed_ms());
+        do_not_optimize(bytes);
+    }
+    {
+        std::vector<char> out(3 * units);
+        Timer timer;
+        char* p = out.data();
+        for (const auto& n : names) p = lsofwin::utf16_to_utf8(n, p);
+        double ms = timer.elapsed_ms();
+        print_result("utf16_to_utf8 only", names.size(), ms);
+        std::printf("    %.2f GB/s of UTF-16 input\n", static_cast<double>(units * 2) / (ms * 1e6));
+        do_not_optimize(p);
+    }
+}
+
+} // anonymous namespace
+
+int main(int argc, char* argv[]) {
+    WorkloadOptions opts;
+    opts.handles = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+    Workload workload(opts);
+    lsofwin::DevicePathMap map;
+    workload.add_device_rules(map);
+
+    std::vector<std::u16string> names, ascii, cjk;
+    for (const auto& h : workload.handles()) {
+        if (h.nt_name.empty()) continue;
+        names.push_back(to_utf16(h.nt_name));
+        std::u16string a = names.back(), c = names.back();
+        for (auto& u : a) if (u >= 0x80) u = u'_';
+        for (size_t i = 24; i < c.size(); ++i) if (c[i] != u'\\') c[i] = static_cast<char16_t>(0x4E00 + c[i]);
+        ascii.push_back(std::move(a));
+        cjk.push_back(std::move(c));
+    }
+
+    run_set("workload object names", names, map);
+    run_set("all-ASCII names", ascii, map);
+    run_set("names mostly CJK after the device prefix", cjk, map);
+    return 0;
+}
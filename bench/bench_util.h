@@ -0,0 +1,96 @@
+#pragma once
+
+// Small helpers shared by the microbenchmarks: a monotonic timer, an
+// optimization barrier and a uniform result line.
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+namespace lsofwin_bench {
+
+class Timer {
+public:
+    Timer() : start_(std::chrono::steady_clock::now()) {}
+
+    double elapsed_ms() const {
+        return std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - start_).count();
+    }
+
+private:
+    std::chrono::steady_clock::time_point start_;
+};
+
+// Keep the compiler from discarding a computed value.
+template <typename T>
+inline void do_not_optimize(const T& value) {
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    static volatile const void* sink;
+    sink = &value;
+#endif
+}
+
+inline void print_header(const char* title) {
+    std::printf("\n== %s ==\n", title);
+    std::printf("%-44s %12s %12s %12s\n", "case", "ops", "total_ms", "ns/op");
+}
+
+inline void print_result(const char* name, uint64_t ops, double total_ms) {
+    double ns_per_op = ops ? (total_ms * 1e6) / static_cast<double>(ops) : 0.0;
+    std::printf("%-44s %12llu %12.2f %12.1f\n", name,
+        static_cast<unsigned long long>(ops), total_ms, ns_per_op);
+}
+
+// Peak resident set size of this process so far (or since reset_peak_rss()),
+// in KiB.
+inline uint64_t peak_rss_kb() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS pmc;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc))) return 0;
+    return static_cast<uint64_t>(pmc.PeakWorkingSetSize / 1024);
+#else
+    // VmHWM can be reset; ru_maxrss cannot
+    if (std::FILE* f = std::fopen("/proc/self/status", "r")) {
+        char line[256];
+        unsigned long long kb = 0;
+        bool found = false;
+        while (!found && std::fgets(line, sizeof(line), f)) {
+            found = std::sscanf(line, "VmHWM: %llu kB", &kb) == 1;
+        }
+        std::fclose(f);
+        if (found) return kb;
+    }
+    struct rusage ru;
+    if (getrusage(RUSAGE_SELF, &ru) != 0) return 0;
+    return static_cast<uint64_t>(ru.ru_maxrss); // KiB on Linux
+#endif
+}
+
+// Restart the peak_rss_kb() measurement from the current resident set, so a
+// peak can be attributed to one stage of a run. Linux only (clear_refs);
+// returns false where the peak keeps covering the whole process.
+inline bool reset_peak_rss() {
+#ifdef _WIN32
+    return false;
+#else
+    std::FILE* f = std::fopen("/proc/self/clear_refs", "w");
+    if (!f) return false;
+    bool ok = std::fputs("5", f) >= 0;
+    return std::fclose(f) == 0 && ok;
+#endif
+}
+
+} // namespace lsofwin_bench
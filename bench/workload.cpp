@@ -0,0 +1,401 @@
+#include "workload.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <unordered_map>
+
+namespace lsofwin_bench {
+
+namespace {
+
+// splitmix64: tiny, fast and identical everywhere, unlike the distributions
+// in <random>, whose output is implementation-defined
+class Rng {
+public:
+    explicit Rng(uint64_t seed) : state_(seed) {}
+
+    uint64_t next() {
+        uint64_t z = (state_ += 0x9e3779b97f4a7c15ull);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+        return z ^ (z >> 31);
+    }
+
+    size_t below(size_t n) { return n ? static_cast<size_t>(next() % n) : 0; }
+    bool chance(unsigned percent) { return below(1000) < percent * 10u; }
+
+    template <typename T, size_t N>
+    const T& pick(const T (&items)[N]) { return items[below(N)]; }
+
+private:
+    uint64_t state_;
+};
+
+struct Weighted {
+    const char* item;
+    unsigned weight;
+};
+
+template <size_t N>
+const char* pick_weighted(Rng& rng, const Weighted (&items)[N]) {
+    unsigned total = 0;
+    for (const auto& w : items) total += w.weight;
+    size_t r = rng.below(total);
+    for (const auto& w : items) {
+        if (r < w.weight) return w.item;
+        r -= w.weight;
+    }
+    return items[N - 1].item;
+}
+
+std::string hex(uint64_t v, int digits) {
+    char buf[17];
+    std::snprintf(buf, sizeof(buf), "%0*llx", digits, static_cast<unsigned long long>(v));
+    return std::string(buf, static_cast<size_t>(digits));
+}
+
+// Type name, Windows 10 type index and share of all handles (per mille)
+struct TypeSpec {
+    const char* name;
+    uint16_t index;
+    unsigned weight;
+};
+
+const TypeSpec Types[] = {
+    { "Directory", 3, 20 },   { "Token", 5, 20 },       { "Process", 7, 10 },
+    { "Thread", 8, 50 },      { "IoCompletion", 37, 30 }, { "Event", 16, 150 },
+    { "Mutant", 17, 40 },     { "Semaphore", 19, 40 },  { "File", 40, 340 },
+    { "WaitCompletionPacket", 38, 50 }, { "Section", 42, 50 }, { "Key", 44, 160 },
+    { "ALPC Port", 46, 40 },
+};
+
+const Weighted ProcessNames[] = {
+    { "svchost.exe", 200 }, { "chrome.exe", 90 }, { "msedge.exe", 60 }, { "conhost.exe", 60 },
+    { "RuntimeBroker.exe", 40 }, { "dllhost.exe", 30 }, { "w3wp.exe", 30 }, { "powershell.exe", 30 },
+    { "cmd.exe", 30 }, { "node.exe", 30 }, { "java.exe", 20 }, { "python.exe", 20 },
+    { "Code.exe", 20 }, { "Teams.exe", 20 }, { "sqlservr.exe", 5 }, { "OneDrive.exe", 10 },
+    { "OUTLOOK.EXE", 5 }, { "MsMpEng.exe", 5 }, { "explorer.exe", 5 }, { "WmiPrvSE.exe", 20 },
+    { "SearchIndexer.exe", 5 }, { "spoolsv.exe", 5 }, { "taskhostw.exe", 15 }, { "backup-agent.exe", 5 },
+};
+
+const Weighted Users[] = {
+    { "NT AUTHORITY\\SYSTEM", 40 }, { "NT AUTHORITY\\LOCAL SERVICE", 10 },
+    { "NT AUTHORITY\\NETWORK SERVICE", 10 }, { "CORP\\alice", 10 }, { "CORP\\bob", 8 },
+    { "CORP\\carol", 7 }, { "CORP\\svc_sql", 5 }, { "CORP\\svc_backup", 5 }, { "CORP\\jürgen", 5 },
+};
+
+const char* const SystemDlls[] = {
+    "ntdll.dll", "kernel32.dll", "KernelBase.dll", "user32.dll", "gdi32.dll", "gdi32full.dll",
+    "msvcp_win.dll", "ucrtbase.dll", "advapi32.dll", "msvcrt.dll", "sechost.dll", "rpcrt4.dll",
+    "combase.dll", "ole32.dll", "oleaut32.dll", "shell32.dll", "shlwapi.dll", "ws2_32.dll",
+    "crypt32.dll", "bcrypt.dll", "bcryptprimitives.dll", "wintrust.dll", "imm32.dll", "uxtheme.dll",
+    "dwmapi.dll", "winhttp.dll", "wininet.dll", "iphlpapi.dll", "dnsapi.dll", "nsi.dll",
+    "mswsock.dll", "profapi.dll", "powrprof.dll", "cfgmgr32.dll", "SHCore.dll", "windows.storage.dll",
+    "propsys.dll", "clbcatq.dll", "CoreMessaging.dll", "CoreUIComponents.dll", "TextInputFramework.dll",
+    "d3d11.dll", "dxgi.dll", "dcomp.dll", "twinapi.appcore.dll", "WinTypes.dll", "msctf.dll",
+    "version.dll", "userenv.dll", "netapi32.dll", "secur32.dll", "sspicli.dll", "kerberos.dll",
+    "schannel.dll", "rsaenh.dll", "cryptsp.dll", "ntmarta.dll", "wldp.dll", "amsi.dll",
+    "mpr.dll", "winsta.dll", "wtsapi32.dll", "setupapi.dll", "devobj.dll", "edputil.dll",
+};
+
+const char* const Apps[] = {
+    "Google\\Chrome\\User Data\\Default", "Microsoft\\Edge\\User Data\\Default", "Microsoft\\Teams",
+    "Microsoft\\OneDrive\\logs\\Personal", "Packages\\Microsoft.Windows.Search_cw5n1h2txyewy",
+    "Temp", "npm-cache\\_cacache\\content-v2", "pip\\cache\\http", "JetBrains\\IntelliJIdea2023.2",
+    "Microsoft\\Windows\\Explorer", "Mozilla\\Firefox\\Profiles\\x8k2.default-release",
+};
+
+const char* const AppSubdirs[] = {
+    "Cache\\Cache_Data", "Code Cache\\js", "IndexedDB\\https_app.example.com_0.indexeddb.leveldb",
+    "Local Storage\\leveldb", "Network", "GPUCache", "", "logs", "Service Worker\\CacheStorage",
+};
+
+const char* const Extensions[] = { ".db", ".log", ".tmp", ".ldb", ".json", "", ".dat", ".journal" };
+
+const char* const Vendors[] = {
+    "Microsoft Office\\root\\Office16", "Microsoft SQL Server\\MSSQL15.MSSQLSERVER\\MSSQL\\Binn",
+    "Git\\mingw64\\bin", "nodejs", "Java\\jdk-17\\bin", "Python311\\DLLs", "Contoso\\Backup Agent",
+    "Windows Defender", "Common Files\\microsoft shared\\ClickToRun", "Mozilla Firefox",
+};
+
+const char* const Modules[] = {
+    "mso.dll", "mso20win32client.dll", "sqlmin.dll", "sqllang.dll", "libcurl-4.dll", "node.dll",
+    "jvm.dll", "python311.dll", "_ssl.pyd", "agent-core.dll", "MpClient.dll", "AppVIsvSubsystems64.dll",
+    "xul.dll", "mozglue.dll", "libssl-3-x64.dll", "libcrypto-3-x64.dll",
+};
+
+const char* const RegistryRoots[] = {
+    "\\REGISTRY\\MACHINE\\SOFTWARE\\Microsoft\\Windows NT\\CurrentVersion",
+    "\\REGISTRY\\MACHINE\\SOFTWARE\\Microsoft\\Windows\\CurrentVersion\\Explorer",
+    "\\REGISTRY\\MACHINE\\SYSTEM\\ControlSet001\\Services",
+    "\\REGISTRY\\MACHINE\\SYSTEM\\ControlSet001\\Control\\Nls\\Sorting\\Versions",
+    "\\REGISTRY\\MACHINE\\SOFTWARE\\Classes\\CLSID",
+    "\\REGISTRY\\MACHINE\\SOFTWARE\\Policies\\Microsoft",
+    "\\REGISTRY\\USER\\S-1-5-21-3623811015-3361044348-30300820-1013\\Software\\Microsoft\\Office\\16.0",
+    "\\REGISTRY\\USER\\S-1-5-21-3623811015-3361044348-30300820-1013_Classes\\Local Settings",
+    "\\REGISTRY\\USER\\.DEFAULT\\Control Panel\\International",
+};
+
+const char* const SyncPrefixes[] = {
+    "\\Sessions\\1\\BaseNamedObjects\\", "\\BaseNamedObjects\\", "\\Sessions\\1\\BaseNamedObjects\\Local\\",
+};
+
+const char* const SyncNames[] = {
+    "SM0:", "CTF.AsmListCache.FMPDefault", "MSCTF.Shared.MUTEX.", "windows_shell_global_counters",
+    "__ComCatalogCache__", "ZonesCounterMutex", "Global\\SvcctrlStartEvent_A3752DX", "crashpad_",
+    "DBWinMutex", "MidiMapper_modLongMessage_RefCnt", "WilStaging_02",
+};
+
+const char* const Directories[] = {
+    "\\KnownDlls", "\\Sessions\\1\\BaseNamedObjects", "\\BaseNamedObjects",
+    "\\Sessions\\1\\AppContainerNamedObjects\\S-1-15-2-1861897761-1695161497-2927542615",
+};
+
+const char* const Devices[] = {
+    "\\Device\\ConDrv", "\\Device\\Afd", "\\Device\\KsecDD", "\\Device\\DeviceApi", "\\Device\\CNG",
+    "\\Device\\Nsi", "\\Device\\HarddiskVolume3",
+};
+
+std::string profile_of(const std::string& user, Rng& rng) {
+    size_t slash = user.find('\\');
+    if (user.compare(0, slash, "CORP") == 0) return user.substr(slash + 1);
+    static const char* const profiles[] = { "alice", "bob", "carol", "Public", "Default" };
+    return rng.pick(profiles);
+}
+
+std::string file_name(Rng& rng, const WorkloadProcess& proc, size_t serial) {
+    std::string name;
+    size_t kind = rng.below(1000);
+    if (kind < 20) return name;                         // Unnamed (e.g. the query timed out)
+    if (kind < 370) {
+        name = "\\Device\\HarddiskVolume3\\Windows\\System32\\";
+        if (rng.chance(10)) name += "en-US\\";
+        name += rng.pick(SystemDlls);
+        if (name.find("en-US") != std::string::npos) name += ".mui";
+        return name;
+    }
+    if (kind < 420) {
+        return "\\Device\\HarddiskVolume3\\Windows\\WinSxS\\amd64_microsoft.windows.common-controls_"
+            "6595b64144ccf1df_6.0.19041." + std::to_string(1000 + rng.below(3000)) + "_none_" +
+            hex(rng.next(), 16) + "\\comctl32.dll";
+    }
+    if (kind < 670) {
+        name = "\\Device\\HarddiskVolume3\\Users\\" + profile_of(proc.user, rng) + "\\";
+        if (rng.chance(8)) {
+            // Documents carry the odd quote and non-ASCII character
+            static const char* const docs[] = { "Résumé (final).docx", "Q3 \"draft\" notes.txt",
+                                                "Ångström data.xlsx", "report.pdf", "notes.txt" };
+            return name + "Documents\\" + rng.pick(docs);
+        }
+        name += "AppData\\Local\\";
+        name += rng.pick(Apps);
+        std::string sub = rng.pick(AppSubdirs);
+        if (!sub.empty()) name += "\\" + sub;
+        return name + "\\f_" + hex(serial, 6) + rng.pick(Extensions);
+    }
+    if (kind < 770) {
+        return "\\Device\\HarddiskVolume3\\Program Files\\" + std::string(rng.pick(Vendors)) + "\\" +
+            rng.pick(Modules);
+    }
+    if (kind < 820) {
+        return "\\Device\\HarddiskVolume3\\ProgramData\\Contoso\\Logs\\" + proc.name.substr(0, proc.name.find('.')) +
+            "_2024-0" + std::to_string(1 + rng.below(9)) + "-1" + std::to_string(rng.below(10)) + ".log";
+    }
+    if (kind < 900) {
+        return "\\Device\\HarddiskVolume4\\data\\db" + std::to_string(rng.below(40)) + "\\table_" +
+            std::to_string(rng.below(5000)) + (rng.chance(50) ? ".mdf" : ".ldf");
+    }
+    if (kind < 950) {
+        if (rng.chance(60)) {
+            return "\\Device\\NamedPipe\\mojo." + std::to_string(proc.pid) + "." + std::to_string(rng.below(100000)) +
+                "." + std::to_string(rng.next() % 100000000);
+        }
+        static const char* const pipes[] = { "srvsvc", "lsass", "ntsvcs", "InitShutdown", "PSHost.1339.pwsh",
+                                             "LOCAL\\crashpad_1234_ABCDEF", "wkssvc", "sql\\query" };
+        return "\\Device\\NamedPipe\\" + std::string(rng.pick(pipes));
+    }
+    if (kind < 970) {
+        return "\\Device\\Mup\\fs" + std::to_string(rng.below(4)) + "\\projects\\team" +
+            std::to_string(rng.below(30)) + "\\spec_" + std::to_string(rng.below(2000)) + ".docx";
+    }
+    return rng.pick(Devices);
+}
+
+std::string object_name(Rng& rng, const std::string& type, const WorkloadProcess& proc, size_t serial) {
+    if (type == "File") return file_name(rng, proc, serial);
+    if (type == "Key") {
+        std::string name = rng.pick(RegistryRoots);
+        if (name.find("CLSID") != std::string::npos) {
+            return name + "\\{" + hex(rng.below(5000), 8) + "-0000-0000-C000-000000000046}\\InprocServer32";
+        }
+        if (name.find("Services") != std::string::npos) {
+            return name + "\\" + pick_weighted(rng, ProcessNames) + "\\Parameters";
+        }
+        return name;
+    }
+    if (type == "Event" || type == "Mutant" || type == "Semaphore" || type == "Section") {
+        if (rng.chance(55)) return std::string();
+        return std::string(rng.pick(SyncPrefixes)) + rng.pick(SyncNames) + std::to_string(rng.below(500));
+    }
+    if (type == "ALPC Port") {
+        if (rng.chance(30)) return std::string();
+        return "\\RPC Control\\LRPC-" + hex(rng.next(), 18);
+    }
+    if (type == "Directory") return rng.pick(Directories);
+    return std::string();
+}
+
+} // anonymous namespace
+
+Workload::Workload(const WorkloadOptions& opts) : opts_(opts) {
+    Rng rng(opts.seed);
+
+    uint16_t max_index = 0;
+    for (const auto& t : Types) max_index = (std::max)(max_index, t.index);
+    type_names_.resize(max_index + 1u);
+    for (const auto& t : Types) type_names_[t.index] = t.name;
+
+    // PIDs rise in multiples of 4 with gaps; System (4) comes first
+    const size_t process_count = (std::max<size_t>)(opts.processes, 1);
+    processes_.reserve(process_count);
+    uint32_t pid = 4;
+    for (size_t i = 0; i < process_count; ++i) {
+        WorkloadProcess p;
+        p.pid = pid;
+        p.name = i == 0 ? "System" : pick_weighted(rng, ProcessNames);
+        p.user = i == 0 ? "NT AUTHORITY\\SYSTEM" : pick_weighted(rng, Users);
+        p.start_time = 133000000000000000ull + rng.below(1000000000000ull);
+        processes_.push_back(std::move(p));
+        pid += static_cast<uint32_t>(4 * (1 + rng.below(8)));
+    }
+
+    // Handle counts follow a Zipf-like curve over a random ranking, with
+    // System at the top: a few processes hold most handles
+    std::vector<size_t> rank(process_count);
+    for (size_t i = 0; i < process_count; ++i) rank[i] = i + 1;
+    for (size_t i = process_count - 1; i > 1; --i) std::swap(rank[i], rank[1 + rng.below(i)]);
+    std::vector<double> weight(process_count);
+    double total_weight = 0;
+    for (size_t i = 0; i < process_count; ++i) {
+        weight[i] = 1.0 / std::pow(static_cast<double>(rank[i]), 0.9);
+        total_weight += weight[i];
+    }
+    std::vector<size_t> counts(process_count, 0);
+    size_t assigned = 0;
+    for (size_t i = 0; i < process_count; ++i) {
+        counts[i] = static_cast<size_t>(static_cast<double>(opts.handles) * weight[i] / total_weight);
+        assigned += counts[i];
+    }
+    for (size_t i = 0; assigned < opts.handles; i = (i + 1) % process_count, ++assigned) ++counts[i];
+
+    // Objects with a fixed name (directories, named sections) are shared
+    std::unordered_map<std::string, uintptr_t> shared_objects;
+    uint64_t next_object = 0xffffa00000000000ull;
+    auto new_object = [&] {
+        next_object += 0x60;
+        return static_cast<uintptr_t>(next_object);
+    };
+    unsigned total_type_weight = 0;
+    for (const auto& t : Types) total_type_weight += t.weight;
+
+    lsofwin::DevicePathMap devices;
+    add_device_rules(devices);
+
+    handles_.reserve(opts.handles);
+    owner_.reserve(opts.handles);
+    for (size_t p = 0; p < process_count; ++p) {
+        uintptr_t value = 4;
+        for (size_t h = 0; h < counts[p]; ++h) {
+            size_t r = rng.below(total_type_weight);
+            const TypeSpec* type = &Types[0];
+            for (const auto& t : Types) {
+                if (r < t.weight) {
+                    type = &t;
+                    break;
+                }
+                r -= t.weight;
+            }
+
+            WorkloadHandle wh;
+            wh.raw.pid = processes_[p].pid;
+            wh.raw.handle_value = value;
+            wh.raw.type_index = type->index;
+            wh.raw.granted_access = 0x00120089;
+            wh.nt_name = object_name(rng, type->name, processes_[p], handles_.size());
+
+            if ((type->index == 3 || type->index == 42) && !wh.nt_name.empty()) {
+                uintptr_t& object = shared_objects[wh.nt_name];
+                if (object == 0) object = new_object();
+                wh.raw.object = object;
+            } else {
+                wh.raw.object = new_object();
+            }
+
+            wh.name = wh.nt_name;
+            devices.normalize(wh.name);
+            handles_.push_back(std::move(wh));
+            owner_.push_back(static_cast<uint32_t>(p));
+            value += 4 * (rng.chance(10) ? 2 + rng.below(8) : 1);
+        }
+    }
+}
+
+lsofwin::HandleList Workload::rows() const {
+    lsofwin::HandleList rows;
+    rows.reserve(handles_.size());
+    for (size_t i = 0; i < handles_.size(); ++i) {
+        const auto& h = handles_[i];
+        const auto& p = process_of(i);
+        lsofwin::HandleInfo info;
+        info.pid = p.pid;
+        info.process_name = p.name;
+        info.user = p.user;
+        info.handle_type = type_names_[h.raw.type_index];
+        info.object_name = h.name;
+        info.handle_value = h.raw.handle_value;
+        rows.push_back(std::move(info));
+    }
+    return rows;
+}
+
+void Workload::add_device_rules(lsofwin::DevicePathMap& map) const {
+    map.add_standard_prefixes();
+    map.add("\\Device\\HarddiskVolume3", "C:");
+    map.add("\\Device\\HarddiskVolume4", "D:");
+    map.add("\\Device\\HarddiskVolume1", "C:\\Mount\\Recovery");
+}
+
+bool WorkloadSource::snapshot(std::vector<lsofwin::RawHandle>& table) {
+    const auto& handles = workload_.handles();
+    table.resize(handles.size());
+    for (size_t i = 0; i < handles.size(); ++i) table[i] = handles[i].raw;
+    return true;
+}
+
+const WorkloadProcess* WorkloadSource::find(uint32_t pid) const {
+    const auto& procs = workload_.processes();
+    auto it = std::lower_bound(procs.begin(), procs.end(), pid,
+        [](const WorkloadProcess& p, uint32_t v) { return p.pid < v; });
+    return it != procs.end() && it->pid == pid ? &*it : nullptr;
+}
+
+lsofwin::ProcessInfo WorkloadSource::process_info(uint32_t pid) {
+    const WorkloadProcess* p = find(pid);
+    return p ? lsofwin::ProcessInfo{ p->name, p->user } : lsofwin::ProcessInfo{};
+}
+
+uint64_t WorkloadSource::process_start_time(uint32_t pid) {
+    const WorkloadProcess* p = find(pid);
+    return p ? p->start_time : 0;
+}
+
+bool WorkloadSource::resolve(const lsofwin::RawHandle& entry, size_t index, uint32_t,
+    lsofwin::ResolvedHandle& out) {
+    const auto& h = workload_.handles()[index];
+    out.type = workload_.type_names()[entry.type_index];
+    out.name = h.name;
+    return true;
+}
+
+} // namespace lsofwin_bench
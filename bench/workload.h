@@ -0,0 +1,93 @@
+#pragma once
+
+// Deterministic synthetic system for the benchmarks: processes with a
+// Zipf-like spread of handle counts, Windows-like object type frequencies,
+// and object names drawn from the places real handles point at (System32
+// DLLs, user profiles, Program Files, a data volume, registry keys, named
+// pipes, UNC shares, BaseNamedObjects, RPC ports). The same options and seed
+// always give the same workload, on every platform and compiler.
+
+#include "device_path_map.h"
+#include "handle_info.h"
+#include "handle_source.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace lsofwin_bench {
+
+struct WorkloadOptions {
+    size_t processes = 10000;
+    size_t handles = 1000000;
+    uint64_t seed = 1;
+};
+
+struct WorkloadProcess {
+    uint32_t pid;
+    std::string name;
+    std::string user;
+    uint64_t start_time;
+};
+
+// One handle as a backend would see it: the raw table entry (its type_index
+// names the type in Workload::type_names()), the object name as the kernel
+// reports it (NT device paths, e.g. \Device\HarddiskVolume3\...) and the
+// same name after normalization.
+struct WorkloadHandle {
+    lsofwin::RawHandle raw;
+    std::string nt_name;
+    std::string name;
+};
+
+class Workload {
+public:
+    explicit Workload(const WorkloadOptions& opts);
+
+    const WorkloadOptions& options() const { return opts_; }
+    const std::vector<WorkloadProcess>& processes() const { return processes_; }
+
+    // Table order: grouped by process, processes in ascending PID order.
+    const std::vector<WorkloadHandle>& handles() const { return handles_; }
+
+    // Type names by RawHandle::type_index; unused indices are empty.
+    const std::vector<std::string>& type_names() const { return type_names_; }
+
+    // Process owning handles()[i].
+    const WorkloadProcess& process_of(size_t handle) const { return processes_[owner_[handle]]; }
+
+    // Result rows, as a scan without filters would return them.
+    lsofwin::HandleList rows() const;
+
+    // The device map the generated NT names were built against.
+    void add_device_rules(lsofwin::DevicePathMap& map) const;
+
+private:
+    WorkloadOptions opts_;
+    std::vector<WorkloadProcess> processes_;
+    std::vector<WorkloadHandle> handles_;
+    std::vector<uint32_t> owner_;
+    std::vector<std::string> type_names_;
+};
+
+// A HandleSource serving a Workload with no per-call cost, so a scan measures
+// enumerate_handles() itself. resolve() returns normalized names.
+class WorkloadSource : public lsofwin::HandleSource {
+public:
+    explicit WorkloadSource(const Workload& workload) : workload_(workload) {}
+
+    bool snapshot(std::vector<lsofwin::RawHandle>& table) override;
+    std::vector<std::string> type_names() override { return workload_.type_names(); }
+    lsofwin::ProcessInfo process_info(uint32_t pid) override;
+    uint64_t process_start_time(uint32_t pid) override;
+    bool resolve(const lsofwin::RawHandle& entry, size_t index, uint32_t timeout_ms,
+        lsofwin::ResolvedHandle& out) override;
+
+private:
+    const WorkloadProcess* find(uint32_t pid) const;
+
+    const Workload& workload_;
+};
+
+} // namespace lsofwin_bench
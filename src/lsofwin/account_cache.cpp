@@ -0,0 +1,71 @@
+#include "account_cache.h"
+
+#include <cstdio>
+
+namespace lsofwin {
+
+std::string AccountCache::name(std::string_view account_id) {
+    std::string key(account_id);
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        ++stats_.lookups;
+        for (;;) {
+            auto it = entries_.find(key);
+            if (it == entries_.end()) {
+                entries_.emplace(key, Entry{});
+                break;
+            }
+            if (it->second.ready) return it->second.name;
+            // Another thread is resolving this account right now
+            ready_cv_.wait(lock);
+        }
+        ++stats_.resolved;
+    }
+
+    std::string result = resolver_(account_id);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto& entry = entries_[key];
+        entry.name = result;
+        entry.ready = true;
+    }
+    ready_cv_.notify_all();
+    return result;
+}
+
+AccountCache::Stats AccountCache::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+std::string format_sid(std::string_view sid) {
+    // Revision, sub-authority count, 48-bit big-endian identifier authority,
+    // then the sub-authorities as little-endian 32-bit values
+    if (sid.size() < 8) return "";
+    auto byte = [&](size_t i) { return static_cast<uint64_t>(static_cast<unsigned char>(sid[i])); };
+    size_t count = static_cast<size_t>(byte(1));
+    if (byte(0) != 1 || sid.size() != 8 + 4 * count) return "";
+
+    uint64_t authority = 0;
+    for (size_t i = 2; i < 8; ++i) authority = (authority << 8) | byte(i);
+
+    // Authorities that do not fit 32 bits are shown in hex, as ConvertSidToStringSid does
+    std::string out = "S-1-";
+    if (authority >> 32) {
+        char hex[16];
+        std::snprintf(hex, sizeof(hex), "0x%012llX", static_cast<unsigned long long>(authority));
+        out += hex;
+    }
+    else {
+        out += std::to_string(authority);
+    }
+    for (size_t k = 0; k < count; ++k) {
+        size_t p = 8 + 4 * k;
+        uint64_t sub = byte(p) | (byte(p + 1) << 8) | (byte(p + 2) << 16) | (byte(p + 3) << 24);
+        out += '-';
+        out += std::to_string(sub);
+    }
+    return out;
+}
+
+} // namespace lsofwin
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace lsofwin {
+
+// Account id -> display name cache for process owners. The id is the binary
+// SID on Windows and the uid on Linux (see get_process_account()); thousands
+// of processes run under a handful of accounts, and a name lookup can go to a
+// domain controller and stall, so each distinct account is resolved once.
+// Entries live as long as the cache, i.e. across -r and --serve scans.
+//
+// Thread-safe. The resolver runs without the lock held; while it runs, other
+// threads asking for the same account wait for its result.
+class AccountCache {
+public:
+    using Resolver = std::function<std::string(std::string_view account_id)>;
+
+    struct Stats {
+        uint64_t lookups = 0;
+        uint64_t resolved = 0;  // Resolver calls
+    };
+
+    explicit AccountCache(Resolver resolver) : resolver_(std::move(resolver)) {}
+
+    std::string name(std::string_view account_id);
+
+    Stats stats() const;
+
+private:
+    struct Entry {
+        bool ready = false;
+        std::string name;
+    };
+
+    Resolver resolver_;
+    mutable std::mutex mutex_;
+    std::condition_variable ready_cv_;
+    std::unordered_map<std::string, Entry> entries_;
+    Stats stats_;
+};
+
+// Format a binary SID as "S-1-5-21-...". Returns an empty string if the bytes
+// are not a well-formed SID.
+std::string format_sid(std::string_view sid);
+
+} // namespace lsofwin
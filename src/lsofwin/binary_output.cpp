@@ -0,0 +1,439 @@
+#include "binary_output.h"
+#include "string_pool.h"
+
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace lsofwin {
+
+namespace {
+
+constexpr size_t SectionAlignment = 8;
+
+bool is_row_column(BinarySection s) {
+    return s >= BinarySection::RowProcess;
+}
+
+// Element width of the fixed-layout sections.
+uint32_t fixed_element_size(BinarySection s) {
+    switch (s) {
+    case BinarySection::StringBytes: return 1;
+    case BinarySection::Processes:   return sizeof(BinaryProcess);
+    default:                         return sizeof(uint32_t);
+    }
+}
+
+// Narrowest of 1, 2, 4 or 8 bytes that holds max_value.
+uint32_t column_width(uint64_t max_value) {
+    if (max_value <= 0xff) return 1;
+    if (max_value <= 0xffff) return 2;
+    if (max_value <= 0xffffffffu) return 4;
+    return 8;
+}
+
+// Append n values as `width`-byte little-endian integers.
+template <typename T>
+void append_column(OutputBuffer& out, const T* values, size_t n, uint32_t width) {
+    if (width == sizeof(T)) {
+        out.append(std::string_view(reinterpret_cast<const char*>(values), n * sizeof(T)));
+        return;
+    }
+    char chunk[4096];
+    size_t used = 0;
+    for (size_t i = 0; i < n; ++i) {
+        if (used + width > sizeof(chunk)) {
+            out.append(std::string_view(chunk, used));
+            used = 0;
+        }
+        uint64_t v = values[i];
+        std::memcpy(chunk + used, &v, width); // Low bytes first on little-endian hosts
+        used += width;
+    }
+    out.append(std::string_view(chunk, used));
+}
+
+// Split an object name after its last path separator, so the directory part
+// is shared between every handle open in that directory.
+size_t prefix_length(std::string_view name) {
+    size_t sep = name.find_last_of("\\/");
+    return sep == std::string_view::npos ? 0 : sep + 1;
+}
+
+class BinarySink : public OutputSink {
+public:
+    explicit BinarySink(OutputBuffer& out) : out_(out) {}
+
+    void write(const HandleInfo& h) override {
+        row_process_.push_back(process_id(h));
+        row_type_.push_back(type_id(h.handle_type));
+        row_handle_.push_back(static_cast<uint64_t>(h.handle_value));
+        max_handle_ = (std::max)(max_handle_, row_handle_.back());
+
+        std::string_view name = h.object_name;
+        size_t split = prefix_length(name);
+        row_prefix_.push_back(strings_.intern(name.substr(0, split)));
+        row_name_.push_back(strings_.intern(name.substr(split)));
+    }
+
+    void finish() override {
+        BinaryHeader header{};
+        std::memcpy(header.magic, BinaryMagic, sizeof(BinaryMagic));
+        header.version = BinaryVersion;
+        header.section_count = static_cast<uint32_t>(BinarySectionCount);
+        const size_t rows = row_process_.size();
+        header.row_count = rows;
+
+        const size_t counts[BinarySectionCount] = {
+            strings_.offsets().size(), strings_.bytes().size(), processes_.size(), types_.size(),
+            rows, rows, rows, rows, rows,
+        };
+        uint32_t widths[BinarySectionCount] = {};
+        for (size_t i = 0; i < BinarySectionCount; ++i) {
+            auto s = static_cast<BinarySection>(i);
+            widths[i] = is_row_column(s) ? column_width(max_value(s)) : fixed_element_size(s);
+        }
+
+        // Lay the sections out back to back after the header
+        uint64_t offset = sizeof(BinaryHeader);
+        for (size_t i = 0; i < BinarySectionCount; ++i) {
+            offset = (offset + SectionAlignment - 1) / SectionAlignment * SectionAlignment;
+            header.sections[i].offset = offset;
+            header.sections[i].count = counts[i];
+            header.sections[i].width = widths[i];
+            offset += counts[i] * widths[i];
+        }
+
+        out_.append(std::string_view(reinterpret_cast<const char*>(&header), sizeof(header)));
+        uint64_t written = sizeof(BinaryHeader);
+        auto pad_to = [&](BinarySection s) {
+            const auto& entry = header.sections[static_cast<size_t>(s)];
+            out_.append_fill('\0', static_cast<size_t>(entry.offset - written));
+            written = entry.offset + entry.count * entry.width;
+            return entry.width;
+        };
+
+        pad_to(BinarySection::StringOffsets);
+        append_column(out_, strings_.offsets().data(), strings_.offsets().size(), sizeof(uint32_t));
+        pad_to(BinarySection::StringBytes);
+        out_.append(strings_.bytes());
+        pad_to(BinarySection::Processes);
+        out_.append(std::string_view(reinterpret_cast<const char*>(processes_.data()),
+            processes_.size() * sizeof(BinaryProcess)));
+        pad_to(BinarySection::Types);
+        append_column(out_, types_.data(), types_.size(), sizeof(uint32_t));
+        append_column(out_, row_process_.data(), rows, pad_to(BinarySection::RowProcess));
+        append_column(out_, row_type_.data(), rows, pad_to(BinarySection::RowType));
+        append_column(out_, row_handle_.data(), rows, pad_to(BinarySection::RowHandle));
+        append_column(out_, row_prefix_.data(), rows, pad_to(BinarySection::RowPrefix));
+        append_column(out_, row_name_.data(), rows, pad_to(BinarySection::RowName));
+        out_.flush();
+    }
+
+private:
+    uint64_t max_value(BinarySection s) const {
+        switch (s) {
+        case BinarySection::RowProcess: return processes_.empty() ? 0 : processes_.size() - 1;
+        case BinarySection::RowType:    return types_.empty() ? 0 : types_.size() - 1;
+        case BinarySection::RowHandle:  return max_handle_;
+        default:                        return strings_.size() - 1; // Prefix and name ids
+        }
+    }
+
+    uint32_t process_id(const HandleInfo& h) {
+        // Rows arrive grouped by process, so the last lookup usually hits
+        if (!processes_.empty() && processes_[last_process_].pid == h.pid &&
+            process_matches(processes_[last_process_], h)) {
+            return last_process_;
+        }
+
+        auto it = process_ids_.find(h.pid);
+        if (it == process_ids_.end() || !process_matches(processes_[it->second], h)) {
+            BinaryProcess p{ h.pid, strings_.intern(h.process_name), strings_.intern(h.user) };
+            uint32_t id = static_cast<uint32_t>(processes_.size());
+            processes_.push_back(p);
+            it = process_ids_.insert_or_assign(h.pid, id).first;
+        }
+        last_process_ = it->second;
+        return last_process_;
+    }
+
+    bool process_matches(const BinaryProcess& p, const HandleInfo& h) const {
+        return strings_.view(p.name) == h.process_name && strings_.view(p.user) == h.user;
+    }
+
+    uint32_t type_id(const std::string& type) {
+        auto it = type_ids_.find(type);
+        if (it != type_ids_.end()) return it->second;
+        uint32_t id = static_cast<uint32_t>(types_.size());
+        types_.push_back(strings_.intern(type));
+        type_ids_.emplace(type, id);
+        return id;
+    }
+
+    OutputBuffer& out_;
+    StringPool strings_;
+    std::vector<BinaryProcess> processes_;
+    std::unordered_map<uint32_t, uint32_t> process_ids_;
+    uint32_t last_process_ = 0;
+    std::vector<uint32_t> types_;
+    std::unordered_map<std::string, uint32_t> type_ids_;
+
+    std::vector<uint32_t> row_process_;
+    std::vector<uint32_t> row_type_;
+    std::vector<uint64_t> row_handle_;
+    uint64_t max_handle_ = 0;
+    std::vector<uint32_t> row_prefix_;
+    std::vector<uint32_t> row_name_;
+};
+
+} // anonymous namespace
+
+std::unique_ptr<OutputSink> make_binary_sink(OutputBuffer& out) {
+    return std::make_unique<BinarySink>(out);
+}
+
+std::string format_binary(const HandleList& handles) {
+    std::string result;
+    {
+        OutputBuffer out(string_writer(result));
+        auto sink = make_binary_sink(out);
+        for (const auto& h : handles) sink->write(h);
+        sink->finish();
+    }
+    return result;
+}
+
+bool BinaryResultReader::open(const void* data, size_t size, std::string& error_msg) {
+    data_ = static_cast<const unsigned char*>(data);
+    size_ = size;
+    rows_ = 0;
+
+    if (size < sizeof(BinaryHeader)) {
+        error_msg = "File is too small to be a binary result";
+        return false;
+    }
+    std::memcpy(&header_, data_, sizeof(BinaryHeader));
+    if (std::memcmp(header_.magic, BinaryMagic, sizeof(BinaryMagic)) != 0) {
+        error_msg = "Not a binary result (bad magic)";
+        return false;
+    }
+    if (header_.version != BinaryVersion) {
+        error_msg = "Unsupported binary result version " + std::to_string(header_.version);
+        return false;
+    }
+    if (header_.section_count < BinarySectionCount) {
+        error_msg = "Binary result is missing sections";
+        return false;
+    }
+
+    for (size_t i = 0; i < BinarySectionCount; ++i) {
+        const auto& s = header_.sections[i];
+        auto kind = static_cast<BinarySection>(i);
+        bool width_ok = is_row_column(kind)
+            ? (s.width == 1 || s.width == 2 || s.width == 4 || s.width == 8)
+            : s.width == fixed_element_size(kind);
+        if (!width_ok) {
+            error_msg = "Binary result section " + std::to_string(i) + " has a bad element width";
+            return false;
+        }
+        if (s.offset > size || s.count > (size - s.offset) / s.width) {
+            error_msg = "Binary result section " + std::to_string(i) + " is out of bounds";
+            return false;
+        }
+    }
+
+    if (section(BinarySection::StringOffsets).count == 0) {
+        error_msg = "Binary result has no string table";
+        return false;
+    }
+    for (auto s : { BinarySection::RowProcess, BinarySection::RowType, BinarySection::RowHandle,
+                    BinarySection::RowPrefix, BinarySection::RowName }) {
+        if (section(s).count != header_.row_count) {
+            error_msg = "Binary result row columns have different lengths";
+            return false;
+        }
+    }
+
+    rows_ = header_.row_count;
+    return true;
+}
+
+template <typename T>
+T BinaryResultReader::load(BinarySection s, uint64_t index) const {
+    // memcpy keeps unaligned buffers (a file read into a std::string) legal
+    T value;
+    std::memcpy(&value, data_ + section(s).offset + index * sizeof(T), sizeof(T));
+    return value;
+}
+
+std::string_view BinaryResultReader::string(uint64_t id) const {
+    if (id >= string_count()) return {};
+    uint32_t begin = load<uint32_t>(BinarySection::StringOffsets, id);
+    uint32_t end = load<uint32_t>(BinarySection::StringOffsets, id + 1);
+    if (begin > end || end > section(BinarySection::StringBytes).count) return {};
+    return std::string_view(reinterpret_cast<const char*>(data_) +
+        section(BinarySection::StringBytes).offset + begin, end - begin);
+}
+
+uint64_t BinaryResultReader::load_column(BinarySection s, size_t row) const {
+    const auto& entry = section(s);
+    const unsigned char* p = data_ + entry.offset + row * entry.width;
+    switch (entry.width) {
+    case 1: return p[0];
+    case 2: { uint16_t v; std::memcpy(&v, p, sizeof(v)); return v; }
+    case 4: { uint32_t v; std::memcpy(&v, p, sizeof(v)); return v; }
+    default: { uint64_t v; std::memcpy(&v, p, sizeof(v)); return v; }
+    }
+}
+
+BinaryProcess BinaryResultReader::process_of(size_t row) const {
+    uint64_t index = load_column(BinarySection::RowProcess, row);
+    if (index >= process_count()) return BinaryProcess{ 0, 0, 0 };
+    return load<BinaryProcess>(BinarySection::Processes, index);
+}
+
+uint32_t BinaryResultReader::pid(size_t row) const {
+    return process_of(row).pid;
+}
+
+std::string_view BinaryResultReader::process_name(size_t row) const {
+    return string(process_of(row).name);
+}
+
+std::string_view BinaryResultReader::user(size_t row) const {
+    return string(process_of(row).user);
+}
+
+std::string_view BinaryResultReader::type(size_t row) const {
+    uint64_t index = load_column(BinarySection::RowType, row);
+    if (index >= type_count()) return {};
+    return string(load<uint32_t>(BinarySection::Types, index));
+}
+
+uint64_t BinaryResultReader::handle_value(size_t row) const {
+    return load_column(BinarySection::RowHandle, row);
+}
+
+std::string_view BinaryResultReader::name_prefix(size_t row) const {
+    return string(load_column(BinarySection::RowPrefix, row));
+}
+
+std::string_view BinaryResultReader::name_leaf(size_t row) const {
+    return string(load_column(BinarySection::RowName, row));
+}
+
+void BinaryResultReader::row(size_t row, HandleInfo& out) const {
+    BinaryProcess p = process_of(row);
+    out.pid = p.pid;
+    out.process_name.assign(string(p.name));
+    out.user.assign(string(p.user));
+    out.handle_type.assign(type(row));
+    std::string_view prefix = name_prefix(row);
+    std::string_view leaf = name_leaf(row);
+    out.object_name.reserve(prefix.size() + leaf.size());
+    out.object_name.assign(prefix);
+    out.object_name.append(leaf);
+    out.handle_value = static_cast<uintptr_t>(handle_value(row));
+}
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+#ifdef _WIN32
+
+bool MappedFile::open(const std::string& path, std::string& error_msg) {
+    close();
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        error_msg = "Cannot open " + path;
+        return false;
+    }
+    file_ = file;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size)) {
+        error_msg = "Cannot read the size of " + path;
+        close();
+        return false;
+    }
+    size_ = static_cast<size_t>(size.QuadPart);
+    if (size_ == 0) return true; // Nothing to map; the reader rejects it
+
+    mapping_ = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping_) {
+        error_msg = "Cannot map " + path;
+        close();
+        return false;
+    }
+    data_ = MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0);
+    if (!data_) {
+        error_msg = "Cannot map " + path;
+        close();
+        return false;
+    }
+    return true;
+}
+
+void MappedFile::close() {
+    if (data_) UnmapViewOfFile(data_);
+    if (mapping_) CloseHandle(mapping_);
+    if (file_) CloseHandle(file_);
+    data_ = nullptr;
+    mapping_ = nullptr;
+    file_ = nullptr;
+    size_ = 0;
+}
+
+#else
+
+bool MappedFile::open(const std::string& path, std::string& error_msg) {
+    close();
+    fd_ = ::open(path.c_str(), O_RDONLY);
+    if (fd_ < 0) {
+        error_msg = "Cannot open " + path;
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd_, &st) != 0) {
+        error_msg = "Cannot read the size of " + path;
+        close();
+        return false;
+    }
+    size_ = static_cast<size_t>(st.st_size);
+    if (size_ == 0) return true; // Nothing to map; the reader rejects it
+
+    void* p = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd_, 0);
+    if (p == MAP_FAILED) {
+        error_msg = "Cannot map " + path;
+        close();
+        return false;
+    }
+    data_ = p;
+    return true;
+}
+
+void MappedFile::close() {
+    if (data_) munmap(const_cast<void*>(data_), size_);
+    if (fd_ >= 0) ::close(fd_);
+    data_ = nullptr;
+    fd_ = -1;
+    size_ = 0;
+}
+
+#endif
+
+} // namespace lsofwin
@@ -0,0 +1,158 @@
+#pragma once
+
+#include "handle_info.h"
+#include "output_sink.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace lsofwin {
+
+// Compact binary result format (--binary), for bulk collection.
+//
+// Process names, users, object types and directory prefixes are stored once
+// in a string pool, and each row is a set of fixed-width columns that refer
+// to them. A file is a header followed by the sections it lists:
+//
+//   BinaryHeader      magic, version, row count, {offset, count, width} per section
+//   StringOffsets     uint32[strings + 1]; string i is bytes [off[i], off[i+1])
+//   StringBytes       the pooled string bytes, not NUL-terminated
+//   Processes         BinaryProcess[]: pid plus name and user string ids
+//   Types             uint32[]: string id of each object type
+//   RowProcess        uint[rows]: index into Processes
+//   RowType           uint[rows]: index into Types
+//   RowHandle         uint[rows]: handle value
+//   RowPrefix         uint[rows]: string id of the name up to its last separator
+//   RowName           uint[rows]: string id of the rest of the name
+//
+// Row columns are stored 1, 2, 4 or 8 bytes wide, whichever is the narrowest
+// that holds every value in that column; the section's width field says
+// which. Every section starts on an 8-byte boundary and all integers are
+// little endian, so a mapped file can be read in place without parsing.
+// String id 0 is always the empty string. The pool is limited to 4 GiB.
+constexpr char BinaryMagic[8] = { 'L', 'S', 'O', 'F', 'W', 'B', 'I', 'N' };
+constexpr uint32_t BinaryVersion = 1;
+
+enum class BinarySection : uint32_t {
+    StringOffsets,
+    StringBytes,
+    Processes,
+    Types,
+    RowProcess,
+    RowType,
+    RowHandle,
+    RowPrefix,
+    RowName,
+    Count
+};
+
+constexpr size_t BinarySectionCount = static_cast<size_t>(BinarySection::Count);
+
+struct BinarySectionEntry {
+    uint64_t offset;    // From the start of the file
+    uint64_t count;     // Elements, not bytes
+    uint32_t width;     // Bytes per element
+    uint32_t reserved;
+};
+
+struct BinaryHeader {
+    char     magic[8];
+    uint32_t version;
+    uint32_t section_count;
+    uint64_t row_count;
+    BinarySectionEntry sections[BinarySectionCount];
+};
+
+struct BinaryProcess {
+    uint32_t pid;
+    uint32_t name;      // String id
+    uint32_t user;      // String id
+};
+
+static_assert(sizeof(BinarySectionEntry) == 24, "unexpected section entry padding");
+static_assert(sizeof(BinaryHeader) == 24 + 24 * BinarySectionCount, "unexpected header padding");
+static_assert(sizeof(BinaryProcess) == 12, "unexpected process record padding");
+
+// Buffers rows as interned ids and writes the whole file on finish(); the
+// header has to know every section's size, so nothing is written before.
+std::unique_ptr<OutputSink> make_binary_sink(OutputBuffer& out);
+
+// Whole-list variant of make_binary_sink().
+std::string format_binary(const HandleList& handles);
+
+// Read access to a binary result held in memory (read or mapped). Columns
+// are read in place; the data must outlive the reader. open() only checks
+// the header and section bounds, and every accessor bounds-checks the ids it
+// follows, so a damaged file yields empty strings rather than bad reads.
+class BinaryResultReader {
+public:
+    bool open(const void* data, size_t size, std::string& error_msg);
+
+    uint64_t row_count() const { return rows_; }
+    uint64_t string_count() const { return section(BinarySection::StringOffsets).count - 1; }
+    uint64_t process_count() const { return section(BinarySection::Processes).count; }
+    uint64_t type_count() const { return section(BinarySection::Types).count; }
+
+    std::string_view string(uint64_t id) const;
+
+    uint32_t pid(size_t row) const;
+    std::string_view process_name(size_t row) const;
+    std::string_view user(size_t row) const;
+    std::string_view type(size_t row) const;
+    uint64_t handle_value(size_t row) const;
+    std::string_view name_prefix(size_t row) const;
+    std::string_view name_leaf(size_t row) const;
+
+    // Materialize one row as a HandleInfo (object_name = prefix + leaf).
+    void row(size_t row, HandleInfo& out) const;
+
+private:
+    const BinarySectionEntry& section(BinarySection s) const {
+        return header_.sections[static_cast<size_t>(s)];
+    }
+
+    template <typename T>
+    T load(BinarySection s, uint64_t index) const;
+
+    // Element `row` of a variable-width row column.
+    uint64_t load_column(BinarySection s, size_t row) const;
+
+    BinaryProcess process_of(size_t row) const;
+
+    const unsigned char* data_ = nullptr;
+    size_t size_ = 0;
+    uint64_t rows_ = 0;
+    BinaryHeader header_{};
+};
+
+// Read-only memory mapping of a whole file (MapViewOfFile / mmap).
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const std::string& path, std::string& error_msg);
+
+    const void* data() const { return data_; }
+    size_t size() const { return size_; }
+
+private:
+    void close();
+
+    const void* data_ = nullptr;
+    size_t size_ = 0;
+#ifdef _WIN32
+    void* file_ = nullptr;
+    void* mapping_ = nullptr;
+#else
+    int fd_ = -1;
+#endif
+};
+
+} // namespace lsofwin
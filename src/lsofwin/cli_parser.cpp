@@ -1,5 +1,11 @@
 #include "cli_parser.h"
 #include "console_color.h"
+#include "field_projection.h"
+#include "filter_expr.h"
+#include "handle_summary.h"
+#include "hang_guard.h"
+#include "type_filter.h"
+#include <algorithm>
 #include <sstream>
 #include <cstdlib>
 #include <regex>
@@ -21,11 +27,37 @@ std::string get_help_text(const char* program_name) {
         << "  " << program_name << " [OPTIONS]\n"
         << "\n"
         << B << "OPTIONS:" << R << "\n"
-        << "  " << BG << "-p" << R << " <pid>       Show only handles for the specified process ID\n"
-        << "  " << BG << "-c" << R << " <name>      Show only handles for processes matching name " << DM << "(case-insensitive substring)" << R << "\n"
-        << "  " << BG << "-f" << R << " <regex>     Filter results by file/object path " << DM << "(regular expression, case-insensitive)" << R << "\n"
+        << "  " << BG << "-p" << R << " <pids>      Show only handles for the specified process ID(s), comma-separated\n"
+        << "  " << BG << "-c" << R << " <names>     Show only handles for processes matching a name " << DM << "(case-insensitive substring, comma-separated)" << R << "\n"
+        << "  " << BG << "-f" << R << " <regex>     Filter results by file/object path " << DM << "(regular expression, case-insensitive; repeatable)" << R << "\n"
+        << "  " << BG << "+d" << R << " <dir>       Show only handles to dir and the entries directly in it " << DM << "(repeatable)" << R << "\n"
+        << "  " << BG << "+D" << R << " <dir>       Show only handles to dir and anything below it " << DM << "(case-insensitive, \\ or /; repeatable)" << R << "\n"
+        << "  " << BG << "-a" << R << "             Show handles matching all of -p, -c, -f and +d/+D " << DM << "(the default)" << R << "\n"
+        << "  " << BG << "--or" << R << "           Show handles matching any of -p, -c, -f and +d/+D " << DM << "(-T still applies)" << R << "\n"
+        << "  " << BG << "-T" << R << " <types>     Show only handles of the given object type(s), comma-separated " << DM << "(e.g. File,Key)" << R << "\n"
         << "  " << BG << "-t" << R << " <seconds>   Timeout per handle query operation " << DM << "(default: 5)" << R << "\n"
+        << "  " << BG << "--deadline" << R << " <seconds> Stop resolving after this long and show what was found " << DM << "(fractions allowed)" << R << "\n"
+        << "  " << BG << "-r" << R << " <seconds>   Rescan every N seconds and print only opened (+) and closed (-) handles\n"
+        << "  " << BG << "-l" << R << "             Show process owners as SIDs " << DM << "(uids on Linux)" << R << " instead of looking up account names\n"
+        << "  " << BG << "-J" << R << " <threads>   Resolve handles on N threads " << DM << "(0 = all cores, default: 1)" << R << "\n"
         << "  " << BG << "-j" << R << ", " << BG << "--json" << R << "     Output results in JSON format\n"
+        << "  " << BG << "--ndjson" << R << "       Output one JSON object per line " << DM << "(streams well into other tools)" << R << "\n"
+        << "  " << BG << "-o" << R << ", " << BG << "--fields" << R << " <list> Show only these columns, in this order: command, pid, user, fd, type, name,\n"
+        << "                 access, attr, object " << DM << "(comma-separated; what is not shown is not looked up)" << R << "\n"
+        << "  " << BG << "--binary" << R << "       Output a compact binary result " << DM << "(interned strings, columnar rows)" << R << "\n"
+        << "  " << BG << "--decode" << R << " <file> Print a saved --binary result as a table, or JSON with -j/--ndjson\n"
+        << "  " << BG << "--record" << R << " <file> Also save the raw handle table and what it resolved to, for --replay\n"
+        << "  " << BG << "--replay" << R << " <file> Scan a --record file instead of the system " << DM << "(any platform, no elevation)" << R << "\n"
+        << "  " << BG << "--serve" << R << "        Keep an index of open handles and answer --client queries " << DM << "(refreshed every -r seconds, default: 1)" << R << "\n"
+        << "  " << BG << "--client" << R << "       Answer from a running --serve instance if there is one, else scan\n"
+        << "  " << BG << "--socket" << R << " <path> Pipe or socket for --serve/--client " << DM << "(default: \\\\.\\pipe\\lsofwin)" << R << "\n"
+        << "  " << BG << "--widths" << R << " <n>   Size table columns from the first n rows " << DM << "(0 = fixed widths, default: 1000)" << R << "\n"
+        << "  " << BG << "--summary" << R << "      Count handles per process and type instead of listing them " << DM << "(same as --group-by pid,type)" << R << "\n"
+        << "  " << BG << "--group-by" << R << " <keys> Count handles per group of pid, type and/or user " << DM << "(comma-separated)" << R << "\n"
+        << "  " << BG << "--top" << R << " <n>      Show only the n largest groups " << DM << "(with --metrics: the n processes holding the most handles)" << R << "\n"
+        << "  " << BG << "--metrics" << R << " <file> Write handle counts per process and type to an OpenMetrics textfile every -r seconds " << DM << "(default: 60)" << R << "\n"
+        << "  " << BG << "--stats" << R << "        Print where the scan spent its time, skip counts and resolve latencies to stderr\n"
+        << "  " << BG << "--stats-json" << R << "   The same as one JSON object on stderr\n"
         << "  " << BG << "-v" << R << ", " << BG << "--version" << R << "  Show version information\n"
         << "  " << BG << "-h" << R << ", " << BG << "--help" << R << "     Show this help message\n"
         << "\n"
@@ -49,12 +81,24 @@ std::string get_help_text(const char* program_name) {
         << "  " << BY << "# Find all open .log or .txt files" << R << "\n"
         << "  " << program_name << " -f \"\\.(log|txt)$\"\n"
         << "\n"
-        << "  " << BY << "# Find files open under a specific directory" << R << "\n"
-        << "  " << program_name << " -f \"C:\\\\Users\\\\John\"\n"
+        << "  " << BY << "# Find files open anywhere under a directory (no regex escaping needed)" << R << "\n"
+        << "  " << program_name << " +D C:\\Users\\John\n"
+        << "\n"
+        << "  " << BY << "# Find files open directly in a directory, not in its subdirectories" << R << "\n"
+        << "  " << program_name << " +d C:\\Windows\\Temp\n"
+        << "\n"
+        << "  " << BY << "# Several services in one scan" << R << "\n"
+        << "  " << program_name << " -c sqlservr,w3wp,spoolsv -T File\n"
+        << "\n"
+        << "  " << BY << "# Anything a service holds, plus whoever has its log directory open" << R << "\n"
+        << "  " << program_name << " --or -c sqlservr +D D:\\SQLLogs\n"
         << "\n"
         << "  " << BY << "# Combine: .dll files opened by explorer" << R << "\n"
         << "  " << program_name << " -c explorer -f \"\\.dll\"\n"
         << "\n"
+        << "  " << BY << "# Only file handles (skips all other handles without opening them)" << R << "\n"
+        << "  " << program_name << " -T File -f \"\\.log$\"\n"
+        << "\n"
         << "  " << BY << "# Combine: registry keys for a specific PID" << R << "\n"
         << "  " << program_name << " -p 1234 -f \"REGISTRY\"\n"
         << "\n"
@@ -64,22 +108,68 @@ std::string get_help_text(const char* program_name) {
         << "  " << BY << "# JSON output piped to PowerShell for processing" << R << "\n"
         << "  " << program_name << " -c chrome -j | ConvertFrom-Json | Where-Object { $_.type -eq 'File' }\n"
         << "\n"
+        << "  " << BY << "# Stream every handle as NDJSON into another tool" << R << "\n"
+        << "  " << program_name << " --ndjson | jq -c 'select(.type == \"File\")'\n"
+        << "\n"
+        << "  " << BY << "# Handle values and types only: no name query and no account lookup" << R << "\n"
+        << "  " << program_name << " -o pid,fd,type -c app\n"
+        << "\n"
+        << "  " << BY << "# Which processes hold the most handles, by type (nothing is opened or queried)" << R << "\n"
+        << "  " << program_name << " --summary --top 20\n"
+        << "\n"
+        << "  " << BY << "# File handles per user" << R << "\n"
+        << "  " << program_name << " --group-by user -T File\n"
+        << "\n"
+        << "  " << BY << "# Export handle counts for a Prometheus textfile collector every 30 seconds" << R << "\n"
+        << "  " << program_name << " --metrics C:\\metrics\\lsofwin.prom -r 30\n"
+        << "\n"
+        << "  " << BY << "# Save a compact binary result and read it back later" << R << "\n"
+        << "  " << program_name << " --binary > handles.bin\n"
+        << "  " << program_name << " --decode handles.bin -j\n"
+        << "\n"
+        << "  " << BY << "# Capture a scan on one machine and query it on another" << R << "\n"
+        << "  " << program_name << " --record handles.rec > NUL\n"
+        << "  " << program_name << " --replay handles.rec -c explorer -f \"\\.dll$\"\n"
+        << "\n"
+        << "  " << BY << "# Watch who opens or closes a lock file, checking every 2 seconds" << R << "\n"
+        << "  " << program_name << " -r 2 -f \"\\.lock$\"\n"
+        << "\n"
+        << "  " << BY << "# Keep an index of file handles; later queries answer from it" << R << "\n"
+        << "  " << program_name << " --serve -T File\n"
+        << "  " << program_name << " --client -f \"^C:\\\\app\\\\app\\.dll$\"\n"
+        << "\n"
+        << "  " << BY << "# Show owners as SIDs, skipping slow domain account lookups" << R << "\n"
+        << "  " << program_name << " -l -c svchost\n"
+        << "\n"
         << "  " << BY << "# Use a longer timeout on busy systems" << R << "\n"
         << "  " << program_name << " -t 15\n"
         << "\n"
         << "  " << BY << "# Quick scan with short timeout" << R << "\n"
         << "  " << program_name << " -p 1234 -t 1\n"
         << "\n"
+        << "  " << BY << "# Whatever can be found within 3 seconds, even if some handles hang" << R << "\n"
+        << "  " << program_name << " --deadline 3\n"
+        << "\n"
+        << "  " << BY << "# Full-system scan using every core" << R << "\n"
+        << "  " << program_name << " -J 0\n"
+        << "\n"
+        << "  " << BY << "# See why a scan is slow: time per phase and per object type" << R << "\n"
+        << "  " << program_name << " -J 0 --stats > NUL\n"
+        << "\n"
         << B << "NOTES:" << R << "\n"
         << "  Running as " << BC << "Administrator" << R << " is recommended for full results.\n"
         << "  Without elevation, only handles accessible to the current user are shown.\n"
         << "  The " << BG << "-f" << R << " regex is matched case-insensitively against the full object path.\n"
-        << "  Use " << BG << "-t" << R << " to prevent hangs on pipe/device handles (default: 5 seconds).\n";
+        << "  Use " << BG << "-t" << R << " to prevent hangs on pipe/device handles (default: 5 seconds).\n"
+        << "  File handles with the access masks of synchronous pipes are queried with a short timeout;\n"
+        << "  with -r, new ones like those that have hung before are shown as " << HangRiskMarker << ".\n";
     return oss.str();
 }
 
 bool parse_args(int argc, const char* const* argv, FilterOptions& opts, std::string& error_msg) {
     opts = FilterOptions{};
+    bool summary = false;
+    bool and_given = false;
 
     for (int i = 1; i < argc; ++i) {
         std::string arg = argv[i];
@@ -95,19 +185,123 @@ bool parse_args(int argc, const char* const* argv, FilterOptions& opts, std::str
         else if (arg == "-j" || arg == "--json") {
             opts.output_json = true;
         }
-        else if (arg == "-p") {
+        else if (arg == "--ndjson") {
+            opts.output_ndjson = true;
+        }
+        else if (arg == "--binary") {
+            opts.output_binary = true;
+        }
+        else if (arg == "--decode") {
             if (i + 1 >= argc) {
-                error_msg = "Option -p requires a PID argument";
+                error_msg = "Option --decode requires a file argument";
+                return false;
+            }
+            ++i;
+            opts.decode_file = argv[i];
+        }
+        else if (arg == "--record" || arg == "--replay") {
+            if (i + 1 >= argc) {
+                error_msg = "Option " + arg + " requires a file argument";
+                return false;
+            }
+            ++i;
+            (arg == "--record" ? opts.record_file : opts.replay_file) = argv[i];
+        }
+        else if (arg == "--stats") {
+            opts.show_stats = true;
+        }
+        else if (arg == "--stats-json") {
+            opts.stats_json = true;
+        }
+        else if (arg == "--summary") {
+            summary = true;
+        }
+        else if (arg == "--group-by") {
+            if (i + 1 >= argc) {
+                error_msg = "Option --group-by requires a list of keys";
+                return false;
+            }
+            ++i;
+            if (!parse_group_keys(argv[i], opts.group_by, error_msg)) return false;
+        }
+        else if (arg == "-o" || arg == "--fields") {
+            if (i + 1 >= argc) {
+                error_msg = "Option " + arg + " requires a list of fields";
+                return false;
+            }
+            ++i;
+            if (!parse_fields(argv[i], opts.fields, error_msg)) return false;
+        }
+        else if (arg == "--top") {
+            if (i + 1 >= argc) {
+                error_msg = "Option --top requires a group count";
                 return false;
             }
             ++i;
             char* end = nullptr;
-            long val = std::strtol(argv[i], &end, 10);
+            long long val = std::strtoll(argv[i], &end, 10);
+            if (end == argv[i] || *end != '\0' || val <= 0) {
+                error_msg = "Invalid group count: " + std::string(argv[i]);
+                return false;
+            }
+            opts.summary_top = static_cast<size_t>(val);
+        }
+        else if (arg == "--metrics") {
+            if (i + 1 >= argc) {
+                error_msg = "Option --metrics requires a file argument";
+                return false;
+            }
+            ++i;
+            opts.metrics_file = argv[i];
+        }
+        else if (arg == "--serve") {
+            opts.serve = true;
+        }
+        else if (arg == "--client") {
+            opts.use_server = true;
+        }
+        else if (arg == "--socket") {
+            if (i + 1 >= argc) {
+                error_msg = "Option --socket requires a path argument";
+                return false;
+            }
+            ++i;
+            opts.socket_path = argv[i];
+        }
+        else if (arg == "--widths") {
+            if (i + 1 >= argc) {
+                error_msg = "Option --widths requires a row count";
+                return false;
+            }
+            ++i;
+            char* end = nullptr;
+            long long val = std::strtoll(argv[i], &end, 10);
             if (end == argv[i] || *end != '\0' || val < 0) {
+                error_msg = "Invalid row count: " + std::string(argv[i]);
+                return false;
+            }
+            opts.table_sample_rows = static_cast<size_t>(val);
+        }
+        else if (arg == "-p") {
+            if (i + 1 >= argc) {
+                error_msg = "Option -p requires a PID argument";
+                return false;
+            }
+            ++i;
+            auto pids = split_list(argv[i]);
+            if (pids.empty()) {
                 error_msg = "Invalid PID: " + std::string(argv[i]);
                 return false;
             }
-            opts.filter_pid = static_cast<int>(val);
+            for (const auto& item : pids) {
+                char* end = nullptr;
+                long long val = std::strtoll(item.c_str(), &end, 10);
+                if (end == item.c_str() || *end != '\0' || val < 0 || val > 0xffffffffll) {
+                    error_msg = "Invalid PID: " + item;
+                    return false;
+                }
+                opts.filter_pids.push_back(static_cast<uint32_t>(val));
+            }
         }
         else if (arg == "-c") {
             if (i + 1 >= argc) {
@@ -115,24 +309,52 @@ bool parse_args(int argc, const char* const* argv, FilterOptions& opts, std::str
                 return false;
             }
             ++i;
-            opts.filter_process_name = argv[i];
+            auto names = split_list(argv[i]);
+            if (names.empty()) {
+                error_msg = "Invalid process name: " + std::string(argv[i]);
+                return false;
+            }
+            opts.filter_process_names.insert(opts.filter_process_names.end(), names.begin(), names.end());
         }
         else if (arg == "-f") {
+            // Patterns may contain commas, so -f is repeated instead
             if (i + 1 >= argc) {
                 error_msg = "Option -f requires a regex argument";
                 return false;
             }
             ++i;
-            opts.filter_file_regex = argv[i];
-            // Validate regex
-            try {
-                std::regex test_re(opts.filter_file_regex, std::regex::icase);
-                (void)test_re;
+            opts.filter_file_regexes.push_back(argv[i]);
+        }
+        else if (arg == "+d" || arg == "+D") {
+            if (i + 1 >= argc) {
+                error_msg = "Option " + arg + " requires a directory argument";
+                return false;
+            }
+            ++i;
+            if (argv[i][0] == '\0') {
+                error_msg = "Invalid directory: " + std::string(argv[i]);
+                return false;
+            }
+            opts.filter_dirs.push_back({ argv[i], arg == "+D" });
+        }
+        else if (arg == "-a") {
+            and_given = true;
+        }
+        else if (arg == "--or") {
+            opts.filter_any = true;
+        }
+        else if (arg == "-T") {
+            if (i + 1 >= argc) {
+                error_msg = "Option -T requires a type name argument";
+                return false;
             }
-            catch (const std::regex_error& e) {
-                error_msg = "Invalid regex: " + std::string(e.what());
+            ++i;
+            auto types = split_list(argv[i]);
+            if (types.empty()) {
+                error_msg = "Invalid type list: " + std::string(argv[i]);
                 return false;
             }
+            opts.filter_types.insert(opts.filter_types.end(), types.begin(), types.end());
         }
         else if (arg == "-t") {
             if (i + 1 >= argc) {
@@ -148,13 +370,172 @@ bool parse_args(int argc, const char* const* argv, FilterOptions& opts, std::str
             }
             opts.timeout_seconds = static_cast<int>(val);
         }
+        else if (arg == "--deadline") {
+            if (i + 1 >= argc) {
+                error_msg = "Option --deadline requires a time in seconds";
+                return false;
+            }
+            ++i;
+            char* end = nullptr;
+            double val = std::strtod(argv[i], &end);
+            if (end == argv[i] || *end != '\0' || !(val > 0) || val > 86400) {
+                error_msg = "Invalid deadline: " + std::string(argv[i]);
+                return false;
+            }
+            opts.deadline_ms = (std::max)(1u, static_cast<uint32_t>(val * 1000));
+        }
+        else if (arg == "-r") {
+            if (i + 1 >= argc) {
+                error_msg = "Option -r requires an interval in seconds";
+                return false;
+            }
+            ++i;
+            char* end = nullptr;
+            long val = std::strtol(argv[i], &end, 10);
+            if (end == argv[i] || *end != '\0' || val <= 0 || val > 86400) {
+                error_msg = "Invalid repeat interval: " + std::string(argv[i]);
+                return false;
+            }
+            opts.repeat_seconds = static_cast<int>(val);
+        }
+        else if (arg == "-l") {
+            opts.raw_account_ids = true;
+        }
+        else if (arg == "-J") {
+            if (i + 1 >= argc) {
+                error_msg = "Option -J requires a thread count";
+                return false;
+            }
+            ++i;
+            char* end = nullptr;
+            long val = std::strtol(argv[i], &end, 10);
+            if (end == argv[i] || *end != '\0' || val < 0 || val > 1024) {
+                error_msg = "Invalid thread count: " + std::string(argv[i]);
+                return false;
+            }
+            opts.threads = static_cast<int>(val);
+        }
         else {
             error_msg = "Unknown option: " + arg;
             return false;
         }
     }
 
+    if (and_given && opts.filter_any) {
+        error_msg = "Options -a and --or cannot be combined";
+        return false;
+    }
+
+    // Validate and compile the whole filter expression once, up front
+    try {
+        opts.filter = std::make_shared<FilterExpr>(opts);
+    }
+    catch (const std::regex_error& e) {
+        error_msg = "Invalid regex: " + std::string(e.what());
+        return false;
+    }
+
+    // --group-by wins over the --summary default
+    if (summary && opts.group_by.empty()) opts.group_by = { GroupKey::Pid, GroupKey::Type };
+    if (opts.summary_top > 0 && opts.group_by.empty() && opts.metrics_file.empty()) {
+        error_msg = "Option --top requires --summary, --group-by or --metrics";
+        return false;
+    }
+
+    // A deadline bounds one scan; an index or a recording must be complete
+    if (opts.deadline_ms > 0 && (opts.repeat_seconds > 0 || opts.serve || opts.use_server ||
+        !opts.metrics_file.empty() || !opts.record_file.empty() || !opts.decode_file.empty())) {
+        error_msg = "Option --deadline cannot be combined with -r, --serve, --client, --metrics, --record or --decode";
+        return false;
+    }
+
+    // -o shapes a listing; other outputs have fixed contents
+    if (!opts.fields.empty() && (!opts.group_by.empty() || opts.repeat_seconds > 0 || opts.serve ||
+        opts.use_server || !opts.metrics_file.empty() || opts.output_binary ||
+        !opts.record_file.empty() || !opts.decode_file.empty())) {
+        error_msg = "Option -o cannot be combined with --summary, --group-by, -r, --serve, --client, --metrics, --binary, --record or --decode";
+        return false;
+    }
+
+    // --metrics counts from the raw handle table, so nothing that needs names
+    if (!opts.metrics_file.empty()) {
+        if (!opts.group_by.empty() || opts.serve || opts.use_server || opts.output_json ||
+            opts.output_ndjson || opts.output_binary || !opts.decode_file.empty() ||
+            !opts.record_file.empty() || !opts.replay_file.empty() || opts.show_stats || opts.stats_json) {
+            error_msg = "Option --metrics cannot be combined with --summary, --group-by, --serve, --client, -j, --ndjson, --binary, --decode, --record, --replay or --stats";
+            return false;
+        }
+        if (!opts.filter_file_regexes.empty() || !opts.filter_dirs.empty()) {
+            error_msg = "Option --metrics cannot be combined with -f, +d or +D";
+            return false;
+        }
+        return true;
+    }
+    if (!opts.group_by.empty() && (opts.repeat_seconds > 0 || opts.serve || opts.use_server ||
+        opts.output_binary || !opts.record_file.empty() || !opts.decode_file.empty())) {
+        error_msg = "Options --summary and --group-by cannot be combined with -r, --serve, --client, --binary, --record or --decode";
+        return false;
+    }
+
+    bool filtered = !opts.filter->empty() || !opts.filter_types.empty();
+    if (!opts.record_file.empty() && filtered) {
+        error_msg = "Option --record saves the whole handle table; apply -p, -c, -f, -T, +d and +D with --replay";
+        return false;
+    }
+
+    bool scans_file = !opts.record_file.empty() || !opts.replay_file.empty();
+    if (scans_file && (opts.repeat_seconds > 0 || opts.serve || opts.use_server || !opts.decode_file.empty())) {
+        error_msg = "Options --record and --replay cannot be combined with -r, --serve, --client or --decode";
+        return false;
+    }
+
+    if (!opts.record_file.empty() && !opts.replay_file.empty()) {
+        error_msg = "Options --record and --replay cannot be combined";
+        return false;
+    }
+
+    if ((opts.show_stats || opts.stats_json) &&
+        (opts.repeat_seconds > 0 || opts.serve || opts.use_server || !opts.decode_file.empty())) {
+        error_msg = "Options --stats and --stats-json cannot be combined with -r, --serve, --client or --decode";
+        return false;
+    }
+
+    // Owners are fixed in a recording, a --binary result or a server's index
+    if (opts.raw_account_ids && (opts.use_server || !opts.replay_file.empty() || !opts.decode_file.empty())) {
+        error_msg = "Option -l cannot be combined with --client, --replay or --decode";
+        return false;
+    }
+
+    if (opts.repeat_seconds > 0 && (opts.output_binary || !opts.decode_file.empty())) {
+        error_msg = "Option -r cannot be combined with --binary or --decode";
+        return false;
+    }
+
+    if (opts.serve && (opts.use_server || opts.output_binary || !opts.decode_file.empty())) {
+        error_msg = "Option --serve cannot be combined with --client, --binary or --decode";
+        return false;
+    }
+
+    if (opts.use_server && (opts.repeat_seconds > 0 || !opts.decode_file.empty())) {
+        error_msg = "Option --client cannot be combined with -r or --decode";
+        return false;
+    }
+
     return true;
 }
 
+std::vector<std::string> server_query_args(int argc, const char* const* argv) {
+    std::vector<std::string> args;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--client") continue;
+        if (arg == "--socket") {
+            ++i;
+            continue;
+        }
+        args.push_back(arg);
+    }
+    return args;
+}
+
 } // namespace lsofwin
@@ -10,6 +10,10 @@ namespace lsofwin {
 // Returns true on success, false on error (error_msg will be set).
 bool parse_args(int argc, const char* const* argv, FilterOptions& opts, std::string& error_msg);
 
+// The arguments a --client run sends to the server: argv without the
+// program name, --client and --socket <path>.
+std::vector<std::string> server_query_args(int argc, const char* const* argv);
+
 // Returns the help/usage text.
 std::string get_help_text(const char* program_name);
 
@@ -2,6 +2,7 @@
 
 #include <string>
 
+#ifdef _WIN32
 #ifndef NOMINMAX
 #define NOMINMAX
 #endif
@@ -9,6 +10,9 @@
 #define WIN32_LEAN_AND_MEAN
 #endif
 #include <Windows.h>
+#else
+#include <unistd.h>
+#endif
 
 namespace lsofwin {
 namespace color {
@@ -31,6 +35,7 @@ inline constexpr const char* DIM     = "\033[2m";
 // Enable ANSI/VT100 escape sequences on Windows console.
 // Call once at startup. Returns true if color is supported.
 inline bool enable_virtual_terminal() {
+#ifdef _WIN32
     HANDLE hOut = GetStdHandle(STD_OUTPUT_HANDLE);
     HANDLE hErr = GetStdHandle(STD_ERROR_HANDLE);
     if (hOut == INVALID_HANDLE_VALUE || hErr == INVALID_HANDLE_VALUE) return false;
@@ -45,13 +50,20 @@ inline bool enable_virtual_terminal() {
         SetConsoleMode(hErr, mode);
     }
     return true;
+#else
+    return true; // POSIX terminals understand ANSI escapes natively
+#endif
 }
 
 // Check if stdout is a real console (not redirected to file/pipe)
 inline bool is_console_output() {
+#ifdef _WIN32
     HANDLE hOut = GetStdHandle(STD_OUTPUT_HANDLE);
     DWORD mode = 0;
     return GetConsoleMode(hOut, &mode) != 0;
+#else
+    return isatty(STDOUT_FILENO) != 0;
+#endif
 }
 
 // Global flag set by init — when false, all color functions return empty strings
@@ -0,0 +1,90 @@
+#include "device_path_map.h"
+#include "utf16_transcode.h"
+
+#include <algorithm>
+#include <functional>
+
+namespace lsofwin {
+
+void DevicePathMap::add_standard_prefixes() {
+    add("\\Device\\Mup", "\\");
+    add("\\??\\UNC", "\\");
+    add("\\??\\", "");
+}
+
+void DevicePathMap::add(const std::string& nt_prefix, const std::string& dos_prefix) {
+    if (nt_prefix.empty() || by_prefix_.count(nt_prefix)) return;
+
+    rules_.push_back({ nt_prefix, dos_prefix });
+    const Rule& rule = rules_.back();
+    by_prefix_.emplace(std::string_view(rule.nt_prefix), &rule);
+
+    size_t len = rule.nt_prefix.size();
+    if (std::find(lengths_.begin(), lengths_.end(), len) == lengths_.end()) {
+        lengths_.push_back(len);
+        std::sort(lengths_.begin(), lengths_.end(), std::greater<size_t>());
+    }
+}
+
+const DevicePathMap::Rule* DevicePathMap::find_longest_match(std::string_view path) const {
+    for (size_t len : lengths_) {
+        if (len > path.size()) continue;
+
+        // Must end on a component boundary, unless the prefix itself ends in '\'
+        bool boundary = len == path.size() || path[len] == '\\' || path[len - 1] == '\\';
+        if (!boundary) continue;
+
+        auto it = by_prefix_.find(path.substr(0, len));
+        if (it != by_prefix_.end()) return it->second;
+    }
+    return nullptr;
+}
+
+bool DevicePathMap::normalize(std::string& path) const {
+    if (path.empty() || path[0] != '\\') return false;
+
+    const Rule* rule = find_longest_match(path);
+    if (!rule) return false;
+
+    // Shifts the tail over the prefix within the existing buffer
+    path.replace(0, rule->nt_prefix.size(), rule->dos_prefix);
+    return true;
+}
+
+bool DevicePathMap::normalize(std::u16string_view nt_name, std::string& out) const {
+    out.clear();
+    if (nt_name.empty() || nt_name[0] != u'\\' || lengths_.empty()) {
+        append_utf8(out, nt_name);
+        return false;
+    }
+
+    // Prefixes too long for the head buffer: convert first, rewrite after
+    char head[256];
+    if (lengths_.front() >= sizeof(head)) {
+        append_utf8(out, nt_name);
+        return normalize(out);
+    }
+
+    // NT prefixes are ASCII, so match on the name's ASCII head, up to one
+    // unit past the longest prefix for the boundary check. A non-ASCII unit
+    // ends the head as 0xFF, a byte no prefix contains and that is not a
+    // boundary either.
+    size_t limit = (std::min)(nt_name.size(), lengths_.front() + 1);
+    size_t n = 0;
+    while (n < limit && nt_name[n] < 0x80) {
+        head[n] = static_cast<char>(nt_name[n]);
+        ++n;
+    }
+    if (n < limit) head[n++] = static_cast<char>(0xFF);
+
+    const Rule* rule = find_longest_match(std::string_view(head, n));
+    if (!rule) {
+        append_utf8(out, nt_name);
+        return false;
+    }
+    out = rule->dos_prefix;
+    append_utf8(out, nt_name.substr(rule->nt_prefix.size()));
+    return true;
+}
+
+} // namespace lsofwin
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace lsofwin {
+
+// NT device path -> DOS path rewriting, built once per scan. Replaces the
+// per-handle GetLogicalDriveStrings/QueryDosDevice loop in normalize_path().
+//
+// Rules are matched longest-prefix-first and only at a path component
+// boundary, so \Device\HarddiskVolume1 never matches \Device\HarddiskVolume10.
+// Matching is case-sensitive: object names come back from the kernel in the
+// same canonical case QueryDosDevice reports.
+class DevicePathMap {
+public:
+    DevicePathMap() = default;
+    DevicePathMap(DevicePathMap&&) = default;
+    DevicePathMap& operator=(DevicePathMap&&) = default;
+
+    // The index points into rules_, so copies would dangle
+    DevicePathMap(const DevicePathMap&) = delete;
+    DevicePathMap& operator=(const DevicePathMap&) = delete;
+
+    // Add the rules every Windows system has: \Device\Mup\server\share and
+    // \??\UNC\server\share become \\server\share, and \??\C:\x becomes C:\x.
+    void add_standard_prefixes();
+
+    // Map an NT prefix (e.g. \Device\HarddiskVolume3) to its DOS form (e.g.
+    // C: or D:\mnt\data). The first rule added for a prefix wins.
+    void add(const std::string& nt_prefix, const std::string& dos_prefix);
+
+    // Rewrite path in place if a rule matches. Drive letter and UNC prefixes
+    // are shorter than the NT prefix they replace, so those rewrites never
+    // reallocate. Returns true if the path was rewritten.
+    bool normalize(std::string& path) const;
+
+    // Convert a UTF-16 object name to UTF-8 in out (replacing its contents),
+    // rewriting a matching NT prefix on the way: the DOS prefix is written
+    // first and only the rest of the name is transcoded, in one pass straight
+    // into out. Returns true if a rule matched.
+    bool normalize(std::u16string_view nt_name, std::string& out) const;
+
+    size_t size() const { return rules_.size(); }
+
+private:
+    struct Rule {
+        std::string nt_prefix;
+        std::string dos_prefix;
+    };
+
+    const Rule* find_longest_match(std::string_view path) const;
+
+    std::deque<Rule> rules_;                                  // Stable addresses for the index
+    std::unordered_map<std::string_view, const Rule*> by_prefix_;
+    std::vector<size_t> lengths_;                             // Distinct prefix lengths, longest first
+};
+
+} // namespace lsofwin
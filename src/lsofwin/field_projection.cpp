@@ -0,0 +1,66 @@
+#include "field_projection.h"
+#include "type_filter.h"
+
+#include <algorithm>
+#include <iterator>
+
+namespace lsofwin {
+
+namespace {
+
+const char* const field_names[] = {
+    "command", "pid", "user", "fd", "type", "name", "access", "attr", "object",
+};
+
+static_assert(std::size(field_names) == static_cast<size_t>(OutputField::Count), "field names");
+
+} // anonymous namespace
+
+const char* field_name(OutputField field) {
+    return field_names[static_cast<size_t>(field)];
+}
+
+const std::vector<OutputField>& default_fields() {
+    static const std::vector<OutputField> fields = {
+        OutputField::Command, OutputField::Pid, OutputField::User, OutputField::Type, OutputField::Name,
+    };
+    return fields;
+}
+
+bool parse_fields(const std::string& value, std::vector<OutputField>& fields, std::string& error_msg) {
+    fields.clear();
+    auto names = split_list(value);
+    if (names.empty()) {
+        error_msg = "Invalid field list: " + value;
+        return false;
+    }
+    for (const auto& name : names) {
+        auto it = std::find_if(std::begin(field_names), std::end(field_names),
+            [&](const char* n) { return name == n; });
+        if (it == std::end(field_names)) {
+            error_msg = "Unknown field: " + name +
+                " (expected command, pid, user, fd, type, name, access, attr or object)";
+            return false;
+        }
+        auto field = static_cast<OutputField>(it - std::begin(field_names));
+        if (std::find(fields.begin(), fields.end(), field) != fields.end()) {
+            error_msg = "Field given twice: " + name;
+            return false;
+        }
+        fields.push_back(field);
+    }
+    return true;
+}
+
+FieldNeeds field_needs(const std::vector<OutputField>& fields) {
+    const auto& shown = fields.empty() ? default_fields() : fields;
+    auto has = [&](OutputField f) { return std::find(shown.begin(), shown.end(), f) != shown.end(); };
+    FieldNeeds needs;
+    needs.command = has(OutputField::Command);
+    needs.user = has(OutputField::User);
+    needs.type = has(OutputField::Type);
+    needs.name = has(OutputField::Name);
+    return needs;
+}
+
+} // namespace lsofwin
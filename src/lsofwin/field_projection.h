@@ -0,0 +1,39 @@
+#pragma once
+
+#include "handle_info.h"
+
+#include <string>
+#include <vector>
+
+namespace lsofwin {
+
+// -o / --fields: the columns a listing shows, and what a scan has to look up
+// to fill them in. Rows always carry the raw table fields (PID, handle
+// value, access mask, attributes, object address), which cost nothing; the
+// rest are lookups that are skipped when no selected field and no filter
+// needs them.
+
+// The -o name of a field ("command", "pid", "user", "fd", "type", "name",
+// "access", "attr", "object").
+const char* field_name(OutputField field);
+
+// The columns shown without -o.
+const std::vector<OutputField>& default_fields();
+
+// Parse an -o value: a comma-separated list of field names, in any order
+// and without repeats.
+bool parse_fields(const std::string& value, std::vector<OutputField>& fields, std::string& error_msg);
+
+// Lookups the selected fields need.
+struct FieldNeeds {
+    bool command = true;    // Process name (from the process snapshot on Windows)
+    bool user = true;       // Process owner: token query and account lookup
+    bool type = true;       // Object type: the type table, or a query for indices it lacks
+    bool name = true;       // Object name: the timed name query and path normalization
+};
+
+// What fields (empty = default_fields()) need. Filters add their own needs
+// on top: -c the process name, -f and +d / +D the object name, -T the type.
+FieldNeeds field_needs(const std::vector<OutputField>& fields);
+
+} // namespace lsofwin
@@ -0,0 +1,90 @@
+#include "filter_expr.h"
+#include "path_matcher.h"
+#include "string_search.h"
+
+#include <algorithm>
+
+namespace lsofwin {
+
+namespace {
+
+// Relative cost of a matcher's engine, for ordering the -f alternatives.
+int matcher_cost(const PathMatcher& m) {
+    switch (m.strategy()) {
+    case PathMatcher::Strategy::Dfa:      return 1;
+    case PathMatcher::Strategy::StdRegex: return 2;
+    default:                              return 0;
+    }
+}
+
+} // anonymous namespace
+
+FilterExpr::FilterExpr(const FilterOptions& opts)
+    : any_(opts.filter_any), pids_(opts.filter_pids), dir_specs_(opts.filter_dirs) {
+    std::sort(pids_.begin(), pids_.end());
+    pids_.erase(std::unique(pids_.begin(), pids_.end()), pids_.end());
+
+    for (const auto& name : opts.filter_process_names) {
+        std::string lower = name;
+        for (auto& c : lower) c = static_cast<char>(ascii_lower(static_cast<unsigned char>(c)));
+        process_names_.push_back(std::move(lower));
+    }
+
+    for (const auto& d : dir_specs_) dirs_.emplace_back(d.path, d.recursive);
+
+    for (const auto& pattern : opts.filter_file_regexes) {
+        matchers_.push_back(std::make_shared<PathMatcher>(pattern));
+    }
+    std::stable_sort(matchers_.begin(), matchers_.end(),
+        [](const std::shared_ptr<const PathMatcher>& a, const std::shared_ptr<const PathMatcher>& b) {
+            return matcher_cost(*a) < matcher_cost(*b);
+        });
+}
+
+FilterExpr::Verdict FilterExpr::pid_verdict(uint32_t pid) const {
+    bool listed = !pids_.empty() && std::binary_search(pids_.begin(), pids_.end(), pid);
+    if (any_) {
+        if (listed || empty()) return Verdict::Accept;
+        if (has_process_names()) return Verdict::NeedProcess;
+        return has_name_terms() ? Verdict::CheckName : Verdict::Reject;
+    }
+    if (!pids_.empty() && !listed) return Verdict::Reject;
+    return has_process_names() ? Verdict::NeedProcess : after_process();
+}
+
+FilterExpr::Verdict FilterExpr::process_verdict(std::string_view process_name) const {
+    bool named = std::any_of(process_names_.begin(), process_names_.end(),
+        [&](const std::string& needle) { return contains_icase(process_name, needle); });
+    if (any_) {
+        if (named) return Verdict::Accept;
+        return has_name_terms() ? Verdict::CheckName : Verdict::Reject;
+    }
+    return named ? after_process() : Verdict::Reject;
+}
+
+FilterExpr::NameResult FilterExpr::check_name(std::string_view object_name) const {
+    bool in_dir = std::any_of(dirs_.begin(), dirs_.end(),
+        [&](const DirectoryFilter& d) { return d.matches(object_name); });
+    if (any_ && in_dir) return NameResult::Match;
+    if (!any_ && !dirs_.empty() && !in_dir) return NameResult::NoDirMatch;
+
+    // A pattern needs a name to match against
+    bool matched = !object_name.empty() && std::any_of(matchers_.begin(), matchers_.end(),
+        [&](const std::shared_ptr<const PathMatcher>& m) { return m->matches(object_name); });
+    if (matched || (!any_ && matchers_.empty())) return NameResult::Match;
+    return matchers_.empty() ? NameResult::NoDirMatch : NameResult::NoFileMatch;
+}
+
+bool FilterExpr::matches(uint32_t pid, std::string_view process_name, std::string_view object_name) const {
+    Verdict v = pid_verdict(pid);
+    if (v == Verdict::NeedProcess) v = process_verdict(process_name);
+    if (v == Verdict::CheckName) return check_name(object_name) == NameResult::Match;
+    return v == Verdict::Accept;
+}
+
+std::shared_ptr<const FilterExpr> compile_filter(const FilterOptions& opts) {
+    if (opts.filter) return opts.filter;
+    return std::make_shared<FilterExpr>(opts);
+}
+
+} // namespace lsofwin
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "handle_info.h"
+#include "path_trie.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace lsofwin {
+
+class PathMatcher;
+
+// The selections (-p, -c, -f, +d / +D) compiled once into a predicate tree.
+// Values of one option are alternatives; the options are ANDed, or ORed with
+// --or. The tree is evaluated one level at a time, cheapest first:
+//
+//   1. PID            from the raw table entry (binary search of a sorted set)
+//   2. process name   looked up once per process, only if the PID left it open
+//   3. object name    needs the handle resolved; directories (a component
+//                     compare) before patterns, patterns cheapest engine first
+//
+// Levels 1 and 2 give one verdict per process, so a scan walks only the
+// processes that can match and knows per process whether level 3 runs at all.
+// -T is not part of the tree: it always restricts, and is bound to each
+// snapshot's type table (TypeFilter) ahead of everything here.
+// Immutable after construction, so one expression can be shared by all -J
+// workers and kept in the server's query cache.
+class FilterExpr {
+public:
+    // What levels 1 and 2 say about all of one process's handles.
+    enum class Verdict : uint8_t {
+        Reject,         // None can match
+        Accept,         // All match (subject to -T)
+        CheckName,      // Each handle's object name decides (level 3)
+        NeedProcess,    // The process name decides; see process_verdict()
+    };
+
+    // Outcome of level 3; which kind of check dropped the name, for --stats.
+    enum class NameResult : uint8_t { Match, NoFileMatch, NoDirMatch };
+
+    FilterExpr() = default;
+
+    // Throws std::regex_error if a -f pattern is not a valid regex.
+    explicit FilterExpr(const FilterOptions& opts);
+
+    // True if there is no selection, so every handle passes.
+    bool empty() const { return pids_.empty() && process_names_.empty() && !has_name_terms(); }
+
+    // --or: a handle passes if any selection matches.
+    bool any() const { return any_; }
+
+    const std::vector<uint32_t>& pids() const { return pids_; }
+    bool has_process_names() const { return !process_names_.empty(); }
+    bool has_name_terms() const { return !dirs_.empty() || !matchers_.empty(); }
+
+    // The -f matchers, cheapest engine first, and the +d / +D directories.
+    const std::vector<std::shared_ptr<const PathMatcher>>& matchers() const { return matchers_; }
+    const std::vector<DirSelection>& dirs() const { return dir_specs_; }
+
+    // Level 1.
+    Verdict pid_verdict(uint32_t pid) const;
+
+    // Level 2, for a process whose pid_verdict() was NeedProcess.
+    Verdict process_verdict(std::string_view process_name) const;
+
+    // Level 3, for a handle of a process whose verdict was CheckName.
+    NameResult check_name(std::string_view object_name) const;
+
+    // All levels at once, for rows that are already resolved.
+    bool matches(uint32_t pid, std::string_view process_name, std::string_view object_name) const;
+
+private:
+    // What is left for a process once its PID and name have passed.
+    Verdict after_process() const { return has_name_terms() ? Verdict::CheckName : Verdict::Accept; }
+
+    bool any_ = false;
+    std::vector<uint32_t> pids_;                // Sorted, unique
+    std::vector<std::string> process_names_;    // Lowercased
+    std::vector<DirSelection> dir_specs_;
+    std::vector<DirectoryFilter> dirs_;
+    std::vector<std::shared_ptr<const PathMatcher>> matchers_;
+};
+
+// The expression parse_args() compiled into opts, or one compiled now for
+// callers that only filled in the option values.
+std::shared_ptr<const FilterExpr> compile_filter(const FilterOptions& opts);
+
+} // namespace lsofwin
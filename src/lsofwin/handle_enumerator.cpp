@@ -1,282 +1,573 @@
 #include "handle_enumerator.h"
 #include "process_utils.h"
 #include "console_color.h"
+#include "field_projection.h"
+#include "filter_expr.h"
+#include "hang_guard.h"
+#include "query_planner.h"
+#include "scan_stats.h"
+#include "shard_scheduler.h"
+#include "type_filter.h"
 
-#include <Windows.h>
-#include <winternl.h>
 #include <algorithm>
-#include <unordered_map>
-#include <regex>
+#include <atomic>
+#include <iterator>
 #include <mutex>
+#include <thread>
+#include <unordered_map>
+
+namespace lsofwin {
 
-#pragma comment(lib, "ntdll.lib")
-
-// NT API types not in standard headers
-extern "C" {
-    typedef struct _SYSTEM_HANDLE_TABLE_ENTRY_INFO_EX {
-        PVOID      Object;
-        ULONG_PTR  UniqueProcessId;
-        ULONG_PTR  HandleValue;
-        ULONG      GrantedAccess;
-        USHORT     CreatorBackTraceIndex;
-        USHORT     ObjectTypeIndex;
-        ULONG      HandleAttributes;
-        ULONG      Reserved;
-    } SYSTEM_HANDLE_TABLE_ENTRY_INFO_EX;
-
-    typedef struct _SYSTEM_HANDLE_INFORMATION_EX {
-        ULONG_PTR NumberOfHandles;
-        ULONG_PTR Reserved;
-        SYSTEM_HANDLE_TABLE_ENTRY_INFO_EX Handles[1];
-    } SYSTEM_HANDLE_INFORMATION_EX;
+std::string get_privilege_warning() {
+    if (!is_elevated()) {
+        std::string w;
+        w += color::c(color::BOLD_YELLOW);
+        w += "WARNING:";
+        w += color::c(color::RESET);
+        w += color::c(color::YELLOW);
+#ifdef _WIN32
+        w += " Not running as Administrator. Results may be incomplete.\n";
+        w += "         Run from an elevated command prompt for full results.\n";
+#else
+        w += " Not running as root. Results may be incomplete.\n";
+        w += "         Run with sudo for full results.\n";
+#endif
+        w += color::c(color::RESET);
+        return w;
+    }
+    return "";
 }
 
-namespace {
+HandleList enumerate_handles(const FilterOptions& opts) {
+    auto source = make_system_handle_source(opts.raw_account_ids);
+    return enumerate_handles(*source, opts);
+}
 
-constexpr ULONG SystemExtendedHandleInformationClass = 64;
-constexpr ULONG ObjectNameInformationClass = 1;
-constexpr ULONG ObjectTypeInformationClass = 2;
+namespace {
 
-struct ObjectNameInfo {
-    UNICODE_STRING Name;
-    WCHAR NameBuffer[1];
+// Filter state (read-only) and caches (thread-safe) shared by all workers.
+// started is when the scan began, before the snapshot, for --deadline.
+struct ScanContext {
+    ScanContext(HandleSource& src, const FilterOptions& o, const std::vector<RawHandle>& t,
+        ScanDeadline::Clock::time_point started)
+        : source(src), opts(o), table(t), type_names(src.type_names()), hang_risk(type_names),
+          deadline(std::chrono::milliseconds(o.deadline_ms), started) {}
+
+    HandleSource& source;
+    const FilterOptions& opts;
+    const std::vector<RawHandle>& table;
+    uint32_t timeout_ms = 0;
+    ObjectCache object_cache;
+    std::atomic<uint64_t> handles_resolved{ 0 };
+    std::atomic<uint64_t> handles_past_deadline{ 0 };
+    std::vector<std::string> type_names;
+    HangRiskClassifier hang_risk;
+    ScanDeadline deadline;
+    TypeFilter type_filter;
+    std::shared_ptr<const FilterExpr> filter;
+    FieldNeeds needs;               // What -o shows; every field unless set
+    ProcessInfo no_process;         // For scans that show neither command nor user
+    ScanPlan plan;
+    ScanStats* stats = nullptr;     // --stats; null records nothing
 };
 
-struct ObjectTypeInfo {
-    UNICODE_STRING TypeName;
-    ULONG Reserved[22];
-};
+void count(ScanContext& ctx, ScanCounter counter) {
+    if (ctx.stats) ctx.stats->add(counter);
+}
 
-// Thread-safe cache for process info
-struct ProcessCacheEntry {
-    std::string name;
-    std::string user;
-};
+// True once --deadline has passed; the n handles the caller was about to
+// look at are counted as left unresolved.
+bool past_deadline(ScanContext& ctx, size_t n) {
+    if (!ctx.deadline.active() || !ctx.deadline.expired()) return false;
+    ctx.handles_past_deadline += n;
+    if (ctx.stats) ctx.stats->add(ScanCounter::SkippedDeadline, n);
+    return true;
+}
 
-std::string wide_to_narrow(const WCHAR* wstr, int len) {
-    if (!wstr || len <= 0) return "";
-    int needed = WideCharToMultiByte(CP_UTF8, 0, wstr, len, nullptr, 0, nullptr, nullptr);
-    if (needed <= 0) return "";
-    std::string result(needed, '\0');
-    WideCharToMultiByte(CP_UTF8, 0, wstr, len, &result[0], needed, nullptr, nullptr);
-    return result;
+// Per-worker process cache. A process split across shards on different
+// workers is looked up once per worker, which keeps the hot path lock-free.
+using ProcessCache = std::unordered_map<uint32_t, ProcessInfo>;
+
+// Process info for a planned range: from the plan when -c already looked the
+// process up, otherwise from the worker's cache.
+const ProcessInfo& process_for(ScanContext& ctx, uint32_t pid, ProcessCache& proc_cache) {
+    auto planned = ctx.plan.processes.find(pid);
+    if (planned != ctx.plan.processes.end()) return planned->second;
+
+    // -o without user skips the owner (token and account) lookup, and
+    // without command the process is not looked up at all
+    if (!ctx.needs.user && !ctx.needs.command) return ctx.no_process;
+
+    auto cache_it = proc_cache.find(pid);
+    if (cache_it == proc_cache.end()) {
+        PhaseTimer timer(ctx.stats, ScanPhase::ProcessInfo);
+        ProcessInfo info;
+        if (ctx.needs.user) info = ctx.source.process_info(pid);
+        else info.name = ctx.source.process_name(pid);
+        cache_it = proc_cache.emplace(pid, std::move(info)).first;
+    }
+    return cache_it->second;
 }
 
-// Query object name with timeout to avoid hangs on pipes/devices
-struct QueryThreadData {
-    HANDLE handle;
-    PVOID buffer;
-    ULONG buffer_size;
-    NTSTATUS status;
-    ULONG return_length;
-};
+// A row -o shows without its name: when no name check needs the name either
+// and the type table names the type (or no field or -T needs it), the handle
+// is kept from its table entry without being queried. Returns false if the
+// row needs resolving after all.
+template <bool CheckNames>
+bool skip_query(ScanContext& ctx, const RawHandle& entry, TypeFilter::Decision type_decision,
+    ResolvedHandle& resolved) {
+    if (CheckNames || ctx.needs.name || type_decision == TypeFilter::Decision::Unknown) return false;
+    bool named_type = entry.type_index < ctx.type_names.size() && !ctx.type_names[entry.type_index].empty();
+    if (ctx.needs.type && !named_type) return false;
+    if (ctx.needs.type) resolved.type = ctx.type_names[entry.type_index];
+    return true;
+}
 
-DWORD WINAPI query_object_name_thread(LPVOID param) {
-    auto* data = static_cast<QueryThreadData*>(param);
-    data->status = NtQueryObject(data->handle, (OBJECT_INFORMATION_CLASS)ObjectNameInformationClass,
-        data->buffer, data->buffer_size, &data->return_length);
-    return 0;
+// A handle the object cache missed: ask the backend, with the -t timeout
+// (the probe timeout for hang-prone handles) cut to what --deadline leaves.
+// Returns false if it was dropped. Timeouts are not remembered: skipping by
+// history within one scan would make the rows -J workers skip depend on
+// which shard of a process finished first.
+bool query_row(ScanContext& ctx, const RawHandle& entry, size_t index, ResolvedHandle& resolved) {
+    uint32_t timeout_ms = ctx.timeout_ms;
+    if (ctx.hang_risk.classify(entry) == HangRisk::Probe) {
+        count(ctx, ScanCounter::HangRiskProbed);
+        timeout_ms = (std::min)(timeout_ms, HangProbeTimeoutMs);
+    }
+    timeout_ms = ctx.deadline.query_timeout_ms(timeout_ms);
+    if (timeout_ms == 0 && past_deadline(ctx, 1)) return false;
+
+    ++ctx.handles_resolved;
+    PhaseTimer timer(ctx.stats, ScanPhase::Resolve);
+    bool ok = ctx.source.resolve(entry, index, timeout_ms, resolved);
+    if (ctx.stats) {
+        ctx.stats->add_resolve(entry.type_index, timer.stop());
+        if (resolved.timed_out) ctx.stats->add(ScanCounter::TimedOut);
+    }
+    if (!ok) count(ctx, ScanCounter::AccessDenied);
+    return ok;
 }
 
-bool query_object_name_with_timeout(HANDLE handle, PVOID buffer, ULONG buffer_size,
-    NTSTATUS& status, DWORD timeout_ms) {
-    QueryThreadData data = { handle, buffer, buffer_size, 0, 0 };
+// Resolve table[index] and apply the per-handle filters that need its type
+// or name (-T for indices missing from the type table; with CheckNames, -f
+// and +d / +D). Returns false if the handle is dropped; the reason has been
+// counted.
+template <bool CheckNames>
+bool resolve_row(ScanContext& ctx, const RawHandle& entry, size_t index,
+    TypeFilter::Decision type_decision, ResolvedHandle& resolved) {
+    if (past_deadline(ctx, 1)) return false;
+
+    if (skip_query<CheckNames>(ctx, entry, type_decision, resolved)) {
+        if (!ctx.source.is_process_accessible(entry.pid)) {
+            count(ctx, ScanCounter::AccessDenied);
+            return false;
+        }
+        count(ctx, ScanCounter::NotQueried);
+        return true;
+    }
 
-    HANDLE hThread = CreateThread(nullptr, 0, query_object_name_thread, &data, 0, nullptr);
-    if (!hThread) return false;
+    // Resolve type and name, once per kernel object across all processes
+    bool cacheable = entry.object != 0;
+    if (cacheable && ctx.object_cache.acquire(entry.object, resolved) == ObjectCache::Lookup::Hit) {
+        count(ctx, ScanCounter::CacheHits);
+        if (!ctx.source.is_process_accessible(entry.pid)) {
+            count(ctx, ScanCounter::AccessDenied);
+            return false;
+        }
+    }
+    else if (!query_row(ctx, entry, index, resolved)) {
+        if (cacheable) ctx.object_cache.release(entry.object);
+        return false;
+    }
+    else if (cacheable) {
+        ctx.object_cache.publish(entry.object, resolved);
+    }
 
-    DWORD wait_result = WaitForSingleObject(hThread, timeout_ms);
-    if (wait_result == WAIT_TIMEOUT) {
-        // Thread is stuck — terminate it to avoid hanging
-        TerminateThread(hThread, 1);
-        CloseHandle(hThread);
+    // Index was not in the type table; filter on the resolved name instead
+    if (type_decision == TypeFilter::Decision::Unknown &&
+        !ctx.type_filter.matches_name(resolved.type)) {
+        count(ctx, ScanCounter::SkippedType);
         return false;
     }
 
-    CloseHandle(hThread);
-    status = data.status;
+    if (CheckNames) {
+        PhaseTimer timer(ctx.stats, ScanPhase::Filter);
+        auto result = ctx.filter->check_name(resolved.name);
+        if (result != FilterExpr::NameResult::Match) {
+            count(ctx, result == FilterExpr::NameResult::NoDirMatch ? ScanCounter::SkippedDir : ScanCounter::SkippedFile);
+            return false;
+        }
+    }
     return true;
 }
 
-// Convert NT device path to DOS path
-std::string normalize_path(const std::string& nt_path) {
-    // Map \Device\HarddiskVolumeN to drive letters
-    char drives[512];
-    if (GetLogicalDriveStringsA(sizeof(drives) - 1, drives) == 0) return nt_path;
-
-    for (const char* drive = drives; *drive; drive += strlen(drive) + 1) {
-        char device_name[3] = { drive[0], drive[1], '\0' }; // "C:"
-        char target[MAX_PATH] = {};
-        if (QueryDosDeviceA(device_name, target, MAX_PATH) > 0) {
-            std::string target_str(target);
-            if (nt_path.compare(0, target_str.size(), target_str) == 0) {
-                return std::string(device_name) + nt_path.substr(target_str.size());
-            }
+// Walk one planned range, passing each result row to
+// emit(pid, const ProcessInfo&, ResolvedHandle&&, const RawHandle&).
+// Ranges never span processes and -p/-c were already applied by the planner,
+// which also decided whether this process's handles need the name checks;
+// the loop is instantiated once with and once without them.
+template <bool CheckNames, typename Emit>
+void scan_range(ScanContext& ctx, const Shard& shard, ProcessCache& proc_cache, Emit&& emit) {
+    const uint32_t pid = ctx.table[shard.begin].pid;
+    const ProcessInfo* proc = nullptr; // Looked up on the first row that needs it
+    if (past_deadline(ctx, shard.end - shard.begin)) return;
+
+    for (size_t i = shard.begin; i < shard.end; ++i) {
+        const auto& entry = ctx.table[i];
+
+        // Apply type filter from the raw type index, before touching the handle
+        auto type_decision = ctx.type_filter.check(entry.type_index);
+        if (type_decision == TypeFilter::Decision::Reject) {
+            count(ctx, ScanCounter::SkippedType);
+            continue;
         }
-    }
-    return nt_path;
-}
 
-} // anonymous namespace
+        if (!proc) proc = &process_for(ctx, pid, proc_cache);
 
-namespace lsofwin {
+        ResolvedHandle resolved;
+        if (!resolve_row<CheckNames>(ctx, entry, i, type_decision, resolved)) continue;
 
-std::string get_privilege_warning() {
-    if (!is_elevated()) {
-        std::string w;
-        w += color::c(color::BOLD_YELLOW);
-        w += "WARNING:";
-        w += color::c(color::RESET);
-        w += color::c(color::YELLOW);
-        w += " Not running as Administrator. Results may be incomplete.\n";
-        w += "         Run from an elevated command prompt for full results.\n";
-        w += color::c(color::RESET);
-        return w;
+        count(ctx, ScanCounter::Rows);
+        emit(pid, *proc, std::move(resolved), entry);
     }
-    return "";
 }
 
-HandleList enumerate_handles(const FilterOptions& opts) {
-    HandleList results;
-    DWORD timeout_ms = static_cast<DWORD>(opts.timeout_seconds) * 1000;
-
-    // Allocate buffer for system handle information
-    ULONG buffer_size = 1024 * 1024; // Start with 1 MB
-    auto buffer = std::make_unique<char[]>(buffer_size);
-    NTSTATUS status;
-    ULONG return_length = 0;
-
-    // Grow buffer until it fits
-    while (true) {
-        status = NtQuerySystemInformation(
-            (SYSTEM_INFORMATION_CLASS)SystemExtendedHandleInformationClass,
-            buffer.get(), buffer_size, &return_length);
-
-        if (status == (NTSTATUS)0xC0000004L) { // STATUS_INFO_LENGTH_MISMATCH
-            buffer_size = return_length + 65536;
-            buffer = std::make_unique<char[]>(buffer_size);
+template <typename Emit>
+void scan_shard(ScanContext& ctx, const Shard& shard, ProcessCache& proc_cache, Emit&& emit) {
+    if (shard.begin >= shard.end) return;
+    if (ctx.plan.check_names(ctx.table[shard.begin].pid)) {
+        scan_range<true>(ctx, shard, proc_cache, std::forward<Emit>(emit));
+    }
+    else {
+        scan_range<false>(ctx, shard, proc_cache, std::forward<Emit>(emit));
+    }
+}
+
+// Count one planned range for --group-by instead of emitting rows. Handles
+// are counted from the raw table entry alone unless -f / +d / +D need their
+// names or the type table cannot name their type; only those are resolved.
+void count_shard(ScanContext& ctx, const Shard& shard, HandleCounter& counter) {
+    if (shard.begin >= shard.end) return;
+    const bool need_names = ctx.plan.check_names(ctx.table[shard.begin].pid);
+    for (size_t i = shard.begin; i < shard.end; ++i) {
+        const auto& entry = ctx.table[i];
+        auto type_decision = ctx.type_filter.check(entry.type_index);
+        if (type_decision == TypeFilter::Decision::Reject) {
+            count(ctx, ScanCounter::SkippedType);
+            continue;
+        }
+
+        bool named_type = entry.type_index < ctx.type_names.size() &&
+            !ctx.type_names[entry.type_index].empty();
+        if (named_type && !need_names) {
+            count(ctx, ScanCounter::Rows);
+            counter.add(entry.pid, entry.type_index);
             continue;
         }
-        break;
+
+        ResolvedHandle resolved;
+        bool kept = need_names ? resolve_row<true>(ctx, entry, i, type_decision, resolved) :
+            resolve_row<false>(ctx, entry, i, type_decision, resolved);
+        if (!kept) continue;
+        count(ctx, ScanCounter::Rows);
+        if (named_type) counter.add(entry.pid, entry.type_index);
+        else counter.add(entry.pid, resolved.type);
     }
+}
 
-    if (status != 0) return results;
+HandleInfo make_handle_info(uint32_t pid, const ProcessInfo& proc, ResolvedHandle&& resolved,
+    const RawHandle& entry) {
+    HandleInfo hi;
+    hi.pid = pid;
+    hi.process_name = proc.name;
+    hi.user = proc.user;
+    hi.handle_type = std::move(resolved.type);
+    hi.object_name = std::move(resolved.name);
+    hi.handle_value = entry.handle_value;
+    hi.granted_access = entry.granted_access;
+    hi.attributes = entry.attributes;
+    hi.object = entry.object;
+    return hi;
+}
 
-    auto* handle_info = reinterpret_cast<SYSTEM_HANDLE_INFORMATION_EX*>(buffer.get());
+void scan_shard(ScanContext& ctx, const Shard& shard, ProcessCache& proc_cache,
+    HandleList& results) {
+    scan_shard(ctx, shard, proc_cache,
+        [&](uint32_t pid, const ProcessInfo& proc, ResolvedHandle&& resolved, const RawHandle& entry) {
+            results.push_back(make_handle_info(pid, proc, std::move(resolved), entry));
+        });
+}
 
-    // Build process cache
-    std::unordered_map<uint32_t, ProcessCacheEntry> proc_cache;
+// Rows go straight into the table; process name and user are not copied.
+void scan_shard(ScanContext& ctx, const Shard& shard, ProcessCache& proc_cache,
+    HandleTable& results) {
+    scan_shard(ctx, shard, proc_cache,
+        [&](uint32_t pid, const ProcessInfo& proc, ResolvedHandle&& resolved, const RawHandle& entry) {
+            results.add(results.add_process(pid, proc.name, proc.user), resolved.type, resolved.name,
+                entry.handle_value, entry.granted_access, entry.attributes, entry.object);
+        });
+}
+
+void append_results(HandleList& results, HandleList&& shard) {
+    std::move(shard.begin(), shard.end(), std::back_inserter(results));
+}
 
-    // Pre-compile regex if specified
-    std::regex file_regex;
-    bool use_regex = !opts.filter_file_regex.empty();
-    if (use_regex) {
-        file_regex = std::regex(opts.filter_file_regex, std::regex::icase);
+void append_results(HandleTable& results, HandleTable&& shard) {
+    results.append(shard);
+}
+
+void fill_stats(const ScanContext& ctx, EnumerationStats* stats) {
+    if (ctx.stats) {
+        ctx.stats->add(ScanCounter::HandlesSeen, ctx.table.size());
+        ctx.stats->add(ScanCounter::SkippedPlan, ctx.table.size() - ctx.plan.handles);
     }
+    if (!stats) return;
+    stats->handles_seen = ctx.table.size();
+    stats->handles_scanned = ctx.plan.handles;
+    stats->processes_matched = ctx.plan.processes_matched;
+    stats->handles_resolved = ctx.handles_resolved.load();
+    stats->handles_past_deadline = ctx.handles_past_deadline.load();
+    stats->object_cache = ctx.object_cache.stats();
+}
 
-    // Buffer for object queries
-    const ULONG obj_buf_size = 2048;
-    auto obj_buffer = std::make_unique<char[]>(obj_buf_size);
+// Compile the filters and plan the walk over a fresh snapshot.
+void prepare_scan(ScanContext& ctx, size_t threads) {
+    const auto& opts = ctx.opts;
+    ctx.timeout_ms = static_cast<uint32_t>(opts.timeout_seconds) * 1000;
 
-    for (ULONG_PTR i = 0; i < handle_info->NumberOfHandles; ++i) {
-        auto& entry = handle_info->Handles[i];
-        uint32_t pid = static_cast<uint32_t>(entry.UniqueProcessId);
+    PhaseTimer prepare_timer(ctx.stats, ScanPhase::Prepare);
+    if (ctx.stats) ctx.stats->set_type_names(ctx.type_names);
+    ctx.type_filter = TypeFilter(opts.filter_types, ctx.type_names);
 
-        // Apply PID filter early
-        if (opts.filter_pid >= 0 && static_cast<int>(pid) != opts.filter_pid) {
-            continue;
-        }
+    // Use the expression parse_args() compiled, or compile one for callers
+    // that only set the option values
+    ctx.filter = compile_filter(opts);
+    prepare_timer.stop();
 
-        // Lookup/cache process info
-        auto cache_it = proc_cache.find(pid);
-        if (cache_it == proc_cache.end()) {
-            ProcessCacheEntry pce;
-            pce.name = get_process_name(pid);
-            pce.user = get_process_user(pid);
-            proc_cache[pid] = std::move(pce);
-            cache_it = proc_cache.find(pid);
-        }
+    // Apply -p/-c once per process and keep only the matching table ranges
+    PhaseTimer plan_timer(ctx.stats, ScanPhase::Plan);
+    ctx.plan = plan_scan(PidIndex(ctx.table), ctx.source, *ctx.filter, threads, ctx.needs.user);
+}
 
-        // Apply process name filter
-        if (!opts.filter_process_name.empty()) {
-            const auto& pname = cache_it->second.name;
-            // Case-insensitive substring match
-            std::string pname_lower = pname;
-            std::string filter_lower = opts.filter_process_name;
-            std::transform(pname_lower.begin(), pname_lower.end(), pname_lower.begin(),
-                [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
-            std::transform(filter_lower.begin(), filter_lower.end(), filter_lower.begin(),
-                [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
-            if (pname_lower.find(filter_lower) == std::string::npos) {
-                continue;
-            }
-        }
+// Hands the ScanStats to the backend for one scan and times the whole of it.
+class StatsScope {
+public:
+    StatsScope(HandleSource& source, ScanStats* stats)
+        : source_(source), stats_(stats), timer_(stats, ScanPhase::Scan) {
+        if (stats_) source_.set_stats(stats_);
+    }
+    ~StatsScope() {
+        if (stats_) source_.set_stats(nullptr);
+    }
 
-        // Duplicate handle into our process to query it
-        HANDLE target_process = OpenProcess(PROCESS_DUP_HANDLE, FALSE, pid);
-        if (!target_process) continue;
+    StatsScope(const StatsScope&) = delete;
+    StatsScope& operator=(const StatsScope&) = delete;
 
-        HANDLE dup_handle = nullptr;
-        if (!DuplicateHandle(target_process, (HANDLE)(uintptr_t)entry.HandleValue,
-            GetCurrentProcess(), &dup_handle, 0, FALSE, DUPLICATE_SAME_ACCESS)) {
-            CloseHandle(target_process);
-            continue;
-        }
-        CloseHandle(target_process);
-
-        // Query object type
-        std::string type_name;
-        memset(obj_buffer.get(), 0, obj_buf_size);
-        ULONG obj_return_len = 0;
-        status = NtQueryObject(dup_handle, (OBJECT_INFORMATION_CLASS)ObjectTypeInformationClass,
-            obj_buffer.get(), obj_buf_size, &obj_return_len);
-
-        if (status == 0) {
-            auto* type_info = reinterpret_cast<ObjectTypeInfo*>(obj_buffer.get());
-            type_name = wide_to_narrow(type_info->TypeName.Buffer,
-                type_info->TypeName.Length / sizeof(WCHAR));
-        }
+private:
+    HandleSource& source_;
+    ScanStats* stats_;
+    PhaseTimer timer_;
+};
 
-        // Query object name with timeout
-        std::string object_name;
-        memset(obj_buffer.get(), 0, obj_buf_size);
-        NTSTATUS name_status;
-        if (query_object_name_with_timeout(dup_handle, obj_buffer.get(), obj_buf_size,
-            name_status, timeout_ms)) {
-            if (name_status == 0) {
-                auto* name_info = reinterpret_cast<ObjectNameInfo*>(obj_buffer.get());
-                if (name_info->Name.Length > 0) {
-                    object_name = wide_to_narrow(name_info->Name.Buffer,
-                        name_info->Name.Length / sizeof(WCHAR));
-                    object_name = normalize_path(object_name);
-                }
-            }
-        }
+// Take the snapshot, timing it as its own phase.
+bool take_snapshot(HandleSource& source, std::vector<RawHandle>& table, ScanStats* stats) {
+    PhaseTimer timer(stats, ScanPhase::Snapshot);
+    return source.snapshot(table);
+}
 
-        CloseHandle(dup_handle);
+size_t effective_thread_count(int requested) {
+    if (requested > 0) return static_cast<size_t>(requested);
+    return (std::max)(1u, std::thread::hardware_concurrency());
+}
 
-        // Apply file regex filter
-        if (use_regex && !object_name.empty()) {
-            if (!std::regex_search(object_name, file_regex)) {
-                continue;
-            }
-        }
-        else if (use_regex && object_name.empty()) {
-            continue; // regex specified but no name to match
+// Collect every result row into a HandleList or a HandleTable.
+template <typename Result>
+Result collect_handles(HandleSource& source, const FilterOptions& opts, EnumerationStats* stats,
+    ScanStats* scan_stats) {
+    Result results;
+    auto started = ScanDeadline::Clock::now();
+    size_t threads = effective_thread_count(opts.threads);
+    source.set_parallelism(threads);
+    StatsScope scope(source, scan_stats);
+
+    std::vector<RawHandle> table;
+    if (!take_snapshot(source, table, scan_stats)) return results;
+
+    ScanContext ctx(source, opts, table, started);
+    ctx.stats = scan_stats;
+    ctx.needs = field_needs(opts.fields);
+    prepare_scan(ctx, threads);
+
+    if (threads <= 1) {
+        ProcessCache proc_cache;
+        for (const auto& range : ctx.plan.ranges) {
+            scan_shard(ctx, range, proc_cache, results);
         }
+        fill_stats(ctx, stats);
+        return results;
+    }
 
-        HandleInfo hi;
-        hi.pid = pid;
-        hi.process_name = cache_it->second.name;
-        hi.user = cache_it->second.user;
-        hi.handle_type = type_name;
-        hi.object_name = object_name;
-        hi.handle_value = entry.HandleValue;
+    // Split the planned ranges into shards, resolve them on a work-stealing
+    // pool, then concatenate in shard order so output matches a
+    // single-threaded run.
+    auto shards = split_shards(ctx.plan.ranges, default_shard_size(ctx.plan.handles, threads));
+    std::vector<Result> shard_results(shards.size());
+    std::vector<ProcessCache> caches(threads);
+
+    run_work_stealing(shards.size(), threads, [&](size_t task, size_t worker) {
+        scan_shard(ctx, shards[task], caches[worker], shard_results[task]);
+    });
+
+    size_t total = 0;
+    for (const auto& r : shard_results) total += r.size();
+    results.reserve(total);
+    for (auto& r : shard_results) {
+        append_results(results, std::move(r));
+    }
+    fill_stats(ctx, stats);
+    return results;
+}
 
-        results.push_back(std::move(hi));
+// Count every planned range into counter, on `threads` workers with one
+// counter each, merged at the end; counts do not depend on the order shards
+// finish in.
+void count_scan(ScanContext& ctx, size_t threads, HandleCounter& counter) {
+    if (threads <= 1) {
+        for (const auto& range : ctx.plan.ranges) count_shard(ctx, range, counter);
+        return;
     }
+    auto shards = split_shards(ctx.plan.ranges, default_shard_size(ctx.plan.handles, threads));
+    std::vector<HandleCounter> counters(threads);
+    run_work_stealing(shards.size(), threads, [&](size_t task, size_t worker) {
+        count_shard(ctx, shards[task], counters[worker]);
+    });
+    for (const auto& c : counters) counter.merge(c);
+}
 
-    return results;
+} // anonymous namespace
+
+HandleList enumerate_handles(HandleSource& source, const FilterOptions& opts,
+    EnumerationStats* stats, ScanStats* scan_stats) {
+    return collect_handles<HandleList>(source, opts, stats, scan_stats);
+}
+
+HandleSummary summarize_handles(HandleSource& source, const FilterOptions& opts,
+    EnumerationStats* stats, ScanStats* scan_stats) {
+    HandleSummary summary;
+    summary.keys = opts.group_by;
+    auto started = ScanDeadline::Clock::now();
+    size_t threads = effective_thread_count(opts.threads);
+    source.set_parallelism(threads);
+    StatsScope scope(source, scan_stats);
+
+    std::vector<RawHandle> table;
+    if (!take_snapshot(source, table, scan_stats)) return summary;
+
+    ScanContext ctx(source, opts, table, started);
+    ctx.stats = scan_stats;
+    // Owners only when grouping by them; -c and pid groups need names alone
+    ctx.needs.user = std::find(opts.group_by.begin(), opts.group_by.end(), GroupKey::User) != opts.group_by.end();
+    prepare_scan(ctx, threads);
+
+    HandleCounter counter;
+    count_scan(ctx, threads, counter);
+
+    ProcessCache proc_cache;
+    summary = summarize_counts(counter, opts.group_by, ctx.type_names, opts.summary_top,
+        [&](uint32_t pid) -> const ProcessInfo& { return process_for(ctx, pid, proc_cache); });
+    fill_stats(ctx, stats);
+    return summary;
+}
+
+bool count_handles(HandleSource& source, const FilterOptions& opts, HandleCounter& counter,
+    std::vector<std::string>& type_names, ScanStats* scan_stats) {
+    auto started = ScanDeadline::Clock::now();
+    size_t threads = effective_thread_count(opts.threads);
+    source.set_parallelism(threads);
+    StatsScope scope(source, scan_stats);
+
+    std::vector<RawHandle> table;
+    if (!take_snapshot(source, table, scan_stats)) return false;
+
+    ScanContext ctx(source, opts, table, started);
+    ctx.stats = scan_stats;
+    ctx.needs.user = false;         // Counts never show owners
+    prepare_scan(ctx, threads);
+    count_scan(ctx, threads, counter);
+    fill_stats(ctx, nullptr);
+    type_names = std::move(ctx.type_names);
+    return true;
+}
+
+HandleTable enumerate_handle_table(const FilterOptions& opts) {
+    auto source = make_system_handle_source(opts.raw_account_ids);
+    return enumerate_handle_table(*source, opts);
+}
+
+HandleTable enumerate_handle_table(HandleSource& source, const FilterOptions& opts,
+    EnumerationStats* stats, ScanStats* scan_stats) {
+    return collect_handles<HandleTable>(source, opts, stats, scan_stats);
+}
+
+void stream_handles(const FilterOptions& opts, const RowCallback& emit) {
+    auto source = make_system_handle_source(opts.raw_account_ids);
+    stream_handles(*source, opts, emit);
+}
+
+void stream_handles(HandleSource& source, const FilterOptions& opts, const RowCallback& emit,
+    EnumerationStats* stats, ScanStats* scan_stats) {
+    auto started = ScanDeadline::Clock::now();
+    size_t threads = effective_thread_count(opts.threads);
+    source.set_parallelism(threads);
+    StatsScope scope(source, scan_stats);
+
+    std::vector<RawHandle> table;
+    if (!take_snapshot(source, table, scan_stats)) return;
+
+    ScanContext ctx(source, opts, table, started);
+    ctx.stats = scan_stats;
+    ctx.needs = field_needs(opts.fields);
+    prepare_scan(ctx, threads);
+
+    if (threads <= 1) {
+        ProcessCache proc_cache;
+        for (const auto& range : ctx.plan.ranges) {
+            scan_shard(ctx, range, proc_cache,
+                [&](uint32_t pid, const ProcessInfo& proc, ResolvedHandle&& resolved, const RawHandle& entry) {
+                    HandleInfo hi = make_handle_info(pid, proc, std::move(resolved), entry);
+                    PhaseTimer timer(scan_stats, ScanPhase::Output);
+                    emit(hi);
+                });
+        }
+        fill_stats(ctx, stats);
+        return;
+    }
+
+    // Shards are handed out in table order and each finished shard is
+    // emitted as soon as every shard before it is done, so only the shards
+    // currently in flight are ever buffered.
+    auto shards = split_shards(ctx.plan.ranges, default_shard_size(ctx.plan.handles, threads));
+    std::vector<HandleList> pending(shards.size());
+    std::vector<char> done(shards.size(), 0);
+    std::vector<ProcessCache> caches(threads);
+    std::mutex emit_mutex;
+    size_t next_to_emit = 0;
+
+    run_in_order(shards.size(), threads, [&](size_t task, size_t worker) {
+        HandleList rows;
+        scan_shard(ctx, shards[task], caches[worker], rows);
+
+        std::lock_guard<std::mutex> lock(emit_mutex);
+        pending[task] = std::move(rows);
+        done[task] = 1;
+        while (next_to_emit < shards.size() && done[next_to_emit]) {
+            PhaseTimer timer(scan_stats, ScanPhase::Output);
+            for (const auto& hi : pending[next_to_emit]) emit(hi);
+            HandleList().swap(pending[next_to_emit]);
+            ++next_to_emit;
+        }
+    });
+    fill_stats(ctx, stats);
 }
 
 } // namespace lsofwin
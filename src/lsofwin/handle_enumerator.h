@@ -1,6 +1,12 @@
 #pragma once
 
 #include "handle_info.h"
+#include "handle_source.h"
+#include "handle_summary.h"
+#include "handle_table.h"
+#include "object_cache.h"
+#include "scan_stats.h"
+#include <functional>
 #include <string>
 
 namespace lsofwin {
@@ -9,6 +15,54 @@ namespace lsofwin {
 // Returns a list of HandleInfo. timeout_ms is per-handle query timeout.
 HandleList enumerate_handles(const FilterOptions& opts);
 
+// Counters collected during one enumeration.
+struct EnumerationStats {
+    uint64_t handles_seen = 0;          // Entries in the raw table
+    uint64_t handles_scanned = 0;       // Entries left after the -p/-c plan
+    uint64_t processes_matched = 0;     // Distinct PIDs left after -p/-c
+    uint64_t handles_resolved = 0;      // Entries passed to HandleSource::resolve()
+    uint64_t handles_past_deadline = 0; // Entries left unresolved because --deadline passed
+    ObjectCache::Stats object_cache;    // Object-address dedupe cache
+};
+
+// Enumerate handles from an explicit backend (native or synthetic).
+// If stats is non-null it is filled with counters for this scan. If
+// scan_stats is non-null, phase timings, skip counters and resolve latencies
+// are added to it (--stats) and the backend is given it for the scan.
+HandleList enumerate_handles(HandleSource& source, const FilterOptions& opts,
+    EnumerationStats* stats = nullptr, ScanStats* scan_stats = nullptr);
+
+// Enumerate into the compact HandleTable instead of a HandleList; rows come
+// out in the same order. Process names and users are stored once per process.
+HandleTable enumerate_handle_table(const FilterOptions& opts);
+HandleTable enumerate_handle_table(HandleSource& source, const FilterOptions& opts,
+    EnumerationStats* stats = nullptr, ScanStats* scan_stats = nullptr);
+
+// --summary / --group-by: count the handles that pass the filters per
+// opts.group_by group instead of producing rows. Nothing is resolved unless
+// -f / +d / +D need names or a type index is missing from the type table, so
+// the counts come from the system handle table itself: on Windows that
+// includes handles of processes that could not be opened, which a listing
+// leaves out.
+HandleSummary summarize_handles(HandleSource& source, const FilterOptions& opts,
+    EnumerationStats* stats = nullptr, ScanStats* scan_stats = nullptr);
+
+// The counting walk behind summarize_handles(), for callers that fold the
+// counts themselves (--metrics): adds per-process, per-type counts to
+// counter and returns the type table they index. False if the snapshot failed.
+bool count_handles(HandleSource& source, const FilterOptions& opts, HandleCounter& counter,
+    std::vector<std::string>& type_names, ScanStats* scan_stats = nullptr);
+
+// Receives result rows in the order enumerate_handles() would return them.
+using RowCallback = std::function<void(const HandleInfo&)>;
+
+// Streaming variants: each row is handed to `emit` as soon as it and every
+// row before it are resolved, instead of collecting the whole list. `emit`
+// is never called concurrently; with scan_stats its time counts as Output.
+void stream_handles(const FilterOptions& opts, const RowCallback& emit);
+void stream_handles(HandleSource& source, const FilterOptions& opts, const RowCallback& emit,
+    EnumerationStats* stats = nullptr, ScanStats* scan_stats = nullptr);
+
 // Returns a human-readable privilege warning if not elevated, empty otherwise.
 std::string get_privilege_warning();
 
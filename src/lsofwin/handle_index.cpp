@@ -0,0 +1,146 @@
+#include "handle_index.h"
+#include "filter_expr.h"
+#include "path_matcher.h"
+#include "type_filter.h"
+
+#include <algorithm>
+
+namespace lsofwin {
+
+namespace {
+
+void remove_slot(std::vector<uint32_t>& slots, uint32_t slot) {
+    auto it = std::find(slots.begin(), slots.end(), slot);
+    if (it == slots.end()) return;
+    *it = slots.back();
+    slots.pop_back();
+}
+
+} // anonymous namespace
+
+void HandleIndex::apply(const std::vector<HandleEvent>& events) {
+    for (const auto& e : events) {
+        if (e.kind == HandleEvent::Kind::Close) erase(e.handle);
+    }
+    for (const auto& e : events) {
+        if (e.kind == HandleEvent::Kind::Open) insert(e.handle);
+    }
+
+    // Names of closed handles and exited processes stay interned until the
+    // table is compacted; do so once they could outnumber the live ones
+    if (rows_.strings().size() + rows_.processes().size() > 4 * rows_.size() + 1024) rows_.compact();
+}
+
+void HandleIndex::insert(const HandleInfo& h) {
+    // A row still present under this key was never closed; replace it
+    erase(h);
+
+    uint32_t slot;
+    if (!free_rows_.empty()) {
+        slot = free_rows_.back();
+        free_rows_.pop_back();
+        rows_.set(slot, h);
+    } else {
+        slot = static_cast<uint32_t>(rows_.size());
+        rows_.push_back(h);
+    }
+    by_handle_[SlotKey{ h.pid, h.handle_value }] = slot;
+    by_pid_[h.pid].push_back(slot);
+    if (!h.object_name.empty()) paths_.insert(h.object_name, slot);
+}
+
+void HandleIndex::erase(const HandleInfo& h) {
+    auto it = by_handle_.find(SlotKey{ h.pid, h.handle_value });
+    if (it == by_handle_.end()) return;
+    uint32_t slot = it->second;
+    by_handle_.erase(it);
+
+    auto row = rows_[slot];
+    auto pid_it = by_pid_.find(row.pid());
+    if (pid_it != by_pid_.end()) {
+        remove_slot(pid_it->second, slot);
+        if (pid_it->second.empty()) by_pid_.erase(pid_it);
+    }
+    if (!row.object_name().empty()) paths_.erase(row.object_name(), slot);
+    rows_.set(slot, HandleInfo{});
+    free_rows_.push_back(slot);
+}
+
+HandleIndex::QueryStats HandleIndex::query(const FilterOptions& opts,
+    const std::function<void(const HandleInfo&)>& emit) const {
+    auto filter = compile_filter(opts);
+    TypeFilter types(opts.filter_types, {});
+
+    QueryStats stats;
+    std::vector<uint32_t> matched;
+    auto consider = [&](const std::vector<uint32_t>& slots) {
+        for (uint32_t slot : slots) {
+            ++stats.rows_examined;
+            auto h = rows_[slot];
+            if (types.active() && !types.matches_name(std::string(h.handle_type()))) continue;
+            if (!filter->matches(h.pid(), h.process_name(), h.object_name())) continue;
+            matched.push_back(slot);
+        }
+    };
+
+    // Rows for each -p PID, +d / +D directory or exact -f path, through
+    // by_pid_ and the trie
+    auto pid_slots = [&](std::vector<uint32_t>& slots) {
+        for (uint32_t pid : filter->pids()) {
+            auto it = by_pid_.find(pid);
+            if (it != by_pid_.end()) slots.insert(slots.end(), it->second.begin(), it->second.end());
+        }
+    };
+    auto dir_slots = [&](std::vector<uint32_t>& slots) {
+        for (const auto& d : filter->dirs()) {
+            paths_.lookup(d.path, d.recursive ? PathTrie::Scope::Subtree : PathTrie::Scope::Children, slots);
+        }
+    };
+    auto exact_slots = [&](std::vector<uint32_t>& slots) {
+        for (const auto& m : filter->matchers()) paths_.lookup(m->literal(), PathTrie::Scope::Exact, slots);
+    };
+    const auto& matchers = filter->matchers();
+    bool all_exact = !matchers.empty() && std::all_of(matchers.begin(), matchers.end(),
+        [](const std::shared_ptr<const PathMatcher>& m) { return m->strategy() == PathMatcher::Strategy::Exact; });
+
+    // Narrow to the rows one selection can match when the query allows it:
+    // ANDed, any one indexed option will do; with --or, every selection must
+    // be indexed and the rows are their union. Nested directories and
+    // repeated paths can list a row twice.
+    std::vector<uint32_t> slots;
+    bool narrowed = true;
+    if (!filter->any() && !filter->pids().empty()) {
+        pid_slots(slots);
+    } else if (!filter->any() && !filter->dirs().empty()) {
+        dir_slots(slots);
+    } else if (!filter->any() && all_exact) {
+        exact_slots(slots);
+    } else if (filter->any() && !filter->empty() && !filter->has_process_names() &&
+        (matchers.empty() || all_exact)) {
+        pid_slots(slots);
+        dir_slots(slots);
+        if (all_exact) exact_slots(slots);
+    } else {
+        narrowed = false;
+    }
+
+    if (narrowed) {
+        std::sort(slots.begin(), slots.end());
+        slots.erase(std::unique(slots.begin(), slots.end()), slots.end());
+        consider(slots);
+    } else {
+        for (const auto& entry : by_pid_) consider(entry.second);
+    }
+
+    std::sort(matched.begin(), matched.end(), [&](uint32_t a, uint32_t b) {
+        auto x = rows_[a];
+        auto y = rows_[b];
+        if (x.pid() != y.pid()) return x.pid() < y.pid();
+        return x.handle_value() < y.handle_value();
+    });
+    for (uint32_t slot : matched) emit(rows_[slot].to_info());
+    stats.rows_matched = matched.size();
+    return stats;
+}
+
+} // namespace lsofwin
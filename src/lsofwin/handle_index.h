@@ -0,0 +1,67 @@
+#pragma once
+
+#include "handle_info.h"
+#include "handle_table.h"
+#include "handle_watcher.h"
+#include "path_trie.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace lsofwin {
+
+// In-memory index of open handles for --serve, kept current by applying the
+// open/close events of a HandleWatcher. Rows are looked up by PID and through
+// a path trie, so the common questions ("what does PID n hold?", "who holds
+// this file?", "what is open under this directory?", i.e. -p, an exact
+// -f "^...$" and +d/+D) only touch the rows they return. Every other query
+// scans the rows with the same -p/-c/-T/-f/+d/+D semantics as a live scan.
+// The rows themselves live in a HandleTable, so a whole-system index holds
+// each process's name and user once and each distinct object name once.
+class HandleIndex {
+public:
+    // What a query() did: how many rows it looked at and how many it returned.
+    struct QueryStats {
+        size_t rows_examined = 0;
+        size_t rows_matched = 0;
+    };
+
+    // Apply one poll's events. Closes are applied first, so a handle value
+    // reused by a new process with a recycled PID replaces the old row.
+    void apply(const std::vector<HandleEvent>& events);
+
+    // Emit the rows matching opts (the -p/-c/-f/+d/+D expression and
+    // filter_types) in (pid, handle value) order.
+    QueryStats query(const FilterOptions& opts,
+        const std::function<void(const HandleInfo&)>& emit) const;
+
+    size_t size() const { return rows_.size() - free_rows_.size(); }
+    size_t process_count() const { return by_pid_.size(); }
+
+private:
+    struct SlotKey {
+        uint32_t pid;
+        uintptr_t handle_value;
+        bool operator==(const SlotKey& o) const { return pid == o.pid && handle_value == o.handle_value; }
+    };
+    struct SlotKeyHash {
+        size_t operator()(const SlotKey& k) const {
+            return std::hash<uint64_t>()((static_cast<uint64_t>(k.pid) << 32) ^ static_cast<uint64_t>(k.handle_value));
+        }
+    };
+
+    void insert(const HandleInfo& h);
+    void erase(const HandleInfo& h);
+
+    HandleTable rows_;
+    std::vector<uint32_t> free_rows_;   // Slots of closed handles, left empty
+    std::unordered_map<SlotKey, uint32_t, SlotKeyHash> by_handle_;
+    std::unordered_map<uint32_t, std::vector<uint32_t>> by_pid_;
+    PathTrie paths_;    // Object name -> row
+};
+
+} // namespace lsofwin
@@ -1,11 +1,14 @@
 #pragma once
 
+#include <memory>
 #include <string>
 #include <vector>
 #include <cstdint>
 
 namespace lsofwin {
 
+class FilterExpr;
+
 struct HandleInfo {
     uint32_t    pid = 0;
     std::string process_name;
@@ -13,14 +16,67 @@ struct HandleInfo {
     std::string handle_type;
     std::string object_name;
     uintptr_t   handle_value = 0;
+    uint32_t    granted_access = 0;     // From the raw table entry (RawHandle)
+    uint32_t    attributes = 0;
+    uintptr_t   object = 0;             // Kernel object address (0 = unknown)
+};
+
+// -o / --fields columns (field_projection.h).
+enum class OutputField : uint8_t {
+    Command,    // Process name
+    Pid,
+    User,       // Process owner
+    Fd,         // Handle value (fd number on Linux)
+    Type,       // Object type
+    Name,       // Object name
+    Access,     // Granted access mask
+    Attributes, // Handle attributes (inherit, protect from close)
+    Object,     // Kernel object address
+    Count
+};
+
+// --group-by keys, in the order given.
+enum class GroupKey : uint8_t {
+    Pid,    // Process (PID and command name)
+    Type,   // Object type
+    User,   // Process owner
+};
+
+// One +d / +D directory.
+struct DirSelection {
+    std::string path;
+    bool        recursive = false;      // +D: the whole subtree, not just its top level
 };
 
 struct FilterOptions {
-    int          filter_pid = -1;        // -p: filter by PID (-1 = no filter)
-    std::string  filter_process_name;    // -c: filter by process name substring
-    std::string  filter_file_regex;      // -f: filter by file path regex
+    std::vector<uint32_t> filter_pids;  // -p: show these PIDs
+    std::vector<std::string> filter_process_names; // -c: process name substrings
+    std::vector<std::string> filter_file_regexes;  // -f: file path regexes
+    std::vector<DirSelection> filter_dirs;         // +d / +D: directories whose entries to show
+    bool         filter_any = false;     // --or: show handles matching any of -p, -c, -f, +d/+D (default: all)
+    std::shared_ptr<const FilterExpr> filter; // The above compiled by parse_args (optional; filter_expr.h)
+    std::vector<std::string> filter_types; // -T: filter by object type name(s)
+    std::vector<OutputField> fields;     // -o / --fields: columns to show, in order (empty = command, pid, user, type, name)
     int          timeout_seconds = 5;    // -t: timeout per operation in seconds
+    uint32_t     deadline_ms = 0;        // --deadline: stop resolving after this long and show what was found (0 = none)
+    int          repeat_seconds = 0;     // -r: rescan every N seconds, printing open/close deltas (0 = once)
+    int          threads = 1;            // -J: worker threads for handle resolution (0 = all cores)
+    bool         raw_account_ids = false; // -l: show process owners as SIDs / uids, without account lookups
     bool         output_json = false;    // -j: output as JSON
+    bool         output_ndjson = false;  // --ndjson: output one JSON object per line
+    bool         output_binary = false;  // --binary: compact binary result (binary_output.h)
+    size_t       table_sample_rows = 1000; // --widths: size table columns from the first N rows (0 = fixed)
+    std::string  decode_file;            // --decode: print a saved --binary result instead of scanning
+    std::string  record_file;            // --record: also save the raw snapshot and its resolutions (handle_recording.h)
+    std::string  replay_file;            // --replay: scan a --record file instead of the system
+    bool         serve = false;          // --serve: keep an index current and answer queries over a local socket
+    bool         use_server = false;     // --client: ask a running --serve instance, scanning locally if none
+    std::string  socket_path;            // --socket: pipe / socket for --serve and --client (empty = default)
+    std::vector<GroupKey> group_by;      // --summary / --group-by: count handles per group instead of listing them (handle_summary.h)
+    size_t       summary_top = 0;        // --top: only the N largest groups (0 = all)
+    std::string  metrics_file;           // --metrics: keep an OpenMetrics textfile of handle counts current (metrics_exporter.h)
+    bool         show_stats = false;     // --stats: print phase timings and counters to stderr (scan_stats.h)
+    bool         stats_json = false;     // --stats-json: the same as one JSON object on stderr
     bool         show_help = false;      // -h: show help
     bool         show_version = false;   // -v: show version
 };
@@ -0,0 +1,280 @@
+#include "handle_recording.h"
+#include "string_pool.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace lsofwin {
+
+namespace {
+
+constexpr size_t SectionAlignment = 8;
+
+uint32_t element_size(RecordingSection s) {
+    switch (s) {
+    case RecordingSection::StringBytes: return 1;
+    case RecordingSection::Processes:   return sizeof(RecordedProcess);
+    case RecordingSection::Handles:     return sizeof(RecordedHandle);
+    default:                            return sizeof(uint32_t);
+    }
+}
+
+} // anonymous namespace
+
+bool RecordingHandleSource::snapshot(std::vector<RawHandle>& table) {
+    if (!inner_.snapshot(table)) return false;
+    table_ = table;
+    resolved_.assign(table.size(), Resolution{});
+    type_names_.clear();
+    return true;
+}
+
+std::vector<std::string> RecordingHandleSource::type_names() {
+    type_names_ = inner_.type_names();
+    return type_names_;
+}
+
+ProcessInfo RecordingHandleSource::process_info(uint32_t pid) {
+    ProcessInfo info = inner_.process_info(pid);
+    std::lock_guard<std::mutex> lock(process_mutex_);
+    processes_[pid] = info;
+    return info;
+}
+
+bool RecordingHandleSource::resolve(const RawHandle& entry, size_t index, uint32_t timeout_ms,
+    ResolvedHandle& out) {
+    bool ok = inner_.resolve(entry, index, timeout_ms, out);
+    if (index < resolved_.size()) {
+        Resolution& r = resolved_[index];
+        r.state = !ok ? RecordedState::Inaccessible
+            : out.timed_out ? RecordedState::TimedOut : RecordedState::Resolved;
+        if (ok) r.handle = out;
+    }
+    return ok;
+}
+
+void RecordingHandleSource::write(OutputBuffer& out) {
+    StringPool strings;
+
+    std::vector<uint32_t> type_names;
+    type_names.reserve(type_names_.size());
+    for (const auto& t : type_names_) type_names.push_back(strings.intern(t));
+
+    std::vector<uint32_t> pids;
+    pids.reserve(table_.size());
+    for (const auto& entry : table_) {
+        if (pids.empty() || pids.back() != entry.pid) pids.push_back(entry.pid);
+    }
+    std::sort(pids.begin(), pids.end());
+    pids.erase(std::unique(pids.begin(), pids.end()), pids.end());
+
+    std::vector<RecordedProcess> processes;
+    processes.reserve(pids.size());
+    for (uint32_t pid : pids) {
+        auto it = processes_.find(pid);
+        ProcessInfo info = it != processes_.end() ? it->second : inner_.process_info(pid);
+        processes.push_back(RecordedProcess{ inner_.process_start_time(pid), pid,
+            strings.intern(info.name), strings.intern(info.user), inner_.is_process_accessible(pid) ? 1u : 0u });
+    }
+
+    std::vector<RecordedHandle> handles(table_.size());
+    for (size_t i = 0; i < table_.size(); ++i) {
+        const RawHandle& raw = table_[i];
+        const Resolution& r = resolved_[i];
+        RecordedHandle& h = handles[i];
+        h.handle_value = raw.handle_value;
+        h.object = raw.object;
+        h.pid = raw.pid;
+        h.granted_access = raw.granted_access;
+        h.attributes = raw.attributes;
+        h.type = strings.intern(r.handle.type);
+        h.name = strings.intern(r.handle.name);
+        h.type_index = raw.type_index;
+        h.state = static_cast<uint8_t>(r.state);
+        h.reserved = 0;
+    }
+
+    RecordingHeader header{};
+    std::memcpy(header.magic, RecordingMagic, sizeof(RecordingMagic));
+    header.version = RecordingVersion;
+    header.section_count = static_cast<uint32_t>(RecordingSectionCount);
+    header.handle_count = handles.size();
+
+    const size_t counts[RecordingSectionCount] = {
+        strings.offsets().size(), strings.bytes().size(), type_names.size(), processes.size(), handles.size(),
+    };
+    uint64_t offset = sizeof(RecordingHeader);
+    for (size_t i = 0; i < RecordingSectionCount; ++i) {
+        offset = (offset + SectionAlignment - 1) / SectionAlignment * SectionAlignment;
+        header.sections[i].offset = offset;
+        header.sections[i].count = counts[i];
+        header.sections[i].width = element_size(static_cast<RecordingSection>(i));
+        offset += counts[i] * header.sections[i].width;
+    }
+
+    out.append(std::string_view(reinterpret_cast<const char*>(&header), sizeof(header)));
+    uint64_t written = sizeof(RecordingHeader);
+    auto section = [&](RecordingSection s, const void* data) {
+        const auto& entry = header.sections[static_cast<size_t>(s)];
+        out.append_fill('\0', static_cast<size_t>(entry.offset - written));
+        out.append(std::string_view(static_cast<const char*>(data), static_cast<size_t>(entry.count * entry.width)));
+        written = entry.offset + entry.count * entry.width;
+    };
+    section(RecordingSection::StringOffsets, strings.offsets().data());
+    section(RecordingSection::StringBytes, strings.bytes().data());
+    section(RecordingSection::TypeNames, type_names.data());
+    section(RecordingSection::Processes, processes.data());
+    section(RecordingSection::Handles, handles.data());
+    out.flush();
+}
+
+bool ReplayHandleSource::open(const void* data, size_t size, std::string& error_msg) {
+    data_ = static_cast<const unsigned char*>(data);
+    size_ = size;
+
+    if (size < sizeof(RecordingHeader)) {
+        error_msg = "File is too small to be a recording";
+        return false;
+    }
+    std::memcpy(&header_, data_, sizeof(RecordingHeader));
+    if (std::memcmp(header_.magic, RecordingMagic, sizeof(RecordingMagic)) != 0) {
+        error_msg = "Not a handle recording (bad magic)";
+        return false;
+    }
+    if (header_.version != RecordingVersion) {
+        error_msg = "Unsupported recording version " + std::to_string(header_.version);
+        return false;
+    }
+    if (header_.section_count < RecordingSectionCount) {
+        error_msg = "Recording is missing sections";
+        return false;
+    }
+    for (size_t i = 0; i < RecordingSectionCount; ++i) {
+        const auto& s = header_.sections[i];
+        if (s.width != element_size(static_cast<RecordingSection>(i))) {
+            error_msg = "Recording section " + std::to_string(i) + " has a bad element width";
+            return false;
+        }
+        if (s.offset > size || s.count > (size - s.offset) / s.width) {
+            error_msg = "Recording section " + std::to_string(i) + " is out of bounds";
+            return false;
+        }
+    }
+    if (section(RecordingSection::StringOffsets).count == 0) {
+        error_msg = "Recording has no string table";
+        return false;
+    }
+    if (section(RecordingSection::Handles).count != header_.handle_count) {
+        error_msg = "Recording handle count does not match its handle table";
+        return false;
+    }
+    return true;
+}
+
+template <typename T>
+T ReplayHandleSource::load(RecordingSection s, uint64_t index) const {
+    // memcpy keeps unaligned buffers (a file read into a std::string) legal
+    T value;
+    std::memcpy(&value, data_ + section(s).offset + index * sizeof(T), sizeof(T));
+    return value;
+}
+
+std::string_view ReplayHandleSource::string(uint64_t id) const {
+    if (id + 1 >= section(RecordingSection::StringOffsets).count) return {};
+    uint32_t begin = load<uint32_t>(RecordingSection::StringOffsets, id);
+    uint32_t end = load<uint32_t>(RecordingSection::StringOffsets, id + 1);
+    if (begin > end || end > section(RecordingSection::StringBytes).count) return {};
+    return std::string_view(reinterpret_cast<const char*>(data_) +
+        section(RecordingSection::StringBytes).offset + begin, end - begin);
+}
+
+bool ReplayHandleSource::snapshot(std::vector<RawHandle>& table) {
+    table.resize(static_cast<size_t>(header_.handle_count));
+    for (size_t i = 0; i < table.size(); ++i) {
+        RecordedHandle h = load<RecordedHandle>(RecordingSection::Handles, i);
+        RawHandle& raw = table[i];
+        raw.pid = h.pid;
+        raw.handle_value = static_cast<uintptr_t>(h.handle_value);
+        raw.object = static_cast<uintptr_t>(h.object);
+        raw.granted_access = h.granted_access;
+        raw.attributes = h.attributes;
+        raw.type_index = h.type_index;
+    }
+    return true;
+}
+
+std::vector<std::string> ReplayHandleSource::type_names() {
+    std::vector<std::string> names(static_cast<size_t>(section(RecordingSection::TypeNames).count));
+    for (size_t i = 0; i < names.size(); ++i) {
+        names[i] = std::string(string(load<uint32_t>(RecordingSection::TypeNames, i)));
+    }
+    return names;
+}
+
+bool ReplayHandleSource::find_process(uint32_t pid, RecordedProcess& out) const {
+    // Processes are sorted by pid
+    uint64_t lo = 0;
+    uint64_t hi = section(RecordingSection::Processes).count;
+    while (lo < hi) {
+        uint64_t mid = lo + (hi - lo) / 2;
+        RecordedProcess p = load<RecordedProcess>(RecordingSection::Processes, mid);
+        if (p.pid == pid) {
+            out = p;
+            return true;
+        }
+        if (p.pid < pid) lo = mid + 1;
+        else hi = mid;
+    }
+    return false;
+}
+
+ProcessInfo ReplayHandleSource::process_info(uint32_t pid) {
+    RecordedProcess p;
+    if (!find_process(pid, p)) return {};
+    return ProcessInfo{ std::string(string(p.name)), std::string(string(p.user)) };
+}
+
+uint64_t ReplayHandleSource::process_start_time(uint32_t pid) {
+    RecordedProcess p;
+    return find_process(pid, p) ? p.start_time : 0;
+}
+
+bool ReplayHandleSource::is_process_accessible(uint32_t pid) {
+    RecordedProcess p;
+    return !find_process(pid, p) || p.accessible != 0;
+}
+
+bool ReplayHandleSource::resolve_record(const RecordedHandle& h, ResolvedHandle& out) const {
+    auto state = static_cast<RecordedState>(h.state);
+    if (state != RecordedState::Resolved && state != RecordedState::TimedOut) return false;
+    out.type.assign(string(h.type));
+    out.name.assign(string(h.name));
+    out.timed_out = state == RecordedState::TimedOut;
+    return true;
+}
+
+bool ReplayHandleSource::resolve(const RawHandle& entry, size_t index, uint32_t /*timeout_ms*/,
+    ResolvedHandle& out) {
+    if (index >= header_.handle_count) return false;
+    RecordedHandle h = load<RecordedHandle>(RecordingSection::Handles, index);
+    if (static_cast<RecordedState>(h.state) != RecordedState::Unresolved || entry.object == 0) {
+        return resolve_record(h, out);
+    }
+
+    // The recording answered this row from the object cache; a replay with
+    // other filters may reach it first, so use the row that was resolved
+    std::call_once(objects_once_, [&] {
+        for (uint64_t i = 0; i < header_.handle_count; ++i) {
+            RecordedHandle r = load<RecordedHandle>(RecordingSection::Handles, i);
+            auto state = static_cast<RecordedState>(r.state);
+            if (r.object != 0 && (state == RecordedState::Resolved || state == RecordedState::TimedOut)) {
+                objects_.emplace(r.object, i);
+            }
+        }
+    });
+    auto it = objects_.find(entry.object);
+    if (it == objects_.end()) return false;
+    return resolve_record(load<RecordedHandle>(RecordingSection::Handles, it->second), out);
+}
+
+} // namespace lsofwin
@@ -0,0 +1,156 @@
+#pragma once
+
+#include "binary_output.h"
+#include "handle_source.h"
+#include "output_sink.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace lsofwin {
+
+// Raw handle snapshot format (--record / --replay), for analysing a scan
+// somewhere else: the whole handle table with what the backend resolved for
+// it, so every filter and formatter can be run again without the system it
+// came from. Laid out like the --binary result, with a header listing
+// {offset, count, width} per section:
+//
+//   RecordingHeader   magic, version, handle count, section table
+//   StringOffsets     uint32[strings + 1]; string i is bytes [off[i], off[i+1])
+//   StringBytes       the pooled string bytes
+//   TypeNames         uint32[]: string id of HandleSource::type_names()[i]
+//   Processes         RecordedProcess[], sorted by pid
+//   Handles           RecordedHandle[], in snapshot order
+//
+// Sections start on 8-byte boundaries and integers are little endian, so a
+// mapped file is used in place on any platform.
+constexpr char RecordingMagic[8] = { 'L', 'S', 'O', 'F', 'W', 'R', 'E', 'C' };
+constexpr uint32_t RecordingVersion = 1;
+
+enum class RecordingSection : uint32_t {
+    StringOffsets,
+    StringBytes,
+    TypeNames,
+    Processes,
+    Handles,
+    Count
+};
+
+constexpr size_t RecordingSectionCount = static_cast<size_t>(RecordingSection::Count);
+
+struct RecordingHeader {
+    char     magic[8];
+    uint32_t version;
+    uint32_t section_count;
+    uint64_t handle_count;
+    BinarySectionEntry sections[RecordingSectionCount];
+};
+
+struct RecordedProcess {
+    uint64_t start_time;
+    uint32_t pid;
+    uint32_t name;          // String id
+    uint32_t user;          // String id
+    uint32_t accessible;    // HandleSource::is_process_accessible()
+};
+
+// What resolve() returned for a handle. Unresolved rows were answered from
+// the object cache while recording and take the result of another row for
+// the same object on replay.
+enum class RecordedState : uint8_t { Unresolved, Resolved, TimedOut, Inaccessible };
+
+struct RecordedHandle {
+    uint64_t handle_value;
+    uint64_t object;
+    uint32_t pid;
+    uint32_t granted_access;
+    uint32_t attributes;
+    uint32_t type;          // String id of the resolved type
+    uint32_t name;          // String id of the resolved name
+    uint16_t type_index;
+    uint8_t  state;         // RecordedState
+    uint8_t  reserved;
+};
+
+static_assert(sizeof(RecordingHeader) == 24 + 24 * RecordingSectionCount, "unexpected header padding");
+static_assert(sizeof(RecordedProcess) == 24, "unexpected process record padding");
+static_assert(sizeof(RecordedHandle) == 40, "unexpected handle record padding");
+
+// Passes every call through to another HandleSource and keeps what it
+// returned, then write() saves the last snapshot. Only handles the scan
+// resolved (or answered from the object cache) are recorded with a name,
+// so record without -p/-c/-T to capture the whole table.
+class RecordingHandleSource : public HandleSource {
+public:
+    explicit RecordingHandleSource(HandleSource& inner) : inner_(inner) {}
+
+    void set_parallelism(size_t threads) override { inner_.set_parallelism(threads); }
+    void set_stats(ScanStats* stats) override { inner_.set_stats(stats); }
+    bool snapshot(std::vector<RawHandle>& table) override;
+    std::vector<std::string> type_names() override;
+    ProcessInfo process_info(uint32_t pid) override;
+    uint64_t process_start_time(uint32_t pid) override { return inner_.process_start_time(pid); }
+    bool is_process_accessible(uint32_t pid) override { return inner_.is_process_accessible(pid); }
+    bool resolve(const RawHandle& entry, size_t index, uint32_t timeout_ms, ResolvedHandle& out) override;
+
+    // Write the recording of the last snapshot. Processes that were never
+    // looked up during the scan are looked up now.
+    void write(OutputBuffer& out);
+
+private:
+    struct Resolution {
+        RecordedState state = RecordedState::Unresolved;
+        ResolvedHandle handle;
+    };
+
+    HandleSource& inner_;
+    std::vector<RawHandle> table_;
+    std::vector<Resolution> resolved_;      // By table index; each index is resolved once
+    std::vector<std::string> type_names_;
+    std::mutex process_mutex_;
+    std::unordered_map<uint32_t, ProcessInfo> processes_;
+};
+
+// A HandleSource that replays a recording held in memory (read or mapped);
+// the data must outlive it. open() checks the header and section bounds,
+// and ids are bounds-checked as they are followed, so a damaged file gives
+// empty strings rather than bad reads.
+class ReplayHandleSource : public HandleSource {
+public:
+    bool open(const void* data, size_t size, std::string& error_msg);
+
+    uint64_t handle_count() const { return header_.handle_count; }
+
+    bool snapshot(std::vector<RawHandle>& table) override;
+    std::vector<std::string> type_names() override;
+    ProcessInfo process_info(uint32_t pid) override;
+    uint64_t process_start_time(uint32_t pid) override;
+    bool is_process_accessible(uint32_t pid) override;
+    bool resolve(const RawHandle& entry, size_t index, uint32_t timeout_ms, ResolvedHandle& out) override;
+
+private:
+    const BinarySectionEntry& section(RecordingSection s) const {
+        return header_.sections[static_cast<size_t>(s)];
+    }
+
+    template <typename T>
+    T load(RecordingSection s, uint64_t index) const;
+
+    std::string_view string(uint64_t id) const;
+    bool find_process(uint32_t pid, RecordedProcess& out) const;
+    bool resolve_record(const RecordedHandle& h, ResolvedHandle& out) const;
+
+    const unsigned char* data_ = nullptr;
+    size_t size_ = 0;
+    RecordingHeader header_{};
+
+    // Object address -> a handle resolved for it, built on first use
+    std::once_flag objects_once_;
+    std::unordered_map<uint64_t, uint64_t> objects_;
+};
+
+} // namespace lsofwin
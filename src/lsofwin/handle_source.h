@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace lsofwin {
+
+class ScanStats;
+
+// One entry of the raw system handle table, before any type/name resolution.
+// Mirrors SYSTEM_HANDLE_TABLE_ENTRY_INFO_EX on Windows; other backends fill
+// the fields they can derive cheaply and leave the rest zero.
+struct RawHandle {
+    uint32_t  pid = 0;
+    uintptr_t handle_value = 0;     // HANDLE value on Windows, fd number on Linux
+    uintptr_t object = 0;           // Kernel object address / identity (0 = unknown)
+    uint32_t  granted_access = 0;
+    uint32_t  attributes = 0;
+    uint16_t  type_index = 0;       // Backend-specific object type index
+};
+
+// Per-process metadata looked up once per PID.
+struct ProcessInfo {
+    std::string name;
+    std::string user;
+};
+
+// Type and name of a single handle, as resolved by a HandleSource.
+struct ResolvedHandle {
+    std::string type;
+    std::string name;
+    bool timed_out = false;         // Name query hit the -t timeout (name is empty)
+};
+
+// A platform backend that produces the raw handle table and resolves
+// individual entries. enumerate_handles() drives a HandleSource and owns all
+// filtering, caching and result assembly, so that logic is platform-neutral.
+//
+// When enumerate_handles() runs with several threads, process_info() and
+// resolve() are called concurrently; snapshot() is always called alone.
+class HandleSource {
+public:
+    virtual ~HandleSource() = default;
+
+    // Hint for how many threads will call process_info()/resolve() at once,
+    // so the backend can size per-thread resources. Called before snapshot().
+    virtual void set_parallelism(size_t threads) { (void)threads; }
+
+    // Where to record backend phases and counters (--stats, scan_stats.h),
+    // or nullptr to stop. Set around a scan by the enumerator; backends
+    // without internal phases ignore it.
+    virtual void set_stats(ScanStats* stats) { (void)stats; }
+
+    // Capture a snapshot of all open handles on the system.
+    // Returns false if the table could not be read.
+    virtual bool snapshot(std::vector<RawHandle>& table) = 0;
+
+    // Names of object types indexed by RawHandle::type_index, for every index
+    // the backend can name up front. Empty entries are unknown. Valid after
+    // snapshot(); the default is an empty table.
+    virtual std::vector<std::string> type_names() { return {}; }
+
+    // Look up the name and owner of a process.
+    virtual ProcessInfo process_info(uint32_t pid) = 0;
+
+    // Look up only the name of a process, for scans that do not show owners
+    // (-o without user): backends whose owner lookup is costly override it.
+    virtual std::string process_name(uint32_t pid) { return process_info(pid).name; }
+
+    // Creation time of a process in a backend-specific unit, or 0 if unknown.
+    // Repeat mode (-r) pairs it with the PID so a reused PID is a new process.
+    virtual uint64_t process_start_time(uint32_t pid) { (void)pid; return 0; }
+
+    // True if handles of this process can be resolved at all. Used for rows
+    // whose object was already resolved through another process's handle.
+    virtual bool is_process_accessible(uint32_t pid) { (void)pid; return true; }
+
+    // Resolve the type and name of table[index] from the most recent snapshot.
+    // Returns false if the handle is not accessible (the row is dropped).
+    virtual bool resolve(const RawHandle& entry, size_t index, uint32_t timeout_ms,
+        ResolvedHandle& out) = 0;
+};
+
+// Create the native backend for the current platform. With raw_account_ids
+// (-l) process owners are shown as SIDs / uids and never looked up.
+std::unique_ptr<HandleSource> make_system_handle_source(bool raw_account_ids = false);
+
+} // namespace lsofwin
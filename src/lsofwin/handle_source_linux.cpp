@@ -0,0 +1,262 @@
+#include "handle_source.h"
+#include "account_cache.h"
+#include "process_utils.h"
+#include "scan_stats.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <thread>
+
+namespace {
+
+// Type indices assigned to /proc/<pid>/fd link targets. Index 0 is unused so
+// that a zero type_index always means "unknown", as on Windows.
+enum LinuxTypeIndex : uint16_t {
+    LinuxTypeFile = 1,
+    LinuxTypeSocket,
+    LinuxTypePipe,
+    LinuxTypeAnonInode,
+    LinuxTypeOther,
+};
+
+const char* const linux_type_names[] = { "", "File", "Socket", "Pipe", "AnonInode", "Other" };
+
+bool starts_with(const char* s, size_t len, const char* prefix) {
+    size_t plen = strlen(prefix);
+    return len >= plen && memcmp(s, prefix, plen) == 0;
+}
+
+// Parse the inode number out of "socket:[12345]" style link targets.
+uintptr_t parse_bracket_inode(const char* s, size_t len) {
+    const char* open = static_cast<const char*>(memchr(s, '[', len));
+    if (!open) return 0;
+    return static_cast<uintptr_t>(strtoull(open + 1, nullptr, 10));
+}
+
+void classify_link(const char* target, size_t len, lsofwin::RawHandle& raw) {
+    if (len > 0 && target[0] == '/') {
+        raw.type_index = LinuxTypeFile;
+    }
+    else if (starts_with(target, len, "socket:[")) {
+        raw.type_index = LinuxTypeSocket;
+        raw.object = parse_bracket_inode(target, len);
+    }
+    else if (starts_with(target, len, "pipe:[")) {
+        raw.type_index = LinuxTypePipe;
+        raw.object = parse_bracket_inode(target, len);
+    }
+    else if (starts_with(target, len, "anon_inode:")) {
+        raw.type_index = LinuxTypeAnonInode;
+    }
+    else {
+        raw.type_index = LinuxTypeOther;
+    }
+}
+
+bool parse_uint(const char* s, uint32_t& out) {
+    if (*s < '0' || *s > '9') return false;
+    char* end = nullptr;
+    unsigned long val = strtoul(s, &end, 10);
+    if (*end != '\0' || val > UINT32_MAX) return false;
+    out = static_cast<uint32_t>(val);
+    return true;
+}
+
+// Handles and link targets collected for a single process.
+struct PidScan {
+    std::vector<lsofwin::RawHandle> handles;
+    std::vector<uint32_t> name_lengths;
+    std::string names;
+};
+
+// Walk /proc/<pid>/fd relative to the /proc dirfd. Processes that vanish or
+// deny access simply produce no entries.
+void scan_pid(int proc_fd, uint32_t pid, PidScan& out) {
+    char rel[32];
+    snprintf(rel, sizeof(rel), "%u/fd", pid);
+
+    int fd_dir = openat(proc_fd, rel, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd_dir < 0) return;
+
+    DIR* dir = fdopendir(fd_dir);
+    if (!dir) {
+        close(fd_dir);
+        return;
+    }
+
+    struct Entry {
+        uint32_t fd;
+        uint32_t offset;
+        uint32_t length;
+        lsofwin::RawHandle raw;
+    };
+    std::vector<Entry> entries;
+    std::string names;
+    char target[PATH_MAX];
+
+    while (struct dirent* de = readdir(dir)) {
+        uint32_t fd_num = 0;
+        if (!parse_uint(de->d_name, fd_num)) continue;
+
+        ssize_t len = readlinkat(dirfd(dir), de->d_name, target, sizeof(target));
+        if (len < 0) continue;
+
+        Entry e;
+        e.fd = fd_num;
+        e.offset = static_cast<uint32_t>(names.size());
+        e.length = static_cast<uint32_t>(len);
+        e.raw.pid = pid;
+        e.raw.handle_value = fd_num;
+        classify_link(target, static_cast<size_t>(len), e.raw);
+        names.append(target, static_cast<size_t>(len));
+        entries.push_back(e);
+    }
+    closedir(dir);
+
+    // readdir order is unspecified; sort by fd so output is deterministic
+    std::sort(entries.begin(), entries.end(),
+        [](const Entry& a, const Entry& b) { return a.fd < b.fd; });
+
+    out.handles.reserve(entries.size());
+    out.name_lengths.reserve(entries.size());
+    out.names.reserve(names.size());
+    for (const auto& e : entries) {
+        out.handles.push_back(e.raw);
+        out.name_lengths.push_back(e.length);
+        out.names.append(names, e.offset, e.length);
+    }
+}
+
+// Handle source backed by /proc/<pid>/fd. Link targets are read during the
+// snapshot (readlinkat is the only way to see them), so resolve() is a lookup.
+class LinuxHandleSource : public lsofwin::HandleSource {
+public:
+    explicit LinuxHandleSource(bool raw_account_ids)
+        : accounts_([this, raw_account_ids](std::string_view uid) {
+              if (raw_account_ids) return lsofwin::format_account_id(uid);
+              lsofwin::PhaseTimer timer(stats_, lsofwin::ScanPhase::AccountLookup);
+              return lsofwin::lookup_account_name(uid);
+          }) {}
+
+    void set_stats(lsofwin::ScanStats* stats) override {
+        stats_ = stats;
+    }
+
+    bool snapshot(std::vector<lsofwin::RawHandle>& table) override {
+        table.clear();
+        names_.clear();
+        name_offsets_.clear();
+
+        int proc_fd = open("/proc", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (proc_fd < 0) return false;
+
+        std::vector<uint32_t> pids;
+        if (DIR* dir = fdopendir(dup(proc_fd))) {
+            while (struct dirent* de = readdir(dir)) {
+                uint32_t pid = 0;
+                if (parse_uint(de->d_name, pid)) pids.push_back(pid);
+            }
+            closedir(dir);
+        }
+        std::sort(pids.begin(), pids.end());
+
+        // Scan PIDs in parallel; each worker claims the next unscanned PID
+        std::vector<PidScan> scans(pids.size());
+        std::atomic<size_t> next{ 0 };
+        auto worker = [&]() {
+            for (size_t i = next++; i < pids.size(); i = next++) {
+                scan_pid(proc_fd, pids[i], scans[i]);
+            }
+        };
+
+        size_t thread_count = (std::min)(static_cast<size_t>(
+            (std::max)(1u, std::thread::hardware_concurrency())), pids.size());
+        std::vector<std::thread> threads;
+        for (size_t t = 1; t < thread_count; ++t) threads.emplace_back(worker);
+        worker();
+        for (auto& t : threads) t.join();
+        close(proc_fd);
+
+        // Merge per-PID results in PID order
+        size_t total = 0, total_names = 0;
+        for (const auto& s : scans) {
+            total += s.handles.size();
+            total_names += s.names.size();
+        }
+        table.reserve(total);
+        name_offsets_.reserve(total + 1);
+        names_.reserve(total_names);
+        for (const auto& s : scans) {
+            size_t pos = 0;
+            for (size_t i = 0; i < s.handles.size(); ++i) {
+                table.push_back(s.handles[i]);
+                name_offsets_.push_back(static_cast<uint64_t>(names_.size()));
+                names_.append(s.names, pos, s.name_lengths[i]);
+                pos += s.name_lengths[i];
+            }
+        }
+        name_offsets_.push_back(static_cast<uint64_t>(names_.size()));
+        return true;
+    }
+
+    std::vector<std::string> type_names() override {
+        return std::vector<std::string>(std::begin(linux_type_names), std::end(linux_type_names));
+    }
+
+    lsofwin::ProcessInfo process_info(uint32_t pid) override {
+        lsofwin::ProcessInfo info;
+        info.name = lsofwin::get_process_name(pid);
+
+        std::string uid;
+        if (lsofwin::get_process_account(pid, uid)) info.user = accounts_.name(uid);
+        return info;
+    }
+
+    std::string process_name(uint32_t pid) override {
+        return lsofwin::get_process_name(pid);
+    }
+
+    uint64_t process_start_time(uint32_t pid) override {
+        return lsofwin::get_process_start_time(pid);
+    }
+
+    bool resolve(const lsofwin::RawHandle& entry, size_t index, uint32_t /*timeout_ms*/,
+        lsofwin::ResolvedHandle& out) override {
+        if (index + 1 >= name_offsets_.size()) return false;
+        if (entry.type_index < sizeof(linux_type_names) / sizeof(linux_type_names[0])) {
+            out.type = linux_type_names[entry.type_index];
+        }
+        out.name.assign(names_, name_offsets_[index],
+            name_offsets_[index + 1] - name_offsets_[index]);
+        return true;
+    }
+
+private:
+    // --stats, set by the enumerator around a scan (null when off)
+    lsofwin::ScanStats* stats_ = nullptr;
+
+    // Link targets of the last snapshot; row i is [offsets[i], offsets[i+1])
+    std::string names_;
+    std::vector<uint64_t> name_offsets_;
+
+    // uid -> user name (or the uid itself under -l), kept across scans; an
+    // NSS lookup can go to LDAP
+    lsofwin::AccountCache accounts_;
+};
+
+} // anonymous namespace
+
+namespace lsofwin {
+
+std::unique_ptr<HandleSource> make_system_handle_source(bool raw_account_ids) {
+    return std::make_unique<LinuxHandleSource>(raw_account_ids);
+}
+
+} // namespace lsofwin
@@ -0,0 +1,520 @@
+#include "handle_source.h"
+#include "account_cache.h"
+#include "device_path_map.h"
+#include "process_utils.h"
+#include "scan_stats.h"
+#include "timed_query_executor.h"
+#include "utf16_transcode.h"
+
+#include <Windows.h>
+#include <winternl.h>
+#include <algorithm>
+#include <cstring>
+#include <cwchar>
+#include <iterator>
+#include <mutex>
+#include <unordered_map>
+
+#pragma comment(lib, "ntdll.lib")
+
+// NT API types not in standard headers
+extern "C" {
+    typedef struct _SYSTEM_HANDLE_TABLE_ENTRY_INFO_EX {
+        PVOID      Object;
+        ULONG_PTR  UniqueProcessId;
+        ULONG_PTR  HandleValue;
+        ULONG      GrantedAccess;
+        USHORT     CreatorBackTraceIndex;
+        USHORT     ObjectTypeIndex;
+        ULONG      HandleAttributes;
+        ULONG      Reserved;
+    } SYSTEM_HANDLE_TABLE_ENTRY_INFO_EX;
+
+    typedef struct _SYSTEM_HANDLE_INFORMATION_EX {
+        ULONG_PTR NumberOfHandles;
+        ULONG_PTR Reserved;
+        SYSTEM_HANDLE_TABLE_ENTRY_INFO_EX Handles[1];
+    } SYSTEM_HANDLE_INFORMATION_EX;
+
+    // SYSTEM_PROCESS_INFORMATION with the fields winternl.h leaves reserved;
+    // thread entries follow each record
+    typedef struct _SYSTEM_PROCESS_INFORMATION_EX {
+        ULONG          NextEntryOffset;
+        ULONG          NumberOfThreads;
+        LARGE_INTEGER  WorkingSetPrivateSize;
+        ULONG          HardFaultCount;
+        ULONG          NumberOfThreadsHighWatermark;
+        ULONGLONG      CycleTime;
+        LARGE_INTEGER  CreateTime;
+        LARGE_INTEGER  UserTime;
+        LARGE_INTEGER  KernelTime;
+        UNICODE_STRING ImageName;
+        LONG           BasePriority;
+        HANDLE         UniqueProcessId;
+        HANDLE         InheritedFromUniqueProcessId;
+    } SYSTEM_PROCESS_INFORMATION_EX;
+}
+
+namespace {
+
+constexpr ULONG SystemProcessInformationClass = 5;
+constexpr ULONG SystemExtendedHandleInformationClass = 64;
+constexpr ULONG ObjectNameInformationClass = 1;
+constexpr ULONG ObjectTypeInformationClass = 2;
+constexpr ULONG ObjectTypesInformationClass = 3;
+
+// Buffer size for object type/name queries
+constexpr ULONG ObjectBufferSize = 2048;
+
+struct ObjectNameInfo {
+    UNICODE_STRING Name;
+    WCHAR NameBuffer[1];
+};
+
+struct ObjectTypeInfo {
+    UNICODE_STRING TypeName;
+    ULONG Reserved1[17];      // Object/handle counters, pool usage, GenericMapping
+    ULONG ValidAccessMask;
+    BOOLEAN SecurityRequired;
+    BOOLEAN MaintainHandleCount;
+    UCHAR TypeIndex;          // Windows 8.1+
+    CHAR ReservedByte;
+    ULONG Reserved2[3];       // PoolType, default pool charges
+};
+
+struct ObjectTypesInfo {
+    ULONG NumberOfTypes;
+};
+
+static_assert(sizeof(WCHAR) == sizeof(char16_t), "WCHAR is UTF-16");
+
+// A counted UTF-16 string from the NT API, without copying it.
+std::u16string_view wide_view(const WCHAR* wstr, size_t len) {
+    if (!wstr) return {};
+    return std::u16string_view(reinterpret_cast<const char16_t*>(wstr), len);
+}
+
+std::string wide_to_narrow(const WCHAR* wstr, size_t len) {
+    std::string result;
+    lsofwin::append_utf8(result, wide_view(wstr, len));
+    return result;
+}
+
+size_t align_up(size_t value, size_t alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+// Load the name of every object type, indexed by ObjectTypeIndex, with a
+// single NtQueryObject(ObjectTypesInformation) call.
+std::vector<std::string> load_type_table() {
+    std::vector<std::string> names;
+
+    ULONG buffer_size = 64 * 1024;
+    std::unique_ptr<char[]> buffer;
+    NTSTATUS status = 0;
+    for (int attempt = 0; attempt < 4; ++attempt) {
+        buffer = std::make_unique<char[]>(buffer_size);
+        ULONG return_length = 0;
+        status = NtQueryObject(nullptr, (OBJECT_INFORMATION_CLASS)ObjectTypesInformationClass,
+            buffer.get(), buffer_size, &return_length);
+        if (status != (NTSTATUS)0xC0000004L) break; // STATUS_INFO_LENGTH_MISMATCH
+        buffer_size = (std::max)(return_length, buffer_size * 2);
+    }
+    if (status != 0) return names;
+
+    auto* types = reinterpret_cast<ObjectTypesInfo*>(buffer.get());
+    const char* p = buffer.get() + align_up(sizeof(ObjectTypesInfo), sizeof(ULONG_PTR));
+    const char* end = buffer.get() + buffer_size;
+
+    for (ULONG i = 0; i < types->NumberOfTypes; ++i) {
+        if (p + sizeof(ObjectTypeInfo) > end) break;
+        auto* info = reinterpret_cast<const ObjectTypeInfo*>(p);
+
+        // TypeIndex is zero before Windows 8.1, where indices start at 2
+        size_t index = info->TypeIndex ? info->TypeIndex : i + 2;
+        if (index >= names.size()) names.resize(index + 1);
+        names[index] = wide_to_narrow(info->TypeName.Buffer,
+            info->TypeName.Length / sizeof(WCHAR));
+
+        p += sizeof(ObjectTypeInfo) + align_up(info->TypeName.MaximumLength, sizeof(ULONG_PTR));
+    }
+    return names;
+}
+
+// Name and creation time of one process, from the process snapshot.
+struct ProcessEntry {
+    uint32_t pid = 0;
+    uint64_t start_time = 0;    // FILETIME ticks, as GetProcessTimes() reports
+    std::string name;           // Image file name without the path
+};
+
+// Load every process with a single NtQuerySystemInformation(SystemProcessInformation)
+// call, sorted by PID, instead of opening each process for its name and times.
+std::vector<ProcessEntry> load_process_table() {
+    std::vector<ProcessEntry> processes;
+
+    ULONG buffer_size = 512 * 1024;
+    std::unique_ptr<char[]> buffer;
+    NTSTATUS status = 0;
+    for (int attempt = 0; attempt < 4; ++attempt) {
+        buffer = std::make_unique<char[]>(buffer_size);
+        ULONG return_length = 0;
+        status = NtQuerySystemInformation((SYSTEM_INFORMATION_CLASS)SystemProcessInformationClass,
+            buffer.get(), buffer_size, &return_length);
+        if (status != (NTSTATUS)0xC0000004L) break; // STATUS_INFO_LENGTH_MISMATCH
+        buffer_size = (std::max)(return_length + 64 * 1024, buffer_size * 2);
+    }
+    if (status != 0) return processes;
+
+    const char* p = buffer.get();
+    for (;;) {
+        auto* info = reinterpret_cast<const SYSTEM_PROCESS_INFORMATION_EX*>(p);
+        ProcessEntry entry;
+        entry.pid = static_cast<uint32_t>(reinterpret_cast<ULONG_PTR>(info->UniqueProcessId));
+        entry.start_time = static_cast<uint64_t>(info->CreateTime.QuadPart);
+        entry.name = wide_to_narrow(info->ImageName.Buffer, info->ImageName.Length / sizeof(WCHAR));
+        processes.push_back(std::move(entry));
+        if (info->NextEntryOffset == 0) break;
+        p += info->NextEntryOffset;
+    }
+
+    std::sort(processes.begin(), processes.end(),
+        [](const ProcessEntry& a, const ProcessEntry& b) { return a.pid < b.pid; });
+    return processes;
+}
+
+// Buffer and result of one NtQueryObject(ObjectNameInformation) call. The
+// watchdog worker holds a reference, so a hung query keeps its buffer alive
+// after we have given up on it.
+struct NameQuery {
+    HANDLE handle = nullptr;
+    NTSTATUS status = 0;
+    ULONG return_length = 0;
+    std::unique_ptr<char[]> buffer = std::make_unique<char[]>(ObjectBufferSize);
+};
+
+std::string wide_to_narrow(const std::wstring& wstr) {
+    return wide_to_narrow(wstr.c_str(), wstr.size());
+}
+
+// Build the NT device -> DOS prefix map once per scan: drive letters (local,
+// subst and mapped network drives), volumes mounted on folders, and the
+// fixed \Device\Mup and \??\ rules.
+lsofwin::DevicePathMap build_device_map() {
+    lsofwin::DevicePathMap map;
+
+    // Drive letters first, so they win over folder mounts of the same volume
+    WCHAR drives[512];
+    DWORD len = GetLogicalDriveStringsW(static_cast<DWORD>(std::size(drives) - 1), drives);
+    if (len > 0 && len < std::size(drives)) {
+        for (const WCHAR* drive = drives; *drive; drive += wcslen(drive) + 1) {
+            WCHAR device_name[3] = { drive[0], drive[1], L'\0' }; // "C:"
+            WCHAR target[MAX_PATH] = {};
+            if (QueryDosDeviceW(device_name, target, MAX_PATH) > 0) {
+                map.add(wide_to_narrow(std::wstring(target)), wide_to_narrow(std::wstring(device_name)));
+            }
+        }
+    }
+
+    // Volumes without a drive letter, mounted on an NTFS folder
+    WCHAR volume[MAX_PATH];
+    HANDLE find = FindFirstVolumeW(volume, MAX_PATH);
+    if (find != INVALID_HANDLE_VALUE) {
+        do {
+            // \\?\Volume{guid}\ -> Volume{guid} for QueryDosDevice
+            std::wstring volume_name(volume);
+            if (volume_name.size() < 6 || volume_name.back() != L'\\') continue;
+            std::wstring dos_name = volume_name.substr(4, volume_name.size() - 5);
+
+            WCHAR target[MAX_PATH] = {};
+            if (QueryDosDeviceW(dos_name.c_str(), target, MAX_PATH) == 0) continue;
+
+            WCHAR paths[1024] = {};
+            DWORD paths_len = 0;
+            if (!GetVolumePathNamesForVolumeNameW(volume, paths, static_cast<DWORD>(std::size(paths)), &paths_len) ||
+                paths[0] == L'\0') {
+                continue;
+            }
+
+            // First mount point (e.g. D:\mnt\data\ or E:\), without the trailing '\'
+            std::wstring mount_point(paths);
+            if (mount_point.back() == L'\\') mount_point.pop_back();
+            map.add(wide_to_narrow(std::wstring(target)), wide_to_narrow(mount_point));
+        } while (FindNextVolumeW(find, volume, MAX_PATH));
+        FindVolumeClose(find);
+    }
+
+    map.add_standard_prefixes();
+    return map;
+}
+
+// Handle source backed by NtQuerySystemInformation(SystemExtendedHandleInformation)
+// and per-handle DuplicateHandle + NtQueryObject.
+class WinHandleSource : public lsofwin::HandleSource {
+public:
+    explicit WinHandleSource(bool raw_account_ids)
+        : accounts_([this, raw_account_ids](std::string_view sid) {
+              if (raw_account_ids) return lsofwin::format_account_id(sid);
+              lsofwin::PhaseTimer timer(stats_, lsofwin::ScanPhase::AccountLookup);
+              return lsofwin::lookup_account_name(sid);
+          }) {}
+
+    void set_parallelism(size_t threads) override {
+        name_executor_ = std::make_unique<lsofwin::TimedQueryExecutor>(threads);
+    }
+
+    void set_stats(lsofwin::ScanStats* stats) override {
+        stats_ = stats;
+    }
+
+    ~WinHandleSource() override {
+        close_process_handles();
+    }
+
+    bool snapshot(std::vector<lsofwin::RawHandle>& table) override {
+        table.clear();
+        close_process_handles();
+
+        // Allocate buffer for system handle information
+        ULONG buffer_size = 1024 * 1024; // Start with 1 MB
+        auto buffer = std::make_unique<char[]>(buffer_size);
+        NTSTATUS status;
+        ULONG return_length = 0;
+
+        // Grow buffer until it fits
+        while (true) {
+            status = NtQuerySystemInformation(
+                (SYSTEM_INFORMATION_CLASS)SystemExtendedHandleInformationClass,
+                buffer.get(), buffer_size, &return_length);
+
+            if (status == (NTSTATUS)0xC0000004L) { // STATUS_INFO_LENGTH_MISMATCH
+                if (stats_) stats_->add(lsofwin::ScanCounter::SnapshotRetries);
+                buffer_size = return_length + 65536;
+                buffer = std::make_unique<char[]>(buffer_size);
+                continue;
+            }
+            break;
+        }
+
+        if (status != 0) return false;
+
+        auto* handle_info = reinterpret_cast<SYSTEM_HANDLE_INFORMATION_EX*>(buffer.get());
+        table.resize(handle_info->NumberOfHandles);
+        for (ULONG_PTR i = 0; i < handle_info->NumberOfHandles; ++i) {
+            const auto& entry = handle_info->Handles[i];
+            auto& raw = table[i];
+            raw.pid            = static_cast<uint32_t>(entry.UniqueProcessId);
+            raw.handle_value   = entry.HandleValue;
+            raw.object         = reinterpret_cast<uintptr_t>(entry.Object);
+            raw.granted_access = entry.GrantedAccess;
+            raw.attributes     = entry.HandleAttributes;
+            raw.type_index     = entry.ObjectTypeIndex;
+        }
+
+        // Drive letters and mounts can change between scans
+        device_map_ = build_device_map();
+
+        // Names and start times of every process, read-only during the walk
+        processes_ = load_process_table();
+
+        // Type indices are fixed for the lifetime of the system
+        if (type_names_.empty()) type_names_ = load_type_table();
+        return true;
+    }
+
+    std::vector<std::string> type_names() override {
+        return type_names_;
+    }
+
+    bool is_process_accessible(uint32_t pid) override {
+        return open_process(pid) != nullptr;
+    }
+
+    lsofwin::ProcessInfo process_info(uint32_t pid) override {
+        lsofwin::ProcessInfo info;
+        info.name = process_name(pid);
+
+        std::string sid;
+        if (lsofwin::get_process_account(pid, sid)) info.user = accounts_.name(sid);
+        return info;
+    }
+
+    std::string process_name(uint32_t pid) override {
+        const ProcessEntry* entry = find_process(pid);
+        // The idle process has no image name in the snapshot
+        return entry && !entry->name.empty() ? entry->name : lsofwin::get_process_name(pid);
+    }
+
+    uint64_t process_start_time(uint32_t pid) override {
+        const ProcessEntry* entry = find_process(pid);
+        return entry ? entry->start_time : lsofwin::get_process_start_time(pid);
+    }
+
+    bool resolve(const lsofwin::RawHandle& entry, size_t /*index*/, uint32_t timeout_ms,
+        lsofwin::ResolvedHandle& out) override {
+        // Duplicate handle into our process to query it
+        HANDLE target_process = open_process(entry.pid);
+        if (!target_process) return false;
+
+        HANDLE dup_handle = nullptr;
+        lsofwin::PhaseTimer duplicate_timer(stats_, lsofwin::ScanPhase::Duplicate);
+        if (!DuplicateHandle(target_process, (HANDLE)entry.handle_value,
+            GetCurrentProcess(), &dup_handle, 0, FALSE, DUPLICATE_SAME_ACCESS)) {
+            return false;
+        }
+        duplicate_timer.stop();
+
+        // Object type comes from the index table; query only unnamed indices
+        if (!lookup_type_name(entry.type_index, out.type)) {
+            lsofwin::PhaseTimer type_timer(stats_, lsofwin::ScanPhase::TypeQuery);
+            auto& buffers = thread_buffers();
+            memset(buffers.type_buffer.get(), 0, ObjectBufferSize);
+            ULONG obj_return_len = 0;
+            NTSTATUS status = NtQueryObject(dup_handle, (OBJECT_INFORMATION_CLASS)ObjectTypeInformationClass,
+                buffers.type_buffer.get(), ObjectBufferSize, &obj_return_len);
+
+            if (status == 0) {
+                auto* type_info = reinterpret_cast<ObjectTypeInfo*>(buffers.type_buffer.get());
+                out.type = wide_to_narrow(type_info->TypeName.Buffer,
+                    type_info->TypeName.Length / sizeof(WCHAR));
+                remember_type_name(entry.type_index, out.type);
+            }
+        }
+
+        // Query object name with timeout
+        lsofwin::PhaseTimer name_timer(stats_, lsofwin::ScanPhase::NameQuery);
+        auto query = query_object_name_with_timeout(dup_handle, timeout_ms);
+        name_timer.stop();
+        out.timed_out = !query;
+        if (query) {
+            if (query->status == 0) {
+                auto* name_info = reinterpret_cast<ObjectNameInfo*>(query->buffer.get());
+                if (name_info->Name.Length > 0) {
+                    // The name stays UTF-16 in the query buffer; it is
+                    // transcoded once, after its device prefix is mapped
+                    lsofwin::PhaseTimer normalize_timer(stats_, lsofwin::ScanPhase::Normalize);
+                    device_map_.normalize(wide_view(name_info->Name.Buffer,
+                        name_info->Name.Length / sizeof(WCHAR)), out.name);
+                }
+            }
+        }
+
+        CloseHandle(dup_handle);
+        return true;
+    }
+
+private:
+    // Process snapshot entry for pid, or nullptr for a process started since
+    const ProcessEntry* find_process(uint32_t pid) const {
+        auto it = std::lower_bound(processes_.begin(), processes_.end(), pid,
+            [](const ProcessEntry& e, uint32_t p) { return e.pid < p; });
+        return it != processes_.end() && it->pid == pid ? &*it : nullptr;
+    }
+
+    // PROCESS_DUP_HANDLE handle for pid, opened once per process per scan.
+    // Returns nullptr if the process cannot be opened.
+    HANDLE open_process(uint32_t pid) {
+        std::lock_guard<std::mutex> lock(process_handles_mutex_);
+        auto it = process_handles_.find(pid);
+        if (it == process_handles_.end()) {
+            lsofwin::PhaseTimer timer(stats_, lsofwin::ScanPhase::OpenProcess);
+            it = process_handles_.emplace(pid, OpenProcess(PROCESS_DUP_HANDLE, FALSE, pid)).first;
+        }
+        return it->second;
+    }
+
+    void close_process_handles() {
+        std::lock_guard<std::mutex> lock(process_handles_mutex_);
+        for (auto& ph : process_handles_) {
+            if (ph.second) CloseHandle(ph.second);
+        }
+        process_handles_.clear();
+    }
+
+    bool lookup_type_name(uint16_t index, std::string& name) {
+        if (index < type_names_.size() && !type_names_[index].empty()) {
+            name = type_names_[index];
+            return true;
+        }
+        std::lock_guard<std::mutex> lock(learned_types_mutex_);
+        auto it = learned_types_.find(index);
+        if (it == learned_types_.end()) return false;
+        name = it->second;
+        return true;
+    }
+
+    void remember_type_name(uint16_t index, const std::string& name) {
+        std::lock_guard<std::mutex> lock(learned_types_mutex_);
+        learned_types_.emplace(index, name);
+    }
+
+    // Query object name on the watchdog worker to avoid hangs on pipes/devices.
+    // Returns the completed query, or nullptr if it timed out.
+    std::shared_ptr<NameQuery> query_object_name_with_timeout(HANDLE handle, DWORD timeout_ms) {
+        auto& buffers = thread_buffers();
+        auto query = buffers.name_query;
+        query->handle = handle;
+        memset(query->buffer.get(), 0, ObjectBufferSize);
+
+        bool finished = name_executor_->run([query]() {
+            query->status = NtQueryObject(query->handle,
+                (OBJECT_INFORMATION_CLASS)ObjectNameInformationClass,
+                query->buffer.get(), ObjectBufferSize, &query->return_length);
+        }, std::chrono::milliseconds(timeout_ms));
+
+        if (!finished) {
+            // The stuck worker still owns the old buffer; use a fresh one from now on
+            buffers.name_query = std::make_shared<NameQuery>();
+            return nullptr;
+        }
+        return query;
+    }
+
+    // Query buffers owned by each resolving thread, so resolve() can run on
+    // several threads at once without locking.
+    struct ThreadBuffers {
+        std::unique_ptr<char[]> type_buffer = std::make_unique<char[]>(ObjectBufferSize);
+        std::shared_ptr<NameQuery> name_query = std::make_shared<NameQuery>();
+    };
+
+    static ThreadBuffers& thread_buffers() {
+        thread_local ThreadBuffers buffers;
+        return buffers;
+    }
+
+    // --stats, set by the enumerator around a scan (null when off)
+    lsofwin::ScanStats* stats_ = nullptr;
+
+    // NT device -> DOS prefix map, rebuilt per snapshot, read-only during resolve
+    lsofwin::DevicePathMap device_map_;
+
+    // Process snapshot taken with the handle table, sorted by PID
+    std::vector<ProcessEntry> processes_;
+
+    // Token SID -> DOMAIN\User (or the SID itself under -l), kept across scans
+    lsofwin::AccountCache accounts_;
+
+    std::mutex process_handles_mutex_;
+    std::unordered_map<uint32_t, HANDLE> process_handles_;
+
+    // Index -> type name from ObjectTypesInformation (read-only after snapshot),
+    // plus indices learned one handle at a time if that table was incomplete
+    std::vector<std::string> type_names_;
+    std::mutex learned_types_mutex_;
+    std::unordered_map<uint16_t, std::string> learned_types_;
+
+    // Long-lived workers for timed name queries (replaced only when one hangs),
+    // one per resolving thread
+    std::unique_ptr<lsofwin::TimedQueryExecutor> name_executor_ =
+        std::make_unique<lsofwin::TimedQueryExecutor>(1);
+};
+
+} // anonymous namespace
+
+namespace lsofwin {
+
+std::unique_ptr<HandleSource> make_system_handle_source(bool raw_account_ids) {
+    return std::make_unique<WinHandleSource>(raw_account_ids);
+}
+
+} // namespace lsofwin
@@ -0,0 +1,326 @@
+#include "handle_summary.h"
+#include "console_color.h"
+#include "json_escape.h"
+#include "type_filter.h"
+
+#include <algorithm>
+#include <charconv>
+
+namespace lsofwin {
+
+void HandleCounter::merge(const HandleCounter& other) {
+    for (const auto& entry : other.pids_) {
+        auto& counts = pids_[entry.first];
+        const auto& from = entry.second;
+        if (from.by_index.size() > counts.by_index.size()) counts.by_index.resize(from.by_index.size());
+        for (size_t i = 0; i < from.by_index.size(); ++i) counts.by_index[i] += from.by_index[i];
+        for (const auto& named : from.by_name) counts.by_name[named.first] += named.second;
+    }
+}
+
+void HandleCounter::for_each(
+    const std::function<void(uint32_t, uint16_t, const std::string*, uint64_t)>& fn) const {
+    for (const auto& entry : pids_) {
+        const auto& counts = entry.second;
+        for (size_t i = 0; i < counts.by_index.size(); ++i) {
+            if (counts.by_index[i]) fn(entry.first, static_cast<uint16_t>(i), nullptr, counts.by_index[i]);
+        }
+        for (const auto& named : counts.by_name) fn(entry.first, 0, &named.first, named.second);
+    }
+}
+
+uint64_t HandleCounter::total() const {
+    uint64_t n = 0;
+    for_each([&](uint32_t, uint16_t, const std::string*, uint64_t count) { n += count; });
+    return n;
+}
+
+namespace {
+
+// A group as small integers: the PID (0 when not grouped on) and indices
+// into the interned type and user names.
+struct GroupId {
+    uint32_t pid;
+    uint32_t type;
+    uint32_t user;
+
+    bool operator==(const GroupId& o) const { return pid == o.pid && type == o.type && user == o.user; }
+};
+
+struct GroupIdHash {
+    size_t operator()(const GroupId& g) const {
+        uint64_t h = (static_cast<uint64_t>(g.pid) << 32) ^ (static_cast<uint64_t>(g.type) << 20) ^ g.user;
+        return static_cast<size_t>(h * 0x9E3779B97F4A7C15ull >> 16);
+    }
+};
+
+// Distinct strings by index, so groups hash and compare as integers.
+class Interner {
+public:
+    uint32_t id(const std::string& s) {
+        auto it = ids_.find(s);
+        if (it != ids_.end()) return it->second;
+        uint32_t id = static_cast<uint32_t>(strings_.size());
+        strings_.push_back(s);
+        ids_.emplace(s, id);
+        return id;
+    }
+
+    const std::string& operator[](uint32_t id) const { return strings_[id]; }
+
+private:
+    std::vector<std::string> strings_;
+    std::unordered_map<std::string, uint32_t> ids_;
+};
+
+} // anonymous namespace
+
+HandleSummary summarize_counts(const HandleCounter& counts, const std::vector<GroupKey>& keys,
+    const std::vector<std::string>& type_names, size_t top,
+    const std::function<const ProcessInfo&(uint32_t pid)>& process) {
+    HandleSummary summary;
+    summary.keys = keys;
+    bool by_pid = std::find(keys.begin(), keys.end(), GroupKey::Pid) != keys.end();
+    bool by_type = std::find(keys.begin(), keys.end(), GroupKey::Type) != keys.end();
+    bool by_user = std::find(keys.begin(), keys.end(), GroupKey::User) != keys.end();
+
+    Interner types, users;
+    const uint32_t no_name = types.id(std::string());
+    users.id(std::string());
+    std::vector<uint32_t> index_types(type_names.size(), UINT32_MAX);
+    std::unordered_map<uint32_t, const ProcessInfo*> processes;
+    auto process_of = [&](uint32_t pid) -> const ProcessInfo& {
+        auto it = processes.find(pid);
+        if (it == processes.end()) it = processes.emplace(pid, &process(pid)).first;
+        return *it->second;
+    };
+
+    // Keys not grouped on stay 0 (the empty name), so the cells of one
+    // group land on the same entry
+    std::unordered_map<GroupId, uint64_t, GroupIdHash> groups;
+    uint32_t user_pid = 0, user_id = 0;
+    counts.for_each([&](uint32_t pid, uint16_t type_index, const std::string* type_name, uint64_t n) {
+        GroupId id{ by_pid ? pid : 0, no_name, 0 };
+        if (by_type) {
+            if (type_name) {
+                id.type = types.id(*type_name);
+            }
+            else if (type_index < index_types.size()) {
+                if (index_types[type_index] == UINT32_MAX) index_types[type_index] = types.id(type_names[type_index]);
+                id.type = index_types[type_index];
+            }
+        }
+        if (by_user) {
+            // Cells of one PID come together
+            if (pid != user_pid || user_id == 0) {
+                user_pid = pid;
+                user_id = users.id(process_of(pid).user);
+            }
+            id.user = user_id;
+        }
+        groups[id] += n;
+        summary.handles += n;
+    });
+
+    std::vector<std::pair<GroupId, uint64_t>> sorted(groups.begin(), groups.end());
+    summary.groups = sorted.size();
+
+    // Largest first, ties in key order
+    auto before = [&](const std::pair<GroupId, uint64_t>& a, const std::pair<GroupId, uint64_t>& b) {
+        if (a.second != b.second) return a.second > b.second;
+        if (a.first.pid != b.first.pid) return a.first.pid < b.first.pid;
+        if (a.first.type != b.first.type) return types[a.first.type] < types[b.first.type];
+        return users[a.first.user] < users[b.first.user];
+    };
+    size_t shown = top > 0 ? (std::min)(top, sorted.size()) : sorted.size();
+    std::partial_sort(sorted.begin(), sorted.begin() + static_cast<std::ptrdiff_t>(shown), sorted.end(), before);
+
+    summary.rows.resize(shown);
+    for (size_t i = 0; i < shown; ++i) {
+        auto& row = summary.rows[i];
+        const GroupId& id = sorted[i].first;
+        row.pid = id.pid;
+        if (by_pid) row.process_name = process_of(id.pid).name;
+        row.type = types[id.type];
+        row.user = users[id.user];
+        row.count = sorted[i].second;
+    }
+    return summary;
+}
+
+bool parse_group_keys(const std::string& value, std::vector<GroupKey>& keys, std::string& error_msg) {
+    keys.clear();
+    auto names = split_list(value);
+    if (names.empty()) {
+        error_msg = "Invalid group list: " + value;
+        return false;
+    }
+    for (const auto& name : names) {
+        GroupKey key;
+        if (name == "pid") key = GroupKey::Pid;
+        else if (name == "type") key = GroupKey::Type;
+        else if (name == "user") key = GroupKey::User;
+        else {
+            error_msg = "Unknown group key: " + name + " (expected pid, type or user)";
+            return false;
+        }
+        if (std::find(keys.begin(), keys.end(), key) != keys.end()) {
+            error_msg = "Group key given twice: " + name;
+            return false;
+        }
+        keys.push_back(key);
+    }
+    return true;
+}
+
+namespace {
+
+void append_cell(OutputBuffer& out, std::string_view s, size_t width) {
+    out.append(s);
+    out.append_fill(' ', width + 2 - (std::min)(s.size(), width + 1));
+}
+
+void write_table(OutputBuffer& out, const HandleSummary& summary) {
+    if (summary.rows.empty()) {
+        out.append(color::c(color::BOLD_YELLOW));
+        out.append("No open handles found.");
+        out.append(color::c(color::RESET));
+        out.append('\n');
+        return;
+    }
+
+    size_t command = 7, pid = 3, user = 4, type = 4, count = 5;
+    for (const auto& row : summary.rows) {
+        command = (std::max)(command, row.process_name.size());
+        pid = (std::max)(pid, decimal_digits(row.pid));
+        user = (std::max)(user, row.user.size());
+        type = (std::max)(type, row.type.size());
+        count = (std::max)(count, decimal_digits(row.count));
+    }
+
+    out.append(color::c(color::BOLD_CYAN));
+    for (GroupKey key : summary.keys) {
+        switch (key) {
+        case GroupKey::Pid:
+            append_cell(out, "COMMAND", command);
+            append_cell(out, "PID", pid);
+            break;
+        case GroupKey::Type: append_cell(out, "TYPE", type); break;
+        case GroupKey::User: append_cell(out, "USER", user); break;
+        }
+    }
+    out.append("COUNT");
+    out.append(color::c(color::RESET));
+    out.append('\n');
+
+    char number[24];
+    auto format = [&](uint64_t v) {
+        return std::string_view(number, static_cast<size_t>(std::to_chars(number, number + sizeof(number), v).ptr - number));
+    };
+    for (const auto& row : summary.rows) {
+        for (GroupKey key : summary.keys) {
+            switch (key) {
+            case GroupKey::Pid:
+                out.append(color::c(color::BOLD_GREEN));
+                append_cell(out, row.process_name, command);
+                out.append(color::c(color::RESET));
+                append_cell(out, format(row.pid), pid);
+                break;
+            case GroupKey::Type:
+                out.append(color::c(color::YELLOW));
+                append_cell(out, row.type, type);
+                out.append(color::c(color::RESET));
+                break;
+            case GroupKey::User:
+                out.append(color::c(color::DIM));
+                append_cell(out, row.user, user);
+                out.append(color::c(color::RESET));
+                break;
+            }
+        }
+        out.append_uint(row.count);
+        out.append('\n');
+    }
+
+    out.append(color::c(color::DIM));
+    out.append_uint(summary.handles);
+    out.append(" handles in ");
+    out.append_uint(summary.groups);
+    out.append(summary.groups == 1 ? " group" : " groups");
+    if (summary.rows.size() < summary.groups) {
+        out.append(", top ");
+        out.append_uint(summary.rows.size());
+        out.append(" shown");
+    }
+    out.append(color::c(color::RESET));
+    out.append('\n');
+}
+
+// The group's keys and count as JSON members, without the braces; pretty
+// puts each member on its own line, as the -j array does.
+void append_json_fields(OutputBuffer& out, const HandleSummary& summary, const SummaryRow& row,
+    bool pretty) {
+    auto member = [&](const char* name) {
+        out.append('"');
+        out.append(name);
+        out.append(pretty ? "\": " : "\":");
+    };
+    auto string_value = [&](const std::string& value) {
+        out.append('"');
+        append_json_escaped(out, value);
+        out.append('"');
+    };
+    auto next = [&]() { out.append(pretty ? ",\n    " : ","); };
+
+    for (GroupKey key : summary.keys) {
+        switch (key) {
+        case GroupKey::Pid:
+            member("command");
+            string_value(row.process_name);
+            next();
+            member("pid");
+            out.append_uint(row.pid);
+            break;
+        case GroupKey::Type:
+            member("type");
+            string_value(row.type);
+            break;
+        case GroupKey::User:
+            member("user");
+            string_value(row.user);
+            break;
+        }
+        next();
+    }
+    member("count");
+    out.append_uint(row.count);
+}
+
+} // anonymous namespace
+
+void write_summary(OutputBuffer& out, const HandleSummary& summary, const FilterOptions& opts) {
+    if (opts.output_ndjson) {
+        for (const auto& row : summary.rows) {
+            out.append('{');
+            append_json_fields(out, summary, row, false);
+            out.append("}\n");
+        }
+    }
+    else if (opts.output_json) {
+        out.append("[\n");
+        for (size_t i = 0; i < summary.rows.size(); ++i) {
+            if (i > 0) out.append(",\n");
+            out.append("  {\n    ");
+            append_json_fields(out, summary, summary.rows[i], true);
+            out.append("\n  }");
+        }
+        if (!summary.rows.empty()) out.append('\n');
+        out.append("]\n");
+    }
+    else {
+        write_table(out, summary);
+    }
+    out.flush();
+}
+
+} // namespace lsofwin
@@ -0,0 +1,100 @@
+#pragma once
+
+#include "handle_info.h"
+#include "handle_source.h"
+#include "output_sink.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace lsofwin {
+
+// Handle counts per process and object type, filled during a --summary /
+// --group-by scan in place of result rows. A type the backend's type table
+// names is counted under its index, a type that had to be resolved under its
+// name. Handles arrive grouped by process, so the common case is one PID
+// comparison and one array increment per handle.
+//
+// Not thread-safe: each worker fills its own counter and they are merged.
+class HandleCounter {
+public:
+    HandleCounter() = default;
+    HandleCounter(const HandleCounter&) = delete;
+    HandleCounter& operator=(const HandleCounter&) = delete;
+
+    void add(uint32_t pid, uint16_t type_index, uint64_t n = 1) {
+        auto& counts = counts_for(pid);
+        if (type_index >= counts.by_index.size()) {
+            counts.by_index.resize((std::max)(static_cast<size_t>(type_index) + 1, 2 * counts.by_index.size()));
+        }
+        counts.by_index[type_index] += n;
+    }
+
+    void add(uint32_t pid, const std::string& type, uint64_t n = 1) {
+        counts_for(pid).by_name[type] += n;
+    }
+
+    void merge(const HandleCounter& other);
+
+    // Calls fn(pid, type_index, type_name, count) for every non-zero cell;
+    // type_name is null for cells counted by index.
+    void for_each(const std::function<void(uint32_t, uint16_t, const std::string*, uint64_t)>& fn) const;
+
+    uint64_t total() const;
+
+private:
+    struct PidCounts {
+        std::vector<uint64_t> by_index;
+        std::map<std::string, uint64_t> by_name;
+    };
+
+    PidCounts& counts_for(uint32_t pid) {
+        // Node-based map: the pointer stays valid as other PIDs are added
+        if (!current_ || pid != current_pid_) {
+            current_ = &pids_[pid];
+            current_pid_ = pid;
+        }
+        return *current_;
+    }
+
+    std::unordered_map<uint32_t, PidCounts> pids_;
+    uint32_t current_pid_ = 0;
+    PidCounts* current_ = nullptr;
+};
+
+// One output group. Fields of keys not grouped on are left empty / zero.
+struct SummaryRow {
+    uint32_t    pid = 0;
+    std::string process_name;
+    std::string user;
+    std::string type;
+    uint64_t    count = 0;
+};
+
+struct HandleSummary {
+    std::vector<GroupKey> keys;
+    std::vector<SummaryRow> rows;   // Largest count first, ties in key order; at most --top rows
+    uint64_t handles = 0;           // Handles counted, including groups cut by --top
+    size_t groups = 0;              // Groups before --top
+};
+
+// Fold per-(process, type) counts into the requested groups. process(pid) is
+// called once per PID, and only when grouping by pid or user needs it.
+HandleSummary summarize_counts(const HandleCounter& counts, const std::vector<GroupKey>& keys,
+    const std::vector<std::string>& type_names, size_t top,
+    const std::function<const ProcessInfo&(uint32_t pid)>& process);
+
+// Parse a --group-by value: a comma-separated subset of pid, type and user,
+// in any order and without repeats.
+bool parse_group_keys(const std::string& value, std::vector<GroupKey>& keys, std::string& error_msg);
+
+// Write a summary as an aligned table with a totals line, or as JSON / NDJSON
+// (one object per group) under -j / --ndjson.
+void write_summary(OutputBuffer& out, const HandleSummary& summary, const FilterOptions& opts);
+
+} // namespace lsofwin
@@ -0,0 +1,122 @@
+#include "handle_table.h"
+
+#include <utility>
+
+namespace lsofwin {
+
+HandleInfo HandleTable::Row::to_info() const {
+    HandleInfo h;
+    h.pid = pid();
+    h.process_name.assign(process_name());
+    h.user.assign(user());
+    h.handle_type.assign(handle_type());
+    h.object_name.assign(object_name());
+    h.handle_value = handle_value();
+    h.granted_access = granted_access();
+    h.attributes = attributes();
+    h.object = object();
+    return h;
+}
+
+void HandleTable::reserve(size_t rows) {
+    row_process_.reserve(rows);
+    types_.reserve(rows);
+    names_.reserve(rows);
+    handle_values_.reserve(rows);
+    access_.reserve(rows);
+    attributes_.reserve(rows);
+    objects_.reserve(rows);
+}
+
+uint32_t HandleTable::add_process(uint32_t pid, std::string_view name, std::string_view user) {
+    auto matches = [&](const Process& p) {
+        return p.pid == pid && strings_.view(p.name) == name && strings_.view(p.user) == user;
+    };
+    if (!processes_.empty() && matches(processes_[last_process_])) return last_process_;
+
+    auto it = process_by_pid_.find(pid);
+    if (it == process_by_pid_.end() || !matches(processes_[it->second])) {
+        uint32_t index = static_cast<uint32_t>(processes_.size());
+        processes_.push_back(Process{ pid, strings_.intern(name), strings_.intern(user) });
+        it = process_by_pid_.insert_or_assign(pid, index).first;
+    }
+    last_process_ = it->second;
+    return last_process_;
+}
+
+void HandleTable::add(uint32_t process, std::string_view type, std::string_view name,
+    uintptr_t handle_value, uint32_t granted_access, uint32_t attributes, uintptr_t object) {
+    row_process_.push_back(process);
+    types_.push_back(strings_.intern(type));
+    names_.push_back(strings_.intern(name));
+    handle_values_.push_back(handle_value);
+    access_.push_back(granted_access);
+    attributes_.push_back(attributes);
+    objects_.push_back(object);
+}
+
+void HandleTable::push_back(const HandleInfo& h) {
+    add(add_process(h.pid, h.process_name, h.user), h.handle_type, h.object_name, h.handle_value,
+        h.granted_access, h.attributes, h.object);
+}
+
+void HandleTable::set(size_t i, const HandleInfo& h) {
+    row_process_[i] = add_process(h.pid, h.process_name, h.user);
+    types_[i] = strings_.intern(h.handle_type);
+    names_[i] = strings_.intern(h.object_name);
+    handle_values_[i] = h.handle_value;
+    access_[i] = h.granted_access;
+    attributes_[i] = h.attributes;
+    objects_[i] = h.object;
+}
+
+void HandleTable::compact() {
+    HandleTable fresh;
+    fresh.reserve(size());
+    for (size_t i = 0; i < size(); ++i) {
+        const auto& p = processes_[row_process_[i]];
+        fresh.add(fresh.add_process(p.pid, strings_.view(p.name), strings_.view(p.user)),
+            strings_.view(types_[i]), strings_.view(names_[i]), handle_values_[i],
+            access_[i], attributes_[i], objects_[i]);
+    }
+    *this = std::move(fresh);
+}
+
+void HandleTable::append(const HandleTable& other) {
+    reserve(size() + other.size());
+
+    // Map the other table's process entries once, then copy rows by id
+    std::vector<uint32_t> process_map(other.processes_.size());
+    for (size_t i = 0; i < other.processes_.size(); ++i) {
+        const auto& p = other.processes_[i];
+        process_map[i] = add_process(p.pid, other.strings_.view(p.name), other.strings_.view(p.user));
+    }
+    for (size_t i = 0; i < other.size(); ++i) {
+        row_process_.push_back(process_map[other.row_process_[i]]);
+        types_.push_back(strings_.intern(other.strings_.view(other.types_[i])));
+        names_.push_back(strings_.intern(other.strings_.view(other.names_[i])));
+        handle_values_.push_back(other.handle_values_[i]);
+        access_.push_back(other.access_[i]);
+        attributes_.push_back(other.attributes_[i]);
+        objects_.push_back(other.objects_[i]);
+    }
+}
+
+HandleList HandleTable::to_list() const {
+    HandleList list;
+    list.reserve(size());
+    for (auto row : *this) list.push_back(row.to_info());
+    return list;
+}
+
+size_t HandleTable::memory_bytes() const {
+    return strings_.memory_bytes() +
+        processes_.capacity() * sizeof(Process) +
+        process_by_pid_.size() * (sizeof(std::pair<const uint32_t, uint32_t>) + 2 * sizeof(void*)) +
+        process_by_pid_.bucket_count() * sizeof(void*) +
+        (row_process_.capacity() + types_.capacity() + names_.capacity() + access_.capacity() +
+            attributes_.capacity()) * sizeof(uint32_t) +
+        (handle_values_.capacity() + objects_.capacity()) * sizeof(uintptr_t);
+}
+
+} // namespace lsofwin
@@ -0,0 +1,136 @@
+#pragma once
+
+#include "handle_info.h"
+#include "string_pool.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace lsofwin {
+
+// Compact result set for very large scans. Each process's pid, name and user
+// are stored once in a process table; each row is a process index plus type
+// and name ids into a shared string arena plus the raw table fields, kept
+// column by column (structure of arrays). A million-row result costs a few hundred heap blocks instead of
+// four strings per row, and duplicate names are stored once.
+//
+// Rows are read through HandleTable::Row, a lightweight view with the same
+// fields as HandleInfo, returned as string_views into the table.
+class HandleTable {
+public:
+    struct Process {
+        uint32_t pid;
+        uint32_t name;  // String id
+        uint32_t user;  // String id
+    };
+
+    class Row {
+    public:
+        Row(const HandleTable& table, size_t index) : table_(&table), index_(index) {}
+
+        uint32_t pid() const { return process().pid; }
+        std::string_view process_name() const { return table_->strings_.view(process().name); }
+        std::string_view user() const { return table_->strings_.view(process().user); }
+        std::string_view handle_type() const { return table_->strings_.view(table_->types_[index_]); }
+        std::string_view object_name() const { return table_->strings_.view(table_->names_[index_]); }
+        uintptr_t handle_value() const { return table_->handle_values_[index_]; }
+        uint32_t granted_access() const { return table_->access_[index_]; }
+        uint32_t attributes() const { return table_->attributes_[index_]; }
+        uintptr_t object() const { return table_->objects_[index_]; }
+
+        // Copy the row out as a HandleInfo.
+        HandleInfo to_info() const;
+
+    private:
+        const Process& process() const { return table_->processes_[table_->row_process_[index_]]; }
+
+        const HandleTable* table_;
+        size_t index_;
+    };
+
+    class const_iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = Row;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = Row;
+
+        const_iterator(const HandleTable& table, size_t index) : table_(&table), index_(index) {}
+
+        Row operator*() const { return Row(*table_, index_); }
+        const_iterator& operator++() { ++index_; return *this; }
+        const_iterator operator++(int) { auto it = *this; ++index_; return it; }
+        bool operator==(const const_iterator& o) const { return index_ == o.index_; }
+        bool operator!=(const const_iterator& o) const { return index_ != o.index_; }
+
+    private:
+        const HandleTable* table_;
+        size_t index_;
+    };
+
+    size_t size() const { return row_process_.size(); }
+    bool empty() const { return row_process_.empty(); }
+    Row operator[](size_t i) const { return Row(*this, i); }
+    const_iterator begin() const { return const_iterator(*this, 0); }
+    const_iterator end() const { return const_iterator(*this, size()); }
+
+    void reserve(size_t rows);
+
+    // Index of the process entry for (pid, name, user), adding one if needed.
+    // Consecutive rows of one process hit a one-entry cache.
+    uint32_t add_process(uint32_t pid, std::string_view name, std::string_view user);
+
+    // Append a row for a process returned by add_process().
+    void add(uint32_t process, std::string_view type, std::string_view name, uintptr_t handle_value,
+        uint32_t granted_access = 0, uint32_t attributes = 0, uintptr_t object = 0);
+
+    void push_back(const HandleInfo& h);
+
+    // Overwrite row i in place, e.g. to reuse the slot of a closed handle.
+    void set(size_t i, const HandleInfo& h);
+
+    // Drop the strings and process entries no row refers to any more, which
+    // set() leaves behind. Row indices are unchanged.
+    void compact();
+
+    // Append every row of another table, re-interning its strings here.
+    void append(const HandleTable& other);
+
+    // Copy out as the classic vector of HandleInfo.
+    HandleList to_list() const;
+
+    // Columns, for callers that scan one field across all rows.
+    const std::vector<Process>& processes() const { return processes_; }
+    const std::vector<uint32_t>& process_column() const { return row_process_; }
+    const std::vector<uint32_t>& type_column() const { return types_; }
+    const std::vector<uint32_t>& name_column() const { return names_; }
+    const std::vector<uintptr_t>& handle_value_column() const { return handle_values_; }
+    const std::vector<uint32_t>& access_column() const { return access_; }
+    const std::vector<uint32_t>& attribute_column() const { return attributes_; }
+    const std::vector<uintptr_t>& object_column() const { return objects_; }
+    const StringPool& strings() const { return strings_; }
+
+    // Approximate heap bytes held by the table.
+    size_t memory_bytes() const;
+
+private:
+    StringPool strings_;
+    std::vector<Process> processes_;
+    std::unordered_map<uint32_t, uint32_t> process_by_pid_;
+    uint32_t last_process_ = 0;
+
+    std::vector<uint32_t> row_process_;
+    std::vector<uint32_t> types_;
+    std::vector<uint32_t> names_;
+    std::vector<uintptr_t> handle_values_;
+    std::vector<uint32_t> access_;
+    std::vector<uint32_t> attributes_;
+    std::vector<uintptr_t> objects_;
+};
+
+} // namespace lsofwin
@@ -0,0 +1,171 @@
+#include "handle_watcher.h"
+
+#include <algorithm>
+
+namespace lsofwin {
+
+HandleWatcher::HandleWatcher(HandleSource& source, const FilterOptions& opts)
+    : source_(source), opts_(opts), filter_(compile_filter(opts)) {
+}
+
+bool HandleWatcher::poll(std::vector<HandleEvent>& events) {
+    if (!source_.snapshot(table_)) return false;
+    ++generation_;
+    stats_ = Stats{};
+    stats_.handles_seen = table_.size();
+
+    // Type names are known after the first snapshot and do not change
+    if (!type_filter_ready_) {
+        type_names_ = source_.type_names();
+        type_filter_ = TypeFilter(opts_.filter_types, type_names_);
+        hang_risk_ = std::make_unique<HangRiskClassifier>(type_names_);
+        type_filter_ready_ = true;
+    }
+
+    // Key every entry. The table comes grouped by process, so the start
+    // time is looked up once per run of rows.
+    std::vector<std::pair<HandleKey, size_t>> current;
+    current.reserve(table_.size());
+    ProcessEntry* proc = nullptr;
+    for (size_t i = 0; i < table_.size(); ++i) {
+        const auto& entry = table_[i];
+        if (!filter_->pids().empty() && filter_->pid_verdict(entry.pid) == FilterExpr::Verdict::Reject) continue;
+        if (!proc || table_[i - 1].pid != entry.pid) {
+            proc = &process_entry(entry.pid, source_.process_start_time(entry.pid));
+        }
+        current.push_back({ HandleKey{ entry.pid, proc->start, entry.handle_value, entry.object }, i });
+    }
+    auto by_key = [](const std::pair<HandleKey, size_t>& a, const std::pair<HandleKey, size_t>& b) {
+        return a.first < b.first;
+    };
+    if (!std::is_sorted(current.begin(), current.end(), by_key)) {
+        std::sort(current.begin(), current.end(), by_key);
+    }
+
+    // Merge against the previous snapshot's keys
+    std::vector<Known> next;
+    next.reserve(current.size());
+    size_t k = 0;
+    auto close = [&](const Known& gone) {
+        if (gone.info == NoInfo) return;
+        events.push_back(HandleEvent{ HandleEvent::Kind::Close, std::move(infos_[gone.info]) });
+        infos_[gone.info] = HandleInfo{};
+        free_infos_.push_back(gone.info);
+    };
+
+    for (const auto& cur : current) {
+        const HandleKey& key = cur.first;
+        while (k < known_.size() && known_[k].key < key) close(known_[k++]);
+
+        if (k < known_.size() && known_[k].key == key) {
+            next.push_back(known_[k++]);
+            continue;
+        }
+
+        ++stats_.handles_new;
+        const auto& entry = table_[cur.second];
+        uint32_t info = evaluate(entry, cur.second, processes_[entry.pid]);
+        if (info != NoInfo) events.push_back(HandleEvent{ HandleEvent::Kind::Open, infos_[info] });
+        next.push_back(Known{ key, info });
+    }
+    while (k < known_.size()) close(known_[k++]);
+    known_.swap(next);
+
+    // Forget processes that have exited
+    for (auto it = processes_.begin(); it != processes_.end();) {
+        if (it->second.generation != generation_) {
+            hang_risk_->forget(it->first);
+            it = processes_.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+    return true;
+}
+
+HandleWatcher::ProcessEntry& HandleWatcher::process_entry(uint32_t pid, uint64_t start) {
+    auto it = processes_.find(pid);
+    if (it == processes_.end() || it->second.start != start) {
+        // A new process (or a reused PID). Unless -c decides whether it
+        // matches, its info is only needed once one of its handles matches;
+        // evaluate() fetches it then.
+        if (it != processes_.end()) hang_risk_->forget(pid);
+        ProcessEntry entry;
+        entry.start = start;
+        entry.verdict = filter_->pid_verdict(pid);
+        if (entry.verdict == FilterExpr::Verdict::NeedProcess) {
+            load_info(pid, entry);
+            entry.verdict = filter_->process_verdict(entry.info.name);
+        }
+        it = processes_.insert_or_assign(pid, std::move(entry)).first;
+    }
+    it->second.generation = generation_;
+    return it->second;
+}
+
+void HandleWatcher::load_info(uint32_t pid, ProcessEntry& proc) {
+    proc.info = source_.process_info(pid);
+    proc.info_loaded = true;
+    ++stats_.processes_looked_up;
+}
+
+uint32_t HandleWatcher::evaluate(const RawHandle& entry, size_t index, ProcessEntry& proc) {
+    if (proc.verdict == FilterExpr::Verdict::Reject) return NoInfo;
+
+    auto type_decision = type_filter_.check(entry.type_index);
+    if (type_decision == TypeFilter::Decision::Reject) return NoInfo;
+
+    // Handles like ones that have hung before are named from the type table
+    // alone, unless -f / +d / +D need the name: those are probed instead, so
+    // a skip never hides a row the filter would have matched
+    ResolvedHandle resolved;
+    HangRisk risk = hang_risk_->classify(entry);
+    if (risk == HangRisk::Skip && proc.verdict == FilterExpr::Verdict::CheckName) risk = HangRisk::Probe;
+    if (risk == HangRisk::Skip) {
+        if (!source_.is_process_accessible(entry.pid)) return NoInfo;
+        ++stats_.hang_risk_skipped;
+        resolved.type = type_names_[entry.type_index];
+        resolved.name = HangRiskMarker;
+    }
+    else {
+        ++stats_.handles_resolved;
+        uint32_t timeout_ms = static_cast<uint32_t>(opts_.timeout_seconds) * 1000;
+        if (risk == HangRisk::Probe) timeout_ms = (std::min)(timeout_ms, HangProbeTimeoutMs);
+        bool ok = source_.resolve(entry, index, timeout_ms, resolved);
+        if (resolved.timed_out) hang_risk_->record_timeout(entry);
+        if (!ok) return NoInfo;
+    }
+
+    if (type_decision == TypeFilter::Decision::Unknown && !type_filter_.matches_name(resolved.type)) {
+        return NoInfo;
+    }
+    if (proc.verdict == FilterExpr::Verdict::CheckName &&
+        filter_->check_name(resolved.name) != FilterExpr::NameResult::Match) {
+        return NoInfo;
+    }
+
+    if (!proc.info_loaded) load_info(entry.pid, proc);
+
+    HandleInfo hi;
+    hi.pid = entry.pid;
+    hi.process_name = proc.info.name;
+    hi.user = proc.info.user;
+    hi.handle_type = std::move(resolved.type);
+    hi.object_name = std::move(resolved.name);
+    hi.handle_value = entry.handle_value;
+    return store_info(std::move(hi));
+}
+
+uint32_t HandleWatcher::store_info(HandleInfo&& info) {
+    if (!free_infos_.empty()) {
+        uint32_t slot = free_infos_.back();
+        free_infos_.pop_back();
+        infos_[slot] = std::move(info);
+        return slot;
+    }
+    infos_.push_back(std::move(info));
+    return static_cast<uint32_t>(infos_.size() - 1);
+}
+
+} // namespace lsofwin
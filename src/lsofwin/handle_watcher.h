@@ -0,0 +1,118 @@
+#pragma once
+
+#include "filter_expr.h"
+#include "handle_info.h"
+#include "hang_guard.h"
+#include "handle_source.h"
+#include "type_filter.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace lsofwin {
+
+// Identity of one open handle across rescans. The process start time tells a
+// reused PID apart, and the object address tells a reused handle value apart
+// (on backends that leave object zero, a handle value reused for another
+// object between two scans is not noticed).
+struct HandleKey {
+    uint32_t  pid = 0;
+    uint64_t  process_start = 0;
+    uintptr_t handle_value = 0;
+    uintptr_t object = 0;
+
+    bool operator<(const HandleKey& o) const {
+        if (pid != o.pid) return pid < o.pid;
+        if (process_start != o.process_start) return process_start < o.process_start;
+        if (handle_value != o.handle_value) return handle_value < o.handle_value;
+        return object < o.object;
+    }
+    bool operator==(const HandleKey& o) const {
+        return pid == o.pid && process_start == o.process_start &&
+            handle_value == o.handle_value && object == o.object;
+    }
+};
+
+// A handle that appeared (Open) or disappeared (Close) between two scans.
+struct HandleEvent {
+    enum class Kind { Open, Close };
+
+    Kind kind = Kind::Open;
+    HandleInfo handle;
+};
+
+// Incremental rescans for -r. Every poll() takes a fresh snapshot and merges
+// its keys against the previous one: handles seen before (whether they
+// matched the filters or not) are neither resolved nor filtered again, so a
+// steady-state poll costs the snapshot, one start-time lookup per process and
+// a linear merge. Process info is looked up once per (pid, start time).
+class HandleWatcher {
+public:
+    struct Stats {
+        uint64_t handles_seen = 0;      // Entries in this snapshot
+        uint64_t handles_new = 0;       // Keys not present in the previous snapshot
+        uint64_t handles_resolved = 0;  // HandleSource::resolve() calls
+        uint64_t processes_looked_up = 0; // HandleSource::process_info() calls
+        uint64_t hang_risk_skipped = 0; // New handles not queried because of their hang risk
+    };
+
+    HandleWatcher(HandleSource& source, const FilterOptions& opts);
+
+    HandleWatcher(const HandleWatcher&) = delete;
+    HandleWatcher& operator=(const HandleWatcher&) = delete;
+
+    // Rescan and append the changes since the previous poll to events, in
+    // (pid, handle value) order. The first poll reports every matching handle
+    // as opened. Returns false if the snapshot failed (state is unchanged).
+    bool poll(std::vector<HandleEvent>& events);
+
+    // Counters for the most recent poll().
+    const Stats& last_stats() const { return stats_; }
+
+    // Handles currently open that match the filters.
+    size_t matching_handles() const { return infos_.size() - free_infos_.size(); }
+
+private:
+    static constexpr uint32_t NoInfo = 0xffffffffu;
+
+    // One key from the previous snapshot; info indexes infos_ for handles
+    // that matched the filters and is NoInfo for the rest.
+    struct Known {
+        HandleKey key;
+        uint32_t info;
+    };
+
+    struct ProcessEntry {
+        uint64_t start = 0;
+        ProcessInfo info;
+        bool info_loaded = false;
+        FilterExpr::Verdict verdict = FilterExpr::Verdict::Reject; // From -p and -c
+        uint64_t generation = 0;    // Last poll that saw this PID
+    };
+
+    ProcessEntry& process_entry(uint32_t pid, uint64_t start);
+    void load_info(uint32_t pid, ProcessEntry& proc);
+    uint32_t evaluate(const RawHandle& entry, size_t index, ProcessEntry& proc);
+    uint32_t store_info(HandleInfo&& info);
+
+    HandleSource& source_;
+    const FilterOptions& opts_;
+    TypeFilter type_filter_;
+    bool type_filter_ready_ = false;
+    std::vector<std::string> type_names_;
+    std::unique_ptr<HangRiskClassifier> hang_risk_;   // Keeps its history across polls
+    std::shared_ptr<const FilterExpr> filter_;
+
+    std::vector<RawHandle> table_;
+    std::vector<Known> known_;          // Sorted by key
+    std::vector<HandleInfo> infos_;
+    std::vector<uint32_t> free_infos_;
+    std::unordered_map<uint32_t, ProcessEntry> processes_;
+    uint64_t generation_ = 0;
+    Stats stats_;
+};
+
+} // namespace lsofwin
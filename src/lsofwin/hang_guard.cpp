@@ -0,0 +1,82 @@
+#include "hang_guard.h"
+
+#include <algorithm>
+#include <iterator>
+
+namespace lsofwin {
+
+namespace {
+
+// GrantedAccess values of synchronous named pipe and device handles whose
+// name query waits for pending I/O on the file object
+constexpr uint32_t blocking_access_masks[] = {
+    0x0012019f,     // FILE_GENERIC_READ | FILE_GENERIC_WRITE, synchronous
+    0x001a019f,     // The same with WRITE_DAC
+    0x00120189,     // FILE_GENERIC_READ | FILE_WRITE_DATA | FILE_WRITE_ATTRIBUTES
+    0x00100000,     // SYNCHRONIZE only
+};
+
+} // anonymous namespace
+
+HangRiskClassifier::HangRiskClassifier(const std::vector<std::string>& type_names)
+    : file_types_(type_names.size(), 0) {
+    for (size_t i = 0; i < type_names.size(); ++i) {
+        if (type_names[i] == "File") file_types_[i] = 1;
+    }
+}
+
+bool HangRiskClassifier::is_blocking_access(uint32_t granted_access) {
+    return std::find(std::begin(blocking_access_masks), std::end(blocking_access_masks), granted_access) !=
+        std::end(blocking_access_masks);
+}
+
+HangRisk HangRiskClassifier::classify(const RawHandle& entry) const {
+    if (!is_file_type(entry.type_index) || !is_blocking_access(entry.granted_access)) return HangRisk::None;
+
+    if (has_history_.load(std::memory_order_acquire)) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = history_.find(entry.pid);
+        if (it != history_.end() &&
+            std::find(it->second.begin(), it->second.end(), entry.granted_access) != it->second.end()) {
+            return HangRisk::Skip;
+        }
+    }
+    return HangRisk::Probe;
+}
+
+void HangRiskClassifier::record_timeout(const RawHandle& entry) {
+    if (!is_file_type(entry.type_index) || !is_blocking_access(entry.granted_access)) return;
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& masks = history_[entry.pid];
+    if (std::find(masks.begin(), masks.end(), entry.granted_access) == masks.end()) {
+        masks.push_back(entry.granted_access);
+    }
+    has_history_.store(true, std::memory_order_release);
+}
+
+void HangRiskClassifier::forget(uint32_t pid) {
+    if (!has_history_.load(std::memory_order_acquire)) return;
+    std::lock_guard<std::mutex> lock(mutex_);
+    history_.erase(pid);
+}
+
+ScanDeadline::ScanDeadline(std::chrono::milliseconds budget, Clock::time_point start)
+    : active_(budget.count() > 0), end_(start + budget) {
+}
+
+bool ScanDeadline::expired(Clock::time_point now) const {
+    if (!active_) return false;
+    if (expired_.load(std::memory_order_relaxed)) return true;
+    if (now < end_) return false;
+    expired_.store(true, std::memory_order_relaxed);
+    return true;
+}
+
+uint32_t ScanDeadline::query_timeout_ms(uint32_t timeout_ms, Clock::time_point now) const {
+    if (!active_) return timeout_ms;
+    if (expired(now)) return 0;
+    auto left = std::chrono::ceil<std::chrono::milliseconds>(end_ - now).count();
+    return static_cast<uint32_t>((std::min)(static_cast<long long>(timeout_ms), static_cast<long long>(left)));
+}
+
+} // namespace lsofwin
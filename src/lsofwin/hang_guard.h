@@ -0,0 +1,109 @@
+#pragma once
+
+#include "handle_source.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace lsofwin {
+
+// What to do about a handle whose name query might hang.
+enum class HangRisk : uint8_t {
+    None,   // Query with the -t timeout
+    Probe,  // Query with the short HangProbeTimeoutMs instead
+    Skip,   // Do not query; the row gets HangRiskMarker as its name
+};
+
+// Timeout for a Probe query (or -t, if that is shorter). A name query that
+// completes at all takes microseconds; one that takes this long is stuck.
+constexpr uint32_t HangProbeTimeoutMs = 50;
+
+// Object name shown for a handle that was not queried because of its risk.
+constexpr const char* HangRiskMarker = "<not queried: hang risk>";
+
+// Recognises handles whose NtQueryObject(ObjectNameInformation) is likely to
+// block, from the raw table entry alone, before anything is queried:
+//
+//   - Only File objects can block; every other type is named by the object
+//     manager without calling into a driver.
+//   - File handles with the access masks that synchronous named pipes and
+//     some device handles are opened with (the masks handle listing tools
+//     have long special-cased) are probed with a short timeout. The same
+//     masks are common on ordinary files, so they are not skipped outright.
+//   - Once a probe of one of those masks timed out, further handles of the
+//     same process with the same mask are skipped. Other masks are never
+//     skipped, however many timeouts the process had.
+//
+// Thread-safe. The history is kept until forget(). Only the repeat-mode
+// watcher records timeouts: it evaluates handles in table order, one poll
+// after another, so what is skipped does not depend on thread timing. A
+// one-shot scan only probes.
+class HangRiskClassifier {
+public:
+    // Classifies nothing.
+    HangRiskClassifier() = default;
+
+    // type_names: the backend's type index -> name table. Indices missing
+    // from it are never classified.
+    explicit HangRiskClassifier(const std::vector<std::string>& type_names);
+
+    HangRiskClassifier(const HangRiskClassifier&) = delete;
+    HangRiskClassifier& operator=(const HangRiskClassifier&) = delete;
+
+    HangRisk classify(const RawHandle& entry) const;
+
+    // A name query for entry hit its timeout. Only File handles with a
+    // blocking access mask are remembered.
+    void record_timeout(const RawHandle& entry);
+
+    // The process has exited; its PID may be reused by another program.
+    void forget(uint32_t pid);
+
+    // True for the access masks of synchronous pipe and device handles.
+    static bool is_blocking_access(uint32_t granted_access);
+
+private:
+    bool is_file_type(uint16_t type_index) const {
+        return type_index < file_types_.size() && file_types_[type_index];
+    }
+
+    std::vector<uint8_t> file_types_;
+    mutable std::mutex mutex_;
+    std::unordered_map<uint32_t, std::vector<uint32_t>> history_;   // PID -> blocking masks that timed out
+    std::atomic<bool> has_history_{ false };    // Lets classify() skip the lock
+};
+
+// --deadline: a time budget for a whole scan, counted from before the
+// snapshot. Each name query is given no more than the time that is left, so
+// a query that hangs cannot carry the scan past the deadline, and once it has
+// passed no further handles are resolved: the scan returns what it has.
+// Thread-safe; a zero budget never expires.
+class ScanDeadline {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    ScanDeadline() = default;
+    explicit ScanDeadline(std::chrono::milliseconds budget, Clock::time_point start = Clock::now());
+
+    bool active() const { return active_; }
+
+    // True once the deadline has passed (and from then on without reading
+    // the clock).
+    bool expired(Clock::time_point now = Clock::now()) const;
+
+    // Timeout for a query that would otherwise get timeout_ms: the time left,
+    // rounded up to a whole millisecond, if that is shorter; 0 once expired.
+    uint32_t query_timeout_ms(uint32_t timeout_ms, Clock::time_point now = Clock::now()) const;
+
+private:
+    bool active_ = false;
+    Clock::time_point end_;
+    mutable std::atomic<bool> expired_{ false };
+};
+
+} // namespace lsofwin
@@ -0,0 +1,335 @@
+#include "index_server.h"
+#include "cli_parser.h"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+namespace lsofwin {
+
+namespace {
+
+constexpr uint32_t MaxRequestArgs = 1024;
+constexpr uint32_t MaxRequestArgBytes = 64 * 1024;
+constexpr uint32_t MaxFrameBytes = 64 * 1024 * 1024;
+constexpr size_t ResponseBufferSize = 64 * 1024;
+constexpr size_t MaxCachedQueries = 1024;
+
+void append_u32(std::string& out, uint32_t v) {
+    out.append(reinterpret_cast<const char*>(&v), sizeof(v));
+}
+
+bool read_u32(LocalStream& stream, uint32_t& v) {
+    return stream.read_exact(&v, sizeof(v));
+}
+
+bool read_request(LocalStream& client, std::vector<std::string>& args) {
+    char magic[sizeof(IndexRequestMagic)];
+    uint32_t count = 0;
+    if (!client.read_exact(magic, sizeof(magic)) ||
+        std::memcmp(magic, IndexRequestMagic, sizeof(magic)) != 0 ||
+        !read_u32(client, count) || count > MaxRequestArgs) {
+        return false;
+    }
+    args.resize(count);
+    for (auto& arg : args) {
+        uint32_t size = 0;
+        if (!read_u32(client, size) || size > MaxRequestArgBytes) return false;
+        arg.resize(size);
+        if (size > 0 && !client.read_exact(&arg[0], size)) return false;
+    }
+    return true;
+}
+
+std::string lower(std::string s) {
+    std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return s;
+}
+
+// One selection option (-p, -c, -f, +d / +D) and its alternatives
+enum class Selection { Pids, ProcessNames, Files, Dirs };
+
+std::vector<Selection> selections(const FilterOptions& opts) {
+    std::vector<Selection> out;
+    if (!opts.filter_pids.empty()) out.push_back(Selection::Pids);
+    if (!opts.filter_process_names.empty()) out.push_back(Selection::ProcessNames);
+    if (!opts.filter_file_regexes.empty()) out.push_back(Selection::Files);
+    if (!opts.filter_dirs.empty()) out.push_back(Selection::Dirs);
+    return out;
+}
+
+// Whether every handle the query's selection s passes also passes the
+// server's selection s. Conservative: patterns and directories must be
+// given the same way.
+bool selection_within(Selection s, const FilterOptions& query, const FilterOptions& server) {
+    auto contains = [](const auto& values, auto pred) { return std::any_of(values.begin(), values.end(), pred); };
+    switch (s) {
+    case Selection::Pids:
+        return std::all_of(query.filter_pids.begin(), query.filter_pids.end(), [&](uint32_t pid) {
+            return contains(server.filter_pids, [&](uint32_t p) { return p == pid; });
+        });
+    case Selection::ProcessNames:
+        // -c matches substrings: a name containing "python3" contains "python"
+        return std::all_of(query.filter_process_names.begin(), query.filter_process_names.end(),
+            [&](const std::string& name) {
+                auto q = lower(name);
+                return contains(server.filter_process_names,
+                    [&](const std::string& n) { return q.find(lower(n)) != std::string::npos; });
+            });
+    case Selection::Files:
+        return std::all_of(query.filter_file_regexes.begin(), query.filter_file_regexes.end(),
+            [&](const std::string& pattern) {
+                return contains(server.filter_file_regexes, [&](const std::string& p) { return p == pattern; });
+            });
+    case Selection::Dirs:
+        return std::all_of(query.filter_dirs.begin(), query.filter_dirs.end(), [&](const DirSelection& dir) {
+            return contains(server.filter_dirs, [&](const DirSelection& d) {
+                return lower(d.path) == lower(dir.path) && (d.recursive || !dir.recursive);
+            });
+        });
+    }
+    return false;
+}
+
+// Whether everything query can match is in an index built with the server's
+// filters. A query this cannot prove it for is scanned by the client.
+bool query_within(const FilterOptions& query, const FilterOptions& server) {
+    // -T always restricts, so the query's types must all be indexed ones
+    if (!server.filter_types.empty()) {
+        if (query.filter_types.empty()) return false;
+        for (const auto& type : query.filter_types) {
+            bool indexed = std::any_of(server.filter_types.begin(), server.filter_types.end(),
+                [&](const std::string& t) { return lower(t) == lower(type); });
+            if (!indexed) return false;
+        }
+    }
+
+    auto server_selections = selections(server);
+    if (server_selections.empty()) return true;
+    auto query_selections = selections(query);
+    bool server_any = server.filter_any && server_selections.size() > 1;
+    bool query_any = query.filter_any && query_selections.size() > 1;
+    auto within = [&](Selection s) {
+        return std::find(server_selections.begin(), server_selections.end(), s) != server_selections.end() &&
+            selection_within(s, query, server);
+    };
+
+    if (!server_any) {
+        // Every server selection has to be narrowed by the same (ANDed) option
+        if (query_any) return false;
+        return std::all_of(server_selections.begin(), server_selections.end(), [&](Selection s) {
+            return std::find(query_selections.begin(), query_selections.end(), s) != query_selections.end() &&
+                selection_within(s, query, server);
+        });
+    }
+    // --or on the server: ANDed, one query option inside a server option is
+    // enough; ORed, each query option has to be
+    if (query_any) return std::all_of(query_selections.begin(), query_selections.end(), within);
+    return std::any_of(query_selections.begin(), query_selections.end(), within);
+}
+
+} // anonymous namespace
+
+IndexServer::IndexServer(HandleSource& source, const FilterOptions& opts)
+    : opts_(opts), source_(source), watcher_(source_, opts_) {}
+
+bool IndexServer::refresh() {
+    std::lock_guard<std::mutex> lock(refresh_mutex_);
+    events_.clear();
+    if (!watcher_.poll(events_)) return false;
+
+    std::unique_lock<std::shared_mutex> index_lock(index_mutex_);
+    index_.apply(events_);
+    return true;
+}
+
+bool IndexServer::parse_query(const std::vector<std::string>& args, FilterOptions& query,
+    std::string& error_msg) {
+    std::string key;
+    for (const auto& arg : args) {
+        key += arg;
+        key += '\0';
+    }
+    std::lock_guard<std::mutex> lock(query_cache_mutex_);
+    auto it = query_cache_.find(key);
+    if (it != query_cache_.end()) {
+        query = it->second;
+        return true;
+    }
+
+    // Parsed as the client's own command line was, so options a --client run
+    // refuses (--summary, -o, --stats, ...) are refused here with the same
+    // message rather than ignored
+    std::vector<const char*> argv = { "lsofwin", "--client" };
+    for (const auto& arg : args) argv.push_back(arg.c_str());
+    if (!parse_args(static_cast<int>(argv.size()), argv.data(), query, error_msg)) return false;
+    if (query.show_help || query.show_version || query.repeat_seconds > 0 ||
+        !query.decode_file.empty() || query.serve) {
+        error_msg = "Only filter and output options can be sent to the server";
+        return false;
+    }
+
+    if (query_cache_.size() >= MaxCachedQueries) query_cache_.clear();
+    query_cache_.emplace(std::move(key), query);
+    return true;
+}
+
+IndexServer::Answer IndexServer::answer(const std::vector<std::string>& args, OutputBuffer& out,
+    std::string& error_msg) {
+    FilterOptions query;
+    if (!parse_query(args, query, error_msg)) return Answer::Rejected;
+    if (!query_within(query, opts_)) return Answer::NotIndexed;
+
+    auto sink = make_output_sink(out, query);
+    std::shared_lock<std::shared_mutex> lock(index_mutex_);
+    index_.query(query, [&](const HandleInfo& h) { sink->write(h); });
+    sink->finish();
+    return Answer::Answered;
+}
+
+void IndexServer::run(LocalListener& listener) {
+    {
+        std::lock_guard<std::mutex> lock(stop_mutex_);
+        wake_path_ = listener.path();
+    }
+
+    int seconds = opts_.repeat_seconds > 0 ? opts_.repeat_seconds : DefaultServeRefreshSeconds;
+    std::thread refresher([this, seconds] {
+        std::unique_lock<std::mutex> lock(stop_mutex_);
+        while (!stop_cv_.wait_for(lock, std::chrono::seconds(seconds), [this] { return stopping_.load(); })) {
+            lock.unlock();
+            refresh();
+            lock.lock();
+        }
+    });
+
+    while (!stopping_) {
+        // A client that connects and then stalls is dropped after the
+        // timeout instead of blocking everyone queued behind it
+        LocalStream client;
+        client.set_timeout(client_timeout_ms_);
+        if (!listener.accept(client)) {
+            // Out of descriptors or similar: back off rather than spin
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            continue;
+        }
+        if (stopping_) break;
+        serve_client(client);
+    }
+    refresher.join();
+}
+
+void IndexServer::stop() {
+    std::string path;
+    {
+        std::lock_guard<std::mutex> lock(stop_mutex_);
+        stopping_ = true;
+        path = wake_path_;
+    }
+    stop_cv_.notify_all();
+
+    // Wake the accept loop with a connection of our own
+    if (!path.empty()) {
+        LocalStream wake;
+        std::string ignored;
+        wake.connect(path, ignored);
+    }
+}
+
+size_t IndexServer::indexed_handles() const {
+    std::shared_lock<std::shared_mutex> lock(index_mutex_);
+    return index_.size();
+}
+
+void IndexServer::serve_client(LocalStream& client) {
+    bool ok = true;
+    auto send_frame = [&](IndexFrame kind, const char* data, size_t size) {
+        char header[5];
+        header[0] = static_cast<char>(kind);
+        uint32_t n = static_cast<uint32_t>(size);
+        std::memcpy(header + 1, &n, sizeof(n));
+        ok = ok && client.write_all(header, sizeof(header)) && (size == 0 || client.write_all(data, size));
+    };
+
+    std::vector<std::string> args;
+    if (!read_request(client, args)) {
+        static const char message[] = "Malformed or unsupported request";
+        send_frame(IndexFrame::Error, message, sizeof(message) - 1);
+        return;
+    }
+
+    std::string error_msg;
+    OutputBuffer out([&](const char* data, size_t size) {
+        // Large appends bypass the buffer; keep frames within the client's limit
+        while (size > 0) {
+            size_t chunk = (std::min)(size, static_cast<size_t>(MaxFrameBytes));
+            send_frame(IndexFrame::Data, data, chunk);
+            data += chunk;
+            size -= chunk;
+        }
+    }, ResponseBufferSize);
+    switch (answer(args, out, error_msg)) {
+    case Answer::Rejected:
+        send_frame(IndexFrame::Error, error_msg.data(), error_msg.size());
+        return;
+    case Answer::NotIndexed:
+        send_frame(IndexFrame::NotIndexed, nullptr, 0);
+        return;
+    case Answer::Answered:
+        break;
+    }
+    out.flush();
+    send_frame(IndexFrame::End, nullptr, 0);
+}
+
+ClientResult query_server(const std::string& socket_path, const std::vector<std::string>& args,
+    const OutputBuffer::FlushFn& out, std::string& error_msg, uint32_t timeout_ms) {
+    LocalStream stream;
+    stream.set_timeout(timeout_ms);
+    std::string ignored;
+    if (!stream.connect(socket_path, ignored)) return ClientResult::Unavailable;
+
+    // Whoever got to the path first could feed us false answers
+    if (!stream.peer_trusted()) return ClientResult::Unavailable;
+
+    std::string request(IndexRequestMagic, sizeof(IndexRequestMagic));
+    append_u32(request, static_cast<uint32_t>(args.size()));
+    for (const auto& arg : args) {
+        append_u32(request, static_cast<uint32_t>(arg.size()));
+        request += arg;
+    }
+
+    std::vector<char> data;
+    if (stream.write_all(request.data(), request.size())) {
+        char header[5];
+        while (stream.read_exact(header, sizeof(header))) {
+            uint32_t size = 0;
+            std::memcpy(&size, header + 1, sizeof(size));
+            if (size > MaxFrameBytes) break;
+            data.resize(size);
+            if (size > 0 && !stream.read_exact(data.data(), size)) break;
+
+            auto kind = static_cast<IndexFrame>(header[0]);
+            if (kind == IndexFrame::Data) {
+                out(data.data(), size);
+            } else if (kind == IndexFrame::End) {
+                return ClientResult::Answered;
+            } else if (kind == IndexFrame::Error) {
+                error_msg.assign(data.data(), size);
+                return ClientResult::Failed;
+            } else if (kind == IndexFrame::NotIndexed) {
+                return ClientResult::Unavailable;
+            } else {
+                break;
+            }
+        }
+    }
+    error_msg = stream.timed_out()
+        ? "The server at " + socket_path + " stopped responding"
+        : "Connection to the server at " + socket_path + " ended before the answer was complete";
+    return ClientResult::Failed;
+}
+
+} // namespace lsofwin
@@ -0,0 +1,124 @@
+#pragma once
+
+#include "handle_index.h"
+#include "handle_info.h"
+#include "handle_source.h"
+#include "handle_watcher.h"
+#include "local_socket.h"
+#include "output_sink.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace lsofwin {
+
+// --serve / --client protocol, over a LocalStream.
+//
+// Request:   IndexRequestMagic, uint32 argument count, then per argument a
+//            uint32 length and its bytes. The arguments are ordinary
+//            command-line options (-p, -c, -f, -T, -j, --ndjson, ...).
+// Response:  frames of {uint8 kind, uint32 length, bytes}: Data frames carry
+//            output exactly as a local run would print it, then one End
+//            frame; or a single Error frame with a message; or a single
+//            NotIndexed frame when the server's own filters may have left out
+//            handles the query matches, and the client has to scan itself.
+//
+// Integers are in host byte order; both ends run on the same machine.
+constexpr char IndexRequestMagic[8] = { 'L', 'S', 'O', 'F', 'W', 'Q', '0', '1' };
+
+enum class IndexFrame : uint8_t { Data, End, Error, NotIndexed };
+
+// Refresh interval when --serve is given without -r.
+constexpr int DefaultServeRefreshSeconds = 1;
+
+// How long the server waits on a client that stops sending or reading
+// before it drops it and serves the next one.
+constexpr uint32_t DefaultClientTimeoutMs = 5000;
+
+// How long --client waits on a stalled server: long enough to sit behind
+// another client that the server gives up on.
+constexpr uint32_t DefaultQueryTimeoutMs = 30000;
+
+// The --serve daemon: a HandleWatcher polling the source feeds a HandleIndex,
+// and queries are answered from the index without scanning. The server's own
+// -p/-c/-T/-f/+d/+D options limit what is indexed; only queries that provably
+// stay within them are answered.
+class IndexServer {
+public:
+    // What answer() did with a query. Nothing is written unless Answered.
+    enum class Answer {
+        Answered,
+        NotIndexed,     // The query may match handles the server's filters left out
+        Rejected,       // The arguments do not describe a query (error_msg)
+    };
+
+    IndexServer(HandleSource& source, const FilterOptions& opts);
+
+    IndexServer(const IndexServer&) = delete;
+    IndexServer& operator=(const IndexServer&) = delete;
+
+    // Rescan and apply the changes to the index. Safe to call while run() is
+    // answering queries; returns false if the snapshot failed.
+    bool refresh();
+
+    // Answer a query given as command-line arguments (without the program
+    // name), writing the output to out.
+    Answer answer(const std::vector<std::string>& args, OutputBuffer& out, std::string& error_msg);
+
+    // Serve clients from listener, one at a time, and refresh every -r
+    // seconds on a background thread, until stop().
+    void run(LocalListener& listener);
+
+    // Make run() return. Callable from any thread.
+    void stop();
+
+    // Per-read / per-write timeout for clients (DefaultClientTimeoutMs).
+    // Set before run().
+    void set_client_timeout(uint32_t timeout_ms) { client_timeout_ms_ = timeout_ms; }
+
+    // Handles currently in the index.
+    size_t indexed_handles() const;
+
+private:
+    void serve_client(LocalStream& client);
+    bool parse_query(const std::vector<std::string>& args, FilterOptions& query, std::string& error_msg);
+
+    FilterOptions opts_;
+    HandleSource& source_;
+    std::mutex refresh_mutex_;          // Serializes refresh(); guards watcher_, events_
+    HandleWatcher watcher_;
+    std::vector<HandleEvent> events_;
+    mutable std::shared_mutex index_mutex_;
+    HandleIndex index_;
+
+    // Parsed queries by their arguments: compiling a -f pattern costs far
+    // more than answering it, and tools tend to ask the same few questions
+    std::mutex query_cache_mutex_;
+    std::unordered_map<std::string, FilterOptions> query_cache_;
+
+    std::mutex stop_mutex_;
+    std::condition_variable stop_cv_;
+    std::atomic<bool> stopping_{ false };
+    std::string wake_path_;
+    uint32_t client_timeout_ms_ = DefaultClientTimeoutMs;
+};
+
+enum class ClientResult {
+    Unavailable,    // No server is listening, or its index cannot answer; scan locally instead
+    Answered,       // The server's output was written to out
+    Failed,         // The server rejected the query or the connection broke (error_msg)
+};
+
+// Send a query to a --serve instance at socket_path and pass its output to
+// out as it arrives. A server that makes no progress for timeout_ms fails
+// the query.
+ClientResult query_server(const std::string& socket_path, const std::vector<std::string>& args,
+    const OutputBuffer::FlushFn& out, std::string& error_msg, uint32_t timeout_ms = DefaultQueryTimeoutMs);
+
+} // namespace lsofwin
@@ -0,0 +1,59 @@
+#include "json_escape.h"
+#include "simd.h"
+
+namespace lsofwin {
+
+namespace {
+
+inline bool is_json_special(unsigned char c) {
+    return c < 0x20 || c == '"' || c == '\\';
+}
+
+} // anonymous namespace
+
+size_t find_json_special(std::string_view s) {
+    size_t i = 0;
+#if LSOFWIN_HAVE_SSE2
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i control_max = _mm_set1_epi8(0x1f);
+
+    for (; i + 16 <= s.size(); i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s.data() + i));
+        // max_epu8(v, 0x1f) == 0x1f exactly when v <= 0x1f (unsigned)
+        __m128i control = _mm_cmpeq_epi8(_mm_max_epu8(v, control_max), control_max);
+        __m128i special = _mm_or_si128(control,
+            _mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, backslash)));
+        uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(special));
+        if (mask) return i + count_trailing_zeros(mask);
+    }
+#endif
+    for (; i < s.size(); ++i) {
+        if (is_json_special(static_cast<unsigned char>(s[i]))) return i;
+    }
+    return s.size();
+}
+
+size_t json_escape_byte(unsigned char c, char* out) {
+    out[0] = '\\';
+    switch (c) {
+    case '"':  out[1] = '"';  return 2;
+    case '\\': out[1] = '\\'; return 2;
+    case '\b': out[1] = 'b';  return 2;
+    case '\f': out[1] = 'f';  return 2;
+    case '\n': out[1] = 'n';  return 2;
+    case '\r': out[1] = 'r';  return 2;
+    case '\t': out[1] = 't';  return 2;
+    default:
+        break;
+    }
+    static const char hex[] = "0123456789abcdef";
+    out[1] = 'u';
+    out[2] = '0';
+    out[3] = '0';
+    out[4] = hex[c >> 4];
+    out[5] = hex[c & 0xf];
+    return 6;
+}
+
+} // namespace lsofwin
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+
+namespace lsofwin {
+
+// Offset of the first byte of s that JSON requires escaping (a quote, a
+// backslash or a control character below 0x20), or s.size() if there is
+// none. Checks 16 bytes per step with SSE2 where available, so clean runs —
+// nearly all of a typical path — are found at memchr-like speed.
+size_t find_json_special(std::string_view s);
+
+// Write the escape sequence for one byte that find_json_special() stopped
+// at ("\\\"", "\\n", "\\u001f", ...) to out, which must hold 6 bytes.
+// Returns the sequence length.
+size_t json_escape_byte(unsigned char c, char* out);
+
+// Append s to out (anything with append(std::string_view)) with JSON
+// escaping, copying clean runs in bulk.
+template <typename Out>
+void append_json_escaped(Out& out, std::string_view s) {
+    while (!s.empty()) {
+        size_t clean = find_json_special(s);
+        if (clean > 0) out.append(s.substr(0, clean));
+        if (clean == s.size()) return;
+
+        char seq[6];
+        size_t n = json_escape_byte(static_cast<unsigned char>(s[clean]), seq);
+        out.append(std::string_view(seq, n));
+        s.remove_prefix(clean + 1);
+    }
+}
+
+} // namespace lsofwin
@@ -0,0 +1,395 @@
+#include "local_socket.h"
+
+#ifdef _WIN32
+#include <windows.h>
+
+#include <vector>
+#else
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace lsofwin {
+
+#ifdef _WIN32
+
+namespace {
+
+constexpr DWORD PipeBufferSize = 64 * 1024;
+constexpr uint32_t LingerTimeoutMs = 5000;
+
+HANDLE create_pipe_instance(const std::string& path, bool first) {
+    DWORD open_mode = PIPE_ACCESS_DUPLEX | FILE_FLAG_OVERLAPPED | (first ? FILE_FLAG_FIRST_PIPE_INSTANCE : 0);
+    return CreateNamedPipeA(path.c_str(), open_mode,
+        PIPE_TYPE_BYTE | PIPE_READMODE_BYTE | PIPE_WAIT | PIPE_REJECT_REMOTE_CLIENTS,
+        PIPE_UNLIMITED_INSTANCES, PipeBufferSize, PipeBufferSize, 0, nullptr);
+}
+
+// TOKEN_USER of a process, or empty if it cannot be read
+std::vector<BYTE> process_user(HANDLE process) {
+    HANDLE token = nullptr;
+    if (!OpenProcessToken(process, TOKEN_QUERY, &token)) return {};
+    DWORD size = 0;
+    GetTokenInformation(token, TokenUser, nullptr, 0, &size);
+    std::vector<BYTE> user(size);
+    if (size == 0 || !GetTokenInformation(token, TokenUser, user.data(), size, &size)) user.clear();
+    CloseHandle(token);
+    return user;
+}
+
+} // anonymous namespace
+
+LocalStream::~LocalStream() {
+    close();
+}
+
+bool LocalStream::connect(const std::string& path, std::string& error_msg) {
+    close();
+    for (int attempt = 0; attempt < 2; ++attempt) {
+        HANDLE h = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr,
+            OPEN_EXISTING, FILE_FLAG_OVERLAPPED, nullptr);
+        if (h != INVALID_HANDLE_VALUE) {
+            handle_ = h;
+            return true;
+        }
+        // Every instance is busy with another client: wait for one to free up
+        if (GetLastError() != ERROR_PIPE_BUSY || !WaitNamedPipeA(path.c_str(), 2000)) break;
+    }
+    error_msg = "Cannot connect to " + path + " (error " + std::to_string(GetLastError()) + ")";
+    return false;
+}
+
+bool LocalStream::is_open() const {
+    return handle_ != nullptr;
+}
+
+bool LocalStream::peer_trusted() const {
+    ULONG pid = 0;
+    BOOL known = server_side_ ? GetNamedPipeClientProcessId(handle_, &pid) : GetNamedPipeServerProcessId(handle_, &pid);
+    if (!known) return false;
+    HANDLE process = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, pid);
+    if (!process) return false;
+    auto peer = process_user(process);
+    CloseHandle(process);
+    auto self = process_user(GetCurrentProcess());
+    if (peer.empty() || self.empty()) return false;
+
+    PSID peer_sid = reinterpret_cast<const TOKEN_USER*>(peer.data())->User.Sid;
+    PSID self_sid = reinterpret_cast<const TOKEN_USER*>(self.data())->User.Sid;
+    return EqualSid(peer_sid, self_sid) || IsWellKnownSid(peer_sid, WinLocalSystemSid);
+}
+
+void LocalStream::set_timeout(uint32_t timeout_ms) {
+    timeout_ms_ = timeout_ms;
+}
+
+bool LocalStream::transfer(bool write, void* data, uint32_t size, uint32_t& done) {
+    if (!io_event_) {
+        io_event_ = CreateEventA(nullptr, TRUE, FALSE, nullptr);
+        if (!io_event_) return false;
+    }
+    OVERLAPPED ov{};
+    ov.hEvent = io_event_;
+    BOOL started = write ? WriteFile(handle_, data, size, nullptr, &ov) : ReadFile(handle_, data, size, nullptr, &ov);
+    if (!started && GetLastError() != ERROR_IO_PENDING) return false;
+
+    DWORD n = 0;
+    DWORD wait = WaitForSingleObject(io_event_, timeout_ms_ ? timeout_ms_ : INFINITE);
+    if (wait != WAIT_OBJECT_0) {
+        // The buffer and ov must outlive the I/O: cancel it and wait for that
+        CancelIoEx(handle_, &ov);
+        GetOverlappedResult(handle_, &ov, &n, TRUE);
+        timed_out_ = wait == WAIT_TIMEOUT;
+        return false;
+    }
+    if (!GetOverlappedResult(handle_, &ov, &n, FALSE)) return false;
+    done = n;
+    return true;
+}
+
+bool LocalStream::write_all(const void* data, size_t size) {
+    char* p = static_cast<char*>(const_cast<void*>(data));
+    while (size > 0) {
+        uint32_t chunk = static_cast<uint32_t>(size < PipeBufferSize ? size : PipeBufferSize);
+        uint32_t written = 0;
+        if (!transfer(true, p, chunk, written) || written == 0) return false;
+        p += written;
+        size -= written;
+    }
+    return true;
+}
+
+bool LocalStream::read_exact(void* data, size_t size) {
+    char* p = static_cast<char*>(data);
+    while (size > 0) {
+        uint32_t chunk = static_cast<uint32_t>(size < PipeBufferSize ? size : PipeBufferSize);
+        uint32_t got = 0;
+        if (!transfer(false, p, chunk, got) || got == 0) return false;
+        p += got;
+        size -= got;
+    }
+    return true;
+}
+
+void LocalStream::close() {
+    if (!handle_) return;
+    if (server_side_ && !timed_out_) {
+        // Let the client read everything before the instance goes away: it
+        // hangs up once it has the last frame. FlushFileBuffers would wait
+        // forever for a client that stopped reading; this waits a bounded time.
+        if (!timeout_ms_) timeout_ms_ = LingerTimeoutMs;
+        ULONGLONG deadline = GetTickCount64() + timeout_ms_;
+        char discard[256];
+        uint32_t got = 0;
+        while (GetTickCount64() < deadline && transfer(false, discard, sizeof(discard), got) && got > 0) {}
+    }
+    if (server_side_) DisconnectNamedPipe(handle_);
+    CloseHandle(handle_);
+    if (io_event_) CloseHandle(io_event_);
+    handle_ = nullptr;
+    io_event_ = nullptr;
+    server_side_ = false;
+    timed_out_ = false;
+}
+
+LocalListener::~LocalListener() {
+    close();
+}
+
+bool LocalListener::listen(const std::string& path, std::string& error_msg) {
+    close();
+    HANDLE h = create_pipe_instance(path, true);
+    if (h == INVALID_HANDLE_VALUE) {
+        DWORD err = GetLastError();
+        error_msg = err == ERROR_ACCESS_DENIED
+            ? "Another server is already listening on " + path
+            : "Cannot create pipe " + path + " (error " + std::to_string(err) + ")";
+        return false;
+    }
+    path_ = path;
+    pending_ = h;
+    return true;
+}
+
+bool LocalListener::accept(LocalStream& client) {
+    if (!pending_) {
+        HANDLE h = create_pipe_instance(path_, false);
+        if (h == INVALID_HANDLE_VALUE) return false;
+        pending_ = h;
+    }
+    if (!connect_event_) {
+        connect_event_ = CreateEventA(nullptr, TRUE, FALSE, nullptr);
+        if (!connect_event_) return false;
+    }
+    OVERLAPPED ov{};
+    ov.hEvent = connect_event_;
+    bool connected = ConnectNamedPipe(pending_, &ov) != 0;
+    if (!connected) {
+        DWORD err = GetLastError();
+        DWORD ignored = 0;
+        connected = err == ERROR_PIPE_CONNECTED ||
+            (err == ERROR_IO_PENDING && GetOverlappedResult(pending_, &ov, &ignored, TRUE));
+    }
+    if (!connected) {
+        CloseHandle(pending_);
+        pending_ = nullptr;
+        return false;
+    }
+    client.close();
+    client.handle_ = pending_;
+    client.server_side_ = true;
+    pending_ = nullptr;
+    return true;
+}
+
+void LocalListener::close() {
+    if (pending_) CloseHandle(pending_);
+    if (connect_event_) CloseHandle(connect_event_);
+    pending_ = nullptr;
+    connect_event_ = nullptr;
+    path_.clear();
+}
+
+std::string default_socket_path() {
+    return "\\\\.\\pipe\\lsofwin";
+}
+
+#else
+
+namespace {
+
+bool make_address(const std::string& path, sockaddr_un& addr, std::string& error_msg) {
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(addr.sun_path)) {
+        error_msg = "Invalid socket path: " + path;
+        return false;
+    }
+    std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+    return true;
+}
+
+// Zero clears the timeout
+void apply_timeout(int fd, uint32_t timeout_ms) {
+    timeval tv{};
+    tv.tv_sec = static_cast<time_t>(timeout_ms / 1000);
+    tv.tv_usec = static_cast<suseconds_t>(timeout_ms % 1000) * 1000;
+    ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    ::setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+}
+
+} // anonymous namespace
+
+LocalStream::~LocalStream() {
+    close();
+}
+
+bool LocalStream::connect(const std::string& path, std::string& error_msg) {
+    close();
+    sockaddr_un addr;
+    if (!make_address(path, addr, error_msg)) return false;
+    int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0 || ::connect(fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) != 0) {
+        error_msg = "Cannot connect to " + path + ": " + std::strerror(errno);
+        if (fd >= 0) ::close(fd);
+        return false;
+    }
+    fd_ = fd;
+    if (timeout_ms_) apply_timeout(fd_, timeout_ms_);
+    return true;
+}
+
+bool LocalStream::is_open() const {
+    return fd_ >= 0;
+}
+
+bool LocalStream::peer_trusted() const {
+    // Credentials the peer had when it called connect() or listen()
+    uid_t uid;
+#ifdef SO_PEERCRED
+    ucred cred{};
+    socklen_t size = sizeof(cred);
+    if (::getsockopt(fd_, SOL_SOCKET, SO_PEERCRED, &cred, &size) != 0) return false;
+    uid = cred.uid;
+#else
+    gid_t gid;
+    if (::getpeereid(fd_, &uid, &gid) != 0) return false;
+#endif
+    return uid == ::getuid() || uid == 0;
+}
+
+void LocalStream::set_timeout(uint32_t timeout_ms) {
+    timeout_ms_ = timeout_ms;
+    if (fd_ >= 0) apply_timeout(fd_, timeout_ms_);
+}
+
+bool LocalStream::write_all(const void* data, size_t size) {
+    const char* p = static_cast<const char*>(data);
+    while (size > 0) {
+        ssize_t n = ::send(fd_, p, size, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) timed_out_ = true;
+        if (n <= 0) return false;
+        p += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+bool LocalStream::read_exact(void* data, size_t size) {
+    char* p = static_cast<char*>(data);
+    while (size > 0) {
+        ssize_t n = ::recv(fd_, p, size, 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) timed_out_ = true;
+        if (n <= 0) return false;
+        p += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+void LocalStream::close() {
+    if (fd_ >= 0) ::close(fd_);
+    fd_ = -1;
+    timed_out_ = false;
+}
+
+LocalListener::~LocalListener() {
+    close();
+}
+
+bool LocalListener::listen(const std::string& path, std::string& error_msg) {
+    close();
+    sockaddr_un addr;
+    if (!make_address(path, addr, error_msg)) return false;
+
+    int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        error_msg = std::string("Cannot create socket: ") + std::strerror(errno);
+        return false;
+    }
+    auto bind_path = [&] { return ::bind(fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) == 0; };
+    bool bound = bind_path();
+    if (!bound && errno == EADDRINUSE) {
+        // Replace a socket file left behind by a server that is gone
+        LocalStream probe;
+        std::string ignored;
+        if (probe.connect(path, ignored)) {
+            ::close(fd);
+            error_msg = probe.peer_trusted()
+                ? "Another server is already listening on " + path
+                : "A process of another user is listening on " + path;
+            return false;
+        }
+        ::unlink(path.c_str());
+        bound = bind_path();
+    }
+    if (!bound || ::chmod(path.c_str(), S_IRUSR | S_IWUSR) != 0 || ::listen(fd, 64) != 0) {
+        error_msg = "Cannot listen on " + path + ": " + std::strerror(errno);
+        if (bound) ::unlink(path.c_str());
+        ::close(fd);
+        return false;
+    }
+    fd_ = fd;
+    path_ = path;
+    return true;
+}
+
+bool LocalListener::accept(LocalStream& client) {
+    int fd;
+    do {
+        fd = ::accept4(fd_, nullptr, nullptr, SOCK_CLOEXEC);
+    } while (fd < 0 && errno == EINTR);
+    if (fd < 0) return false;
+
+    client.close();
+    client.fd_ = fd;
+    if (client.timeout_ms_) apply_timeout(fd, client.timeout_ms_);
+    return true;
+}
+
+void LocalListener::close() {
+    if (fd_ >= 0) {
+        ::close(fd_);
+        ::unlink(path_.c_str());
+    }
+    fd_ = -1;
+    path_.clear();
+}
+
+std::string default_socket_path() {
+    const char* runtime_dir = std::getenv("XDG_RUNTIME_DIR");
+    if (runtime_dir && *runtime_dir) return std::string(runtime_dir) + "/lsofwin.sock";
+    return "/tmp/lsofwin-" + std::to_string(::getuid()) + ".sock";
+}
+
+#endif
+
+} // namespace lsofwin
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace lsofwin {
+
+// Byte stream to a local endpoint: a named pipe on Windows, a Unix domain
+// socket elsewhere. Used by --serve and --client.
+class LocalStream {
+public:
+    LocalStream() = default;
+    ~LocalStream();
+
+    LocalStream(const LocalStream&) = delete;
+    LocalStream& operator=(const LocalStream&) = delete;
+
+    // Connect to a listening endpoint. Fails at once if nothing is listening.
+    bool connect(const std::string& path, std::string& error_msg);
+
+    bool is_open() const;
+
+    // Whether the process at the other end runs as the current user or as
+    // root / LocalSystem. Any user can listen on a predictable path first,
+    // so a client checks this before trusting what it is told.
+    bool peer_trusted() const;
+
+    // Fail any single read or write that makes no progress for timeout_ms
+    // (0, the default, waits forever). The stream is unusable afterwards.
+    void set_timeout(uint32_t timeout_ms);
+
+    bool write_all(const void* data, size_t size);
+
+    // Read exactly size bytes; false at end of stream, on error or timeout.
+    bool read_exact(void* data, size_t size);
+
+    // Whether the last failed read or write gave up because of the timeout.
+    bool timed_out() const { return timed_out_; }
+
+    void close();
+
+private:
+    friend class LocalListener;
+
+    uint32_t timeout_ms_ = 0;
+    bool timed_out_ = false;
+#ifdef _WIN32
+    // Overlapped I/O, so that a stalled peer cannot block a call forever
+    bool transfer(bool write, void* data, uint32_t size, uint32_t& done);
+
+    void* handle_ = nullptr;
+    void* io_event_ = nullptr;
+    bool server_side_ = false;
+#else
+    int fd_ = -1;
+#endif
+};
+
+// Listening endpoint. On Linux the socket file is created owner-only (0600)
+// and removed again by close(); a stale file left by a server that died is
+// replaced, but a live server on the same path is an error. On Windows the
+// pipe rejects remote clients and keeps the default pipe security.
+class LocalListener {
+public:
+    LocalListener() = default;
+    ~LocalListener();
+
+    LocalListener(const LocalListener&) = delete;
+    LocalListener& operator=(const LocalListener&) = delete;
+
+    bool listen(const std::string& path, std::string& error_msg);
+
+    // Block until a client connects. The stream keeps any timeout already
+    // set on it.
+    bool accept(LocalStream& client);
+
+    const std::string& path() const { return path_; }
+
+    void close();
+
+private:
+    std::string path_;
+#ifdef _WIN32
+    void* pending_ = nullptr;   // Pipe instance waiting for the next client
+    void* connect_event_ = nullptr;
+#else
+    int fd_ = -1;
+#endif
+};
+
+// \\.\pipe\lsofwin on Windows; $XDG_RUNTIME_DIR/lsofwin.sock, or
+// /tmp/lsofwin-<uid>.sock without it, elsewhere.
+std::string default_socket_path();
+
+} // namespace lsofwin
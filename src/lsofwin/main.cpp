@@ -1,12 +1,74 @@
+#include "binary_output.h"
 #include "cli_parser.h"
 #include "handle_enumerator.h"
-#include "output_formatter.h"
+#include "handle_recording.h"
+#include "handle_summary.h"
+#include "handle_watcher.h"
+#include "index_server.h"
+#include "metrics_exporter.h"
+#include "output_sink.h"
 #include "process_utils.h"
+#include "scan_stats.h"
 #include "console_color.h"
 #include "version.h"
 
+#include <chrono>
+#include <cstdio>
 #include <iostream>
+#include <memory>
 #include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#endif
+
+namespace {
+
+// With --stats / --stats-json, report on stderr once the output is written.
+void report_stats(const lsofwin::OutputBuffer& out, const lsofwin::FilterOptions& opts,
+    lsofwin::ScanStats* stats) {
+    if (!stats) return;
+    stats->add(lsofwin::ScanCounter::BytesWritten, out.bytes_flushed());
+    std::cerr << (opts.stats_json ? stats->to_json() + "\n" : stats->to_text());
+}
+
+// --deadline: say on stderr when the result is partial.
+void report_deadline(const lsofwin::EnumerationStats& scan) {
+    if (scan.handles_past_deadline == 0) return;
+    std::cerr << lsofwin::color::c(lsofwin::color::YELLOW)
+              << "WARNING: Deadline reached; " << scan.handles_past_deadline
+              << " handles were not resolved (partial results)"
+              << lsofwin::color::c(lsofwin::color::RESET) << "\n";
+}
+
+// Finish the output and report.
+void finish_scan(lsofwin::OutputSink& sink, const lsofwin::OutputBuffer& out,
+    const lsofwin::FilterOptions& opts, const lsofwin::EnumerationStats& scan, lsofwin::ScanStats* stats) {
+    {
+        lsofwin::PhaseTimer timer(stats, lsofwin::ScanPhase::Output);
+        sink.finish();
+    }
+    report_deadline(scan);
+    report_stats(out, opts, stats);
+}
+
+// --summary / --group-by: count instead of listing, then print the groups.
+void print_summary(lsofwin::HandleSource& source, lsofwin::OutputBuffer& out,
+    const lsofwin::FilterOptions& opts, lsofwin::ScanStats* stats) {
+    lsofwin::EnumerationStats scan;
+    auto summary = lsofwin::summarize_handles(source, opts, &scan, stats);
+    {
+        lsofwin::PhaseTimer timer(stats, lsofwin::ScanPhase::Output);
+        lsofwin::write_summary(out, summary, opts);
+    }
+    report_deadline(scan);
+    report_stats(out, opts, stats);
+}
+
+} // anonymous namespace
 
 int main(int argc, char* argv[]) {
     lsofwin::color::init();
@@ -32,17 +94,184 @@ int main(int argc, char* argv[]) {
         return 0;
     }
 
+    // Keep the CRT from translating '\n' in binary output
+#ifdef _WIN32
+    if (opts.output_binary) _setmode(_fileno(stdout), _O_BINARY);
+#endif
+
+    std::string socket_path = opts.socket_path.empty() ? lsofwin::default_socket_path() : opts.socket_path;
+
+    // --client: answer from a running --serve instance when there is one
+    if (opts.use_server) {
+        auto result = lsofwin::query_server(socket_path, lsofwin::server_query_args(argc, argv),
+            lsofwin::file_writer(stdout), error_msg);
+        if (result == lsofwin::ClientResult::Answered) return 0;
+        if (result == lsofwin::ClientResult::Failed) {
+            std::cerr << lsofwin::color::c(lsofwin::color::BOLD_RED)
+                      << "Error: " << error_msg
+                      << lsofwin::color::c(lsofwin::color::RESET) << "\n";
+            return 1;
+        }
+    }
+
+    // --decode prints a saved binary result instead of scanning
+    lsofwin::MappedFile file;
+    lsofwin::BinaryResultReader reader;
+    if (!opts.decode_file.empty() &&
+        (!file.open(opts.decode_file, error_msg) || !reader.open(file.data(), file.size(), error_msg))) {
+        std::cerr << lsofwin::color::c(lsofwin::color::BOLD_RED)
+                  << "Error: " << error_msg
+                  << lsofwin::color::c(lsofwin::color::RESET) << "\n";
+        return 1;
+    }
+
+    lsofwin::OutputBuffer out(lsofwin::file_writer(stdout),
+        lsofwin::OutputBuffer::DefaultCapacity, std::chrono::milliseconds(100));
+
+    if (!opts.decode_file.empty()) {
+        auto sink = lsofwin::make_output_sink(out, opts);
+        lsofwin::HandleInfo h;
+        for (size_t i = 0; i < reader.row_count(); ++i) {
+            reader.row(i, h);
+            sink->write(h);
+        }
+        sink->finish();
+        return 0;
+    }
+
+    // --stats: nothing is timed or counted unless asked for
+    std::unique_ptr<lsofwin::ScanStats> stats;
+    if (opts.show_stats || opts.stats_json) stats = std::make_unique<lsofwin::ScanStats>();
+
+    // --replay scans a recording instead of the system
+    lsofwin::ReplayHandleSource replay;
+    if (!opts.replay_file.empty()) {
+        if (!file.open(opts.replay_file, error_msg) || !replay.open(file.data(), file.size(), error_msg)) {
+            std::cerr << lsofwin::color::c(lsofwin::color::BOLD_RED)
+                      << "Error: " << error_msg
+                      << lsofwin::color::c(lsofwin::color::RESET) << "\n";
+            return 1;
+        }
+        if (!opts.group_by.empty()) {
+            print_summary(replay, out, opts, stats.get());
+            return 0;
+        }
+        auto sink = lsofwin::make_output_sink(out, opts);
+        lsofwin::EnumerationStats scan;
+        lsofwin::stream_handles(replay, opts, [&](const lsofwin::HandleInfo& h) { sink->write(h); },
+            &scan, stats.get());
+        finish_scan(*sink, out, opts, scan, stats.get());
+        return 0;
+    }
+
     // Privilege warning
     std::string warning = lsofwin::get_privilege_warning();
-    if (!warning.empty() && !opts.output_json) {
+    if (!warning.empty() && !opts.output_json && !opts.output_binary) {
         std::cerr << warning << "\n";
     }
 
-    // Enumerate handles
-    lsofwin::HandleList handles = lsofwin::enumerate_handles(opts);
+    // --serve: claim the socket, build the index, then keep it current and
+    // answer queries. Clients that connect during the first scan wait for it.
+    if (opts.serve) {
+        auto source = lsofwin::make_system_handle_source(opts.raw_account_ids);
+        lsofwin::IndexServer server(*source, opts);
+        lsofwin::LocalListener listener;
+        if (listener.listen(socket_path, error_msg) && !server.refresh()) {
+            error_msg = "Failed to snapshot the system handle table";
+        }
+        if (!error_msg.empty()) {
+            std::cerr << lsofwin::color::c(lsofwin::color::BOLD_RED)
+                      << "Error: " << error_msg
+                      << lsofwin::color::c(lsofwin::color::RESET) << "\n";
+            return 1;
+        }
+        std::cerr << "Serving " << server.indexed_handles() << " handles on " << socket_path << "\n";
+        server.run(listener);
+        return 0;
+    }
 
-    // Output results
-    std::cout << lsofwin::format_output(handles, opts);
+    // --metrics: rewrite the textfile every -r seconds until interrupted
+    if (!opts.metrics_file.empty()) {
+        auto source = lsofwin::make_system_handle_source(opts.raw_account_ids);
+        lsofwin::MetricsExporter exporter(*source, opts);
+        int interval = opts.repeat_seconds > 0 ? opts.repeat_seconds : lsofwin::DefaultMetricsIntervalSeconds;
+        for (;;) {
+            auto started = std::chrono::steady_clock::now();
+            if (!exporter.sample(std::chrono::system_clock::now())) {
+                // The file keeps the last good sample; its timestamp gauge shows how old it is
+                std::cerr << lsofwin::color::c(lsofwin::color::BOLD_YELLOW) << "WARNING:"
+                          << lsofwin::color::c(lsofwin::color::RESET)
+                          << lsofwin::color::c(lsofwin::color::YELLOW)
+                          << " Handle snapshot failed; " << opts.metrics_file << " was not updated"
+                          << lsofwin::color::c(lsofwin::color::RESET) << "\n";
+            }
+            else if (!exporter.write_file(opts.metrics_file, error_msg)) {
+                std::cerr << lsofwin::color::c(lsofwin::color::BOLD_RED)
+                          << "Error: " << error_msg
+                          << lsofwin::color::c(lsofwin::color::RESET) << "\n";
+                return 1;
+            }
+            std::this_thread::sleep_until(started + std::chrono::seconds(interval));
+        }
+    }
+
+    // -r: rescan until interrupted, printing only what changed
+    if (opts.repeat_seconds > 0) {
+        auto source = lsofwin::make_system_handle_source(opts.raw_account_ids);
+        lsofwin::HandleWatcher watcher(*source, opts);
+        auto deltas = lsofwin::make_delta_sink(out, opts);
+        std::vector<lsofwin::HandleEvent> events;
+        for (;;) {
+            auto started = std::chrono::steady_clock::now();
+            events.clear();
+            if (watcher.poll(events)) {
+                for (const auto& e : events) deltas->write(e);
+            }
+            deltas->end_pass();
+            std::this_thread::sleep_until(started + std::chrono::seconds(opts.repeat_seconds));
+        }
+    }
+
+    if (!opts.group_by.empty()) {
+        auto source = lsofwin::make_system_handle_source(opts.raw_account_ids);
+        print_summary(*source, out, opts, stats.get());
+        return 0;
+    }
+
+    // --record: open the file first so a bad path fails before the scan
+    std::FILE* record = nullptr;
+    if (!opts.record_file.empty()) {
+        record = std::fopen(opts.record_file.c_str(), "wb");
+        if (!record) {
+            std::cerr << lsofwin::color::c(lsofwin::color::BOLD_RED)
+                      << "Error: Cannot create " << opts.record_file
+                      << lsofwin::color::c(lsofwin::color::RESET) << "\n";
+            return 1;
+        }
+    }
+
+    // Enumerate handles, writing each row out as soon as it is resolved
+    auto source = lsofwin::make_system_handle_source(opts.raw_account_ids);
+    lsofwin::RecordingHandleSource recorder(*source);
+    auto sink = lsofwin::make_output_sink(out, opts);
+    lsofwin::EnumerationStats scan;
+    lsofwin::stream_handles(record ? static_cast<lsofwin::HandleSource&>(recorder) : *source, opts,
+        [&](const lsofwin::HandleInfo& h) { sink->write(h); }, &scan, stats.get());
+    finish_scan(*sink, out, opts, scan, stats.get());
+
+    if (record) {
+        {
+            lsofwin::OutputBuffer record_out(lsofwin::file_writer(record));
+            recorder.write(record_out);
+        }
+        bool failed = std::ferror(record) != 0;
+        if (std::fclose(record) != 0 || failed) {
+            std::cerr << lsofwin::color::c(lsofwin::color::BOLD_RED)
+                      << "Error: Failed to write " << opts.record_file
+                      << lsofwin::color::c(lsofwin::color::RESET) << "\n";
+            return 1;
+        }
+    }
 
     return 0;
 }
@@ -0,0 +1,272 @@
+#include "metrics_exporter.h"
+#include "handle_enumerator.h"
+#include "handle_summary.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <map>
+
+#ifdef _WIN32
+#include <Windows.h>
+#endif
+
+namespace lsofwin {
+
+namespace {
+
+double seconds_since_epoch(std::chrono::system_clock::time_point t) {
+    return std::chrono::duration<double>(t.time_since_epoch()).count();
+}
+
+// A label value with \, " and newlines escaped, as OpenMetrics requires.
+void append_label_value(OutputBuffer& out, const std::string& value) {
+    out.append('"');
+    for (char c : value) {
+        if (c == '\\') out.append("\\\\");
+        else if (c == '"') out.append("\\\"");
+        else if (c == '\n') out.append("\\n");
+        else out.append(c);
+    }
+    out.append('"');
+}
+
+void append_double(OutputBuffer& out, const char* format, double v) {
+    char text[64];
+    int n = std::snprintf(text, sizeof(text), format, v);
+    if (n > 0) out.append(std::string_view(text, static_cast<size_t>(n)));
+}
+
+void append_family(OutputBuffer& out, const char* name, const char* help, const char* unit = nullptr) {
+    out.append("# TYPE ");
+    out.append(name);
+    out.append(" gauge\n");
+    if (unit) {
+        out.append("# UNIT ");
+        out.append(name);
+        out.append(' ');
+        out.append(unit);
+        out.append('\n');
+    }
+    out.append("# HELP ");
+    out.append(name);
+    out.append(' ');
+    out.append(help);
+    out.append('\n');
+}
+
+// {pid="..",command=".." plus a trailing comma when more labels follow.
+void append_process_labels(OutputBuffer& out, uint32_t pid, const std::string& name, bool more) {
+    out.append("{pid=\"");
+    out.append_uint(pid);
+    out.append("\",command=");
+    append_label_value(out, name);
+    out.append(more ? "," : "}");
+}
+
+// Rename from to to, replacing it in one step.
+bool replace_file(const std::string& from, const std::string& to) {
+#ifdef _WIN32
+    return MoveFileExA(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+    return std::rename(from.c_str(), to.c_str()) == 0;
+#endif
+}
+
+} // anonymous namespace
+
+MetricsExporter::MetricsExporter(HandleSource& source, const FilterOptions& opts, size_t history)
+    : source_(source), opts_(opts), history_size_((std::max)(history, static_cast<size_t>(2))) {
+}
+
+bool MetricsExporter::sample(std::chrono::system_clock::time_point now) {
+    auto started = std::chrono::steady_clock::now();
+    HandleCounter counter;
+    std::vector<std::string> type_names;
+    if (!count_handles(source_, opts_, counter, type_names)) return false;
+    ++samples_;
+
+    static const std::string unnamed;
+    std::map<uint32_t, std::map<std::string, uint64_t>> by_process;
+    std::map<std::string, uint64_t> by_type;
+    total_ = 0;
+    counter.for_each([&](uint32_t pid, uint16_t type_index, const std::string* type_name, uint64_t n) {
+        const std::string& type = type_name ? *type_name :
+            type_index < type_names.size() ? type_names[type_index] : unnamed;
+        by_process[pid][type] += n;
+        by_type[type] += n;
+        total_ += n;
+    });
+
+    // Names are looked up once per (pid, start time) across samples
+    processes_.clear();
+    processes_.reserve(by_process.size());
+    History h;
+    h.time = seconds_since_epoch(now);
+    h.total = total_;
+    for (auto& entry : by_process) {
+        ProcessCount p;
+        p.pid = entry.first;
+        p.start_time = source_.process_start_time(p.pid);
+        auto& cached = names_[p.pid];
+        if (cached.seen == 0 || cached.start_time != p.start_time) {
+            cached.start_time = p.start_time;
+            cached.name = source_.process_name(p.pid);
+        }
+        cached.seen = samples_;
+        p.name = cached.name;
+        for (auto& type : entry.second) {
+            p.total += type.second;
+            p.by_type.emplace_back(type.first, type.second);
+        }
+        h.totals.emplace(p.pid, std::make_pair(p.start_time, p.total));
+        processes_.push_back(std::move(p));
+    }
+    for (auto it = names_.begin(); it != names_.end();) {
+        it = it->second.seen == samples_ ? std::next(it) : names_.erase(it);
+    }
+    types_.assign(by_type.begin(), by_type.end());
+
+    if (history_.size() < history_size_) history_.push_back(std::move(h));
+    else history_[history_next_] = std::move(h);
+    history_next_ = (history_next_ + 1) % history_size_;
+
+    time_ = seconds_since_epoch(now);
+    duration_ = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    return true;
+}
+
+bool MetricsExporter::oldest_sample(const ProcessCount* p, double& time, uint64_t& total) const {
+    bool found = false;
+    for (const auto& h : history_) {
+        if (h.time >= time_ || (found && h.time >= time)) continue;
+        if (!p) {
+            time = h.time;
+            total = h.total;
+            found = true;
+            continue;
+        }
+        // A restarted pid starts a new series
+        auto it = h.totals.find(p->pid);
+        if (it == h.totals.end() || it->second.first != p->start_time) continue;
+        time = h.time;
+        total = it->second.second;
+        found = true;
+    }
+    return found;
+}
+
+void MetricsExporter::write(OutputBuffer& out) const {
+    // --top: per-process series for the processes holding the most handles
+    std::vector<const ProcessCount*> shown;
+    shown.reserve(processes_.size());
+    for (const auto& p : processes_) shown.push_back(&p);
+    if (opts_.summary_top > 0 && shown.size() > opts_.summary_top) {
+        std::stable_sort(shown.begin(), shown.end(),
+            [](const ProcessCount* a, const ProcessCount* b) { return a->total > b->total; });
+        shown.resize(opts_.summary_top);
+        std::sort(shown.begin(), shown.end(),
+            [](const ProcessCount* a, const ProcessCount* b) { return a->pid < b->pid; });
+    }
+
+    append_family(out, "lsofwin_handles", "Open handles by process and object type.");
+    for (const auto* p : shown) {
+        for (const auto& type : p->by_type) {
+            out.append("lsofwin_handles");
+            append_process_labels(out, p->pid, p->name, true);
+            out.append("type=");
+            append_label_value(out, type.first);
+            out.append("} ");
+            out.append_uint(type.second);
+            out.append('\n');
+        }
+    }
+
+    append_family(out, "lsofwin_process_handles", "Open handles by process.");
+    for (const auto* p : shown) {
+        out.append("lsofwin_process_handles");
+        append_process_labels(out, p->pid, p->name, false);
+        out.append(' ');
+        out.append_uint(p->total);
+        out.append('\n');
+    }
+
+    append_family(out, "lsofwin_process_handle_growth",
+        "Change in a process's open handles per second over the sampled window.");
+    for (const auto* p : shown) {
+        double old_time = 0;
+        uint64_t old_total = 0;
+        if (!oldest_sample(p, old_time, old_total)) continue;
+        out.append("lsofwin_process_handle_growth");
+        append_process_labels(out, p->pid, p->name, false);
+        out.append(' ');
+        append_double(out, "%.4f", (static_cast<double>(p->total) - static_cast<double>(old_total)) /
+            (time_ - old_time));
+        out.append('\n');
+    }
+
+    append_family(out, "lsofwin_type_handles", "Open handles by object type, over all processes.");
+    for (const auto& type : types_) {
+        out.append("lsofwin_type_handles{type=");
+        append_label_value(out, type.first);
+        out.append("} ");
+        out.append_uint(type.second);
+        out.append('\n');
+    }
+
+    append_family(out, "lsofwin_system_handles", "Open handles over all processes.");
+    out.append("lsofwin_system_handles ");
+    out.append_uint(total_);
+    out.append('\n');
+
+    double old_time = 0;
+    uint64_t old_total = 0;
+    append_family(out, "lsofwin_system_handle_growth",
+        "Change in open handles over all processes per second over the sampled window.");
+    if (oldest_sample(nullptr, old_time, old_total)) {
+        out.append("lsofwin_system_handle_growth ");
+        append_double(out, "%.4f", (static_cast<double>(total_) - static_cast<double>(old_total)) /
+            (time_ - old_time));
+        out.append('\n');
+    }
+
+    append_family(out, "lsofwin_sample_duration_seconds", "Time taken by the last sample.", "seconds");
+    out.append("lsofwin_sample_duration_seconds ");
+    append_double(out, "%.6f", duration_);
+    out.append('\n');
+
+    append_family(out, "lsofwin_sample_timestamp_seconds", "When the last sample was taken, as Unix time.",
+        "seconds");
+    out.append("lsofwin_sample_timestamp_seconds ");
+    append_double(out, "%.3f", time_);
+    out.append('\n');
+
+    out.append("# EOF\n");
+    out.flush();
+}
+
+bool MetricsExporter::write_file(const std::string& path, std::string& error_msg) const {
+    std::string temp = path + ".tmp";
+    std::FILE* file = std::fopen(temp.c_str(), "wb");
+    if (!file) {
+        error_msg = "Cannot create " + temp;
+        return false;
+    }
+    {
+        OutputBuffer out(file_writer(file));
+        write(out);
+    }
+    bool failed = std::ferror(file) != 0;
+    if (std::fclose(file) != 0 || failed) {
+        std::remove(temp.c_str());
+        error_msg = "Failed to write " + temp;
+        return false;
+    }
+    if (!replace_file(temp, path)) {
+        std::remove(temp.c_str());
+        error_msg = "Cannot replace " + path;
+        return false;
+    }
+    return true;
+}
+
+} // namespace lsofwin
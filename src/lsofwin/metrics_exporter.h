@@ -0,0 +1,96 @@
+#pragma once
+
+#include "handle_info.h"
+#include "handle_source.h"
+#include "output_sink.h"
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace lsofwin {
+
+// Sample interval when --metrics is given without -r.
+constexpr int DefaultMetricsIntervalSeconds = 60;
+
+// Samples kept for growth rates: with the default interval, a 10 minute window.
+constexpr size_t DefaultMetricsHistory = 10;
+
+// --metrics: handle counts per process and per type, sampled from the raw
+// handle table and written as an OpenMetrics textfile (for node_exporter's
+// or windows_exporter's textfile collector).
+//
+// A sample is one counting scan as --summary does it, so nothing is opened,
+// duplicated or queried: it costs the handle and process snapshots, one pass
+// over the table, and a start-time check per process. Process info is looked
+// up once per (pid, start time) across samples. Memory is the raw table
+// while it is counted plus the last `history` per-process totals, which give
+// each process's growth rate over the window.
+class MetricsExporter {
+public:
+    MetricsExporter(HandleSource& source, const FilterOptions& opts,
+        size_t history = DefaultMetricsHistory);
+
+    MetricsExporter(const MetricsExporter&) = delete;
+    MetricsExporter& operator=(const MetricsExporter&) = delete;
+
+    // Take one sample at `now`. Returns false if the snapshot failed (the
+    // previous sample stays current).
+    bool sample(std::chrono::system_clock::time_point now);
+
+    // The latest sample as OpenMetrics text, ending in "# EOF".
+    void write(OutputBuffer& out) const;
+
+    // Write the latest sample to path through a temporary file in the same
+    // directory and a rename, so a collector never reads a partial file.
+    bool write_file(const std::string& path, std::string& error_msg) const;
+
+    // Samples taken so far.
+    uint64_t samples() const { return samples_; }
+
+private:
+    struct ProcessCount {
+        uint32_t pid = 0;
+        uint64_t start_time = 0;
+        std::string name;
+        uint64_t total = 0;
+        std::vector<std::pair<std::string, uint64_t>> by_type; // Sorted by type
+    };
+
+    // Per-process totals of one sample, for growth rates.
+    struct History {
+        double time = 0;    // Seconds since the epoch
+        uint64_t total = 0;
+        std::unordered_map<uint32_t, std::pair<uint64_t, uint64_t>> totals; // pid -> (start time, total)
+    };
+
+    struct CachedName {
+        uint64_t start_time = 0;
+        std::string name;
+        uint64_t seen = 0;  // Sample that last saw the process
+    };
+
+    // Time and handle total of the oldest earlier sample in the window that
+    // has process p (nullptr: the system total). False if there is none.
+    bool oldest_sample(const ProcessCount* p, double& time, uint64_t& total) const;
+
+    HandleSource& source_;
+    FilterOptions opts_;
+    size_t history_size_;
+
+    // Latest sample
+    double time_ = 0;
+    double duration_ = 0;
+    uint64_t total_ = 0;
+    std::vector<ProcessCount> processes_;                   // Sorted by pid
+    std::vector<std::pair<std::string, uint64_t>> types_;   // Sorted by type
+
+    std::vector<History> history_;      // Ring buffer, history_size_ entries
+    size_t history_next_ = 0;
+    std::unordered_map<uint32_t, CachedName> names_;
+    uint64_t samples_ = 0;
+};
+
+} // namespace lsofwin
@@ -0,0 +1,55 @@
+#include "object_cache.h"
+
+namespace lsofwin {
+
+ObjectCache::Lookup ObjectCache::acquire(uintptr_t object, ResolvedHandle& out) {
+    ++lookups_;
+    auto& shard = shard_for(object);
+    std::unique_lock<std::mutex> lock(shard.mutex);
+
+    for (;;) {
+        auto it = shard.entries.find(object);
+        if (it == shard.entries.end()) {
+            shard.entries.emplace(object, Entry{});
+            return Lookup::Miss;
+        }
+        if (it->second.ready) {
+            out = it->second.value;
+            ++hits_;
+            if (out.timed_out) ++timeout_hits_;
+            return Lookup::Hit;
+        }
+        // Another thread is resolving this object right now
+        shard.ready_cv.wait(lock);
+    }
+}
+
+void ObjectCache::publish(uintptr_t object, const ResolvedHandle& value) {
+    auto& shard = shard_for(object);
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto& entry = shard.entries[object];
+        entry.value = value;
+        entry.ready = true;
+    }
+    shard.ready_cv.notify_all();
+}
+
+void ObjectCache::release(uintptr_t object) {
+    auto& shard = shard_for(object);
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        shard.entries.erase(object);
+    }
+    shard.ready_cv.notify_all();
+}
+
+ObjectCache::Stats ObjectCache::stats() const {
+    Stats s;
+    s.lookups = lookups_.load();
+    s.hits = hits_.load();
+    s.timeout_hits = timeout_hits_.load();
+    return s;
+}
+
+} // namespace lsofwin
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "handle_source.h"
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+
+namespace lsofwin {
+
+// Per-scan cache of resolved type/name keyed by kernel object address, so an
+// object held by many processes (sections, directories, inherited files,
+// pipes) is queried and normalized once. Timeouts are cached like any other
+// outcome: a stuck pipe shared by 40 processes costs one timeout, not 40.
+//
+// Thread-safe. While one thread resolves an object, others asking for the
+// same object wait for its result instead of issuing a duplicate query.
+class ObjectCache {
+public:
+    struct Stats {
+        uint64_t lookups = 0;
+        uint64_t hits = 0;
+        uint64_t timeout_hits = 0;  // Hits that reused a recorded timeout
+
+        double hit_ratio() const {
+            return lookups ? static_cast<double>(hits) / static_cast<double>(lookups) : 0.0;
+        }
+    };
+
+    enum class Lookup {
+        Hit,  // `out` holds the cached result
+        Miss, // Caller now owns the entry and must call publish() or release()
+    };
+
+    Lookup acquire(uintptr_t object, ResolvedHandle& out);
+
+    // Store the result for an object acquired with Miss and wake any waiters.
+    void publish(uintptr_t object, const ResolvedHandle& value);
+
+    // Give up an object acquired with Miss without a result (e.g. the handle
+    // was inaccessible); the next waiter takes over resolving it.
+    void release(uintptr_t object);
+
+    Stats stats() const;
+
+private:
+    struct Entry {
+        bool ready = false;
+        ResolvedHandle value;
+    };
+
+    struct Shard {
+        std::mutex mutex;
+        std::condition_variable ready_cv;
+        std::unordered_map<uintptr_t, Entry> entries;
+    };
+
+    static constexpr size_t ShardCount = 64;
+
+    Shard& shard_for(uintptr_t object) {
+        // Kernel objects are at least 16-byte aligned; mix in the higher bits
+        uintptr_t h = object >> 4;
+        h ^= h >> 17;
+        return shards_[h % ShardCount];
+    }
+
+    std::array<Shard, ShardCount> shards_;
+    std::atomic<uint64_t> lookups_{ 0 };
+    std::atomic<uint64_t> hits_{ 0 };
+    std::atomic<uint64_t> timeout_hits_{ 0 };
+};
+
+} // namespace lsofwin
@@ -5,13 +5,20 @@
 
 namespace lsofwin {
 
+// Whole-list formatting into one string. main() streams rows through an
+// OutputSink instead (output_sink.h); both produce the same bytes.
+
 // Format handles as a human-readable table.
 std::string format_table(const HandleList& handles);
 
 // Format handles as a JSON array.
 std::string format_json(const HandleList& handles);
 
-// Format output based on FilterOptions (delegates to format_table or format_json).
+// Format handles as newline-delimited JSON, one object per line.
+std::string format_ndjson(const HandleList& handles);
+
+// Format output based on FilterOptions (delegates to format_table, format_json
+// or format_ndjson).
 std::string format_output(const HandleList& handles, const FilterOptions& opts);
 
 } // namespace lsofwin
@@ -0,0 +1,400 @@
+#include "output_sink.h"
+#include "binary_output.h"
+#include "console_color.h"
+#include "field_projection.h"
+#include "json_escape.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace lsofwin {
+
+OutputBuffer::OutputBuffer(FlushFn flush, size_t capacity, std::chrono::milliseconds flush_interval)
+    : flush_fn_(std::move(flush)),
+      capacity_((std::max)(capacity, MinCapacity)),
+      flush_interval_(flush_interval),
+      last_flush_(std::chrono::steady_clock::now()),
+      buf_(new char[capacity_]) {
+}
+
+OutputBuffer::~OutputBuffer() {
+    flush();
+}
+
+void OutputBuffer::end_record() {
+    if (flush_interval_.count() <= 0) return;
+    if (!flushed_once_ || std::chrono::steady_clock::now() - last_flush_ >= flush_interval_) {
+        flush();
+    }
+}
+
+void OutputBuffer::flush() {
+    if (used_ > 0) {
+        flush_fn_(buf_.get(), used_);
+        bytes_flushed_ += used_;
+        used_ = 0;
+    }
+    flushed_once_ = true;
+    last_flush_ = std::chrono::steady_clock::now();
+}
+
+void OutputBuffer::write_through(std::string_view s) {
+    flush_fn_(s.data(), s.size());
+    bytes_flushed_ += s.size();
+}
+
+OutputBuffer::FlushFn file_writer(std::FILE* file) {
+    return [file](const char* data, size_t size) {
+        std::fwrite(data, 1, size, file);
+        std::fflush(file);
+    };
+}
+
+OutputBuffer::FlushFn string_writer(std::string& out) {
+    return [&out](const char* data, size_t size) { out.append(data, size); };
+}
+
+namespace {
+
+// Access masks and attributes are shown as 8 hex digits, object addresses
+// as wide as a pointer.
+constexpr size_t MaskHexDigits = 8;
+constexpr size_t ObjectHexDigits = sizeof(uintptr_t) * 2;
+
+// "0x" and v in exactly `digits` lowercase hex digits, formatted into buf.
+std::string_view format_hex(char (&buf)[24], uint64_t v, size_t digits) {
+    char hex[16];
+    auto end = std::to_chars(hex, hex + sizeof(hex), v, 16).ptr;
+    size_t n = static_cast<size_t>(end - hex);
+    size_t pad = digits > n ? digits - n : 0;
+    buf[0] = '0';
+    buf[1] = 'x';
+    std::memset(buf + 2, '0', pad);
+    std::memcpy(buf + 2 + pad, hex, n);
+    return std::string_view(buf, 2 + pad + n);
+}
+
+// The value of one field as JSON: a string, or a number for the PID and the
+// handle value.
+void append_json_value(OutputBuffer& out, const HandleInfo& h, OutputField field) {
+    char buf[24];
+    switch (field) {
+    case OutputField::Pid: out.append_uint(h.pid); return;
+    case OutputField::Fd: out.append_uint(h.handle_value); return;
+    default: break;
+    }
+    out.append('"');
+    switch (field) {
+    case OutputField::Command: append_json_escaped(out, h.process_name); break;
+    case OutputField::User: append_json_escaped(out, h.user); break;
+    case OutputField::Type: append_json_escaped(out, h.handle_type); break;
+    case OutputField::Name: append_json_escaped(out, h.object_name); break;
+    case OutputField::Access: out.append(format_hex(buf, h.granted_access, MaskHexDigits)); break;
+    case OutputField::Attributes: out.append(format_hex(buf, h.attributes, MaskHexDigits)); break;
+    case OutputField::Object: out.append(format_hex(buf, h.object, ObjectHexDigits)); break;
+    default: break;
+    }
+    out.append('"');
+}
+
+// The fields of one compact JSON object, without the braces.
+void append_ndjson_fields(OutputBuffer& out, const HandleInfo& h, const std::vector<OutputField>& fields) {
+    for (size_t i = 0; i < fields.size(); ++i) {
+        out.append(i > 0 ? ",\"" : "\"");
+        out.append(field_name(fields[i]));
+        out.append("\":");
+        append_json_value(out, h, fields[i]);
+    }
+}
+
+class NdjsonSink : public OutputSink {
+public:
+    NdjsonSink(OutputBuffer& out, const std::vector<OutputField>& fields) : out_(out), fields_(fields) {}
+
+    void write(const HandleInfo& h) override {
+        out_.append('{');
+        append_ndjson_fields(out_, h, fields_);
+        out_.append("}\n");
+        out_.end_record();
+    }
+
+    void finish() override { out_.flush(); }
+
+private:
+    OutputBuffer& out_;
+    std::vector<OutputField> fields_;
+};
+
+class JsonArraySink : public OutputSink {
+public:
+    JsonArraySink(OutputBuffer& out, const std::vector<OutputField>& fields) : out_(out), fields_(fields) {
+        out_.append("[\n");
+    }
+
+    void write(const HandleInfo& h) override {
+        if (rows_++ > 0) out_.append(",\n");
+        for (size_t i = 0; i < fields_.size(); ++i) {
+            out_.append(i > 0 ? ",\n    \"" : "  {\n    \"");
+            out_.append(field_name(fields_[i]));
+            out_.append("\": ");
+            append_json_value(out_, h, fields_[i]);
+        }
+        out_.append("\n  }");
+        out_.end_record();
+    }
+
+    void finish() override {
+        if (rows_ > 0) out_.append('\n');
+        out_.append("]\n");
+        out_.flush();
+    }
+
+private:
+    OutputBuffer& out_;
+    std::vector<OutputField> fields_;
+    size_t rows_ = 0;
+};
+
+// Column caps for readability; also the widths of an unsampled table.
+constexpr size_t MaxCommandWidth = 25;
+constexpr size_t MaxUserWidth = 30;
+constexpr size_t MaxTypeWidth = 20;
+constexpr size_t MaxNameWidth = 60;        // When NAME is not the last column
+constexpr size_t FixedPidWidth = 7;
+constexpr size_t FixedFdWidth = 7;
+
+} // anonymous namespace
+
+TableWidths table_widths(const HandleList& handles) {
+    TableWidths w;
+    for (const auto& h : handles) {
+        w.command = (std::max)(w.command, h.process_name.size());
+        w.pid     = (std::max)(w.pid,     decimal_digits(h.pid));
+        w.user    = (std::max)(w.user,    h.user.size());
+        w.type    = (std::max)(w.type,    h.handle_type.size());
+        w.fd      = (std::max)(w.fd,      decimal_digits(h.handle_value));
+        w.name    = (std::max)(w.name,    h.object_name.size());
+    }
+    w.command = (std::min)(w.command, MaxCommandWidth);
+    w.user    = (std::min)(w.user,    MaxUserWidth);
+    w.type    = (std::min)(w.type,    MaxTypeWidth);
+    w.name    = (std::min)(w.name,    MaxNameWidth);
+    return w;
+}
+
+namespace {
+
+class TableSink : public OutputSink {
+public:
+    TableSink(OutputBuffer& out, size_t sample_rows, const std::vector<OutputField>& fields = default_fields())
+        : out_(out), fields_(fields), sample_rows_(sample_rows) {
+        if (sample_rows_ == 0) {
+            w_ = { MaxCommandWidth, FixedPidWidth, MaxUserWidth, MaxTypeWidth, FixedFdWidth, MaxNameWidth };
+            start();
+        }
+    }
+
+    TableSink(OutputBuffer& out, const TableWidths& widths)
+        : out_(out), fields_(default_fields()), sample_rows_(0), preset_(true), w_(widths) {}
+
+    void write(const HandleInfo& h) override {
+        if (!started_) {
+            if (preset_) {
+                start();
+            }
+            else {
+                sample_.push_back(h);
+                if (sample_.size() >= sample_rows_) start();
+                return;
+            }
+        }
+        write_row(h);
+    }
+
+    void finish() override {
+        if (!started_) {
+            if (sample_.empty()) {
+                out_.append(color::c(color::BOLD_YELLOW));
+                out_.append("No open handles found.");
+                out_.append(color::c(color::RESET));
+                out_.append('\n');
+                out_.flush();
+                return;
+            }
+            start();
+        }
+        out_.flush();
+    }
+
+private:
+    // Size the columns from the sample, then write the header and sample rows
+    void start() {
+        if (sample_rows_ > 0) w_ = table_widths(sample_);
+        started_ = true;
+
+        out_.append(color::c(color::BOLD_CYAN));
+        for (size_t i = 0; i < fields_.size(); ++i) {
+            static const char* const headers[] = {
+                "COMMAND", "PID", "USER", "FD", "TYPE", "NAME", "ACCESS", "ATTR", "OBJECT",
+            };
+            const char* header = headers[static_cast<size_t>(fields_[i])];
+            if (i + 1 < fields_.size()) cell(header, width(fields_[i]), false);
+            else out_.append(header);
+        }
+        out_.append(color::c(color::RESET));
+        out_.append('\n');
+
+        for (const auto& h : sample_) write_row(h);
+        std::vector<HandleInfo>().swap(sample_);
+    }
+
+    // Write s left-aligned in a column of width + 2, optionally truncated to
+    // width with a trailing '~'. An over-wide value that is not truncated (a
+    // PID longer than any in the sample) is written in full plus one space.
+    void cell(std::string_view s, size_t width, bool truncate) {
+        size_t n = s.size();
+        if (truncate && n > width) {
+            out_.append(s.substr(0, width - 1));
+            out_.append('~');
+            n = width;
+        }
+        else {
+            out_.append(s);
+        }
+        out_.append_fill(' ', n < width + 2 ? width + 2 - n : 1);
+    }
+
+    // Content width of a column; hex columns have a fixed width.
+    size_t width(OutputField field) const {
+        switch (field) {
+        case OutputField::Command: return w_.command;
+        case OutputField::Pid: return w_.pid;
+        case OutputField::User: return w_.user;
+        case OutputField::Fd: return w_.fd;
+        case OutputField::Type: return w_.type;
+        case OutputField::Name: return w_.name;
+        case OutputField::Object: return 2 + ObjectHexDigits;
+        default: return 2 + MaskHexDigits;
+        }
+    }
+
+    // Text columns other than the last are truncated to their width; the
+    // last column is written in full.
+    void field_cell(const HandleInfo& h, OutputField field, bool last) {
+        const char* color = nullptr;
+        char buf[24];
+        std::string_view s;
+        bool truncate = true;
+        switch (field) {
+        case OutputField::Command: color = color::BOLD_GREEN; s = h.process_name; break;
+        case OutputField::User: color = color::DIM; s = h.user; break;
+        case OutputField::Type: color = color::YELLOW; s = h.handle_type; break;
+        case OutputField::Name: s = h.object_name; break;
+        case OutputField::Pid:
+            s = std::string_view(buf, static_cast<size_t>(std::to_chars(buf, buf + sizeof(buf), h.pid).ptr - buf));
+            truncate = false;
+            break;
+        case OutputField::Fd:
+            s = std::string_view(buf,
+                static_cast<size_t>(std::to_chars(buf, buf + sizeof(buf), h.handle_value).ptr - buf));
+            truncate = false;
+            break;
+        case OutputField::Access: s = format_hex(buf, h.granted_access, MaskHexDigits); break;
+        case OutputField::Attributes: s = format_hex(buf, h.attributes, MaskHexDigits); break;
+        case OutputField::Object: s = format_hex(buf, h.object, ObjectHexDigits); break;
+        default: break;
+        }
+        if (color) out_.append(color::c(color));
+        if (last) out_.append(s);
+        else cell(s, width(field), truncate);
+        if (color) out_.append(color::c(color::RESET));
+    }
+
+    void write_row(const HandleInfo& h) {
+        for (size_t i = 0; i < fields_.size(); ++i) field_cell(h, fields_[i], i + 1 == fields_.size());
+        out_.append('\n');
+        out_.end_record();
+    }
+
+    OutputBuffer& out_;
+    std::vector<OutputField> fields_;
+    size_t sample_rows_;
+    bool preset_ = false;
+    TableWidths w_;
+    bool started_ = false;
+    std::vector<HandleInfo> sample_;
+};
+
+class DeltaTableSink : public DeltaSink {
+public:
+    // The marker column is two characters wide; indent the header to match
+    explicit DeltaTableSink(OutputBuffer& out) : out_(out) {
+        out_.append("  ");
+        table_ = std::make_unique<TableSink>(out, 0);
+    }
+
+    void write(const HandleEvent& e) override {
+        bool opened = e.kind == HandleEvent::Kind::Open;
+        out_.append(color::c(opened ? color::BOLD_GREEN : color::BOLD_RED));
+        out_.append(opened ? '+' : '-');
+        out_.append(color::c(color::RESET));
+        out_.append(' ');
+        table_->write(e.handle);
+    }
+
+    void end_pass() override { out_.flush(); }
+
+private:
+    OutputBuffer& out_;
+    std::unique_ptr<TableSink> table_;
+};
+
+class DeltaJsonSink : public DeltaSink {
+public:
+    explicit DeltaJsonSink(OutputBuffer& out) : out_(out) {}
+
+    void write(const HandleEvent& e) override {
+        out_.append(e.kind == HandleEvent::Kind::Open ? "{\"event\":\"open\"," : "{\"event\":\"close\",");
+        append_ndjson_fields(out_, e.handle, default_fields());
+        out_.append("}\n");
+        out_.end_record();
+    }
+
+    void end_pass() override { out_.flush(); }
+
+private:
+    OutputBuffer& out_;
+};
+
+} // anonymous namespace
+
+std::unique_ptr<OutputSink> make_ndjson_sink(OutputBuffer& out) {
+    return std::make_unique<NdjsonSink>(out, default_fields());
+}
+
+std::unique_ptr<OutputSink> make_json_array_sink(OutputBuffer& out) {
+    return std::make_unique<JsonArraySink>(out, default_fields());
+}
+
+std::unique_ptr<OutputSink> make_table_sink(OutputBuffer& out, size_t sample_rows) {
+    return std::make_unique<TableSink>(out, sample_rows);
+}
+
+std::unique_ptr<OutputSink> make_table_sink(OutputBuffer& out, const TableWidths& widths) {
+    return std::make_unique<TableSink>(out, widths);
+}
+
+std::unique_ptr<OutputSink> make_output_sink(OutputBuffer& out, const FilterOptions& opts) {
+    if (opts.output_binary) return make_binary_sink(out);
+    const auto& fields = opts.fields.empty() ? default_fields() : opts.fields;
+    if (opts.output_ndjson) return std::make_unique<NdjsonSink>(out, fields);
+    if (opts.output_json) return std::make_unique<JsonArraySink>(out, fields);
+    return std::make_unique<TableSink>(out, opts.table_sample_rows, fields);
+}
+
+std::unique_ptr<DeltaSink> make_delta_sink(OutputBuffer& out, const FilterOptions& opts) {
+    if (opts.output_json || opts.output_ndjson) return std::make_unique<DeltaJsonSink>(out);
+    return std::make_unique<DeltaTableSink>(out);
+}
+
+} // namespace lsofwin
@@ -0,0 +1,175 @@
+#pragma once
+
+#include "handle_info.h"
+#include "handle_watcher.h"
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace lsofwin {
+
+// Large reusable output buffer. Formatted bytes are written straight into a
+// fixed block of memory until it is full and are then handed to the flush
+// function in one write, so a million-row scan makes a few hundred writes
+// rather than one per row, and formatting a row never allocates.
+//
+// With a non-zero flush interval, end_record() also flushes the first record
+// immediately and then at least once per interval, so rows show up promptly
+// while the scan is still running.
+class OutputBuffer {
+public:
+    using FlushFn = std::function<void(const char* data, size_t size)>;
+
+    static constexpr size_t DefaultCapacity = 1 << 20;
+    static constexpr size_t MinCapacity = 64; // Room for any single number
+
+    explicit OutputBuffer(FlushFn flush, size_t capacity = DefaultCapacity,
+        std::chrono::milliseconds flush_interval = std::chrono::milliseconds(0));
+    ~OutputBuffer();
+
+    OutputBuffer(const OutputBuffer&) = delete;
+    OutputBuffer& operator=(const OutputBuffer&) = delete;
+
+    void append(std::string_view s) {
+        if (s.size() > capacity_ - used_) {
+            flush();
+            if (s.size() >= capacity_) {
+                write_through(s);
+                return;
+            }
+        }
+        std::memcpy(buf_.get() + used_, s.data(), s.size());
+        used_ += s.size();
+    }
+
+    void append(char c) {
+        if (used_ == capacity_) flush();
+        buf_[used_++] = c;
+    }
+
+    // Append n copies of c (column padding).
+    void append_fill(char c, size_t n) {
+        while (n > 0) {
+            if (used_ == capacity_) flush();
+            size_t chunk = (std::min)(n, capacity_ - used_);
+            std::memset(buf_.get() + used_, c, chunk);
+            used_ += chunk;
+            n -= chunk;
+        }
+    }
+
+    // Append the decimal form of v, formatted in place with std::to_chars.
+    void append_uint(uint64_t v) {
+        if (capacity_ - used_ < 20) flush();
+        char* begin = buf_.get() + used_;
+        used_ += static_cast<size_t>(std::to_chars(begin, begin + 20, v).ptr - begin);
+    }
+
+    // Mark the end of one output record (row); may flush per the policy above.
+    void end_record();
+
+    // Hand everything buffered to the flush function.
+    void flush();
+
+    // Bytes handed to the flush function so far.
+    uint64_t bytes_flushed() const { return bytes_flushed_; }
+
+private:
+    void write_through(std::string_view s);
+
+    FlushFn flush_fn_;
+    size_t capacity_;
+    std::chrono::milliseconds flush_interval_;
+    std::chrono::steady_clock::time_point last_flush_;
+    bool flushed_once_ = false;
+    uint64_t bytes_flushed_ = 0;
+    std::unique_ptr<char[]> buf_;
+    size_t used_ = 0;
+};
+
+// Number of decimal digits in v (column width of a number).
+inline size_t decimal_digits(uint64_t v) {
+    size_t n = 1;
+    while (v >= 10) {
+        v /= 10;
+        ++n;
+    }
+    return n;
+}
+
+// Flush functions for a stdio stream (fwrite + fflush) and for a string.
+OutputBuffer::FlushFn file_writer(std::FILE* file);
+OutputBuffer::FlushFn string_writer(std::string& out);
+
+// Receives result rows one at a time, in output order.
+class OutputSink {
+public:
+    virtual ~OutputSink() = default;
+
+    virtual void write(const HandleInfo& h) = 0;
+
+    // Write whatever the format needs after the last row (closing bracket,
+    // the "no handles" message, a table still being sampled) and flush.
+    virtual void finish() = 0;
+};
+
+// One compact JSON object per line.
+std::unique_ptr<OutputSink> make_ndjson_sink(OutputBuffer& out);
+
+// The -j JSON array, written element by element as rows arrive.
+std::unique_ptr<OutputSink> make_json_array_sink(OutputBuffer& out);
+
+// The aligned table. Column widths come from the first sample_rows rows,
+// which are held back until the sample is complete (or finish() is called);
+// later rows reuse those widths, truncating long names as usual. With
+// sample_rows == 0 the table starts immediately with fixed widths.
+std::unique_ptr<OutputSink> make_table_sink(OutputBuffer& out, size_t sample_rows);
+
+// Content widths of the padded table columns (fd and name are used when -o
+// shows them, and name only when it is not the last column).
+struct TableWidths {
+    size_t command = 7;
+    size_t pid = 3;
+    size_t user = 4;
+    size_t type = 4;
+    size_t fd = 2;
+    size_t name = 4;
+};
+
+// Widths sized from every row, capped as a sampled table caps them.
+TableWidths table_widths(const HandleList& handles);
+
+// The aligned table with widths known up front, so no rows are held back.
+// The header is written with the first row; finish() without any rows
+// prints the "no handles" message, as the sampling sink does.
+std::unique_ptr<OutputSink> make_table_sink(OutputBuffer& out, const TableWidths& widths);
+
+// The sink selected by -j / --ndjson / --binary / --widths, showing the
+// columns -o selected (the factories above show the default columns).
+std::unique_ptr<OutputSink> make_output_sink(OutputBuffer& out, const FilterOptions& opts);
+
+// Receives -r open/close events, one poll at a time.
+class DeltaSink {
+public:
+    virtual ~DeltaSink() = default;
+
+    virtual void write(const HandleEvent& e) = 0;
+
+    // Called after each poll's events; flushes them.
+    virtual void end_pass() = 0;
+};
+
+// -r output. The table form prefixes each fixed-width row with '+' (opened)
+// or '-' (closed); -j and --ndjson write one JSON object per event with an
+// "event": "open" | "close" field ahead of the usual ones.
+std::unique_ptr<DeltaSink> make_delta_sink(OutputBuffer& out, const FilterOptions& opts);
+
+} // namespace lsofwin
@@ -0,0 +1,714 @@
+#include "path_matcher.h"
+#include "string_search.h"
+
+#include <algorithm>
+#include <bitset>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+namespace lsofwin {
+
+namespace {
+
+// Caps that keep a pathological pattern from blowing up the compiled form;
+// past them the pattern simply runs on std::regex.
+constexpr size_t MaxRepeatCount = 1000;
+constexpr size_t MaxNfaStates = 20000;
+constexpr size_t MaxDfaStates = 4096;
+
+// A literal needs at least this many bytes to be worth a prefilter pass.
+constexpr size_t MinPrefilterLength = 2;
+
+using ByteSet = std::bitset<256>;
+
+// Close a set under ASCII case folding, then apply [^...] negation, which is
+// how std::regex::icase treats classes.
+ByteSet fold_set(const ByteSet& raw, bool negated) {
+    ByteSet lower_members;
+    for (size_t c = 0; c < 256; ++c) {
+        if (raw[c]) lower_members.set(ascii_lower(static_cast<unsigned char>(c)));
+    }
+    ByteSet folded;
+    for (size_t c = 0; c < 256; ++c) {
+        if (lower_members[ascii_lower(static_cast<unsigned char>(c))]) folded.set(c);
+    }
+    return negated ? ~folded : folded;
+}
+
+ByteSet single_byte(unsigned char c) {
+    ByteSet s;
+    s.set(c);
+    return s;
+}
+
+ByteSet byte_range(unsigned char lo, unsigned char hi) {
+    ByteSet s;
+    for (size_t c = lo; c <= hi; ++c) s.set(c);
+    return s;
+}
+
+// If a folded set matches exactly one character (ignoring case), return it
+// lowercased.
+bool literal_char(const ByteSet& set, char& out) {
+    size_t count = set.count();
+    if (count == 0 || count > 2) return false;
+    for (size_t c = 0; c < 256; ++c) {
+        if (!set[c]) continue;
+        unsigned char lower = ascii_lower(static_cast<unsigned char>(c));
+        if (set != fold_set(single_byte(lower), false)) return false;
+        out = static_cast<char>(lower);
+        return true;
+    }
+    return false;
+}
+
+struct Node {
+    enum class Kind { Set, Concat, Alt, Repeat };
+
+    Kind kind = Kind::Concat;
+    ByteSet set;                    // Set: folded member bytes
+    std::vector<Node> children;     // Concat/Alt branches; Repeat has one
+    size_t min = 0;                 // Repeat bounds; max == Unbounded for *, +, {n,}
+    size_t max = 0;
+};
+
+constexpr size_t Unbounded = static_cast<size_t>(-1);
+
+Node make_set_node(const ByteSet& folded) {
+    Node n;
+    n.kind = Node::Kind::Set;
+    n.set = folded;
+    return n;
+}
+
+// Recursive-descent parser for the ECMAScript subset the DFA supports. Only
+// ever sees patterns std::regex has already accepted, so it does not need to
+// report syntax errors: anything it does not understand returns false and the
+// pattern falls back to std::regex.
+class PatternParser {
+public:
+    explicit PatternParser(std::string_view pattern) : p_(pattern) {}
+
+    bool parse(Node& out) {
+        return parse_alt(out) && pos_ == p_.size();
+    }
+
+private:
+    char peek() const { return pos_ < p_.size() ? p_[pos_] : '\0'; }
+    bool at_end() const { return pos_ >= p_.size(); }
+
+    bool parse_alt(Node& out) {
+        Node branch;
+        if (!parse_concat(branch)) return false;
+        if (at_end() || peek() != '|') {
+            out = std::move(branch);
+            return true;
+        }
+        out = Node();
+        out.kind = Node::Kind::Alt;
+        out.children.push_back(std::move(branch));
+        while (!at_end() && peek() == '|') {
+            ++pos_;
+            Node next;
+            if (!parse_concat(next)) return false;
+            out.children.push_back(std::move(next));
+        }
+        return true;
+    }
+
+    bool parse_concat(Node& out) {
+        out = Node();
+        out.kind = Node::Kind::Concat;
+        while (!at_end() && peek() != '|' && peek() != ')') {
+            Node item;
+            if (!parse_repeat(item)) return false;
+            // Flatten groups so "(?:ab)c" still reads as the literal "abc"
+            if (item.kind == Node::Kind::Concat) {
+                for (auto& child : item.children) out.children.push_back(std::move(child));
+            }
+            else {
+                out.children.push_back(std::move(item));
+            }
+        }
+        return true;
+    }
+
+    bool parse_repeat(Node& out) {
+        Node atom;
+        if (!parse_atom(atom)) return false;
+
+        while (!at_end()) {
+            size_t min = 0, max = 0;
+            char c = peek();
+            if (c == '*') { min = 0; max = Unbounded; ++pos_; }
+            else if (c == '+') { min = 1; max = Unbounded; ++pos_; }
+            else if (c == '?') { min = 0; max = 1; ++pos_; }
+            else if (c == '{') { if (!parse_braces(min, max)) return false; }
+            else break;
+
+            // Lazy quantifiers change which match is reported, not whether
+            // one exists, so they compile the same way.
+            if (!at_end() && peek() == '?') ++pos_;
+
+            Node rep;
+            rep.kind = Node::Kind::Repeat;
+            rep.min = min;
+            rep.max = max;
+            rep.children.push_back(std::move(atom));
+            atom = std::move(rep);
+        }
+        out = std::move(atom);
+        return true;
+    }
+
+    bool parse_number(size_t& out) {
+        if (at_end() || peek() < '0' || peek() > '9') return false;
+        out = 0;
+        while (!at_end() && peek() >= '0' && peek() <= '9') {
+            out = out * 10 + static_cast<size_t>(peek() - '0');
+            if (out > MaxRepeatCount) return false;
+            ++pos_;
+        }
+        return true;
+    }
+
+    bool parse_braces(size_t& min, size_t& max) {
+        ++pos_; // '{'
+        if (!parse_number(min)) return false;
+        max = min;
+        if (peek() == ',') {
+            ++pos_;
+            if (peek() == '}') max = Unbounded;
+            else if (!parse_number(max) || max < min) return false;
+        }
+        if (peek() != '}') return false;
+        ++pos_;
+        return true;
+    }
+
+    bool parse_atom(Node& out) {
+        if (at_end()) return false;
+        char c = p_[pos_++];
+        switch (c) {
+        case '(': {
+            if (peek() == '?') {
+                // Only non-capturing groups; lookahead needs std::regex
+                if (pos_ + 1 >= p_.size() || p_[pos_ + 1] != ':') return false;
+                pos_ += 2;
+            }
+            if (!parse_alt(out)) return false;
+            if (peek() != ')') return false;
+            ++pos_;
+            return true;
+        }
+        case '[': {
+            ByteSet raw;
+            bool negated = false;
+            if (!parse_class(raw, negated)) return false;
+            out = make_set_node(fold_set(raw, negated));
+            return true;
+        }
+        case '.': {
+            ByteSet any;
+            any.set();
+            any.reset('\n');
+            any.reset('\r');
+            out = make_set_node(any);
+            return true;
+        }
+        case '\\': {
+            ByteSet raw;
+            if (!parse_escape(raw, false)) return false;
+            out = make_set_node(fold_set(raw, false));
+            return true;
+        }
+        case '^': case '$': case ')': case '|': case '*': case '+':
+        case '?': case '{': case '}': case ']':
+            return false;
+        default:
+            out = make_set_node(fold_set(single_byte(static_cast<unsigned char>(c)), false));
+            return true;
+        }
+    }
+
+    bool parse_hex(size_t digits, unsigned& out) {
+        out = 0;
+        for (size_t i = 0; i < digits; ++i) {
+            if (at_end()) return false;
+            char h = p_[pos_++];
+            unsigned v;
+            if (h >= '0' && h <= '9') v = static_cast<unsigned>(h - '0');
+            else if (h >= 'a' && h <= 'f') v = static_cast<unsigned>(h - 'a' + 10);
+            else if (h >= 'A' && h <= 'F') v = static_cast<unsigned>(h - 'A' + 10);
+            else return false;
+            out = out * 16 + v;
+        }
+        return true;
+    }
+
+    bool parse_escape(ByteSet& out, bool in_class) {
+        if (at_end()) return false;
+        char c = p_[pos_++];
+        ByteSet digit = byte_range('0', '9');
+        ByteSet word = byte_range('a', 'z') | byte_range('A', 'Z') | digit | single_byte('_');
+        ByteSet space = single_byte(' ') | byte_range('\t', '\r');
+
+        switch (c) {
+        case 'd': out = digit; return true;
+        case 'D': out = ~digit; return true;
+        case 'w': out = word; return true;
+        case 'W': out = ~word; return true;
+        case 's': out = space; return true;
+        case 'S': out = ~space; return true;
+        case 't': out = single_byte('\t'); return true;
+        case 'n': out = single_byte('\n'); return true;
+        case 'r': out = single_byte('\r'); return true;
+        case 'f': out = single_byte('\f'); return true;
+        case 'v': out = single_byte('\v'); return true;
+        case '0':
+            if (!at_end() && peek() >= '0' && peek() <= '9') return false;
+            out = single_byte('\0');
+            return true;
+        case 'b':
+            // Backspace inside a class, word boundary outside
+            if (!in_class) return false;
+            out = single_byte('\b');
+            return true;
+        case 'x':
+        case 'u': {
+            unsigned value = 0;
+            if (!parse_hex(c == 'x' ? 2 : 4, value) || value > 0x7f) return false;
+            out = single_byte(static_cast<unsigned char>(value));
+            return true;
+        }
+        default:
+            // Backreferences, \B, \c and friends are left to std::regex
+            if ((c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z')) {
+                return false;
+            }
+            out = single_byte(static_cast<unsigned char>(c));
+            return true;
+        }
+    }
+
+    // One class endpoint or escape; `single` is set if it is a single byte.
+    bool parse_class_item(ByteSet& item, int& single) {
+        single = -1;
+        if (at_end()) return false;
+        char c = p_[pos_];
+        if (c == '\\') {
+            ++pos_;
+            if (!parse_escape(item, true)) return false;
+        }
+        else if (c == '[' && pos_ + 1 < p_.size() &&
+            (p_[pos_ + 1] == ':' || p_[pos_ + 1] == '.' || p_[pos_ + 1] == '=')) {
+            return false; // POSIX bracket expressions
+        }
+        else {
+            ++pos_;
+            item = single_byte(static_cast<unsigned char>(c));
+        }
+        if (item.count() == 1) {
+            for (int b = 0; b < 256; ++b) {
+                if (item[static_cast<size_t>(b)]) single = b;
+            }
+        }
+        return true;
+    }
+
+    bool parse_class(ByteSet& out, bool& negated) {
+        negated = false;
+        if (peek() == '^') {
+            negated = true;
+            ++pos_;
+        }
+        if (peek() == ']') return false; // [] and [^] are ECMAScript corner cases
+
+        for (;;) {
+            if (at_end()) return false;
+            if (peek() == ']') {
+                ++pos_;
+                return true;
+            }
+            ByteSet item;
+            int lo = -1;
+            if (!parse_class_item(item, lo)) return false;
+
+            if (lo >= 0 && peek() == '-' && pos_ + 1 < p_.size() && p_[pos_ + 1] != ']') {
+                ++pos_;
+                ByteSet hi_item;
+                int hi = -1;
+                if (!parse_class_item(hi_item, hi) || hi < lo) return false;
+                out |= byte_range(static_cast<unsigned char>(lo), static_cast<unsigned char>(hi));
+                continue;
+            }
+            out |= item;
+        }
+    }
+
+    std::string_view p_;
+    size_t pos_ = 0;
+};
+
+// If the whole pattern is a sequence of single characters, return them.
+bool as_literal(const Node& n, std::string& out) {
+    out.clear();
+    if (n.kind == Node::Kind::Set) {
+        char c;
+        if (!literal_char(n.set, c)) return false;
+        out.push_back(c);
+        return true;
+    }
+    if (n.kind != Node::Kind::Concat) return false;
+    for (const auto& child : n.children) {
+        char c;
+        if (child.kind != Node::Kind::Set || !literal_char(child.set, c)) return false;
+        out.push_back(c);
+    }
+    return true;
+}
+
+void keep_longer(std::string& best, const std::string& candidate) {
+    if (candidate.size() > best.size()) best = candidate;
+}
+
+// Longest literal that every match of `n` must contain (possibly empty).
+std::string required_literal(const Node& n) {
+    switch (n.kind) {
+    case Node::Kind::Set: {
+        char c;
+        return literal_char(n.set, c) ? std::string(1, c) : std::string();
+    }
+    case Node::Kind::Concat: {
+        std::string best, run;
+        for (const auto& child : n.children) {
+            char c;
+            if (child.kind == Node::Kind::Set && literal_char(child.set, c)) {
+                run.push_back(c);
+                continue;
+            }
+            keep_longer(best, run);
+            run.clear();
+            keep_longer(best, required_literal(child));
+        }
+        keep_longer(best, run);
+        return best;
+    }
+    case Node::Kind::Repeat:
+        return n.min >= 1 ? required_literal(n.children[0]) : std::string();
+    case Node::Kind::Alt:
+        break;
+    }
+    return std::string();
+}
+
+// Thompson NFA. States with set >= 0 consume one byte in sets[set] and move to
+// `out`; the rest are epsilon states (out/out2) or the single match state.
+struct NfaState {
+    int set = -1;
+    int out = -1;
+    int out2 = -1;
+    bool match = false;
+};
+
+class NfaBuilder {
+public:
+    struct Frag {
+        int start;
+        int end; // Epsilon state whose `out` is still unpatched
+    };
+
+    std::vector<NfaState> states;
+    std::vector<ByteSet> sets;
+    bool overflow = false;
+
+    int add(const NfaState& s) {
+        if (states.size() >= MaxNfaStates) {
+            overflow = true;
+            return 0;
+        }
+        states.push_back(s);
+        return static_cast<int>(states.size() - 1);
+    }
+
+    int add_epsilon(int out = -1, int out2 = -1) {
+        NfaState s;
+        s.out = out;
+        s.out2 = out2;
+        return add(s);
+    }
+
+    void append(Frag& f, const Frag& next) {
+        if (overflow) return;
+        states[static_cast<size_t>(f.end)].out = next.start;
+        f.end = next.end;
+    }
+
+    Frag compile(const Node& n) {
+        if (overflow) return { 0, 0 };
+
+        switch (n.kind) {
+        case Node::Kind::Set: {
+            int end = add_epsilon();
+            sets.push_back(n.set);
+            NfaState s;
+            s.set = static_cast<int>(sets.size() - 1);
+            s.out = end;
+            return { add(s), end };
+        }
+        case Node::Kind::Concat: {
+            int e = add_epsilon();
+            Frag f{ e, e };
+            for (const auto& child : n.children) append(f, compile(child));
+            return f;
+        }
+        case Node::Kind::Alt: {
+            int end = add_epsilon();
+            int start = -1;
+            for (auto it = n.children.rbegin(); it != n.children.rend(); ++it) {
+                Frag branch = compile(*it);
+                if (overflow) return { 0, 0 };
+                states[static_cast<size_t>(branch.end)].out = end;
+                start = start < 0 ? branch.start : add_epsilon(branch.start, start);
+            }
+            return { start, end };
+        }
+        case Node::Kind::Repeat: {
+            const Node& child = n.children[0];
+            int e = add_epsilon();
+            Frag f{ e, e };
+            for (size_t i = 0; i < n.min; ++i) append(f, compile(child));
+
+            if (n.max == Unbounded) {
+                int loop = add_epsilon();
+                int exit = add_epsilon();
+                Frag body = compile(child);
+                if (overflow) return { 0, 0 };
+                states[static_cast<size_t>(loop)].out = body.start;
+                states[static_cast<size_t>(loop)].out2 = exit;
+                states[static_cast<size_t>(body.end)].out = loop;
+                append(f, Frag{ loop, exit });
+            }
+            else {
+                for (size_t i = n.min; i < n.max; ++i) {
+                    int exit = add_epsilon();
+                    Frag body = compile(child);
+                    if (overflow) return { 0, 0 };
+                    states[static_cast<size_t>(body.end)].out = exit;
+                    append(f, Frag{ add_epsilon(body.start, exit), exit });
+                }
+            }
+            return f;
+        }
+        }
+        return { 0, 0 };
+    }
+};
+
+// Add the epsilon closure of `state` to `out`, keeping only byte-consuming and
+// match states (the ones that distinguish DFA states).
+void add_closure(const std::vector<NfaState>& states, int state,
+    std::vector<char>& seen, std::vector<int>& out) {
+    std::vector<int> stack{ state };
+    while (!stack.empty()) {
+        int s = stack.back();
+        stack.pop_back();
+        if (s < 0 || seen[static_cast<size_t>(s)]) continue;
+        seen[static_cast<size_t>(s)] = 1;
+
+        const NfaState& st = states[static_cast<size_t>(s)];
+        if (st.set >= 0 || st.match) {
+            out.push_back(s);
+        }
+        else {
+            stack.push_back(st.out2);
+            stack.push_back(st.out);
+        }
+    }
+}
+
+} // anonymous namespace
+
+// Fully built (not lazy) DFA, so matching is read-only and thread-safe.
+// Bytes are first mapped to equivalence classes to keep the table small.
+struct PathMatcher::Dfa {
+    uint8_t byte_class[256] = {};
+    size_t class_count = 0;
+    std::vector<int32_t> next;      // [state * class_count + class]; -1 = dead
+    std::vector<uint8_t> accepting;
+    bool anchored_end = false;
+
+    bool matches(std::string_view name) const {
+        int32_t s = 0;
+        if (anchored_end) {
+            for (unsigned char c : name) {
+                s = next[static_cast<size_t>(s) * class_count + byte_class[c]];
+                if (s < 0) return false;
+            }
+            return accepting[static_cast<size_t>(s)] != 0;
+        }
+
+        if (accepting[0]) return true;
+        for (unsigned char c : name) {
+            s = next[static_cast<size_t>(s) * class_count + byte_class[c]];
+            if (s < 0) return false;
+            if (accepting[static_cast<size_t>(s)]) return true;
+        }
+        return false;
+    }
+
+    // Subset construction over the NFA. Returns false past MaxDfaStates.
+    bool build(const NfaBuilder& nfa, int start, bool anchored_start) {
+        // Bytes with identical membership in every set share a class
+        std::map<std::vector<bool>, uint8_t> signatures;
+        std::vector<unsigned char> representative;
+        for (size_t b = 0; b < 256; ++b) {
+            std::vector<bool> sig(nfa.sets.size());
+            for (size_t i = 0; i < nfa.sets.size(); ++i) sig[i] = nfa.sets[i][b];
+            auto it = signatures.find(sig);
+            if (it == signatures.end()) {
+                it = signatures.emplace(std::move(sig), static_cast<uint8_t>(representative.size())).first;
+                representative.push_back(static_cast<unsigned char>(b));
+            }
+            byte_class[b] = it->second;
+        }
+        class_count = representative.size();
+
+        std::vector<char> seen(nfa.states.size());
+        std::vector<int> start_set;
+        add_closure(nfa.states, start, seen, start_set);
+        std::sort(start_set.begin(), start_set.end());
+
+        auto is_accepting = [&](const std::vector<int>& set) {
+            for (int s : set) {
+                if (nfa.states[static_cast<size_t>(s)].match) return true;
+            }
+            return false;
+        };
+
+        std::map<std::vector<int>, int32_t> ids;
+        std::vector<std::vector<int>> pending;
+        auto intern = [&](std::vector<int> set) -> int32_t {
+            auto it = ids.find(set);
+            if (it != ids.end()) return it->second;
+            int32_t id = static_cast<int32_t>(accepting.size());
+            accepting.push_back(is_accepting(set) ? 1 : 0);
+            next.resize(accepting.size() * class_count, -1);
+            ids.emplace(set, id);
+            pending.push_back(std::move(set));
+            return id;
+        };
+        intern(start_set);
+
+        for (size_t id = 0; id < pending.size(); ++id) {
+            if (accepting.size() > MaxDfaStates) return false;
+
+            // Without $, an accepting state ends the search, so it needs no edges
+            if (accepting[id] && !anchored_end) continue;
+
+            for (size_t k = 0; k < class_count; ++k) {
+                std::fill(seen.begin(), seen.end(), 0);
+                std::vector<int> target;
+                for (int s : pending[id]) {
+                    const NfaState& st = nfa.states[static_cast<size_t>(s)];
+                    if (st.set >= 0 && nfa.sets[static_cast<size_t>(st.set)][representative[k]]) {
+                        add_closure(nfa.states, st.out, seen, target);
+                    }
+                }
+                // Unanchored search: a match may start at every position
+                if (!anchored_start) add_closure(nfa.states, start, seen, target);
+                if (target.empty()) continue;
+
+                std::sort(target.begin(), target.end());
+                next[id * class_count + k] = intern(std::move(target));
+            }
+        }
+        return accepting.size() <= MaxDfaStates;
+    }
+};
+
+PathMatcher::PathMatcher(const std::string& pattern)
+    : regex_(pattern, std::regex::icase) {
+    std::string_view body = pattern;
+    bool anchored_start = false, anchored_end = false;
+    if (!body.empty() && body.front() == '^') {
+        anchored_start = true;
+        body.remove_prefix(1);
+    }
+    if (!body.empty() && body.back() == '$') {
+        // "\$" is a literal dollar; "\\$" is a backslash and an anchor
+        size_t backslashes = 0;
+        while (backslashes + 1 < body.size() && body[body.size() - 2 - backslashes] == '\\') {
+            ++backslashes;
+        }
+        if (backslashes % 2 == 0) {
+            anchored_end = true;
+            body.remove_suffix(1);
+        }
+    }
+
+    Node root;
+    if (!PatternParser(body).parse(root)) return;
+
+    // In "^a|b$" each anchor binds to one branch only; leave that to std::regex
+    if ((anchored_start || anchored_end) && root.kind == Node::Kind::Alt) return;
+
+    if (as_literal(root, literal_)) {
+        if (anchored_start && anchored_end) strategy_ = Strategy::Exact;
+        else if (anchored_start) strategy_ = Strategy::Prefix;
+        else if (anchored_end) strategy_ = Strategy::Suffix;
+        else strategy_ = Strategy::Substring;
+        regex_ = std::regex();
+        return;
+    }
+
+    NfaBuilder nfa;
+    NfaBuilder::Frag frag = nfa.compile(root);
+    NfaState match;
+    match.match = true;
+    int match_state = nfa.add(match);
+    if (nfa.overflow) return;
+    nfa.states[static_cast<size_t>(frag.end)].out = match_state;
+
+    auto dfa = std::make_unique<Dfa>();
+    dfa->anchored_end = anchored_end;
+    if (!dfa->build(nfa, frag.start, anchored_start)) return;
+
+    dfa_ = std::move(dfa);
+    strategy_ = Strategy::Dfa;
+    literal_ = required_literal(root);
+    if (literal_.size() < MinPrefilterLength) literal_.clear();
+    regex_ = std::regex();
+}
+
+PathMatcher::~PathMatcher() = default;
+
+bool PathMatcher::matches(std::string_view name) const {
+    switch (strategy_) {
+    case Strategy::Substring: return contains_icase(name, literal_);
+    case Strategy::Prefix:    return starts_with_icase(name, literal_);
+    case Strategy::Suffix:    return ends_with_icase(name, literal_);
+    case Strategy::Exact:     return equals_icase(name, literal_);
+    case Strategy::Dfa:
+        if (!literal_.empty() && !contains_icase(name, literal_)) return false;
+        return dfa_->matches(name);
+    case Strategy::StdRegex:
+        break;
+    }
+    return std::regex_search(name.begin(), name.end(), regex_);
+}
+
+const char* PathMatcher::strategy_name(Strategy s) {
+    switch (s) {
+    case Strategy::Substring: return "substring";
+    case Strategy::Prefix:    return "prefix";
+    case Strategy::Suffix:    return "suffix";
+    case Strategy::Exact:     return "exact";
+    case Strategy::Dfa:       return "dfa";
+    case Strategy::StdRegex:  return "std::regex";
+    }
+    return "";
+}
+
+} // namespace lsofwin
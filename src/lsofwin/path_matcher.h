@@ -0,0 +1,53 @@
+#pragma once
+
+#include <memory>
+#include <regex>
+#include <string>
+#include <string_view>
+
+namespace lsofwin {
+
+// The -f pattern, analysed once at parse time and matched with the cheapest
+// engine that gives the same answer as
+//     std::regex_search(name, std::regex(pattern, std::regex::icase))
+//
+//  - Plain literals, optionally anchored with ^ and/or $ ("myfile\.docx",
+//    "\.log$"), use a vectorized case-insensitive substring/prefix/suffix test.
+//  - Other patterns in the common ECMAScript subset (classes, groups,
+//    alternation, quantifiers) compile to a DFA, guarded by a prefilter on the
+//    longest literal every match must contain.
+//  - Anything else (backreferences, lookahead, \b, ...) uses std::regex.
+//
+// Case folding is ASCII-only, like std::regex::icase in the "C" locale.
+// Immutable after construction, so one matcher can be shared by all -J workers.
+class PathMatcher {
+public:
+    enum class Strategy { Substring, Prefix, Suffix, Exact, Dfa, StdRegex };
+
+    // Throws std::regex_error if the pattern is not a valid ECMAScript regex.
+    explicit PathMatcher(const std::string& pattern);
+    ~PathMatcher();
+
+    PathMatcher(const PathMatcher&) = delete;
+    PathMatcher& operator=(const PathMatcher&) = delete;
+
+    bool matches(std::string_view name) const;
+
+    Strategy strategy() const { return strategy_; }
+
+    // Lowercased literal used by the literal strategies, or the DFA prefilter
+    // literal (empty if the pattern has none worth checking).
+    const std::string& literal() const { return literal_; }
+
+    static const char* strategy_name(Strategy s);
+
+private:
+    struct Dfa;
+
+    Strategy strategy_ = Strategy::StdRegex;
+    std::string literal_;
+    std::unique_ptr<Dfa> dfa_;
+    std::regex regex_;
+};
+
+} // namespace lsofwin
@@ -0,0 +1,241 @@
+#include "path_trie.h"
+#include "string_search.h"
+
+namespace lsofwin {
+
+namespace {
+
+bool is_separator(char c) {
+    return c == '\\' || c == '/';
+}
+
+constexpr size_t InitialChildSlots = 1024;
+
+} // anonymous namespace
+
+PathComponents::PathComponents(std::string_view path) : rest_(path) {}
+
+bool PathComponents::next() {
+    if (at_start_) {
+        at_start_ = false;
+        size_t separators = 0;
+        while (separators < rest_.size() && is_separator(rest_[separators])) ++separators;
+        if (separators > 0) {
+            raw_ = separators == 1 ? std::string_view("/") : std::string_view("//");
+            rest_.remove_prefix(separators);
+            return true;
+        }
+    }
+    for (;;) {
+        while (!rest_.empty() && is_separator(rest_.front())) rest_.remove_prefix(1);
+        if (rest_.empty()) return false;
+        size_t end = 1;
+        while (end < rest_.size() && !is_separator(rest_[end])) ++end;
+        raw_ = rest_.substr(0, end);
+        rest_.remove_prefix(end);
+        if (raw_ != ".") return true;
+    }
+}
+
+std::string_view PathComponents::lowered() {
+    lowered_.resize(raw_.size());
+    for (size_t i = 0; i < raw_.size(); ++i) {
+        lowered_[i] = static_cast<char>(ascii_lower(static_cast<unsigned char>(raw_[i])));
+    }
+    return lowered_;
+}
+
+DirectoryFilter::DirectoryFilter(std::string_view dir, bool recursive)
+    : active_(true), recursive_(recursive) {
+    PathComponents parts(dir);
+    while (parts.next()) components_.emplace_back(parts.lowered());
+}
+
+bool DirectoryFilter::matches(std::string_view name) const {
+    if (!active_ || name.empty()) return false;
+    PathComponents parts(name);
+    for (const auto& component : components_) {
+        if (!parts.next() || !equals_icase(parts.raw(), component)) return false;
+    }
+    if (recursive_ || !parts.next()) return true;
+    return !parts.next(); // +d: at most one level below
+}
+
+PathTrie::PathTrie() : nodes_(1), children_(InitialChildSlots, ChildSlot{ 0, None }) {}
+
+void PathTrie::insert(std::string_view path, uint32_t value) {
+    if (value < values_.size() && values_[value].node != None) unlink_value(value);
+
+    uint32_t node = Root;
+    PathComponents parts(path);
+    while (parts.next()) {
+        uint32_t name = names_.intern(parts.lowered());
+        uint32_t child = find_child(node, name);
+        node = child != None ? child : add_child(node, name);
+    }
+
+    if (value >= values_.size()) values_.resize(static_cast<size_t>(value) + 1, ValueLink{ None, None, None });
+    uint32_t head = nodes_[node].first_value;
+    values_[value] = ValueLink{ node, None, head };
+    if (head != None) values_[head].prev = value;
+    nodes_[node].first_value = value;
+    ++size_;
+}
+
+bool PathTrie::erase(std::string_view path, uint32_t value) {
+    if (value >= values_.size() || values_[value].node == None) return false;
+    if (find_node(path) != values_[value].node) return false;
+    prune(unlink_value(value));
+    return true;
+}
+
+void PathTrie::lookup(std::string_view path, Scope scope, std::vector<uint32_t>& out) const {
+    uint32_t node = find_node(path);
+    if (node == None) return;
+    append_values(node, out);
+    if (scope == Scope::Exact) return;
+
+    if (scope == Scope::Children) {
+        for (uint32_t c = nodes_[node].first_child; c != None; c = nodes_[c].next_sibling) {
+            append_values(c, out);
+        }
+        return;
+    }
+
+    std::vector<uint32_t> pending;
+    for (uint32_t c = nodes_[node].first_child; c != None; c = nodes_[c].next_sibling) pending.push_back(c);
+    while (!pending.empty()) {
+        uint32_t n = pending.back();
+        pending.pop_back();
+        append_values(n, out);
+        for (uint32_t c = nodes_[n].first_child; c != None; c = nodes_[c].next_sibling) pending.push_back(c);
+    }
+}
+
+size_t PathTrie::memory_bytes() const {
+    return names_.memory_bytes() +
+        nodes_.capacity() * sizeof(Node) +
+        values_.capacity() * sizeof(ValueLink) +
+        free_nodes_.capacity() * sizeof(uint32_t) +
+        children_.capacity() * sizeof(ChildSlot);
+}
+
+uint32_t PathTrie::find_node(std::string_view path) const {
+    uint32_t node = Root;
+    PathComponents parts(path);
+    while (parts.next()) {
+        uint32_t name = names_.find(parts.lowered());
+        if (name == StringPool::NotFound) return None;
+        node = find_child(node, name);
+        if (node == None) return None;
+    }
+    return node;
+}
+
+size_t PathTrie::home_slot(uint64_t key) const {
+    return static_cast<size_t>((key * 0x9e3779b97f4a7c15ull) >> 32) & (children_.size() - 1);
+}
+
+uint32_t PathTrie::find_child(uint32_t parent, uint32_t name) const {
+    uint64_t key = child_key(parent, name);
+    size_t mask = children_.size() - 1;
+    for (size_t slot = home_slot(key); children_[slot].node != None; slot = (slot + 1) & mask) {
+        if (children_[slot].key == key) return children_[slot].node;
+    }
+    return None;
+}
+
+uint32_t PathTrie::add_child(uint32_t parent, uint32_t name) {
+    uint32_t id;
+    if (!free_nodes_.empty()) {
+        id = free_nodes_.back();
+        free_nodes_.pop_back();
+    } else {
+        id = static_cast<uint32_t>(nodes_.size());
+        nodes_.emplace_back();
+    }
+    Node& n = nodes_[id];
+    n = Node{};
+    n.parent = parent;
+    n.name = name;
+    n.next_sibling = nodes_[parent].first_child;
+    if (n.next_sibling != None) nodes_[n.next_sibling].prev_sibling = id;
+    nodes_[parent].first_child = id;
+
+    uint64_t key = child_key(parent, name);
+    size_t mask = children_.size() - 1;
+    size_t slot = home_slot(key);
+    while (children_[slot].node != None) slot = (slot + 1) & mask;
+    children_[slot] = ChildSlot{ key, id };
+    // Keep the table at most half full
+    if (++child_count_ * 2 > children_.size()) grow_children();
+    return id;
+}
+
+void PathTrie::erase_child(uint32_t parent, uint32_t name) {
+    uint64_t key = child_key(parent, name);
+    size_t mask = children_.size() - 1;
+    size_t hole = home_slot(key);
+    while (children_[hole].key != key || children_[hole].node == None) {
+        if (children_[hole].node == None) return;
+        hole = (hole + 1) & mask;
+    }
+
+    // Shift later entries of the probe run back so lookups never stop early
+    for (size_t next = (hole + 1) & mask; children_[next].node != None; next = (next + 1) & mask) {
+        size_t home = home_slot(children_[next].key);
+        bool movable = hole <= next ? (home <= hole || home > next) : (home <= hole && home > next);
+        if (movable) {
+            children_[hole] = children_[next];
+            hole = next;
+        }
+    }
+    children_[hole] = ChildSlot{ 0, None };
+    --child_count_;
+}
+
+void PathTrie::grow_children() {
+    std::vector<ChildSlot> old(children_.size() * 2, ChildSlot{ 0, None });
+    old.swap(children_);
+    size_t mask = children_.size() - 1;
+    for (const auto& entry : old) {
+        if (entry.node == None) continue;
+        size_t slot = home_slot(entry.key);
+        while (children_[slot].node != None) slot = (slot + 1) & mask;
+        children_[slot] = entry;
+    }
+}
+
+void PathTrie::append_values(uint32_t node, std::vector<uint32_t>& out) const {
+    for (uint32_t value = nodes_[node].first_value; value != None; value = values_[value].next) {
+        out.push_back(value);
+    }
+}
+
+uint32_t PathTrie::unlink_value(uint32_t value) {
+    ValueLink& v = values_[value];
+    uint32_t node = v.node;
+    if (v.prev != None) values_[v.prev].next = v.next;
+    else nodes_[node].first_value = v.next;
+    if (v.next != None) values_[v.next].prev = v.prev;
+    v = ValueLink{ None, None, None };
+    --size_;
+    return node;
+}
+
+void PathTrie::prune(uint32_t node) {
+    // Drop nodes left with no values and no children, up to the root
+    while (node != Root && nodes_[node].first_value == None && nodes_[node].first_child == None) {
+        Node& n = nodes_[node];
+        uint32_t parent = n.parent;
+        if (n.prev_sibling != None) nodes_[n.prev_sibling].next_sibling = n.next_sibling;
+        else nodes_[parent].first_child = n.next_sibling;
+        if (n.next_sibling != None) nodes_[n.next_sibling].prev_sibling = n.prev_sibling;
+        erase_child(parent, n.name);
+        n = Node{};
+        free_nodes_.push_back(node);
+        node = parent;
+    }
+}
+
+} // namespace lsofwin
@@ -0,0 +1,145 @@
+#pragma once
+
+#include "string_pool.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace lsofwin {
+
+// Splits a resolved object name into lowercased path components, the form
+// +d/+D compare and PathTrie stores. '\' and '/' are both separators, and
+// repeated or trailing separators and "." components are ignored. A leading
+// separator becomes a "/" root component and two or more become "//" (UNC
+// and other device-style roots), so
+//
+//   C:\Users\Alice\      -> c:  users  alice
+//   /home/alice          -> /   home   alice
+//   \REGISTRY\MACHINE    -> /   registry  machine
+//   \\server\share\x     -> //  server  share  x
+//
+// Case folding is ASCII-only, like the -f matcher.
+class PathComponents {
+public:
+    explicit PathComponents(std::string_view path);
+
+    // Advance to the next component; false when there are no more.
+    bool next();
+
+    // The current component as written (a root is "/" or "//").
+    std::string_view raw() const { return raw_; }
+
+    // The current component lowercased, in a buffer reused by each call.
+    std::string_view lowered();
+
+private:
+    std::string_view rest_;
+    std::string_view raw_;
+    std::string lowered_;
+    bool at_start_ = true;
+};
+
+// The +d / +D filter for a single name: matches the directory itself and
+// names one level below it (+d) or anywhere below it (+D). Used where rows
+// are filtered one at a time as they are resolved.
+class DirectoryFilter {
+public:
+    DirectoryFilter() = default;
+    DirectoryFilter(std::string_view dir, bool recursive);
+
+    bool active() const { return active_; }
+    bool matches(std::string_view name) const;
+
+private:
+    bool active_ = false;
+    bool recursive_ = false;
+    std::vector<std::string> components_;
+};
+
+// Case-insensitive, component-wise trie over object names, mapping each path
+// to the uint32_t values (row ids) stored under it. A path is looked up one
+// component at a time, so listing a directory costs the size of its subtree
+// rather than the number of paths stored. Component strings are interned
+// once and kept; nodes that lose their last value and child are removed.
+//
+// A value is stored under one path at a time, and per-value links are kept
+// in an array indexed by the value, so values should be dense ids.
+class PathTrie {
+public:
+    enum class Scope {
+        Exact,      // Only the path itself
+        Children,   // The path and names one level below it (+d)
+        Subtree,    // The path and everything below it (+D)
+    };
+
+    PathTrie();
+
+    // Store value under path, moving it if it was stored elsewhere.
+    void insert(std::string_view path, uint32_t value);
+
+    // Remove one value stored under path. Returns false if it was not there.
+    bool erase(std::string_view path, uint32_t value);
+
+    // Append the values stored at path within the given scope.
+    void lookup(std::string_view path, Scope scope, std::vector<uint32_t>& out) const;
+
+    // Values stored, and nodes in use (one per distinct path prefix).
+    size_t size() const { return size_; }
+    size_t node_count() const { return nodes_.size() - free_nodes_.size(); }
+
+    // Approximate heap bytes held by the trie.
+    size_t memory_bytes() const;
+
+private:
+    static constexpr uint32_t None = 0xffffffffu;
+    static constexpr uint32_t Root = 0;
+
+    struct Node {
+        uint32_t parent = None;
+        uint32_t name = StringPool::Empty;  // Component string id
+        uint32_t first_child = None;
+        uint32_t next_sibling = None;
+        uint32_t prev_sibling = None;
+        uint32_t first_value = None;        // Head of the node's value list
+    };
+
+    // Per-value list links, indexed by the value itself
+    struct ValueLink {
+        uint32_t node;  // None if the value is not stored
+        uint32_t prev;
+        uint32_t next;
+    };
+
+    // Open-addressing table entry for the (parent, name) -> child lookup
+    struct ChildSlot {
+        uint64_t key;
+        uint32_t node;  // None if the slot is empty
+    };
+
+    static uint64_t child_key(uint32_t parent, uint32_t name) {
+        return (static_cast<uint64_t>(parent) << 32) | name;
+    }
+
+    uint32_t find_node(std::string_view path) const;
+    uint32_t find_child(uint32_t parent, uint32_t name) const;
+    uint32_t add_child(uint32_t parent, uint32_t name);
+    void erase_child(uint32_t parent, uint32_t name);
+    void grow_children();
+    size_t home_slot(uint64_t key) const;
+    void append_values(uint32_t node, std::vector<uint32_t>& out) const;
+    uint32_t unlink_value(uint32_t value);
+    void prune(uint32_t node);
+
+    StringPool names_;
+    std::vector<Node> nodes_;
+    std::vector<uint32_t> free_nodes_;
+    std::vector<ValueLink> values_;
+    std::vector<ChildSlot> children_;   // (parent, name) -> node, linear probing
+    size_t child_count_ = 0;
+    size_t size_ = 0;
+};
+
+} // namespace lsofwin
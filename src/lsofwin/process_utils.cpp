@@ -1,9 +1,10 @@
 #include "process_utils.h"
+#include "account_cache.h"
+#include "utf16_transcode.h"
 
 #include <Windows.h>
 #include <Psapi.h>
 #include <sddl.h>
-#include <memory>
 
 #pragma comment(lib, "advapi32.lib")
 #pragma comment(lib, "psapi.lib")
@@ -38,56 +39,74 @@ std::string get_process_name(uint32_t pid) {
     return "";
 }
 
-std::string get_process_user(uint32_t pid) {
-    if (pid == 0 || pid == 4) return "SYSTEM";
+bool get_process_account(uint32_t pid, std::string& account_id) {
+    if (pid == 0 || pid == 4) {
+        // The idle process and the kernel have no token; both are LocalSystem
+        static const unsigned char local_system[] = { 1, 1, 0, 0, 0, 0, 0, 5, 18, 0, 0, 0 };
+        account_id.assign(reinterpret_cast<const char*>(local_system), sizeof(local_system));
+        return true;
+    }
 
     HANDLE hProcess = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, pid);
-    if (!hProcess) return "";
+    if (!hProcess) return false;
 
     HANDLE hToken = nullptr;
     if (!OpenProcessToken(hProcess, TOKEN_QUERY, &hToken)) {
         CloseHandle(hProcess);
-        return "";
+        return false;
     }
 
+    // A TOKEN_USER always fits this buffer, so one call is enough
+    alignas(TOKEN_USER) char buffer[sizeof(TOKEN_USER) + SECURITY_MAX_SID_SIZE];
     DWORD token_size = 0;
-    GetTokenInformation(hToken, TokenUser, nullptr, 0, &token_size);
-    if (token_size == 0) {
-        CloseHandle(hToken);
-        CloseHandle(hProcess);
-        return "";
+    bool ok = GetTokenInformation(hToken, TokenUser, buffer, sizeof(buffer), &token_size) != 0;
+    if (ok) {
+        PSID sid = reinterpret_cast<TOKEN_USER*>(buffer)->User.Sid;
+        account_id.assign(static_cast<const char*>(sid), GetLengthSid(sid));
     }
 
-    auto buffer = std::make_unique<char[]>(token_size);
-    if (!GetTokenInformation(hToken, TokenUser, buffer.get(), token_size, &token_size)) {
-        CloseHandle(hToken);
-        CloseHandle(hProcess);
-        return "";
+    CloseHandle(hToken);
+    CloseHandle(hProcess);
+    return ok;
+}
+
+std::string lookup_account_name(std::string_view account_id) {
+    PSID sid = const_cast<char*>(account_id.data());
+    if (account_id.size() < 8 || !IsValidSid(sid) || GetLengthSid(sid) != account_id.size()) {
+        return format_account_id(account_id);
     }
 
-    auto* token_user = reinterpret_cast<TOKEN_USER*>(buffer.get());
-    char user_name[256] = {};
-    char domain_name[256] = {};
+    WCHAR user_name[256] = {};
+    WCHAR domain_name[256] = {};
     DWORD user_size = 256, domain_size = 256;
     SID_NAME_USE sid_type;
-
-    if (!LookupAccountSidA(nullptr, token_user->User.Sid,
-        user_name, &user_size, domain_name, &domain_size, &sid_type)) {
-        CloseHandle(hToken);
-        CloseHandle(hProcess);
-        return "";
+    if (!LookupAccountSidW(nullptr, sid, user_name, &user_size, domain_name, &domain_size, &sid_type)) {
+        return format_account_id(account_id);
     }
 
-    CloseHandle(hToken);
-    CloseHandle(hProcess);
-
     std::string result;
-    if (domain_name[0] != '\0') {
-        result = std::string(domain_name) + "\\" + user_name;
+    if (domain_size > 0) {
+        append_utf8(result, std::u16string_view(reinterpret_cast<const char16_t*>(domain_name), domain_size));
+        result += '\\';
     }
-    else {
-        result = user_name;
+    append_utf8(result, std::u16string_view(reinterpret_cast<const char16_t*>(user_name), user_size));
+    return result;
+}
+
+std::string format_account_id(std::string_view account_id) {
+    return format_sid(account_id);
+}
+
+uint64_t get_process_start_time(uint32_t pid) {
+    HANDLE hProcess = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, pid);
+    if (!hProcess) return 0;
+
+    FILETIME creation = {}, exit_time = {}, kernel_time = {}, user_time = {};
+    uint64_t result = 0;
+    if (GetProcessTimes(hProcess, &creation, &exit_time, &kernel_time, &user_time)) {
+        result = (static_cast<uint64_t>(creation.dwHighDateTime) << 32) | creation.dwLowDateTime;
     }
+    CloseHandle(hProcess);
     return result;
 }
 
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <cstdint>
 
 namespace lsofwin {
@@ -8,10 +9,24 @@ namespace lsofwin {
 // Get the executable name for a given PID. Returns empty string on failure.
 std::string get_process_name(uint32_t pid);
 
-// Get the owner (DOMAIN\User) for a given PID. Returns empty string on failure.
-std::string get_process_user(uint32_t pid);
+// Get the owner of a process as an opaque account id, the key of AccountCache:
+// the binary SID of the process token on Windows, the uid on Linux. Returns
+// false on failure.
+bool get_process_account(uint32_t pid, std::string& account_id);
 
-// Check if the current process is running with Administrator privileges.
+// Look up the display name (DOMAIN\User on Windows) of an account id. May
+// block for seconds on a domain controller. Falls back to format_account_id().
+std::string lookup_account_name(std::string_view account_id);
+
+// An account id as text without any lookup: "S-1-5-18" or "1000" (-l).
+std::string format_account_id(std::string_view account_id);
+
+// Get the process creation time in a backend-specific unit (FILETIME ticks on
+// Windows, clock ticks since boot on Linux). Returns 0 on failure. Only used
+// to tell a reused PID apart from the process that had it before.
+uint64_t get_process_start_time(uint32_t pid);
+
+// Check if the current process is running with Administrator (root) privileges.
 bool is_elevated();
 
 } // namespace lsofwin
@@ -0,0 +1,100 @@
+#include "process_utils.h"
+
+#include <fcntl.h>
+#include <pwd.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace lsofwin {
+
+std::string get_process_name(uint32_t pid) {
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%u/comm", pid);
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return "";
+
+    char name[256] = {};
+    ssize_t len = read(fd, name, sizeof(name) - 1);
+    close(fd);
+    if (len <= 0) return "";
+
+    // comm is newline-terminated
+    while (len > 0 && (name[len - 1] == '\n' || name[len - 1] == '\0')) --len;
+    return std::string(name, static_cast<size_t>(len));
+}
+
+bool get_process_account(uint32_t pid, std::string& account_id) {
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%u", pid);
+
+    struct stat st;
+    if (stat(path, &st) != 0) return false;
+    account_id.assign(reinterpret_cast<const char*>(&st.st_uid), sizeof(st.st_uid));
+    return true;
+}
+
+namespace {
+
+bool account_uid(std::string_view account_id, uid_t& uid) {
+    if (account_id.size() != sizeof(uid)) return false;
+    memcpy(&uid, account_id.data(), sizeof(uid));
+    return true;
+}
+
+} // anonymous namespace
+
+std::string lookup_account_name(std::string_view account_id) {
+    uid_t uid;
+    if (!account_uid(account_id, uid)) return "";
+
+    long buf_size = sysconf(_SC_GETPW_R_SIZE_MAX);
+    if (buf_size <= 0) buf_size = 16384;
+    std::vector<char> buffer(static_cast<size_t>(buf_size));
+
+    struct passwd pwd;
+    struct passwd* result = nullptr;
+    if (getpwuid_r(uid, &pwd, buffer.data(), buffer.size(), &result) != 0 || !result) {
+        return std::to_string(uid);
+    }
+    return std::string(result->pw_name);
+}
+
+std::string format_account_id(std::string_view account_id) {
+    uid_t uid;
+    return account_uid(account_id, uid) ? std::to_string(uid) : "";
+}
+
+uint64_t get_process_start_time(uint32_t pid) {
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%u/stat", pid);
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return 0;
+
+    char stat[1024];
+    ssize_t len = read(fd, stat, sizeof(stat) - 1);
+    close(fd);
+    if (len <= 0) return 0;
+    stat[len] = '\0';
+
+    // comm may contain spaces and ')'; fields resume after the last ')'.
+    // starttime is field 22, the 20th after it.
+    char* p = strrchr(stat, ')');
+    if (!p) return 0;
+    for (int field = 0; field < 20; ++field) {
+        p = strchr(p + 1, ' ');
+        if (!p) return 0;
+    }
+    return strtoull(p + 1, nullptr, 10);
+}
+
+bool is_elevated() {
+    return geteuid() == 0;
+}
+
+} // namespace lsofwin
@@ -0,0 +1,119 @@
+#include "query_planner.h"
+
+#include <algorithm>
+
+namespace lsofwin {
+
+PidIndex::PidIndex(const std::vector<RawHandle>& table) {
+    size_t begin = 0;
+    for (size_t i = 1; i <= table.size(); ++i) {
+        if (i == table.size() || table[i].pid != table[begin].pid) {
+            runs_.push_back({ table[begin].pid, begin, i });
+            begin = i;
+        }
+    }
+
+    by_pid_.resize(runs_.size());
+    for (size_t i = 0; i < runs_.size(); ++i) by_pid_[i] = static_cast<uint32_t>(i);
+    std::sort(by_pid_.begin(), by_pid_.end(), [this](uint32_t a, uint32_t b) {
+        return runs_[a].pid != runs_[b].pid ? runs_[a].pid < runs_[b].pid : a < b;
+    });
+}
+
+std::vector<uint32_t> PidIndex::pids() const {
+    std::vector<uint32_t> out;
+    for (uint32_t r : by_pid_) {
+        if (out.empty() || out.back() != runs_[r].pid) out.push_back(runs_[r].pid);
+    }
+    return out;
+}
+
+std::vector<PidRange> PidIndex::find(uint32_t pid) const {
+    auto first = std::lower_bound(by_pid_.begin(), by_pid_.end(), pid,
+        [this](uint32_t r, uint32_t p) { return runs_[r].pid < p; });
+    std::vector<PidRange> out;
+    for (auto it = first; it != by_pid_.end() && runs_[*it].pid == pid; ++it) {
+        out.push_back(runs_[*it]);
+    }
+    return out;
+}
+
+ScanPlan plan_scan(const PidIndex& index, HandleSource& source, const FilterExpr& filter,
+    size_t threads, bool need_users) {
+    ScanPlan plan;
+
+    // ANDed PIDs select their runs directly; anything else starts from all runs
+    std::vector<PidRange> candidates;
+    if (!filter.any() && !filter.pids().empty()) {
+        for (uint32_t pid : filter.pids()) {
+            auto runs = index.find(pid);
+            candidates.insert(candidates.end(), runs.begin(), runs.end());
+        }
+        std::sort(candidates.begin(), candidates.end(),
+            [](const PidRange& a, const PidRange& b) { return a.begin < b.begin; });
+    }
+    else {
+        candidates = index.runs();
+    }
+
+    std::vector<uint32_t> pids;
+    for (const auto& r : candidates) pids.push_back(r.pid);
+    std::sort(pids.begin(), pids.end());
+    pids.erase(std::unique(pids.begin(), pids.end()), pids.end());
+
+    // Level 1 for every process, then level 2 for those the PID left open,
+    // looking each one's name up once, in parallel when -J allows
+    std::vector<FilterExpr::Verdict> verdicts(pids.size());
+    std::vector<size_t> lookups;
+    for (size_t i = 0; i < pids.size(); ++i) {
+        verdicts[i] = filter.pid_verdict(pids[i]);
+        if (verdicts[i] == FilterExpr::Verdict::NeedProcess) lookups.push_back(i);
+    }
+    std::vector<ProcessInfo> infos(lookups.size());
+    run_work_stealing(lookups.size(), threads, [&](size_t task, size_t) {
+        infos[task].name = source.process_name(pids[lookups[task]]);
+    });
+
+    // Only the processes that matched are worth an owner lookup
+    std::vector<size_t> matched;
+    for (size_t k = 0; k < lookups.size(); ++k) {
+        verdicts[lookups[k]] = filter.process_verdict(infos[k].name);
+        if (verdicts[lookups[k]] != FilterExpr::Verdict::Reject) matched.push_back(k);
+    }
+    if (need_users) {
+        run_work_stealing(matched.size(), threads, [&](size_t task, size_t) {
+            size_t k = matched[task];
+            infos[k] = source.process_info(pids[lookups[k]]);
+        });
+    }
+    for (size_t k : matched) plan.processes.emplace(pids[lookups[k]], std::move(infos[k]));
+
+    plan.names_checked = filter.has_name_terms();
+    for (size_t i = 0; i < pids.size(); ++i) {
+        if (verdicts[i] == FilterExpr::Verdict::Reject) continue;
+        ++plan.processes_matched;
+        if (plan.names_checked && verdicts[i] == FilterExpr::Verdict::Accept) plan.accepted.push_back(pids[i]);
+    }
+
+    plan.ranges.reserve(candidates.size());
+    for (const auto& r : candidates) {
+        auto it = std::lower_bound(pids.begin(), pids.end(), r.pid);
+        if (verdicts[static_cast<size_t>(it - pids.begin())] == FilterExpr::Verdict::Reject) continue;
+        plan.ranges.push_back({ r.begin, r.end });
+        plan.handles += r.end - r.begin;
+    }
+    return plan;
+}
+
+std::vector<Shard> split_shards(const std::vector<Shard>& ranges, size_t max_shard_size) {
+    if (max_shard_size == 0) max_shard_size = 1;
+    std::vector<Shard> shards;
+    for (const auto& r : ranges) {
+        for (size_t begin = r.begin; begin < r.end; begin += max_shard_size) {
+            shards.push_back({ begin, (std::min)(r.end, begin + max_shard_size) });
+        }
+    }
+    return shards;
+}
+
+} // namespace lsofwin
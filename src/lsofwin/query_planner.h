@@ -0,0 +1,77 @@
+#pragma once
+
+#include "filter_expr.h"
+#include "handle_info.h"
+#include "handle_source.h"
+#include "shard_scheduler.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace lsofwin {
+
+// A maximal run of consecutive table entries owned by one process.
+struct PidRange {
+    uint32_t pid = 0;
+    size_t begin = 0;
+    size_t end = 0;
+};
+
+// PID -> table ranges index over one snapshot. The raw table is grouped by
+// process, so a single pass comparing PIDs yields a few hundred runs; lookups
+// are then a binary search over the runs, never a walk of the handles.
+// A PID split into several runs (possible but unusual) keeps every run.
+class PidIndex {
+public:
+    explicit PidIndex(const std::vector<RawHandle>& table);
+
+    // All runs, in table order.
+    const std::vector<PidRange>& runs() const { return runs_; }
+
+    // Distinct PIDs present in the table, ascending.
+    std::vector<uint32_t> pids() const;
+
+    // Runs belonging to pid, in table order (empty if the PID has no handles).
+    std::vector<PidRange> find(uint32_t pid) const;
+
+private:
+    std::vector<PidRange> runs_;
+    std::vector<uint32_t> by_pid_;  // Indices into runs_, sorted by (pid, begin)
+};
+
+// Table ranges left to walk once -p/-c have been applied per process.
+struct ScanPlan {
+    std::vector<Shard> ranges;      // Per-process ranges, in table order
+    size_t handles = 0;             // Entries covered by ranges
+    size_t processes_matched = 0;   // Distinct PIDs left after -p/-c
+
+    // Process info looked up while planning (only populated when -c needed
+    // names; owners are empty unless plan_scan was asked for them); other
+    // PIDs are looked up lazily during the scan.
+    std::unordered_map<uint32_t, ProcessInfo> processes;
+
+    // Whether the handles of a planned process go through the object name
+    // checks (-f, +d / +D): all of them, except, with --or, processes that
+    // -p or -c already selected.
+    bool check_names(uint32_t pid) const {
+        return names_checked && !std::binary_search(accepted.begin(), accepted.end(), pid);
+    }
+
+    bool names_checked = false;
+    std::vector<uint32_t> accepted; // Sorted; planned PIDs that skip the name checks
+};
+
+// Apply the process-level levels of the filter once per PID instead of once
+// per handle: with -p alone (or ANDed) the runs come straight from the index,
+// and -c looks up the name of each process the PID left open once (on
+// `threads` workers). Owners are looked up only for the processes that
+// matched, and only if need_users.
+ScanPlan plan_scan(const PidIndex& index, HandleSource& source, const FilterExpr& filter,
+    size_t threads, bool need_users = true);
+
+// Split planned ranges so no shard exceeds max_shard_size entries.
+std::vector<Shard> split_shards(const std::vector<Shard>& ranges, size_t max_shard_size);
+
+} // namespace lsofwin
@@ -0,0 +1,171 @@
+#include "scan_stats.h"
+#include "json_escape.h"
+
+#include <cinttypes>
+#include <cstdio>
+#include <iterator>
+
+namespace lsofwin {
+
+namespace {
+
+const char* const phase_names[] = {
+    "scan", "snapshot", "prepare", "plan", "process_info", "account_lookup", "resolve",
+    "open_process", "duplicate", "type_query", "name_query", "normalize", "filter", "output",
+};
+
+const char* const counter_names[] = {
+    "handles_seen", "skipped_plan", "skipped_type", "access_denied", "skipped_file",
+    "skipped_dir", "rows", "cache_hits", "timed_out", "hang_risk_probed",
+    "skipped_deadline", "not_queried", "snapshot_retries", "bytes_written",
+};
+
+static_assert(std::size(phase_names) == static_cast<size_t>(ScanPhase::Count), "phase names");
+static_assert(std::size(counter_names) == static_cast<size_t>(ScanCounter::Count), "counter names");
+
+// printf into a std::string.
+template <typename... Args>
+void appendf(std::string& out, const char* format, Args... args) {
+    char line[256];
+    int n = std::snprintf(line, sizeof(line), format, args...);
+    if (n > 0) out.append(line, (std::min)(static_cast<size_t>(n), sizeof(line) - 1));
+}
+
+double to_ms(uint64_t ns) {
+    return static_cast<double>(ns) / 1e6;
+}
+
+} // anonymous namespace
+
+const char* scan_phase_name(ScanPhase phase) {
+    return phase_names[static_cast<size_t>(phase)];
+}
+
+const char* scan_counter_name(ScanCounter counter) {
+    return counter_names[static_cast<size_t>(counter)];
+}
+
+uint64_t LatencyHistogram::count() const {
+    uint64_t n = 0;
+    for (const auto& b : buckets_) n += b.load(std::memory_order_relaxed);
+    return n;
+}
+
+size_t LatencyHistogram::bucket_for(uint64_t ns) {
+    uint64_t us = ns / 1000;
+    size_t b = 0;
+    while (us != 0 && b + 1 < BucketCount) {
+        us >>= 1;
+        ++b;
+    }
+    return b;
+}
+
+uint64_t LatencyHistogram::bucket_limit_us(size_t b) {
+    return b + 1 < BucketCount ? uint64_t{ 1 } << b : 0;
+}
+
+uint64_t LatencyHistogram::quantile_us(double q) const {
+    uint64_t total = count();
+    if (total == 0) return 0;
+    auto rank = static_cast<uint64_t>(q * static_cast<double>(total));
+    if (rank == 0) rank = 1;
+    uint64_t seen = 0;
+    for (size_t b = 0; b + 1 < BucketCount; ++b) {
+        seen += bucket(b);
+        if (seen >= rank) return bucket_limit_us(b);
+    }
+    return max_ns() / 1000;
+}
+
+ScanStats::ScanStats() : resolve_(std::make_unique<LatencyHistogram[]>(MaxTypeIndex + 1)) {}
+
+void ScanStats::set_type_names(const std::vector<std::string>& names) {
+    type_names_ = names;
+}
+
+std::string ScanStats::type_label(size_t index) const {
+    if (index == MaxTypeIndex) return "(other)";
+    if (index < type_names_.size() && !type_names_[index].empty()) return type_names_[index];
+    return "#" + std::to_string(index);
+}
+
+std::string ScanStats::to_text() const {
+    std::string out = "Scan statistics (phases on worker threads are summed over threads)\n";
+    appendf(out, "  %-18s %12s %10s\n", "phase", "total ms", "calls");
+    for (size_t p = 0; p < static_cast<size_t>(ScanPhase::Count); ++p) {
+        uint64_t calls = phase_calls_[p].load(std::memory_order_relaxed);
+        if (calls == 0) continue;
+        appendf(out, "  %-18s %12.3f %10" PRIu64 "\n", phase_names[p],
+            to_ms(phase_ns_[p].load(std::memory_order_relaxed)), calls);
+    }
+
+    appendf(out, "  %-18s %12s\n", "counter", "value");
+    for (size_t c = 0; c < static_cast<size_t>(ScanCounter::Count); ++c) {
+        uint64_t value = counters_[c].load(std::memory_order_relaxed);
+        if (value == 0) continue;
+        appendf(out, "  %-18s %12" PRIu64 "\n", counter_names[c], value);
+    }
+
+    bool header = false;
+    for (size_t t = 0; t <= MaxTypeIndex; ++t) {
+        const auto& h = resolve_[t];
+        uint64_t n = h.count();
+        if (n == 0) continue;
+        if (!header) {
+            appendf(out, "  %-18s %12s %10s %8s %8s %8s %10s\n", "resolve by type", "count",
+                "mean us", "p50 <us", "p90 <us", "p99 <us", "max us");
+            header = true;
+        }
+        appendf(out, "  %-18s %12" PRIu64 " %10.1f %8" PRIu64 " %8" PRIu64 " %8" PRIu64 " %10.1f\n",
+            type_label(t).c_str(), n, static_cast<double>(h.total_ns()) / 1e3 / static_cast<double>(n),
+            h.quantile_us(0.5), h.quantile_us(0.9), h.quantile_us(0.99),
+            static_cast<double>(h.max_ns()) / 1e3);
+    }
+    return out;
+}
+
+std::string ScanStats::to_json() const {
+    std::string out = "{\"phases\":{";
+    for (size_t p = 0; p < static_cast<size_t>(ScanPhase::Count); ++p) {
+        if (p) out += ',';
+        appendf(out, "\"%s\":{\"ms\":%.3f,\"calls\":%" PRIu64 "}", phase_names[p],
+            to_ms(phase_ns_[p].load(std::memory_order_relaxed)),
+            phase_calls_[p].load(std::memory_order_relaxed));
+    }
+
+    out += "},\"counters\":{";
+    for (size_t c = 0; c < static_cast<size_t>(ScanCounter::Count); ++c) {
+        if (c) out += ',';
+        appendf(out, "\"%s\":%" PRIu64, counter_names[c], counters_[c].load(std::memory_order_relaxed));
+    }
+
+    out += "},\"bucket_limits_us\":[";
+    for (size_t b = 0; b < LatencyHistogram::BucketCount; ++b) {
+        if (b) out += ',';
+        appendf(out, "%" PRIu64, LatencyHistogram::bucket_limit_us(b));
+    }
+
+    out += "],\"resolve_latency\":[";
+    bool first = true;
+    for (size_t t = 0; t <= MaxTypeIndex; ++t) {
+        const auto& h = resolve_[t];
+        uint64_t n = h.count();
+        if (n == 0) continue;
+        if (!first) out += ',';
+        first = false;
+        out += "{\"type\":\"";
+        append_json_escaped(out, type_label(t));
+        appendf(out, "\",\"count\":%" PRIu64 ",\"total_ms\":%.3f,\"max_us\":%.1f,\"buckets\":[", n,
+            to_ms(h.total_ns()), static_cast<double>(h.max_ns()) / 1e3);
+        for (size_t b = 0; b < LatencyHistogram::BucketCount; ++b) {
+            if (b) out += ',';
+            appendf(out, "%" PRIu64, h.bucket(b));
+        }
+        out += "]}";
+    }
+    out += "]}";
+    return out;
+}
+
+} // namespace lsofwin
@@ -0,0 +1,183 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace lsofwin {
+
+// Where the time of a scan goes (--stats). Phases run on worker threads are
+// summed over all threads, so with -J they can add up to more than Scan.
+enum class ScanPhase : uint8_t {
+    Scan,           // The whole enumeration, wall clock
+    Snapshot,       // HandleSource::snapshot(): the system handle table
+    Prepare,        // Type table and filter compilation
+    Plan,           // -p / -c, including the process lookups -c needs
+    ProcessInfo,    // Process name and user lookups during the walk
+    AccountLookup,  // Backend part of ProcessInfo: account id to name, once per account
+    Resolve,        // HandleSource::resolve() for handles the object cache missed
+    OpenProcess,    // Backend part of Resolve: opening the owning process
+    Duplicate,      // Backend part of Resolve: DuplicateHandle
+    TypeQuery,      // Backend part of Resolve: NtQueryObject(ObjectTypeInformation)
+    NameQuery,      // Backend part of Resolve: NtQueryObject(ObjectNameInformation) under -t
+    Normalize,      // Backend part of Resolve: name to UTF-8 and NT device path to drive letter
+    Filter,         // -f and +d / +D on resolved names
+    Output,         // Formatting and writing rows
+    Count
+};
+
+enum class ScanCounter : uint8_t {
+    HandlesSeen,        // Entries in the raw table
+    SkippedPlan,        // Dropped by -p / -c before being looked at
+    SkippedType,        // Dropped by -T
+    AccessDenied,       // The process or the handle could not be opened
+    SkippedFile,        // Dropped by -f (including handles without a name)
+    SkippedDir,         // Dropped by +d / +D
+    Rows,               // Result rows
+    CacheHits,          // Handles answered by the object cache
+    TimedOut,           // Name queries that hit the -t timeout
+    HangRiskProbed,     // Name queries given the short probe timeout (hang_guard.h)
+    SkippedDeadline,    // Left unresolved because --deadline had passed
+    NotQueried,         // Rows kept unresolved: -o shows neither their name nor an unknown type
+    SnapshotRetries,    // Handle table queries repeated with a larger buffer
+    BytesWritten,       // Output bytes
+    Count
+};
+
+const char* scan_phase_name(ScanPhase phase);
+const char* scan_counter_name(ScanCounter counter);
+
+// Latency histogram with power-of-two microsecond buckets: bucket 0 holds
+// times under 1 us, bucket b times in [2^(b-1), 2^b) us, and the last
+// bucket everything from 2^(BucketCount-2) us (about 2 s) up. Thread-safe.
+class LatencyHistogram {
+public:
+    static constexpr size_t BucketCount = 24;
+
+    void add(uint64_t ns) {
+        buckets_[bucket_for(ns)].fetch_add(1, std::memory_order_relaxed);
+        total_ns_.fetch_add(ns, std::memory_order_relaxed);
+        uint64_t max = max_ns_.load(std::memory_order_relaxed);
+        while (ns > max && !max_ns_.compare_exchange_weak(max, ns, std::memory_order_relaxed)) {}
+    }
+
+    uint64_t bucket(size_t b) const { return buckets_[b].load(std::memory_order_relaxed); }
+    uint64_t count() const;
+    uint64_t total_ns() const { return total_ns_.load(std::memory_order_relaxed); }
+    uint64_t max_ns() const { return max_ns_.load(std::memory_order_relaxed); }
+
+    // Upper bound of the bucket holding the q-th quantile (0 < q <= 1), in
+    // microseconds; the last bucket reports max_ns(). 0 when empty.
+    uint64_t quantile_us(double q) const;
+
+    static size_t bucket_for(uint64_t ns);
+
+    // Exclusive upper bound of bucket b in microseconds (0 for the last).
+    static uint64_t bucket_limit_us(size_t b);
+
+private:
+    std::array<std::atomic<uint64_t>, BucketCount> buckets_{};
+    std::atomic<uint64_t> total_ns_{ 0 };
+    std::atomic<uint64_t> max_ns_{ 0 };
+};
+
+// Phase timings, counters and per-type resolve latencies for one run. The
+// enumerator and the backends record into it only when one is passed in, so
+// a scan without --stats reads no clocks and touches no counters.
+// Thread-safe; recording is a few relaxed atomic adds.
+class ScanStats {
+public:
+    // Histograms are kept per type index below this; higher indices share one.
+    static constexpr size_t MaxTypeIndex = 256;
+
+    ScanStats();
+
+    void add_time(ScanPhase phase, uint64_t ns) {
+        auto p = static_cast<size_t>(phase);
+        phase_ns_[p].fetch_add(ns, std::memory_order_relaxed);
+        phase_calls_[p].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void add(ScanCounter counter, uint64_t n = 1) {
+        counters_[static_cast<size_t>(counter)].fetch_add(n, std::memory_order_relaxed);
+    }
+
+    // One resolve() of a handle with the given raw type index.
+    void add_resolve(uint16_t type_index, uint64_t ns) {
+        resolve_[(std::min)(static_cast<size_t>(type_index), MaxTypeIndex)].add(ns);
+    }
+
+    // Names for the type indices, used to label the histograms. Called by
+    // the enumerator before the walk; indices without a name print as #N.
+    void set_type_names(const std::vector<std::string>& names);
+
+    uint64_t time_ns(ScanPhase phase) const {
+        return phase_ns_[static_cast<size_t>(phase)].load(std::memory_order_relaxed);
+    }
+    uint64_t calls(ScanPhase phase) const {
+        return phase_calls_[static_cast<size_t>(phase)].load(std::memory_order_relaxed);
+    }
+    uint64_t get(ScanCounter counter) const {
+        return counters_[static_cast<size_t>(counter)].load(std::memory_order_relaxed);
+    }
+
+    // Histogram for a type index (MaxTypeIndex for every higher index).
+    const LatencyHistogram& resolve_latency(size_t type_index) const {
+        return resolve_[(std::min)(type_index, MaxTypeIndex)];
+    }
+
+    // Report for a terminal: phases that ran, non-zero counters and a line
+    // of percentiles per type that was resolved.
+    std::string to_text() const;
+
+    // The same as one JSON object (no trailing newline): "phases" maps each
+    // phase to {"ms", "calls"}, "counters" maps each counter to its value,
+    // and "resolve_latency" lists the types that were resolved with their
+    // bucket counts ("bucket_limits_us" gives the bucket bounds).
+    std::string to_json() const;
+
+private:
+    std::string type_label(size_t index) const;
+
+    std::array<std::atomic<uint64_t>, static_cast<size_t>(ScanPhase::Count)> phase_ns_{};
+    std::array<std::atomic<uint64_t>, static_cast<size_t>(ScanPhase::Count)> phase_calls_{};
+    std::array<std::atomic<uint64_t>, static_cast<size_t>(ScanCounter::Count)> counters_{};
+    std::unique_ptr<LatencyHistogram[]> resolve_;
+    std::vector<std::string> type_names_;
+};
+
+// Adds the time from construction to destruction to a phase. With a null
+// ScanStats it does nothing, not even read the clock.
+class PhaseTimer {
+public:
+    PhaseTimer(ScanStats* stats, ScanPhase phase) : stats_(stats), phase_(phase) {
+        if (stats_) start_ = std::chrono::steady_clock::now();
+    }
+    ~PhaseTimer() { stop(); }
+
+    PhaseTimer(const PhaseTimer&) = delete;
+    PhaseTimer& operator=(const PhaseTimer&) = delete;
+
+    // Record now instead of at destruction; returns the elapsed nanoseconds.
+    uint64_t stop() {
+        if (!stats_) return 0;
+        uint64_t ns = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start_).count());
+        stats_->add_time(phase_, ns);
+        stats_ = nullptr;
+        return ns;
+    }
+
+private:
+    ScanStats* stats_;
+    ScanPhase phase_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+} // namespace lsofwin
@@ -0,0 +1,120 @@
+#include "shard_scheduler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace lsofwin {
+
+std::vector<Shard> plan_shards(const std::vector<RawHandle>& table, size_t max_shard_size) {
+    std::vector<Shard> shards;
+    if (max_shard_size == 0) max_shard_size = 1;
+
+    size_t begin = 0;
+    for (size_t i = 1; i <= table.size(); ++i) {
+        bool pid_changes = i == table.size() || table[i].pid != table[begin].pid;
+        if (pid_changes || i - begin == max_shard_size) {
+            shards.push_back({ begin, i });
+            begin = i;
+        }
+    }
+    return shards;
+}
+
+size_t default_shard_size(size_t table_size, size_t threads) {
+    // Aim for ~8 shards per worker, never below 256 handles per shard
+    size_t target = table_size / ((std::max)(threads, static_cast<size_t>(1)) * 8);
+    return (std::max)(target, static_cast<size_t>(256));
+}
+
+namespace {
+
+// One worker's queue of task indices; the owner pops the front, thieves the back.
+struct TaskDeque {
+    std::mutex mutex;
+    std::deque<size_t> tasks;
+
+    bool pop_front(size_t& task) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (tasks.empty()) return false;
+        task = tasks.front();
+        tasks.pop_front();
+        return true;
+    }
+
+    bool steal_back(size_t& task) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (tasks.empty()) return false;
+        task = tasks.back();
+        tasks.pop_back();
+        return true;
+    }
+};
+
+} // anonymous namespace
+
+void run_work_stealing(size_t task_count, size_t threads,
+    const std::function<void(size_t task, size_t worker)>& fn) {
+    threads = (std::min)(threads, task_count);
+    if (threads <= 1) {
+        for (size_t t = 0; t < task_count; ++t) fn(t, 0);
+        return;
+    }
+
+    // Deal out contiguous blocks so neighbouring shards stay on one thread
+    std::vector<std::unique_ptr<TaskDeque>> deques;
+    for (size_t w = 0; w < threads; ++w) {
+        auto d = std::make_unique<TaskDeque>();
+        size_t first = task_count * w / threads;
+        size_t last = task_count * (w + 1) / threads;
+        for (size_t t = first; t < last; ++t) d->tasks.push_back(t);
+        deques.push_back(std::move(d));
+    }
+
+    // Tasks are never added after start, so once every deque has been seen
+    // empty there is nothing left to steal.
+    auto worker = [&](size_t self) {
+        size_t task;
+        for (;;) {
+            if (deques[self]->pop_front(task)) {
+                fn(task, self);
+                continue;
+            }
+            bool stole = false;
+            for (size_t k = 1; k < threads && !stole; ++k) {
+                stole = deques[(self + k) % threads]->steal_back(task);
+            }
+            if (!stole) return;
+            fn(task, self);
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (size_t w = 1; w < threads; ++w) pool.emplace_back(worker, w);
+    worker(0);
+    for (auto& t : pool) t.join();
+}
+
+void run_in_order(size_t task_count, size_t threads,
+    const std::function<void(size_t task, size_t worker)>& fn) {
+    threads = (std::min)(threads, task_count);
+    if (threads <= 1) {
+        for (size_t t = 0; t < task_count; ++t) fn(t, 0);
+        return;
+    }
+
+    std::atomic<size_t> next{ 0 };
+    auto worker = [&](size_t self) {
+        for (size_t task = next++; task < task_count; task = next++) fn(task, self);
+    };
+
+    std::vector<std::thread> pool;
+    for (size_t w = 1; w < threads; ++w) pool.emplace_back(worker, w);
+    worker(0);
+    for (auto& t : pool) t.join();
+}
+
+} // namespace lsofwin
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "handle_source.h"
+
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+namespace lsofwin {
+
+// A contiguous range [begin, end) of the raw handle table. Shards never span
+// two processes, so concatenating per-shard results in shard order gives
+// exactly the order of a single-threaded walk.
+struct Shard {
+    size_t begin = 0;
+    size_t end = 0;
+};
+
+// Split the table into per-process shards. Runs of more than max_shard_size
+// handles for one process (svchost, chrome, ...) are split further.
+std::vector<Shard> plan_shards(const std::vector<RawHandle>& table, size_t max_shard_size);
+
+// Pick a shard size that gives each of `threads` workers several shards to
+// balance over, without making shards so small that scheduling dominates.
+size_t default_shard_size(size_t table_size, size_t threads);
+
+// Run fn(task, worker) for every task in [0, task_count) on `threads` threads.
+// Each worker starts with a contiguous block of tasks and, once its own deque
+// is empty, steals from the back of the other workers' deques. `worker` is in
+// [0, threads) and can index per-thread state. threads <= 1 runs inline.
+void run_work_stealing(size_t task_count, size_t threads,
+    const std::function<void(size_t task, size_t worker)>& fn);
+
+// Run fn(task, worker) for every task on `threads` threads, handing tasks out
+// strictly in index order from a shared counter. Work always stays close to
+// the lowest unfinished task, so a consumer that needs results in order only
+// buffers what other workers finish while that task is running.
+// threads <= 1 runs inline.
+void run_in_order(size_t task_count, size_t threads,
+    const std::function<void(size_t task, size_t worker)>& fn);
+
+} // namespace lsofwin
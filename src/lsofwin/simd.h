@@ -0,0 +1,33 @@
+#pragma once
+
+// Compile-time SIMD feature detection shared by the vectorized string helpers.
+// SSE2 is baseline on x64 for both MSVC and GCC/Clang; everything else gets
+// the scalar fallbacks.
+
+#include <cstdint>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define LSOFWIN_HAVE_SSE2 1
+#include <emmintrin.h>
+#else
+#define LSOFWIN_HAVE_SSE2 0
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace lsofwin {
+
+// Index of the lowest set bit. mask must be non-zero.
+inline unsigned count_trailing_zeros(uint32_t mask) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return static_cast<unsigned>(index);
+#else
+    return static_cast<unsigned>(__builtin_ctz(mask));
+#endif
+}
+
+} // namespace lsofwin
@@ -0,0 +1,62 @@
+#include "string_pool.h"
+
+#include <functional>
+#include <limits>
+
+namespace lsofwin {
+
+namespace {
+
+constexpr size_t InitialSlots = 1024;
+
+size_t hash_of(std::string_view s) {
+    return std::hash<std::string_view>{}(s);
+}
+
+} // anonymous namespace
+
+StringPool::StringPool() : offsets_{ 0, 0 }, slots_(InitialSlots, NoSlot) {
+    slots_[hash_of(std::string_view()) & (slots_.size() - 1)] = Empty;
+}
+
+uint32_t StringPool::intern(std::string_view s) {
+    size_t mask = slots_.size() - 1;
+    size_t slot = hash_of(s) & mask;
+    while (slots_[slot] != NoSlot) {
+        if (view(slots_[slot]) == s) return slots_[slot];
+        slot = (slot + 1) & mask;
+    }
+
+    // Keep offsets representable; an over-full arena degrades to ""
+    if (bytes_.size() + s.size() > (std::numeric_limits<uint32_t>::max)()) return Empty;
+
+    uint32_t id = static_cast<uint32_t>(size());
+    bytes_.append(s.data(), s.size());
+    offsets_.push_back(static_cast<uint32_t>(bytes_.size()));
+    slots_[slot] = id;
+
+    // Keep the table at most half full
+    if (size() * 2 > slots_.size()) grow();
+    return id;
+}
+
+uint32_t StringPool::find(std::string_view s) const {
+    size_t mask = slots_.size() - 1;
+    for (size_t slot = hash_of(s) & mask; slots_[slot] != NoSlot; slot = (slot + 1) & mask) {
+        if (view(slots_[slot]) == s) return slots_[slot];
+    }
+    return NotFound;
+}
+
+void StringPool::grow() {
+    std::vector<uint32_t> slots(slots_.size() * 2, NoSlot);
+    size_t mask = slots.size() - 1;
+    for (uint32_t id = 0; id < size(); ++id) {
+        size_t slot = hash_of(view(id)) & mask;
+        while (slots[slot] != NoSlot) slot = (slot + 1) & mask;
+        slots[slot] = id;
+    }
+    slots_.swap(slots);
+}
+
+} // namespace lsofwin
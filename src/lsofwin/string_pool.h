@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace lsofwin {
+
+// Deduplicating string arena. Each distinct string is stored once, back to
+// back in one byte buffer, and is named by a dense uint32_t id; id 0 is
+// always the empty string. Lookups hash the probe string directly against the
+// arena, so interning a string that is already present never allocates.
+class StringPool {
+public:
+    static constexpr uint32_t Empty = 0;
+    static constexpr uint32_t NotFound = 0xffffffffu;
+
+    StringPool();
+
+    // Id of s, adding it if it is new. The arena is limited to 4 GiB; a
+    // string that would not fit is interned as the empty string.
+    uint32_t intern(std::string_view s);
+
+    // Id of s if it has been interned, else NotFound. Never adds s.
+    uint32_t find(std::string_view s) const;
+
+    std::string_view view(uint32_t id) const {
+        return std::string_view(bytes_.data() + offsets_[id], offsets_[id + 1] - offsets_[id]);
+    }
+
+    // Number of distinct strings, including the empty string.
+    size_t size() const { return offsets_.size() - 1; }
+
+    // String i occupies bytes()[offsets()[i], offsets()[i + 1]).
+    const std::vector<uint32_t>& offsets() const { return offsets_; }
+    const std::string& bytes() const { return bytes_; }
+
+    // Heap bytes held by the arena and its index.
+    size_t memory_bytes() const {
+        return bytes_.capacity() + offsets_.capacity() * sizeof(uint32_t) +
+            slots_.capacity() * sizeof(uint32_t);
+    }
+
+private:
+    static constexpr uint32_t NoSlot = 0xffffffffu;
+
+    void grow();
+
+    std::string bytes_;
+    std::vector<uint32_t> offsets_;
+    std::vector<uint32_t> slots_;   // Open-addressing table of ids
+};
+
+} // namespace lsofwin
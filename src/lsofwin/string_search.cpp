@@ -0,0 +1,62 @@
+#include "string_search.h"
+#include "simd.h"
+
+namespace lsofwin {
+
+bool equals_icase(std::string_view text, std::string_view lower) {
+    if (text.size() != lower.size()) return false;
+    for (size_t i = 0; i < text.size(); ++i) {
+        if (ascii_lower(static_cast<unsigned char>(text[i])) != static_cast<unsigned char>(lower[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool starts_with_icase(std::string_view text, std::string_view lower_prefix) {
+    return text.size() >= lower_prefix.size() &&
+        equals_icase(text.substr(0, lower_prefix.size()), lower_prefix);
+}
+
+bool ends_with_icase(std::string_view text, std::string_view lower_suffix) {
+    return text.size() >= lower_suffix.size() &&
+        equals_icase(text.substr(text.size() - lower_suffix.size()), lower_suffix);
+}
+
+bool contains_icase(std::string_view haystack, std::string_view lower_needle) {
+    const size_t n = lower_needle.size();
+    if (n == 0) return true;
+    if (haystack.size() < n) return false;
+
+    size_t i = 0;
+#if LSOFWIN_HAVE_SSE2
+    const unsigned char first = static_cast<unsigned char>(lower_needle[0]);
+    const unsigned char last = static_cast<unsigned char>(lower_needle[n - 1]);
+    const __m128i first_lo = _mm_set1_epi8(static_cast<char>(first));
+    const __m128i first_up = _mm_set1_epi8(static_cast<char>(ascii_upper(first)));
+    const __m128i last_lo = _mm_set1_epi8(static_cast<char>(last));
+    const __m128i last_up = _mm_set1_epi8(static_cast<char>(ascii_upper(last)));
+    const std::string_view middle = n > 2 ? lower_needle.substr(1, n - 2) : std::string_view();
+
+    for (; i + n - 1 + 16 <= haystack.size(); i += 16) {
+        __m128i block_first = _mm_loadu_si128(reinterpret_cast<const __m128i*>(haystack.data() + i));
+        __m128i block_last = _mm_loadu_si128(reinterpret_cast<const __m128i*>(haystack.data() + i + n - 1));
+        __m128i eq_first = _mm_or_si128(_mm_cmpeq_epi8(block_first, first_lo), _mm_cmpeq_epi8(block_first, first_up));
+        __m128i eq_last = _mm_or_si128(_mm_cmpeq_epi8(block_last, last_lo), _mm_cmpeq_epi8(block_last, last_up));
+        uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(_mm_and_si128(eq_first, eq_last)));
+
+        while (mask) {
+            size_t pos = i + count_trailing_zeros(mask);
+            if (n <= 2 || equals_icase(haystack.substr(pos + 1, n - 2), middle)) return true;
+            mask &= mask - 1;
+        }
+    }
+#endif
+
+    for (; i + n <= haystack.size(); ++i) {
+        if (equals_icase(haystack.substr(i, n), lower_needle)) return true;
+    }
+    return false;
+}
+
+} // namespace lsofwin
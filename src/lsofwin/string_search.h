@@ -0,0 +1,27 @@
+#pragma once
+
+#include <string_view>
+
+namespace lsofwin {
+
+// ASCII case folding, matching std::regex::icase in the "C" locale.
+inline unsigned char ascii_lower(unsigned char c) {
+    return (static_cast<unsigned char>(c - 'A') < 26u) ? static_cast<unsigned char>(c | 0x20) : c;
+}
+
+inline unsigned char ascii_upper(unsigned char c) {
+    return (static_cast<unsigned char>(c - 'a') < 26u) ? static_cast<unsigned char>(c & ~0x20) : c;
+}
+
+// ASCII case-insensitive comparisons. The needle / prefix / suffix must
+// already be lowercase; the haystack may be in any case.
+bool equals_icase(std::string_view text, std::string_view lower);
+bool starts_with_icase(std::string_view text, std::string_view lower_prefix);
+bool ends_with_icase(std::string_view text, std::string_view lower_suffix);
+
+// Substring search, vectorized with SSE2 where available: candidate
+// positions are found by comparing the needle's first and last bytes against
+// 16 haystack positions at once, then verified.
+bool contains_icase(std::string_view haystack, std::string_view lower_needle);
+
+} // namespace lsofwin
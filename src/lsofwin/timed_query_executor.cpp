@@ -0,0 +1,134 @@
+#include "timed_query_executor.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+
+enum class JobState { Queued, Running, Done };
+
+struct WorkerState {
+    bool abandoned = false;
+};
+
+struct Job {
+    lsofwin::TimedQueryExecutor::Query fn;
+    JobState state = JobState::Queued;
+    std::shared_ptr<WorkerState> worker;
+    std::condition_variable done_cv;
+};
+
+} // anonymous namespace
+
+namespace lsofwin {
+
+// State shared between the executor and its workers. Workers hold a reference,
+// so an abandoned worker that eventually returns never touches freed memory.
+struct TimedQueryExecutor::Shared {
+    struct Worker {
+        std::thread thread;
+        std::shared_ptr<WorkerState> state;
+    };
+
+    std::mutex mutex;
+    std::condition_variable work_cv;
+    std::deque<std::shared_ptr<Job>> queue;
+    std::vector<Worker> workers;
+    bool stopping = false;
+    Stats stats;
+
+    // Caller must hold shared->mutex.
+    static void start_worker(const std::shared_ptr<Shared>& shared) {
+        auto state = std::make_shared<WorkerState>();
+        shared->workers.push_back({ std::thread(worker_loop, shared, state), state });
+        ++shared->stats.workers_started;
+    }
+
+    static void worker_loop(std::shared_ptr<Shared> shared, std::shared_ptr<WorkerState> self) {
+        std::unique_lock<std::mutex> lock(shared->mutex);
+        for (;;) {
+            shared->work_cv.wait(lock, [&]() { return shared->stopping || !shared->queue.empty(); });
+            if (shared->queue.empty()) return; // stopping and drained
+
+            auto job = std::move(shared->queue.front());
+            shared->queue.pop_front();
+            job->state = JobState::Running;
+            job->worker = self;
+
+            lock.unlock();
+            job->fn();
+            lock.lock();
+
+            job->state = JobState::Done;
+            job->done_cv.notify_all();
+
+            // A replacement already took our place while we were stuck
+            if (self->abandoned) return;
+        }
+    }
+};
+
+TimedQueryExecutor::TimedQueryExecutor(size_t worker_count)
+    : shared_(std::make_shared<Shared>()) {
+    std::lock_guard<std::mutex> lock(shared_->mutex);
+    for (size_t i = 0; i < (std::max)(worker_count, static_cast<size_t>(1)); ++i) {
+        Shared::start_worker(shared_);
+    }
+}
+
+TimedQueryExecutor::~TimedQueryExecutor() {
+    std::vector<Shared::Worker> workers;
+    {
+        std::lock_guard<std::mutex> lock(shared_->mutex);
+        shared_->stopping = true;
+        workers.swap(shared_->workers);
+    }
+    shared_->work_cv.notify_all();
+    for (auto& w : workers) w.thread.join();
+}
+
+bool TimedQueryExecutor::run(Query query, std::chrono::milliseconds timeout) {
+    auto job = std::make_shared<Job>();
+    job->fn = std::move(query);
+
+    std::unique_lock<std::mutex> lock(shared_->mutex);
+    shared_->queue.push_back(job);
+    shared_->work_cv.notify_one();
+
+    if (job->done_cv.wait_for(lock, timeout, [&]() { return job->state == JobState::Done; })) {
+        ++shared_->stats.completed;
+        return true;
+    }
+
+    ++shared_->stats.timed_out;
+    if (job->state == JobState::Queued) {
+        // Never picked up (all workers busy) — just withdraw it
+        auto& q = shared_->queue;
+        q.erase(std::remove(q.begin(), q.end(), job), q.end());
+        return false;
+    }
+
+    // The query is stuck on a worker: leave that thread behind and replace it
+    auto& workers = shared_->workers;
+    auto it = std::find_if(workers.begin(), workers.end(),
+        [&](const Shared::Worker& w) { return w.state == job->worker; });
+    if (it != workers.end()) {
+        it->state->abandoned = true;
+        it->thread.detach();
+        workers.erase(it);
+        ++shared_->stats.workers_abandoned;
+        Shared::start_worker(shared_);
+    }
+    return false;
+}
+
+TimedQueryExecutor::Stats TimedQueryExecutor::stats() const {
+    std::lock_guard<std::mutex> lock(shared_->mutex);
+    return shared_->stats;
+}
+
+} // namespace lsofwin
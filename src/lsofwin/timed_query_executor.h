@@ -0,0 +1,46 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+namespace lsofwin {
+
+// Runs potentially blocking queries (e.g. NtQueryObject on a synchronous pipe)
+// on a small set of long-lived worker threads with a per-call deadline.
+//
+// A query that misses its deadline is not killed: the worker running it is
+// abandoned (detached) and a fresh worker takes its place, so a scan pays for
+// a new thread only when a query actually hangs. The callable is kept alive
+// until it returns, so anything it captures by value (such as a shared_ptr to
+// its output buffer) remains valid even after the caller has given up on it.
+class TimedQueryExecutor {
+public:
+    using Query = std::function<void()>;
+
+    struct Stats {
+        uint64_t completed = 0;         // Queries that finished before their deadline
+        uint64_t timed_out = 0;         // Queries that missed their deadline
+        uint64_t workers_started = 0;   // Includes replacements for hung workers
+        uint64_t workers_abandoned = 0; // Workers left behind on a hung query
+    };
+
+    explicit TimedQueryExecutor(size_t worker_count = 1);
+    ~TimedQueryExecutor();
+
+    TimedQueryExecutor(const TimedQueryExecutor&) = delete;
+    TimedQueryExecutor& operator=(const TimedQueryExecutor&) = delete;
+
+    // Run `query` on a worker and wait up to `timeout` for it to finish.
+    // Returns true if it completed in time. Safe to call from several threads.
+    bool run(Query query, std::chrono::milliseconds timeout);
+
+    Stats stats() const;
+
+private:
+    struct Shared;
+    std::shared_ptr<Shared> shared_;
+};
+
+} // namespace lsofwin
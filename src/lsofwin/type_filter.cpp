@@ -0,0 +1,49 @@
+#include "type_filter.h"
+
+#include <algorithm>
+#include <cctype>
+
+namespace lsofwin {
+
+namespace {
+
+std::string to_lower(std::string s) {
+    std::transform(s.begin(), s.end(), s.begin(),
+        [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return s;
+}
+
+} // anonymous namespace
+
+TypeFilter::TypeFilter(const std::vector<std::string>& types,
+    const std::vector<std::string>& type_names)
+    : active_(!types.empty()) {
+    for (const auto& t : types) types_lower_.push_back(to_lower(t));
+
+    decisions_.resize(type_names.size(), static_cast<uint8_t>(Decision::Unknown));
+    for (size_t i = 0; i < type_names.size(); ++i) {
+        if (type_names[i].empty()) continue;
+        decisions_[i] = static_cast<uint8_t>(
+            matches_name(type_names[i]) ? Decision::Match : Decision::Reject);
+    }
+}
+
+bool TypeFilter::matches_name(const std::string& type_name) const {
+    if (!active_) return true;
+    std::string lower = to_lower(type_name);
+    return std::find(types_lower_.begin(), types_lower_.end(), lower) != types_lower_.end();
+}
+
+std::vector<std::string> split_list(const std::string& value) {
+    std::vector<std::string> items;
+    size_t start = 0;
+    while (start <= value.size()) {
+        size_t comma = value.find(',', start);
+        if (comma == std::string::npos) comma = value.size();
+        if (comma > start) items.push_back(value.substr(start, comma - start));
+        start = comma + 1;
+    }
+    return items;
+}
+
+} // namespace lsofwin
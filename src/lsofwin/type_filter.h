@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace lsofwin {
+
+// The -T filter compiled against a backend's type_index -> name table, so
+// entries can be accepted or dropped from the raw table entry alone, before
+// any handle is opened or queried.
+class TypeFilter {
+public:
+    enum class Decision {
+        Match,   // Type index is known and selected
+        Reject,  // Type index is known and not selected
+        Unknown, // Index missing from the table; resolve and use matches_name()
+    };
+
+    TypeFilter() = default;
+
+    // types: the -T names (case-insensitive). type_names: index -> name, with
+    // empty strings for indices the backend could not name up front.
+    TypeFilter(const std::vector<std::string>& types, const std::vector<std::string>& type_names);
+
+    // True if a -T filter was given.
+    bool active() const { return active_; }
+
+    Decision check(uint16_t type_index) const {
+        if (!active_) return Decision::Match;
+        if (type_index >= decisions_.size()) return Decision::Unknown;
+        return static_cast<Decision>(decisions_[type_index]);
+    }
+
+    // Fallback for Unknown indices once the type name has been resolved.
+    bool matches_name(const std::string& type_name) const;
+
+private:
+    bool active_ = false;
+    std::vector<std::string> types_lower_;
+    std::vector<uint8_t> decisions_;
+};
+
+// Split a comma-separated option value, dropping empty items.
+std::vector<std::string> split_list(const std::string& value);
+
+} // namespace lsofwin
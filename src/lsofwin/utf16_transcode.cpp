@@ -0,0 +1,123 @@
+#include "utf16_transcode.h"
+#include "simd.h"
+
+namespace lsofwin {
+
+namespace {
+
+bool is_high_surrogate(char16_t c) { return c >= 0xD800 && c <= 0xDBFF; }
+bool is_low_surrogate(char16_t c) { return c >= 0xDC00 && c <= 0xDFFF; }
+bool is_surrogate(char16_t c) { return c >= 0xD800 && c <= 0xDFFF; }
+
+#if LSOFWIN_HAVE_SSE2
+// Bit per byte of the 16 code units at p that are not ASCII (zero if all are).
+uint32_t non_ascii_mask(const char16_t* p) {
+    const __m128i high = _mm_set1_epi16(static_cast<short>(0xFF80));
+    const __m128i zero = _mm_setzero_si128();
+    __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 8));
+    __m128i ascii = _mm_packs_epi16(_mm_cmpeq_epi16(_mm_and_si128(a, high), zero),
+        _mm_cmpeq_epi16(_mm_and_si128(b, high), zero));
+    return ~static_cast<uint32_t>(_mm_movemask_epi8(ascii)) & 0xFFFF;
+}
+#endif
+
+// UTF-8 length of the code point at p; advances p past it.
+size_t scalar_length(const char16_t*& p, const char16_t* end) {
+    char16_t c = *p++;
+    if (c < 0x80) return 1;
+    if (c < 0x800) return 2;
+    if (is_high_surrogate(c) && p < end && is_low_surrogate(*p)) {
+        ++p;
+        return 4;
+    }
+    return 3; // Includes U+FFFD for an unpaired surrogate
+}
+
+// Encode the code point at p; advances p past it and returns the new output end.
+char* scalar_encode(const char16_t*& p, const char16_t* end, char* out) {
+    char32_t c = *p++;
+    if (c < 0x80) {
+        *out++ = static_cast<char>(c);
+        return out;
+    }
+    if (c < 0x800) {
+        *out++ = static_cast<char>(0xC0 | (c >> 6));
+        *out++ = static_cast<char>(0x80 | (c & 0x3F));
+        return out;
+    }
+    if (is_surrogate(static_cast<char16_t>(c))) {
+        if (is_high_surrogate(static_cast<char16_t>(c)) && p < end && is_low_surrogate(*p)) {
+            c = 0x10000 + ((c - 0xD800) << 10) + (*p++ - 0xDC00);
+            *out++ = static_cast<char>(0xF0 | (c >> 18));
+            *out++ = static_cast<char>(0x80 | ((c >> 12) & 0x3F));
+            *out++ = static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+            *out++ = static_cast<char>(0x80 | (c & 0x3F));
+            return out;
+        }
+        c = 0xFFFD;
+    }
+    *out++ = static_cast<char>(0xE0 | (c >> 12));
+    *out++ = static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+    *out++ = static_cast<char>(0x80 | (c & 0x3F));
+    return out;
+}
+
+} // anonymous namespace
+
+// Both loops take 16 code units at a time: an all-ASCII block in one step,
+// any other block one code point at a time (a surrogate pair may run one
+// unit past the block).
+
+size_t utf8_length(std::u16string_view s) {
+    const char16_t* p = s.data();
+    const char16_t* end = p + s.size();
+    size_t bytes = 0;
+    while (p < end) {
+        const char16_t* block_end = end;
+#if LSOFWIN_HAVE_SSE2
+        if (end - p >= 16) {
+            if (non_ascii_mask(p) == 0) {
+                bytes += 16;
+                p += 16;
+                continue;
+            }
+            block_end = p + 16;
+        }
+#endif
+        while (p < block_end) bytes += scalar_length(p, end);
+    }
+    return bytes;
+}
+
+char* utf16_to_utf8(std::u16string_view s, char* out) {
+    const char16_t* p = s.data();
+    const char16_t* end = p + s.size();
+    while (p < end) {
+        const char16_t* block_end = end;
+#if LSOFWIN_HAVE_SSE2
+        if (end - p >= 16) {
+            if (non_ascii_mask(p) == 0) {
+                // Narrow the block with one pack and one store
+                __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+                __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 8));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_packus_epi16(a, b));
+                out += 16;
+                p += 16;
+                continue;
+            }
+            block_end = p + 16;
+        }
+#endif
+        while (p < block_end) out = scalar_encode(p, end, out);
+    }
+    return out;
+}
+
+void append_utf8(std::string& out, std::u16string_view s) {
+    size_t old_size = out.size();
+    out.resize(old_size + utf8_length(s));
+    utf16_to_utf8(s, &out[0] + old_size);
+}
+
+} // namespace lsofwin
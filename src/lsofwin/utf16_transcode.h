@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace lsofwin {
+
+// UTF-16 -> UTF-8 for object names, which the kernel hands back as UTF-16.
+// Runs of ASCII (nearly every path) are converted 16 code units per step
+// with SSE2 where available; everything else takes a scalar path. Unpaired
+// surrogates become U+FFFD, as WideCharToMultiByte(CP_UTF8) does without
+// WC_ERR_INVALID_CHARS.
+
+// Number of bytes utf16_to_utf8() writes for s.
+size_t utf8_length(std::u16string_view s);
+
+// Write s as UTF-8 starting at out, which must have room for utf8_length(s)
+// bytes (3 * s.size() is always enough). Returns the end of the output.
+char* utf16_to_utf8(std::u16string_view s, char* out);
+
+// Append s to out as UTF-8, growing out exactly once.
+void append_utf8(std::string& out, std::u16string_view s);
+
+} // namespace lsofwin
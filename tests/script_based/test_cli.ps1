@@ -100,3 +100,10 @@ function Test-ZeroTimeoutError {
     $passed = ($r.ExitCode -ne 0) -and ($r.OutputString -match "Invalid timeout")
     @{ Passed = $passed; Message = "Expected error for timeout of 0" }
 }
+
+function Test-InvalidThreadCountError {
+    param([string]$LsofwinPath)
+    $r = Invoke-Lsofwin -LsofwinPath $LsofwinPath -Arguments @("-J", "abc") -CaptureStderr
+    $passed = ($r.ExitCode -ne 0) -and ($r.OutputString -match "Invalid thread count")
+    @{ Passed = $passed; Message = "Expected error for thread count 'abc'" }
+}
@@ -75,3 +75,21 @@ function Test-LargerTimeoutStillWorks {
     $passed = ($r.ExitCode -eq 0) -and ($r.OutputString.Length -gt 0)
     @{ Passed = $passed; Message = "Expected successful run with -t 10" }
 }
+
+function Test-TypeFilterReturnsOnlyThatType {
+    param([string]$LsofwinPath)
+    $r = Invoke-Lsofwin -LsofwinPath $LsofwinPath -Arguments @("-p", "$PID", "-t", "2", "-j", "-T", "File")
+    try {
+        $entries = @($r.OutputString | ConvertFrom-Json)
+    } catch {
+        @{ Passed = $false; Message = "JSON parse error" }
+        return
+    }
+    if ($entries.Count -eq 0) {
+        @{ Passed = $false; Message = "Expected File handles for PID $PID" }
+        return
+    }
+    $other = @($entries | Where-Object { $_.type -ne "File" })
+    $passed = $other.Count -eq 0
+    @{ Passed = $passed; Message = "$($other.Count) entries were not of type File" }
+}
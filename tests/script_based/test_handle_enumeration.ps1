@@ -96,3 +96,19 @@ function Test-UserMatchesWhoami {
     $passed = $firstUser -ieq $expectedUser
     @{ Passed = $passed; Message = "Expected user '$expectedUser', got '$firstUser'" }
 }
+
+function Test-ParallelScanMatchesSerial {
+    param([string]$LsofwinPath)
+    $serial = Invoke-Lsofwin -LsofwinPath $LsofwinPath -Arguments @("-p", "$PID", "-t", "2", "-j") -SuppressOutput
+    $parallel = Invoke-Lsofwin -LsofwinPath $LsofwinPath -Arguments @("-p", "$PID", "-t", "2", "-j", "-J", "4") -SuppressOutput
+    try {
+        $a = @($serial.OutputString | ConvertFrom-Json)
+        $b = @($parallel.OutputString | ConvertFrom-Json)
+    } catch {
+        @{ Passed = $false; Message = "Failed to parse JSON" }
+        return
+    }
+    # Handles can open/close between runs, so only require similar row counts
+    $passed = ($b.Count -gt 0) -and ([math]::Abs($a.Count - $b.Count) -lt 50)
+    @{ Passed = $passed; Message = "Serial returned $($a.Count) rows, -J 4 returned $($b.Count)" }
+}
@@ -110,3 +110,18 @@ function Test-JsonFilteredByRegex {
     $passed = $nonMatching.Count -eq 0
     @{ Passed = $passed; Message = "Found $($nonMatching.Count) entries not matching 'REGISTRY' filter" }
 }
+
+function Test-NdjsonLinesMatchJsonArray {
+    param([string]$LsofwinPath)
+    $array = Invoke-Lsofwin -LsofwinPath $LsofwinPath -Arguments @("-p", "$PID", "-t", "2", "-j") -SuppressOutput
+    $lines = Invoke-Lsofwin -LsofwinPath $LsofwinPath -Arguments @("-p", "$PID", "-t", "2", "--ndjson") -SuppressOutput
+    try {
+        $expected = @($array.OutputString | ConvertFrom-Json)
+        $entries = @($lines.OutputString -split "`r?`n" | Where-Object { $_ } | ForEach-Object { $_ | ConvertFrom-Json })
+    } catch {
+        @{ Passed = $false; Message = "NDJSON line is not valid JSON: $_" }
+        return
+    }
+    $passed = $entries.Count -eq $expected.Count
+    @{ Passed = $passed; Message = "Expected $($expected.Count) NDJSON lines, got $($entries.Count)" }
+}
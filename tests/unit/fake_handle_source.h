@@ -0,0 +1,108 @@
+#pragma once
+
+#include "handle_source.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <set>
+#include <thread>
+
+namespace lsofwin_test {
+
+// Synthetic HandleSource: a fixed table with per-row type/name and a
+// PID -> ProcessInfo map. Counts backend calls so tests can assert on them.
+// Safe for the concurrent process_info()/resolve() calls made under -J.
+class FakeHandleSource : public lsofwin::HandleSource {
+public:
+    struct Row {
+        lsofwin::RawHandle raw;
+        std::string type;
+        std::string name;
+        bool accessible = true;
+        bool timed_out = false;
+        uint32_t delay_ms = 0;      // resolve() takes this long; past its timeout it times out
+    };
+
+    void add_process(uint32_t pid, const std::string& name, const std::string& user) {
+        processes[pid] = lsofwin::ProcessInfo{ name, user };
+    }
+
+    void add_handle(uint32_t pid, uintptr_t value, const std::string& type,
+        const std::string& name, uint16_t type_index = 0, uintptr_t object = 0) {
+        Row row;
+        row.raw.pid = pid;
+        row.raw.handle_value = value;
+        row.raw.type_index = type_index;
+        row.raw.object = object;
+        row.type = type;
+        row.name = name;
+        rows.push_back(row);
+    }
+
+    bool snapshot(std::vector<lsofwin::RawHandle>& table) override {
+        ++snapshot_calls;
+        table.clear();
+        for (const auto& r : rows) table.push_back(r.raw);
+        return true;
+    }
+
+    void set_stats(lsofwin::ScanStats* s) override {
+        stats = s;
+    }
+
+    std::vector<std::string> type_names() override {
+        return types_by_index;
+    }
+
+    bool is_process_accessible(uint32_t pid) override {
+        return inaccessible_pids.count(pid) == 0;
+    }
+
+    lsofwin::ProcessInfo process_info(uint32_t pid) override {
+        ++process_info_calls;
+        auto it = processes.find(pid);
+        return it != processes.end() ? it->second : lsofwin::ProcessInfo{};
+    }
+
+    std::string process_name(uint32_t pid) override {
+        ++process_name_calls;
+        auto it = processes.find(pid);
+        return it != processes.end() ? it->second.name : std::string();
+    }
+
+    uint64_t process_start_time(uint32_t pid) override {
+        auto it = start_times.find(pid);
+        return it != start_times.end() ? it->second : 0;
+    }
+
+    bool resolve(const lsofwin::RawHandle& /*entry*/, size_t index, uint32_t timeout_ms,
+        lsofwin::ResolvedHandle& out) override {
+        ++resolve_calls;
+        last_timeout_ms = timeout_ms;
+        const auto& r = rows.at(index);
+        if (!r.accessible) return false;
+        if (r.delay_ms > 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds((std::min)(r.delay_ms, timeout_ms)));
+        }
+        out.type = r.type;
+        out.timed_out = r.timed_out || r.delay_ms > timeout_ms;
+        out.name = out.timed_out ? std::string() : r.name;
+        return true;
+    }
+
+    std::vector<Row> rows;
+    std::vector<std::string> types_by_index;
+    std::set<uint32_t> inaccessible_pids;
+    std::map<uint32_t, lsofwin::ProcessInfo> processes;
+    std::map<uint32_t, uint64_t> start_times;
+    lsofwin::ScanStats* stats = nullptr;    // Last set_stats() argument
+    std::atomic<int> snapshot_calls{ 0 };
+    std::atomic<int> process_info_calls{ 0 };
+    std::atomic<int> process_name_calls{ 0 };   // Lookups without the owner
+    std::atomic<int> resolve_calls{ 0 };
+    std::atomic<uint32_t> last_timeout_ms{ 0 }; // Timeout passed to the last resolve()
+};
+
+} // namespace lsofwin_test
@@ -0,0 +1,80 @@
+#include "test_framework.h"
+#include "account_cache.h"
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+using lsofwin::AccountCache;
+using lsofwin::format_sid;
+
+namespace {
+
+std::string bytes(std::initializer_list<unsigned char> b) {
+    return std::string(b.begin(), b.end());
+}
+
+} // anonymous namespace
+
+TEST(account_cache_resolves_each_account_once) {
+    std::vector<std::string> asked;
+    AccountCache cache([&](std::string_view id) {
+        asked.emplace_back(id);
+        return "user:" + std::string(id);
+    });
+
+    for (int i = 0; i < 1000; ++i) {
+        CHECK_EQ(cache.name(i % 3 == 0 ? "alice" : "bob"), std::string(i % 3 == 0 ? "user:alice" : "user:bob"));
+    }
+    CHECK_EQ(asked.size(), static_cast<size_t>(2));
+    CHECK_EQ(cache.stats().lookups, static_cast<uint64_t>(1000));
+    CHECK_EQ(cache.stats().resolved, static_cast<uint64_t>(2));
+
+    // Binary ids with embedded NULs are distinct keys
+    CHECK_EQ(cache.name(std::string("a\0b", 3)), std::string("user:a\0b", 8));
+    CHECK_EQ(cache.name(std::string("a\0c", 3)), std::string("user:a\0c", 8));
+    CHECK_EQ(asked.size(), static_cast<size_t>(4));
+}
+
+TEST(account_cache_waits_for_a_lookup_in_flight) {
+    std::atomic<int> calls{ 0 };
+    AccountCache cache([&](std::string_view id) {
+        ++calls;
+        // A slow domain controller: every thread arrives while this runs
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        return std::string(id) + "-name";
+    });
+
+    std::vector<std::thread> threads;
+    std::atomic<int> wrong{ 0 };
+    for (int t = 0; t < 8; ++t) {
+        threads.emplace_back([&, t]() {
+            std::string id = t % 2 ? "S-odd" : "S-even";
+            if (cache.name(id) != id + "-name") ++wrong;
+        });
+    }
+    for (auto& th : threads) th.join();
+
+    CHECK_EQ(calls.load(), 2);
+    CHECK_EQ(wrong.load(), 0);
+    CHECK_EQ(cache.stats().lookups, static_cast<uint64_t>(8));
+}
+
+TEST(format_sid_matches_the_string_form) {
+    CHECK_EQ(format_sid(bytes({ 1, 1, 0, 0, 0, 0, 0, 5, 18, 0, 0, 0 })), std::string("S-1-5-18"));
+    CHECK_EQ(format_sid(bytes({ 1, 0, 0, 0, 0, 0, 0, 1 })), std::string("S-1-1"));
+    // S-1-5-21-3623811015-3361044348-30300820-1013
+    CHECK_EQ(format_sid(bytes({ 1, 5, 0, 0, 0, 0, 0, 5,
+        21, 0, 0, 0, 0xC7, 0xF7, 0xFE, 0xD7, 0x7C, 0x77, 0x55, 0xC8, 0x94, 0x5A, 0xCE, 0x01, 0xF5, 0x03, 0, 0 })),
+        std::string("S-1-5-21-3623811015-3361044348-30300820-1013"));
+    CHECK_EQ(format_sid(bytes({ 1, 0, 0x12, 0x34, 0x56, 0x78, 0x9A, 0xBC })), std::string("S-1-0x123456789ABC"));
+}
+
+TEST(format_sid_rejects_malformed_input) {
+    CHECK_EQ(format_sid(""), std::string());
+    CHECK_EQ(format_sid(bytes({ 1, 1, 0, 0, 0, 0, 0, 5 })), std::string());             // Sub-authority missing
+    CHECK_EQ(format_sid(bytes({ 2, 0, 0, 0, 0, 0, 0, 5 })), std::string());             // Unknown revision
+    CHECK_EQ(format_sid(bytes({ 1, 0, 0, 0, 0, 0, 0, 5, 18, 0, 0, 0 })), std::string()); // Trailing bytes
+}
@@ -0,0 +1,154 @@
+#include "test_framework.h"
+#include "binary_output.h"
+#include "output_formatter.h"
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using lsofwin::BinaryResultReader;
+using lsofwin::HandleInfo;
+using lsofwin::HandleList;
+
+namespace {
+
+HandleInfo make_row(uint32_t pid, const std::string& cmd, const std::string& type,
+    const std::string& name, uintptr_t value) {
+    HandleInfo h;
+    h.pid = pid;
+    h.process_name = cmd;
+    h.user = "HOST\\user";
+    h.handle_type = type;
+    h.object_name = name;
+    h.handle_value = value;
+    return h;
+}
+
+HandleList sample_rows() {
+    return {
+        make_row(4, "System", "File", "C:\\Windows\\System32\\config\\SYSTEM", 0x4),
+        make_row(4, "System", "Key", "\\REGISTRY\\MACHINE\\SYSTEM", 0x8),
+        make_row(1200, "notepad.exe", "File", "C:\\Windows\\System32\\en-US\\notepad.exe.mui", 0x40),
+        make_row(1200, "notepad.exe", "File", "C:\\Users\\Eve\\\"quoted\".txt", 0x44),
+        make_row(1200, "notepad.exe", "Event", "", 0x48),
+        make_row(1300, "no-separator", "Section", "Global", 0xfffffffcu),
+    };
+}
+
+HandleList decode(const std::string& bytes) {
+    BinaryResultReader reader;
+    std::string error;
+    CHECK(reader.open(bytes.data(), bytes.size(), error));
+    HandleList rows(reader.row_count());
+    for (size_t i = 0; i < rows.size(); ++i) reader.row(i, rows[i]);
+    return rows;
+}
+
+} // anonymous namespace
+
+TEST(binary_output_round_trips_rows) {
+    auto rows = sample_rows();
+    auto decoded = decode(lsofwin::format_binary(rows));
+    CHECK_EQ(decoded.size(), rows.size());
+    for (size_t i = 0; i < rows.size(); ++i) {
+        CHECK_EQ(decoded[i].pid, rows[i].pid);
+        CHECK_EQ(decoded[i].process_name, rows[i].process_name);
+        CHECK_EQ(decoded[i].user, rows[i].user);
+        CHECK_EQ(decoded[i].handle_type, rows[i].handle_type);
+        CHECK_EQ(decoded[i].object_name, rows[i].object_name);
+        CHECK_EQ(decoded[i].handle_value, rows[i].handle_value);
+    }
+    CHECK_EQ(lsofwin::format_json(decoded), lsofwin::format_json(rows));
+}
+
+TEST(binary_output_stores_shared_strings_once) {
+    auto rows = sample_rows();
+    auto bytes = lsofwin::format_binary(rows);
+    BinaryResultReader reader;
+    std::string error;
+    CHECK(reader.open(bytes.data(), bytes.size(), error));
+    CHECK_EQ(reader.process_count(), static_cast<uint64_t>(3));
+    CHECK_EQ(reader.type_count(), static_cast<uint64_t>(4));
+    CHECK_EQ(reader.name_prefix(0), std::string_view("C:\\Windows\\System32\\config\\"));
+    CHECK_EQ(reader.name_leaf(0), std::string_view("SYSTEM"));
+    CHECK_EQ(reader.name_prefix(5), std::string_view());
+
+    // "SYSTEM" is both a leaf and part of no other string; "File" is one type entry
+    size_t system_count = 0;
+    for (uint64_t id = 0; id < reader.string_count(); ++id) {
+        if (reader.string(id) == "SYSTEM") ++system_count;
+    }
+    CHECK_EQ(system_count, static_cast<size_t>(1));
+
+    // Sections are 8-byte aligned so a mapped file can be read in place
+    lsofwin::BinaryHeader header;
+    std::memcpy(&header, bytes.data(), sizeof(header));
+    for (const auto& s : header.sections) CHECK_EQ(s.offset % 8, static_cast<uint64_t>(0));
+
+    // Row columns are only as wide as their largest value
+    auto width = [&](lsofwin::BinarySection s) { return header.sections[static_cast<size_t>(s)].width; };
+    CHECK_EQ(width(lsofwin::BinarySection::RowProcess), static_cast<uint32_t>(1));
+    CHECK_EQ(width(lsofwin::BinarySection::RowName), static_cast<uint32_t>(1));
+    CHECK_EQ(width(lsofwin::BinarySection::RowHandle), static_cast<uint32_t>(4));
+}
+
+TEST(binary_output_empty_result_is_valid) {
+    auto bytes = lsofwin::format_binary({});
+    CHECK(decode(bytes).empty());
+}
+
+TEST(binary_reader_rejects_damaged_input) {
+    auto bytes = lsofwin::format_binary(sample_rows());
+    BinaryResultReader reader;
+    std::string error;
+
+    CHECK(!reader.open(bytes.data(), 10, error));
+    CHECK(!reader.open(bytes.data(), bytes.size() - 1, error)); // RowName runs past the end
+
+    std::string bad_magic = bytes;
+    bad_magic[0] = 'X';
+    CHECK(!reader.open(bad_magic.data(), bad_magic.size(), error));
+    CHECK(error.find("magic") != std::string::npos);
+
+    std::string bad_width = bytes;
+    lsofwin::BinaryHeader width_header;
+    std::memcpy(&width_header, bad_width.data(), sizeof(width_header));
+    width_header.sections[static_cast<size_t>(lsofwin::BinarySection::RowType)].width = 3;
+    std::memcpy(&bad_width[0], &width_header, sizeof(width_header));
+    CHECK(!reader.open(bad_width.data(), bad_width.size(), error));
+
+    // Out-of-range ids read as empty strings instead of out of bounds
+    std::string bad_id = bytes;
+    lsofwin::BinaryHeader header;
+    std::memcpy(&header, bad_id.data(), sizeof(header));
+    const auto& names = header.sections[static_cast<size_t>(lsofwin::BinarySection::RowName)];
+    std::memset(&bad_id[names.offset], 0xff, names.width);
+    CHECK(reader.open(bad_id.data(), bad_id.size(), error));
+    CHECK_EQ(reader.name_leaf(0), std::string_view());
+}
+
+TEST(mapped_file_reads_binary_result) {
+    std::string path = "lsofwin_test_binary_output.bin";
+    auto bytes = lsofwin::format_binary(sample_rows());
+    std::FILE* f = std::fopen(path.c_str(), "wb");
+    CHECK(f != nullptr);
+    std::fwrite(bytes.data(), 1, bytes.size(), f);
+    std::fclose(f);
+
+    {
+        lsofwin::MappedFile file;
+        std::string error;
+        CHECK(file.open(path, error));
+        CHECK_EQ(file.size(), bytes.size());
+        BinaryResultReader reader;
+        CHECK(reader.open(file.data(), file.size(), error));
+        CHECK_EQ(reader.process_name(2), std::string_view("notepad.exe"));
+        CHECK_EQ(reader.pid(5), static_cast<uint32_t>(1300));
+    }
+    std::remove(path.c_str());
+
+    lsofwin::MappedFile missing;
+    std::string error;
+    CHECK(!missing.open(path, error));
+}
@@ -0,0 +1,271 @@
+#include "test_framework.h"
+#include "cli_parser.h"
+#include "filter_expr.h"
+
+#include <vector>
+
+using lsofwin::FilterOptions;
+
+namespace {
+
+bool parse(std::vector<const char*> args, FilterOptions& opts, std::string& error) {
+    args.insert(args.begin(), "lsofwin");
+    return lsofwin::parse_args(static_cast<int>(args.size()), args.data(), opts, error);
+}
+
+} // anonymous namespace
+
+TEST(parse_defaults) {
+    FilterOptions opts;
+    std::string error;
+    CHECK(parse({}, opts, error));
+    CHECK(opts.filter_pids.empty());
+    CHECK_EQ(opts.timeout_seconds, 5);
+    CHECK_EQ(opts.threads, 1);
+    CHECK(!opts.output_json);
+}
+
+TEST(parse_basic_filters) {
+    FilterOptions opts;
+    std::string error;
+    CHECK(parse({ "-p", "42", "-c", "notepad", "-f", "\\.txt$", "-t", "3", "-j" }, opts, error));
+    CHECK(opts.filter_pids == std::vector<uint32_t>({ 42 }));
+    CHECK(opts.filter_process_names == std::vector<std::string>({ "notepad" }));
+    CHECK(opts.filter_file_regexes == std::vector<std::string>({ "\\.txt$" }));
+    CHECK_EQ(opts.timeout_seconds, 3);
+    CHECK(opts.output_json);
+}
+
+TEST(parse_thread_count) {
+    FilterOptions opts;
+    std::string error;
+    CHECK(parse({ "-J", "8" }, opts, error));
+    CHECK_EQ(opts.threads, 8);
+    CHECK(parse({ "-J", "0" }, opts, error));
+    CHECK_EQ(opts.threads, 0);
+    CHECK(!parse({ "-J", "-2" }, opts, error));
+    CHECK(!parse({ "-J" }, opts, error));
+}
+
+TEST(parse_rejects_bad_input) {
+    FilterOptions opts;
+    std::string error;
+    CHECK(!parse({ "-p", "abc" }, opts, error));
+    CHECK(!parse({ "-f", "(unclosed" }, opts, error));
+    CHECK(!parse({ "--bogus" }, opts, error));
+    CHECK(error.find("--bogus") != std::string::npos);
+}
+
+TEST(parse_type_filter_accumulates) {
+    FilterOptions opts;
+    std::string error;
+    CHECK(parse({ "-T", "File,Key", "-T", "Section" }, opts, error));
+    CHECK_EQ(opts.filter_types.size(), static_cast<size_t>(3));
+    CHECK_EQ(opts.filter_types[2], std::string("Section"));
+    CHECK(!parse({ "-T", "," }, opts, error));
+    CHECK(!parse({ "-T" }, opts, error));
+}
+
+TEST(parse_streaming_output_options) {
+    FilterOptions opts;
+    std::string error;
+    CHECK(parse({}, opts, error));
+    CHECK_EQ(opts.table_sample_rows, static_cast<size_t>(1000));
+    CHECK(parse({ "--ndjson", "--widths", "0" }, opts, error));
+    CHECK(opts.output_ndjson);
+    CHECK_EQ(opts.table_sample_rows, static_cast<size_t>(0));
+    CHECK(!parse({ "--widths", "-1" }, opts, error));
+    CHECK(!parse({ "--widths" }, opts, error));
+}
+
+TEST(parse_binary_options) {
+    FilterOptions opts;
+    std::string error;
+    CHECK(parse({ "--binary" }, opts, error));
+    CHECK(opts.output_binary);
+    CHECK(opts.decode_file.empty());
+    CHECK(parse({ "--decode", "handles.bin", "-j" }, opts, error));
+    CHECK_EQ(opts.decode_file, std::string("handles.bin"));
+    CHECK(opts.output_json);
+    CHECK(!parse({ "--decode" }, opts, error));
+}
+
+TEST(parse_repeat_interval) {
+    FilterOptions opts;
+    std::string error;
+    CHECK(parse({}, opts, error));
+    CHECK_EQ(opts.repeat_seconds, 0);
+    CHECK(parse({ "-r", "5", "-f", "\\.lock$" }, opts, error));
+    CHECK_EQ(opts.repeat_seconds, 5);
+    CHECK(!parse({ "-r", "0" }, opts, error));
+    CHECK(!parse({ "-r" }, opts, error));
+    CHECK(!parse({ "-r", "5", "--binary" }, opts, error));
+}
+
+TEST(parse_serve_and_client_options) {
+    FilterOptions opts;
+    std::string error;
+    CHECK(parse({ "--serve", "-T", "File", "--socket", "/tmp/x.sock" }, opts, error));
+    CHECK(opts.serve);
+    CHECK_EQ(opts.socket_path, std::string("/tmp/x.sock"));
+    CHECK(parse({ "--client", "-p", "4" }, opts, error));
+    CHECK(opts.use_server);
+    CHECK(!parse({ "--serve", "--client" }, opts, error));
+    CHECK(!parse({ "--client", "-r", "2" }, opts, error));
+    CHECK(!parse({ "--socket" }, opts, error));
+
+    std::vector<const char*> argv = { "lsofwin", "--client", "-f", "a", "--socket", "/tmp/x.sock", "-j" };
+    auto forwarded = lsofwin::server_query_args(static_cast<int>(argv.size()), argv.data());
+    CHECK_EQ(forwarded.size(), static_cast<size_t>(3));
+    CHECK_EQ(forwarded[0], std::string("-f"));
+    CHECK_EQ(forwarded[2], std::string("-j"));
+}
+
+TEST(parse_directory_filters) {
+    FilterOptions opts;
+    std::string error;
+    CHECK(parse({ "+d", "C:\\Temp" }, opts, error));
+    CHECK_EQ(opts.filter_dirs.size(), static_cast<size_t>(1));
+    CHECK_EQ(opts.filter_dirs[0].path, std::string("C:\\Temp"));
+    CHECK(!opts.filter_dirs[0].recursive);
+    CHECK(parse({ "+D", "/var/log" }, opts, error));
+    CHECK(opts.filter_dirs[0].recursive);
+    CHECK(!parse({ "+D" }, opts, error));
+    CHECK_EQ(error, std::string("Option +D requires a directory argument"));
+    CHECK(!parse({ "+d", "" }, opts, error));
+}
+
+TEST(parse_record_and_replay_options) {
+    FilterOptions opts;
+    std::string error;
+    CHECK(parse({ "--record", "scan.rec", "-J", "0" }, opts, error));
+    CHECK_EQ(opts.record_file, std::string("scan.rec"));
+    CHECK(parse({ "--replay", "scan.rec", "-p", "4", "-j" }, opts, error));
+    CHECK_EQ(opts.replay_file, std::string("scan.rec"));
+    CHECK(!parse({ "--record", "scan.rec", "-p", "4" }, opts, error));
+    CHECK(!parse({ "--replay", "scan.rec", "-r", "2" }, opts, error));
+    CHECK(!parse({ "--record", "a.rec", "--replay", "b.rec" }, opts, error));
+    CHECK(!parse({ "--replay" }, opts, error));
+    CHECK_EQ(error, std::string("Option --replay requires a file argument"));
+}
+
+TEST(parse_stats_options) {
+    FilterOptions opts;
+    std::string error;
+    CHECK(parse({ "-c", "svchost" }, opts, error));
+    CHECK(!opts.show_stats && !opts.stats_json);
+    CHECK(parse({ "--stats", "-J", "0" }, opts, error));
+    CHECK(opts.show_stats);
+    CHECK(parse({ "--replay", "scan.rec", "--stats-json" }, opts, error));
+    CHECK(opts.stats_json);
+    CHECK(!parse({ "--stats", "-r", "2" }, opts, error));
+    CHECK(!parse({ "--stats-json", "--serve" }, opts, error));
+}
+
+TEST(parse_raw_account_ids) {
+    FilterOptions opts;
+    std::string error;
+    CHECK(parse({ "-c", "svchost" }, opts, error));
+    CHECK(!opts.raw_account_ids);
+    CHECK(parse({ "-l", "-c", "svchost" }, opts, error));
+    CHECK(opts.raw_account_ids);
+    CHECK(parse({ "-l", "--serve" }, opts, error));
+    CHECK(!parse({ "-l", "--client" }, opts, error));
+    CHECK(!parse({ "-l", "--replay", "scan.rec" }, opts, error));
+}
+
+TEST(parse_summary_options) {
+    FilterOptions opts;
+    std::string error;
+    CHECK(parse({ "--summary" }, opts, error));
+    CHECK(opts.group_by == std::vector<lsofwin::GroupKey>({ lsofwin::GroupKey::Pid, lsofwin::GroupKey::Type }));
+    CHECK(parse({ "--group-by", "user", "--summary", "--top", "5" }, opts, error));
+    CHECK(opts.group_by == std::vector<lsofwin::GroupKey>({ lsofwin::GroupKey::User }));
+    CHECK_EQ(opts.summary_top, static_cast<size_t>(5));
+    CHECK(parse({ "--summary", "--replay", "scan.rec", "-j" }, opts, error));
+    CHECK(!parse({ "--top", "5" }, opts, error));
+    CHECK(!parse({ "--summary", "--top", "0" }, opts, error));
+    CHECK(!parse({ "--group-by", "name" }, opts, error));
+    CHECK(!parse({ "--summary", "-r", "2" }, opts, error));
+    CHECK(!parse({ "--summary", "--binary" }, opts, error));
+}
+
+TEST(parse_repeated_and_listed_selections) {
+    FilterOptions opts;
+    std::string error;
+    CHECK(parse({ "-p", "4,100", "-p", "8", "-c", "sql,w3wp", "-f", "a{1,2}", "-f", "\\.log$",
+        "+d", "C:\\Temp", "+D", "D:\\Data" }, opts, error));
+    CHECK(opts.filter_pids == std::vector<uint32_t>({ 4, 100, 8 }));
+    CHECK(opts.filter_process_names == std::vector<std::string>({ "sql", "w3wp" }));
+    CHECK(opts.filter_file_regexes == std::vector<std::string>({ "a{1,2}", "\\.log$" }));
+    CHECK_EQ(opts.filter_dirs.size(), static_cast<size_t>(2));
+    CHECK(opts.filter_dirs[1].recursive);
+    CHECK(!opts.filter_any);
+    CHECK(opts.filter != nullptr);
+    CHECK_EQ(opts.filter->matchers().size(), static_cast<size_t>(2));
+
+    CHECK(parse({ "--or", "-p", "4", "-c", "sql" }, opts, error));
+    CHECK(opts.filter_any);
+    CHECK(opts.filter->any());
+    CHECK(parse({ "-a", "-p", "4", "-c", "sql" }, opts, error));
+    CHECK(!opts.filter_any);
+    CHECK(!parse({ "-a", "--or" }, opts, error));
+    CHECK(!parse({ "-p", "4,x" }, opts, error));
+    CHECK_EQ(error, std::string("Invalid PID: x"));
+    CHECK(!parse({ "-p", "," }, opts, error));
+    CHECK(!parse({ "-f", "ok", "-f", "(" }, opts, error));
+    CHECK_EQ(error.compare(0, 14, "Invalid regex:"), 0);
+}
+
+TEST(parse_metrics_options) {
+    FilterOptions opts;
+    std::string error;
+    CHECK(parse({ "--metrics", "handles.prom", "-r", "30", "--top", "10", "-T", "File" }, opts, error));
+    CHECK_EQ(opts.metrics_file, std::string("handles.prom"));
+    CHECK_EQ(opts.repeat_seconds, 30);
+    CHECK_EQ(opts.summary_top, static_cast<size_t>(10));
+    CHECK(parse({ "--metrics", "handles.prom", "-c", "svchost", "-l" }, opts, error));
+    CHECK_EQ(opts.repeat_seconds, 0);
+    CHECK(!parse({ "--metrics" }, opts, error));
+    CHECK(!parse({ "--metrics", "handles.prom", "-j" }, opts, error));
+    CHECK(!parse({ "--metrics", "handles.prom", "--summary" }, opts, error));
+    CHECK(!parse({ "--metrics", "handles.prom", "--stats" }, opts, error));
+    CHECK(!parse({ "--metrics", "handles.prom", "-f", "\\.log$" }, opts, error));
+    CHECK(!parse({ "--metrics", "handles.prom", "+D", "C:\\Temp" }, opts, error));
+}
+
+TEST(parse_deadline) {
+    FilterOptions opts;
+    std::string error;
+    CHECK(parse({ "--deadline", "3" }, opts, error));
+    CHECK_EQ(opts.deadline_ms, 3000u);
+    CHECK(parse({ "--deadline", "0.25", "-J", "0", "--summary" }, opts, error));
+    CHECK_EQ(opts.deadline_ms, 250u);
+    CHECK(parse({ "-p", "4" }, opts, error));
+    CHECK_EQ(opts.deadline_ms, 0u);
+    CHECK(!parse({ "--deadline" }, opts, error));
+    CHECK(!parse({ "--deadline", "0" }, opts, error));
+    CHECK(!parse({ "--deadline", "-1" }, opts, error));
+    CHECK(!parse({ "--deadline", "2s" }, opts, error));
+    CHECK_EQ(error, std::string("Invalid deadline: 2s"));
+    CHECK(!parse({ "--deadline", "2", "-r", "5" }, opts, error));
+    CHECK(!parse({ "--deadline", "2", "--record", "x.rec" }, opts, error));
+}
+
+TEST(parse_fields_option) {
+    FilterOptions opts;
+    std::string error;
+    CHECK(parse({ "-o", "pid,fd,type" }, opts, error));
+    CHECK_EQ(opts.fields.size(), static_cast<size_t>(3));
+    CHECK(opts.fields[1] == lsofwin::OutputField::Fd);
+    CHECK(parse({ "--fields", "name,object", "-c", "app", "--ndjson" }, opts, error));
+    CHECK(opts.fields[1] == lsofwin::OutputField::Object);
+    CHECK(parse({ "-p", "4" }, opts, error));
+    CHECK(opts.fields.empty());
+    CHECK(!parse({ "-o" }, opts, error));
+    CHECK_EQ(error, std::string("Option -o requires a list of fields"));
+    CHECK(!parse({ "-o", "pid,size" }, opts, error));
+    CHECK(!parse({ "-o", "pid", "--summary" }, opts, error));
+    CHECK(!parse({ "-o", "pid", "-r", "5" }, opts, error));
+    CHECK(!parse({ "-o", "pid", "--binary" }, opts, error));
+}
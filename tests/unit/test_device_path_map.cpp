@@ -0,0 +1,112 @@
+#include "test_framework.h"
+#include "device_path_map.h"
+
+using lsofwin::DevicePathMap;
+
+namespace {
+
+DevicePathMap make_map() {
+    DevicePathMap map;
+    map.add("\\Device\\HarddiskVolume1", "C:");
+    map.add("\\Device\\HarddiskVolume10", "D:");
+    map.add("\\Device\\HarddiskVolume7", "C:\\mnt\\data");
+    map.add_standard_prefixes();
+    return map;
+}
+
+std::string normalized(const DevicePathMap& map, std::string path) {
+    map.normalize(path);
+    return path;
+}
+
+} // anonymous namespace
+
+TEST(device_map_rewrites_drive_letters) {
+    auto map = make_map();
+    CHECK_EQ(normalized(map, "\\Device\\HarddiskVolume1\\Windows\\notepad.exe"),
+        std::string("C:\\Windows\\notepad.exe"));
+    CHECK_EQ(normalized(map, "\\Device\\HarddiskVolume10\\x.txt"), std::string("D:\\x.txt"));
+    CHECK_EQ(normalized(map, "\\Device\\HarddiskVolume1"), std::string("C:"));
+}
+
+TEST(device_map_requires_component_boundary) {
+    auto map = make_map();
+    // Volume1 must not match Volume12
+    CHECK_EQ(normalized(map, "\\Device\\HarddiskVolume12\\x"), std::string("\\Device\\HarddiskVolume12\\x"));
+}
+
+TEST(device_map_handles_unc_and_dos_prefixes) {
+    auto map = make_map();
+    CHECK_EQ(normalized(map, "\\Device\\Mup\\server\\share\\f.txt"), std::string("\\\\server\\share\\f.txt"));
+    CHECK_EQ(normalized(map, "\\??\\UNC\\server\\share"), std::string("\\\\server\\share"));
+    CHECK_EQ(normalized(map, "\\??\\C:\\Windows"), std::string("C:\\Windows"));
+}
+
+TEST(device_map_handles_folder_mounts) {
+    auto map = make_map();
+    CHECK_EQ(normalized(map, "\\Device\\HarddiskVolume7\\logs\\a.log"), std::string("C:\\mnt\\data\\logs\\a.log"));
+}
+
+TEST(device_map_leaves_other_names_alone) {
+    auto map = make_map();
+    std::string key = "\\REGISTRY\\MACHINE\\SOFTWARE";
+    CHECK(!map.normalize(key));
+    CHECK_EQ(key, std::string("\\REGISTRY\\MACHINE\\SOFTWARE"));
+    std::string empty;
+    CHECK(!map.normalize(empty));
+}
+
+TEST(device_map_first_rule_wins) {
+    DevicePathMap map;
+    map.add("\\Device\\HarddiskVolume3", "E:");
+    map.add("\\Device\\HarddiskVolume3", "F:\\mount");
+    CHECK_EQ(map.size(), static_cast<size_t>(1));
+    CHECK_EQ(normalized(map, "\\Device\\HarddiskVolume3\\a"), std::string("E:\\a"));
+}
+
+TEST(device_map_rewrites_without_reallocating) {
+    auto map = make_map();
+    std::string path = "\\Device\\HarddiskVolume1\\Users\\someone\\Documents\\report.docx";
+    const char* before = path.data();
+    CHECK(map.normalize(path));
+    CHECK(path.data() == before);
+}
+
+TEST(device_map_normalizes_utf16_names_like_converted_ones) {
+    auto map = make_map();
+    map.add("\\Device\\Mup\\srv", "S:");
+    const std::u16string names[] = {
+        u"\\Device\\HarddiskVolume1\\Users\\Zo\u00eb\\caf\u00e9.txt",
+        u"\\Device\\HarddiskVolume10\\\u65e5\u672c\\x",
+        u"\\Device\\HarddiskVolume12\\x",
+        u"\\Device\\HarddiskVolume1",
+        u"\\Device\\HarddiskVolume1\u00e9\\x",       // Non-ASCII right after a prefix: no boundary
+        u"\\Device\\Mup\\srv\u00e9\\share\\f.txt",  // Falls back to the shorter \Device\Mup rule
+        u"\\Device\\Mup\\srv\\share\\f.txt",
+        u"\\??\\C:\\x\U0001F600.txt",
+        u"\\REGISTRY\\MACHINE\\SOFTWARE",
+        u"\u00e9\\Device\\HarddiskVolume1",
+        u"",
+    };
+    const std::string expected[] = {
+        "C:\\Users\\Zo\xc3\xab\\caf\xc3\xa9.txt",
+        "D:\\\xe6\x97\xa5\xe6\x9c\xac\\x",
+        "\\Device\\HarddiskVolume12\\x",
+        "C:",
+        "\\Device\\HarddiskVolume1\xc3\xa9\\x",
+        "\\\\srv\xc3\xa9\\share\\f.txt",
+        "S:\\share\\f.txt",
+        "C:\\x\xf0\x9f\x98\x80.txt",
+        "\\REGISTRY\\MACHINE\\SOFTWARE",
+        "\xc3\xa9\\Device\\HarddiskVolume1",
+        "",
+    };
+    std::string out = "stale";
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); ++i) {
+        map.normalize(names[i], out);
+        CHECK_EQ(out, expected[i]);
+    }
+    CHECK(map.normalize(u"\\Device\\HarddiskVolume7\\a", out));
+    CHECK_EQ(out, std::string("C:\\mnt\\data\\a"));
+    CHECK(!map.normalize(u"\\Device\\Unknown\\a", out));
+}
@@ -0,0 +1,124 @@
+#include "test_framework.h"
+#include "fake_handle_source.h"
+#include "field_projection.h"
+#include "handle_enumerator.h"
+#include "scan_stats.h"
+
+#include <string>
+#include <vector>
+
+using lsofwin::FilterOptions;
+using lsofwin::OutputField;
+using lsofwin_test::FakeHandleSource;
+
+namespace {
+
+// Two processes with File and Key handles, named by the type table
+void add_handles(FakeHandleSource& src) {
+    src.types_by_index = { "", "", "File", "Key" };
+    src.add_process(100, "app.exe", "HOST\\user");
+    src.add_process(200, "svc.exe", "SYSTEM");
+    src.add_handle(100, 0x4, "File", "C:\\app\\log.txt", 2, 0xffff8000);
+    src.rows.back().raw.granted_access = 0x0012019f;
+    src.rows.back().raw.attributes = 0x2;
+    src.add_handle(100, 0x8, "Key", "\\REGISTRY\\MACHINE", 3);
+    src.add_handle(200, 0x4, "File", "C:\\svc\\data.db", 2);
+    src.add_handle(200, 0xc, "Mystery", "\\x", 9);          // Not in the type table
+}
+
+} // anonymous namespace
+
+TEST(parse_fields_keeps_the_order_given) {
+    std::vector<OutputField> fields;
+    std::string error;
+    CHECK(lsofwin::parse_fields("pid,fd,type", fields, error));
+    CHECK(fields == std::vector<OutputField>({ OutputField::Pid, OutputField::Fd, OutputField::Type }));
+    CHECK(lsofwin::parse_fields("object,attr,access", fields, error));
+    CHECK(fields == std::vector<OutputField>({ OutputField::Object, OutputField::Attributes, OutputField::Access }));
+    CHECK_EQ(std::string(lsofwin::field_name(OutputField::Attributes)), std::string("attr"));
+
+    CHECK(!lsofwin::parse_fields("pid,handle", fields, error));
+    CHECK_EQ(error, std::string("Unknown field: handle (expected command, pid, user, fd, type, name, access, attr or object)"));
+    CHECK(!lsofwin::parse_fields("fd,fd", fields, error));
+    CHECK_EQ(error, std::string("Field given twice: fd"));
+    CHECK(!lsofwin::parse_fields(",", fields, error));
+}
+
+TEST(field_needs_follow_the_selected_fields) {
+    auto all = lsofwin::field_needs({});
+    CHECK(all.command && all.user && all.type && all.name);
+
+    auto some = lsofwin::field_needs({ OutputField::Pid, OutputField::Fd, OutputField::Type });
+    CHECK(!some.command && !some.user && some.type && !some.name);
+
+    auto raw = lsofwin::field_needs({ OutputField::Access, OutputField::Object });
+    CHECK(!raw.command && !raw.user && !raw.type && !raw.name);
+}
+
+TEST(projection_without_name_or_owner_queries_nothing) {
+    FakeHandleSource src;
+    add_handles(src);
+    FilterOptions opts;
+    opts.fields = { OutputField::Pid, OutputField::Fd, OutputField::Type };
+    lsofwin::ScanStats stats;
+    auto rows = lsofwin::enumerate_handles(src, opts, nullptr, &stats);
+
+    // Only the index the type table lacks is resolved, for its type
+    CHECK_EQ(rows.size(), static_cast<size_t>(4));
+    CHECK_EQ(src.resolve_calls.load(), 1);
+    CHECK_EQ(src.process_info_calls.load(), 0);
+    CHECK_EQ(src.process_name_calls.load(), 0);
+    CHECK_EQ(stats.get(lsofwin::ScanCounter::NotQueried), 3u);
+    CHECK_EQ(rows[0].handle_type, std::string("File"));
+    CHECK_EQ(rows[0].handle_value, static_cast<uintptr_t>(0x4));
+    CHECK_EQ(rows[0].granted_access, 0x0012019fu);
+    CHECK_EQ(rows[0].attributes, 0x2u);
+    CHECK_EQ(rows[0].object, static_cast<uintptr_t>(0xffff8000));
+    CHECK(rows[0].object_name.empty());
+    CHECK(rows[0].process_name.empty() && rows[0].user.empty());
+    CHECK_EQ(rows[3].handle_type, std::string("Mystery"));
+
+    // Without type either, not even that one is
+    src.resolve_calls = 0;
+    opts.fields = { OutputField::Pid, OutputField::Fd, OutputField::Access };
+    CHECK_EQ(lsofwin::enumerate_handles(src, opts).size(), static_cast<size_t>(4));
+    CHECK_EQ(src.resolve_calls.load(), 0);
+
+    // Inaccessible processes are still left out
+    src.inaccessible_pids.insert(200);
+    CHECK_EQ(lsofwin::enumerate_handles(src, opts).size(), static_cast<size_t>(2));
+}
+
+TEST(projection_looks_up_only_what_fields_and_filters_need) {
+    FakeHandleSource src;
+    add_handles(src);
+    FilterOptions opts;
+    opts.fields = { OutputField::Command, OutputField::Fd, OutputField::Access };
+    opts.threads = 2;
+    auto rows = lsofwin::enumerate_handles(src, opts);
+    CHECK_EQ(rows.size(), static_cast<size_t>(4));
+    CHECK_EQ(rows[0].process_name, std::string("app.exe"));
+    CHECK(rows[0].user.empty());
+    CHECK_EQ(src.process_info_calls.load(), 0);
+    CHECK(src.process_name_calls.load() >= 2);
+    CHECK_EQ(src.resolve_calls.load(), 0);
+
+    // -c and -f still get the process and object names they filter on
+    src.process_name_calls = 0;
+    opts.threads = 1;
+    opts.fields = { OutputField::Pid, OutputField::Fd };
+    opts.filter_process_names = { "app" };
+    opts.filter_file_regexes = { "log" };
+    rows = lsofwin::enumerate_handles(src, opts);
+    CHECK_EQ(rows.size(), static_cast<size_t>(1));
+    CHECK_EQ(rows[0].handle_value, static_cast<uintptr_t>(0x4));
+    CHECK_EQ(src.process_info_calls.load(), 0);
+    CHECK_EQ(src.process_name_calls.load(), 2);
+    CHECK_EQ(src.resolve_calls.load(), 2);
+
+    // The default columns look everything up, as before
+    FilterOptions defaults;
+    rows = lsofwin::enumerate_handles(src, defaults);
+    CHECK_EQ(rows[0].user, std::string("HOST\\user"));
+    CHECK_EQ(rows[0].object_name, std::string("C:\\app\\log.txt"));
+}
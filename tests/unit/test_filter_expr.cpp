@@ -0,0 +1,150 @@
+#include "test_framework.h"
+#include "fake_handle_source.h"
+#include "filter_expr.h"
+#include "handle_enumerator.h"
+#include "path_matcher.h"
+
+#include <string>
+#include <vector>
+
+using lsofwin::FilterExpr;
+using lsofwin::FilterOptions;
+using lsofwin_test::FakeHandleSource;
+
+namespace {
+
+using Verdict = FilterExpr::Verdict;
+using NameResult = FilterExpr::NameResult;
+
+// Twenty services, each holding a log file and a registry key
+void fill_services(FakeHandleSource& src) {
+    for (uint32_t n = 0; n < 20; ++n) {
+        uint32_t pid = 1000 + n * 4;
+        std::string name = "svc" + std::to_string(n) + ".exe";
+        src.add_process(pid, name, "SYSTEM");
+        src.add_handle(pid, 0x4, "File", "C:\\Logs\\" + name + ".log");
+        src.add_handle(pid, 0x8, "Key", "\\REGISTRY\\MACHINE\\SOFTWARE\\" + name);
+    }
+}
+
+} // anonymous namespace
+
+TEST(filter_expr_ands_options_and_ors_their_values) {
+    FilterOptions opts;
+    opts.filter_pids = { 30, 10, 20, 10 };
+    opts.filter_process_names = { "NOTE", "calc" };
+    FilterExpr expr(opts);
+    CHECK(expr.pids() == std::vector<uint32_t>({ 10, 20, 30 }));
+    CHECK(expr.pid_verdict(15) == Verdict::Reject);
+    CHECK(expr.pid_verdict(20) == Verdict::NeedProcess);
+    CHECK(expr.process_verdict("Calc.exe") == Verdict::Accept);
+    CHECK(expr.process_verdict("explorer.exe") == Verdict::Reject);
+
+    opts.filter_file_regexes = { "\\.txt$" };
+    opts.filter_dirs = { { "C:\\Users", true } };
+    FilterExpr named(opts);
+    CHECK(named.process_verdict("notepad.exe") == Verdict::CheckName);
+    CHECK(named.check_name("C:\\Users\\a\\notes.txt") == NameResult::Match);
+    CHECK(named.check_name("C:\\Users\\a\\notes.log") == NameResult::NoFileMatch);
+    CHECK(named.check_name("D:\\notes.txt") == NameResult::NoDirMatch);
+
+    FilterExpr none{ FilterOptions{} };
+    CHECK(none.empty());
+    CHECK(none.pid_verdict(1) == Verdict::Accept);
+    CHECK(none.matches(1, "", ""));
+}
+
+TEST(filter_expr_or_accepts_on_the_cheapest_match) {
+    FilterOptions opts;
+    opts.filter_any = true;
+    opts.filter_pids = { 4 };
+    CHECK(FilterExpr(opts).pid_verdict(5) == Verdict::Reject);
+
+    opts.filter_process_names = { "sql" };
+    FilterExpr by_process(opts);
+    CHECK(by_process.pid_verdict(4) == Verdict::Accept);    // No process lookup
+    CHECK(by_process.pid_verdict(5) == Verdict::NeedProcess);
+    CHECK(by_process.process_verdict("sqlservr.exe") == Verdict::Accept);
+    CHECK(by_process.process_verdict("w3wp.exe") == Verdict::Reject);
+
+    opts.filter_dirs = { { "D:\\Data", false } };
+    opts.filter_file_regexes = { "\\.mdf$" };
+    FilterExpr any(opts);
+    CHECK(any.process_verdict("w3wp.exe") == Verdict::CheckName);
+    CHECK(any.check_name("D:\\Data\\x.ldf") == NameResult::Match);
+    CHECK(any.check_name("E:\\x.mdf") == NameResult::Match);
+    CHECK(any.check_name("E:\\x.ldf") == NameResult::NoFileMatch);
+    CHECK(any.check_name("") == NameResult::NoFileMatch);
+    CHECK(any.matches(4, "", "E:\\x.ldf"));
+    CHECK(any.matches(9, "sqlservr.exe", ""));
+    CHECK(!any.matches(9, "w3wp.exe", "E:\\x.ldf"));
+}
+
+TEST(filter_expr_orders_patterns_by_engine_cost) {
+    FilterOptions opts;
+    opts.filter_file_regexes = { "(a)\\1", "[0-9]+\\.log$", "\\.txt$" };
+    FilterExpr expr(opts);
+    CHECK_EQ(expr.matchers().size(), static_cast<size_t>(3));
+    CHECK(expr.matchers()[0]->strategy() == lsofwin::PathMatcher::Strategy::Suffix);
+    CHECK(expr.matchers()[1]->strategy() == lsofwin::PathMatcher::Strategy::Dfa);
+    CHECK(expr.matchers()[2]->strategy() == lsofwin::PathMatcher::Strategy::StdRegex);
+    CHECK(expr.check_name("C:\\aa") == NameResult::Match);
+    CHECK(expr.check_name("C:\\b") == NameResult::NoFileMatch);
+
+    bool threw = false;
+    opts.filter_file_regexes = { "(" };
+    try {
+        FilterExpr bad(opts);
+    }
+    catch (const std::regex_error&) {
+        threw = true;
+    }
+    CHECK(threw);
+}
+
+TEST(enumerate_answers_many_services_in_one_scan) {
+    FakeHandleSource src;
+    fill_services(src);
+    FilterOptions opts;
+    for (uint32_t n = 0; n < 20; n += 4) opts.filter_process_names.push_back("svc" + std::to_string(n) + ".");
+    opts.filter_types = { "File" };
+
+    lsofwin::EnumerationStats stats;
+    auto rows = lsofwin::enumerate_handles(src, opts, &stats);
+    CHECK_EQ(rows.size(), static_cast<size_t>(5));
+    CHECK_EQ(rows[1].process_name, std::string("svc4.exe"));
+    CHECK_EQ(src.snapshot_calls.load(), 1);
+    CHECK_EQ(src.process_name_calls.load(), 20);   // Each process once
+    CHECK_EQ(src.process_info_calls.load(), 5);     // Owners of the matches only
+    CHECK_EQ(stats.handles_scanned, 10u);           // Only the five services' ranges
+
+    // By PID, processes are looked up only for the rows they appear in
+    src.process_info_calls = 0;
+    FilterOptions by_pid;
+    by_pid.filter_pids = { 1000, 1016, 1032, 1048, 1064 };
+    by_pid.filter_types = { "File" };
+    CHECK_EQ(lsofwin::enumerate_handles(src, by_pid).size(), static_cast<size_t>(5));
+    CHECK_EQ(src.process_info_calls.load(), 5);
+}
+
+TEST(enumerate_or_skips_name_checks_for_selected_processes) {
+    FakeHandleSource src;
+    fill_services(src);
+    FilterOptions opts;
+    opts.filter_any = true;
+    opts.filter_pids = { 1000 };
+    opts.filter_file_regexes = { "svc7\\.exe\\.log$" };
+
+    for (int threads : { 1, 4 }) {
+        opts.threads = threads;
+        auto rows = lsofwin::enumerate_handles(src, opts);
+        CHECK_EQ(rows.size(), static_cast<size_t>(3));  // Both of PID 1000's handles, one log
+        CHECK_EQ(rows[0].pid, 1000u);
+        CHECK_EQ(rows[1].handle_type, std::string("Key"));
+        CHECK_EQ(rows[2].object_name, std::string("C:\\Logs\\svc7.exe.log"));
+    }
+
+    // Without --or the same options select nothing
+    opts.filter_any = false;
+    CHECK(lsofwin::enumerate_handles(src, opts).empty());
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+// Minimal self-registering test harness for the portable core.
+// Each test_*.cpp defines TEST(name) functions; test_main.cpp runs them all.
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace lsofwin_test {
+
+struct TestCase {
+    const char* name;
+    void (*fn)();
+};
+
+inline std::vector<TestCase>& registry() {
+    static std::vector<TestCase> tests;
+    return tests;
+}
+
+struct Registrar {
+    Registrar(const char* name, void (*fn)()) { registry().push_back({ name, fn }); }
+};
+
+// Thrown by CHECK macros; caught and reported by the runner.
+struct Failure {
+    std::string message;
+};
+
+template <typename A, typename B>
+std::string describe_mismatch(const A& a, const B& b) {
+    std::ostringstream oss;
+    oss << "expected '" << b << "', got '" << a << "'";
+    return oss.str();
+}
+
+} // namespace lsofwin_test
+
+#define TEST(name)                                                            \
+    static void name();                                                       \
+    static lsofwin_test::Registrar name##_registrar(#name, name);             \
+    static void name()
+
+#define CHECK(cond)                                                           \
+    do {                                                                      \
+        if (!(cond)) {                                                        \
+            throw lsofwin_test::Failure{ std::string(__FILE__) + ":" +        \
+                std::to_string(__LINE__) + ": CHECK(" #cond ") failed" };     \
+        }                                                                     \
+    } while (0)
+
+#define CHECK_EQ(actual, expected)                                            \
+    do {                                                                      \
+        if (!((actual) == (expected))) {                                      \
+            throw lsofwin_test::Failure{ std::string(__FILE__) + ":" +        \
+                std::to_string(__LINE__) + ": " #actual ": " +                \
+                lsofwin_test::describe_mismatch((actual), (expected)) };      \
+        }                                                                     \
+    } while (0)
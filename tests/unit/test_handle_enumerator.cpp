@@ -0,0 +1,156 @@
+#include "test_framework.h"
+#include "fake_handle_source.h"
+#include "handle_enumerator.h"
+
+using lsofwin::FilterOptions;
+using lsofwin_test::FakeHandleSource;
+
+namespace {
+
+void fill_sample(FakeHandleSource& src) {
+    src.add_process(100, "notepad.exe", "HOST\\alice");
+    src.add_process(200, "explorer.exe", "HOST\\bob");
+    src.add_handle(100, 0x4, "File", "C:\\Users\\alice\\notes.txt");
+    src.add_handle(100, 0x8, "Key", "\\REGISTRY\\MACHINE\\SOFTWARE");
+    src.add_handle(200, 0x4, "File", "C:\\Windows\\explorer.exe");
+    src.add_handle(200, 0xc, "Event", "");
+}
+
+} // anonymous namespace
+
+TEST(enumerate_returns_all_rows_without_filters) {
+    FakeHandleSource src;
+    fill_sample(src);
+    FilterOptions opts;
+    auto rows = lsofwin::enumerate_handles(src, opts);
+    CHECK_EQ(rows.size(), static_cast<size_t>(4));
+    CHECK_EQ(rows[0].process_name, std::string("notepad.exe"));
+    CHECK_EQ(rows[0].user, std::string("HOST\\alice"));
+    CHECK_EQ(rows[1].handle_type, std::string("Key"));
+    CHECK_EQ(rows[3].handle_value, static_cast<uintptr_t>(0xc));
+}
+
+TEST(enumerate_caches_process_info_per_pid) {
+    FakeHandleSource src;
+    fill_sample(src);
+    FilterOptions opts;
+    lsofwin::enumerate_handles(src, opts);
+    CHECK_EQ(src.process_info_calls.load(), 2);
+}
+
+TEST(enumerate_applies_pid_filter) {
+    FakeHandleSource src;
+    fill_sample(src);
+    FilterOptions opts;
+    opts.filter_pids = { 200 };
+    auto rows = lsofwin::enumerate_handles(src, opts);
+    CHECK_EQ(rows.size(), static_cast<size_t>(2));
+    for (const auto& h : rows) CHECK_EQ(h.pid, 200u);
+}
+
+TEST(enumerate_applies_process_name_filter_case_insensitive) {
+    FakeHandleSource src;
+    fill_sample(src);
+    FilterOptions opts;
+    opts.filter_process_names = { "NOTE" };
+    auto rows = lsofwin::enumerate_handles(src, opts);
+    CHECK_EQ(rows.size(), static_cast<size_t>(2));
+    CHECK_EQ(rows[0].pid, 100u);
+}
+
+TEST(enumerate_regex_drops_unnamed_and_nonmatching) {
+    FakeHandleSource src;
+    fill_sample(src);
+    FilterOptions opts;
+    opts.filter_file_regexes = { "\\.EXE$" };
+    auto rows = lsofwin::enumerate_handles(src, opts);
+    CHECK_EQ(rows.size(), static_cast<size_t>(1));
+    CHECK_EQ(rows[0].object_name, std::string("C:\\Windows\\explorer.exe"));
+}
+
+TEST(enumerate_directory_filters_keep_top_level_or_subtree) {
+    FakeHandleSource src;
+    fill_sample(src);
+    src.add_handle(100, 0xc, "File", "C:\\Users\\alice");
+    src.add_handle(100, 0x10, "File", "c:/users/ALICE/docs/report.docx");
+    src.add_handle(100, 0x14, "File", "C:\\Users\\alice2\\other.txt");
+
+    FilterOptions opts;
+    opts.filter_dirs = { { "C:\\USERS\\Alice\\", false } };
+    auto top = lsofwin::enumerate_handles(src, opts);
+    CHECK_EQ(top.size(), static_cast<size_t>(2)); // The directory itself and notes.txt
+    CHECK_EQ(top[0].object_name, std::string("C:\\Users\\alice\\notes.txt"));
+    CHECK_EQ(top[1].object_name, std::string("C:\\Users\\alice"));
+
+    opts.filter_dirs[0].recursive = true;
+    auto all = lsofwin::enumerate_handles(src, opts);
+    CHECK_EQ(all.size(), static_cast<size_t>(3));
+    CHECK_EQ(all[2].object_name, std::string("c:/users/ALICE/docs/report.docx"));
+}
+
+TEST(enumerate_drops_inaccessible_handles) {
+    FakeHandleSource src;
+    fill_sample(src);
+    src.rows[1].accessible = false;
+    FilterOptions opts;
+    auto rows = lsofwin::enumerate_handles(src, opts);
+    CHECK_EQ(rows.size(), static_cast<size_t>(3));
+}
+
+namespace {
+
+// Synthetic table: many small processes plus a few very large ones, so the
+// scheduler has to split processes across shards.
+void fill_synthetic(FakeHandleSource& src) {
+    for (uint32_t pid = 1; pid <= 300; ++pid) {
+        src.add_process(pid, "proc" + std::to_string(pid) + ".exe", "HOST\\user");
+        size_t count = (pid % 100 == 0) ? 5000 : (pid % 7) + 1;
+        for (size_t h = 0; h < count; ++h) {
+            std::string name = (h % 3 == 0) ? "" : "C:\\data\\p" + std::to_string(pid) +
+                "\\f" + std::to_string(h) + ((h % 2) ? ".log" : ".dat");
+            src.add_handle(pid, (h + 1) * 4, (h % 3 == 0) ? "Event" : "File", name);
+        }
+    }
+}
+
+bool same_rows(const lsofwin::HandleList& a, const lsofwin::HandleList& b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (a[i].pid != b[i].pid || a[i].handle_value != b[i].handle_value ||
+            a[i].object_name != b[i].object_name || a[i].process_name != b[i].process_name) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // anonymous namespace
+
+TEST(enumerate_parallel_matches_single_threaded_order) {
+    FakeHandleSource src;
+    fill_synthetic(src);
+
+    FilterOptions opts;
+    auto serial = lsofwin::enumerate_handles(src, opts);
+
+    for (int threads : { 2, 3, 8 }) {
+        opts.threads = threads;
+        auto parallel = lsofwin::enumerate_handles(src, opts);
+        CHECK(same_rows(parallel, serial));
+    }
+}
+
+TEST(enumerate_parallel_applies_filters) {
+    FakeHandleSource src;
+    fill_synthetic(src);
+
+    FilterOptions opts;
+    opts.filter_file_regexes = { "\\.log$" };
+    opts.filter_process_names = { "proc1" };
+    auto serial = lsofwin::enumerate_handles(src, opts);
+    CHECK(!serial.empty());
+
+    opts.threads = 4;
+    auto parallel = lsofwin::enumerate_handles(src, opts);
+    CHECK(same_rows(parallel, serial));
+}
@@ -0,0 +1,222 @@
+#include "test_framework.h"
+#include "fake_handle_source.h"
+#include "filter_expr.h"
+#include "handle_enumerator.h"
+#include "handle_index.h"
+#include "handle_watcher.h"
+
+#include <string>
+#include <vector>
+
+using lsofwin::FilterOptions;
+using lsofwin::HandleEvent;
+using lsofwin::HandleIndex;
+using lsofwin::HandleInfo;
+using lsofwin_test::FakeHandleSource;
+
+namespace {
+
+void fill_sample(FakeHandleSource& src) {
+    src.add_process(100, "notepad.exe", "HOST\\alice");
+    src.add_process(200, "explorer.exe", "HOST\\bob");
+    src.add_process(300, "svchost.exe", "NT AUTHORITY\\SYSTEM");
+    src.add_handle(100, 0x4, "File", "C:\\Users\\alice\\notes.txt", 0, 0xa000);
+    src.add_handle(100, 0x8, "Key", "\\REGISTRY\\MACHINE\\SOFTWARE", 0, 0xa008);
+    src.add_handle(100, 0xc, "File", "C:\\Shared\\app.log", 0, 0xa00c);
+    src.add_handle(200, 0x4, "File", "C:\\Windows\\explorer.exe", 0, 0xb000);
+    src.add_handle(200, 0x8, "File", "c:\\shared\\APP.LOG", 0, 0xb008);
+    src.add_handle(200, 0xc, "Event", "", 0, 0xb00c);
+    src.add_handle(300, 0x4, "File", "C:\\Shared\\app.log", 0, 0xc000);
+}
+
+// Index everything the source holds, the way --serve does
+void build(FakeHandleSource& src, HandleIndex& index) {
+    FilterOptions all;
+    lsofwin::HandleWatcher watcher(src, all);
+    std::vector<HandleEvent> events;
+    CHECK(watcher.poll(events));
+    index.apply(events);
+}
+
+// "pid:value:name;" per row
+std::string render(const std::vector<HandleInfo>& rows) {
+    std::string out;
+    for (const auto& h : rows) {
+        out += std::to_string(h.pid) + ":" + std::to_string(h.handle_value) + ":" + h.object_name + ";";
+    }
+    return out;
+}
+
+std::vector<HandleInfo> query(const HandleIndex& index, const FilterOptions& opts,
+    HandleIndex::QueryStats* stats = nullptr) {
+    std::vector<HandleInfo> rows;
+    auto s = index.query(opts, [&](const HandleInfo& h) { rows.push_back(h); });
+    if (stats) *stats = s;
+    return rows;
+}
+
+FilterOptions with_regex(const std::string& pattern) {
+    FilterOptions opts;
+    opts.filter_file_regexes = { pattern };
+    opts.filter = std::make_shared<lsofwin::FilterExpr>(opts);
+    return opts;
+}
+
+HandleEvent event(HandleEvent::Kind kind, uint32_t pid, uintptr_t value, const std::string& name) {
+    HandleEvent e;
+    e.kind = kind;
+    e.handle.pid = pid;
+    e.handle.handle_value = value;
+    e.handle.handle_type = "File";
+    e.handle.object_name = name;
+    return e;
+}
+
+} // anonymous namespace
+
+TEST(index_queries_match_a_live_scan) {
+    FakeHandleSource src;
+    fill_sample(src);
+    HandleIndex index;
+    build(src, index);
+    CHECK_EQ(index.size(), static_cast<size_t>(7));
+    CHECK_EQ(index.process_count(), static_cast<size_t>(3));
+
+    std::vector<FilterOptions> queries;
+    queries.push_back(FilterOptions{});
+    queries.push_back(FilterOptions{});
+    queries.back().filter_pids = { 200 };
+    queries.push_back(FilterOptions{});
+    queries.back().filter_process_names = { "NOTE" };
+    queries.push_back(FilterOptions{});
+    queries.back().filter_types = { "event", "KEY" };
+    queries.push_back(with_regex("^c:\\\\shared\\\\app\\.log$"));
+    queries.push_back(with_regex("\\.log$"));
+    queries.push_back(with_regex("(notes|explorer)\\.(txt|exe)"));
+    queries.push_back(with_regex("^C:\\\\Shared\\\\app\\.log$"));
+    queries.back().filter_process_names = { "svc" };
+    queries.back().filter = std::make_shared<lsofwin::FilterExpr>(queries.back());
+
+    for (const auto& opts : queries) {
+        CHECK_EQ(render(query(index, opts)), render(lsofwin::enumerate_handles(src, opts)));
+    }
+}
+
+TEST(index_answers_pid_and_exact_path_from_their_lookups) {
+    FakeHandleSource src;
+    fill_sample(src);
+    HandleIndex index;
+    build(src, index);
+
+    HandleIndex::QueryStats stats;
+    auto holders = query(index, with_regex("^C:\\\\SHARED\\\\APP\\.LOG$"), &stats);
+    CHECK_EQ(holders.size(), static_cast<size_t>(3));
+    CHECK_EQ(stats.rows_examined, static_cast<size_t>(3));
+    CHECK_EQ(holders[0].pid, 100u);
+    CHECK_EQ(holders[2].pid, 300u);
+
+    FilterOptions by_pid;
+    by_pid.filter_pids = { 300 };
+    CHECK_EQ(query(index, by_pid, &stats).size(), static_cast<size_t>(1));
+    CHECK_EQ(stats.rows_examined, static_cast<size_t>(1));
+
+    // Substring patterns have to look at every row
+    query(index, with_regex("shared"), &stats);
+    CHECK_EQ(stats.rows_examined, static_cast<size_t>(7));
+    CHECK_EQ(stats.rows_matched, static_cast<size_t>(3));
+}
+
+TEST(index_answers_directory_queries_from_the_path_trie) {
+    FakeHandleSource src;
+    fill_sample(src);
+    src.add_process(400, "deep.exe", "HOST\\carol");
+    src.add_handle(400, 0x4, "File", "C:\\Shared\\logs\\2024\\a.log", 0, 0xd000);
+    HandleIndex index;
+    build(src, index);
+
+    FilterOptions top;
+    top.filter_dirs = { { "c:/shared", false } };
+    HandleIndex::QueryStats stats;
+    CHECK_EQ(render(query(index, top, &stats)), render(lsofwin::enumerate_handles(src, top)));
+    CHECK_EQ(stats.rows_matched, static_cast<size_t>(3));
+    CHECK_EQ(stats.rows_examined, static_cast<size_t>(3));
+
+    FilterOptions subtree = top;
+    subtree.filter_dirs[0].recursive = true;
+    CHECK_EQ(render(query(index, subtree, &stats)), render(lsofwin::enumerate_handles(src, subtree)));
+    CHECK_EQ(stats.rows_examined, static_cast<size_t>(4));
+
+    subtree.filter_process_names = { "deep" };
+    CHECK_EQ(query(index, subtree).size(), static_cast<size_t>(1));
+}
+
+TEST(index_answers_or_queries_from_the_union_of_lookups) {
+    FakeHandleSource src;
+    fill_sample(src);
+    HandleIndex index;
+    build(src, index);
+
+    FilterOptions opts;
+    opts.filter_any = true;
+    opts.filter_pids = { 300, 999 };
+    opts.filter_dirs = { { "c:/users", true }, { "C:\\Users\\alice", true } };
+    HandleIndex::QueryStats stats;
+    CHECK_EQ(render(query(index, opts, &stats)), render(lsofwin::enumerate_handles(src, opts)));
+    CHECK_EQ(stats.rows_matched, static_cast<size_t>(2));
+    CHECK_EQ(stats.rows_examined, static_cast<size_t>(2)); // Nested directories list notes.txt once
+
+    // -c cannot be looked up, so the rows are scanned
+    opts.filter_process_names = { "explorer" };
+    CHECK_EQ(render(query(index, opts, &stats)), render(lsofwin::enumerate_handles(src, opts)));
+    CHECK_EQ(stats.rows_matched, static_cast<size_t>(5));
+    CHECK_EQ(stats.rows_examined, static_cast<size_t>(7));
+
+    // Several PIDs, ANDed with a pattern
+    FilterOptions pids;
+    pids.filter_pids = { 100, 200 };
+    pids.filter_file_regexes = { "\\.(txt|log)$" };
+    CHECK_EQ(render(query(index, pids, &stats)), render(lsofwin::enumerate_handles(src, pids)));
+    CHECK_EQ(stats.rows_matched, static_cast<size_t>(3));
+    CHECK_EQ(stats.rows_examined, static_cast<size_t>(6));
+}
+
+TEST(index_applies_closes_and_reused_handle_values) {
+    HandleIndex index;
+    index.apply({ event(HandleEvent::Kind::Open, 5, 4, "C:\\old.txt"),
+        event(HandleEvent::Kind::Open, 5, 8, "C:\\keep.txt") });
+    CHECK_EQ(index.size(), static_cast<size_t>(2));
+
+    // A recycled PID reuses handle value 4; the open is listed before the
+    // close of the old process's handle, but must win
+    index.apply({ event(HandleEvent::Kind::Open, 5, 4, "C:\\new.txt"),
+        event(HandleEvent::Kind::Close, 5, 4, "C:\\old.txt") });
+    auto rows = query(index, FilterOptions{});
+    CHECK_EQ(render(rows), std::string("5:4:C:\\new.txt;5:8:C:\\keep.txt;"));
+    CHECK(query(index, with_regex("^c:\\\\old\\.txt$")).empty());
+
+    index.apply({ event(HandleEvent::Kind::Close, 5, 4, "C:\\new.txt"),
+        event(HandleEvent::Kind::Close, 5, 8, "C:\\keep.txt") });
+    CHECK_EQ(index.size(), static_cast<size_t>(0));
+    CHECK_EQ(index.process_count(), static_cast<size_t>(0));
+    CHECK(query(index, with_regex("^c:\\\\new\\.txt$")).empty());
+}
+
+TEST(index_survives_compacting_its_rows) {
+    // Thousands of short-lived files push the table past its compaction
+    // threshold; the live rows and their lookups must be unaffected
+    HandleIndex index;
+    index.apply({ event(HandleEvent::Kind::Open, 5, 8, "C:\\keep.txt") });
+    for (int i = 0; i < 3000; ++i) {
+        std::string name = "C:\\tmp\\f" + std::to_string(i) + ".tmp";
+        index.apply({ event(HandleEvent::Kind::Open, 5, 4, name) });
+        index.apply({ event(HandleEvent::Kind::Close, 5, 4, name) });
+    }
+    index.apply({ event(HandleEvent::Kind::Open, 5, 4, "C:\\tmp\\last.tmp") });
+    CHECK_EQ(index.size(), static_cast<size_t>(2));
+    CHECK_EQ(render(query(index, FilterOptions{})), std::string("5:4:C:\\tmp\\last.tmp;5:8:C:\\keep.txt;"));
+    CHECK_EQ(query(index, with_regex("^c:\\\\keep\\.txt$")).size(), static_cast<size_t>(1));
+    CHECK(query(index, with_regex("f1\\.tmp$")).empty());
+    FilterOptions dir;
+    dir.filter_dirs = { { "C:\\tmp", false } };
+    CHECK_EQ(render(query(index, dir)), std::string("5:4:C:\\tmp\\last.tmp;"));
+}
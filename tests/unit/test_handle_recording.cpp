@@ -0,0 +1,129 @@
+#include "test_framework.h"
+#include "fake_handle_source.h"
+#include "handle_enumerator.h"
+#include "handle_recording.h"
+
+#include <string>
+
+using lsofwin::FilterOptions;
+using lsofwin::HandleList;
+using lsofwin::RecordingHandleSource;
+using lsofwin::ReplayHandleSource;
+using lsofwin_test::FakeHandleSource;
+
+namespace {
+
+// Three processes sharing one file object, plus an inaccessible handle, a
+// timed-out name and a process whose handles cannot be opened at all.
+void fill_source(FakeHandleSource& src) {
+    src.types_by_index = { "", "", "File", "Key" };
+    src.add_process(100, "editor.exe", "HOST\\alice");
+    src.add_process(200, "indexer.exe", "NT AUTHORITY\\SYSTEM");
+    src.add_process(300, "locked.exe", "HOST\\bob");
+    src.add_handle(100, 0x10, "File", "C:\\data\\shared.db", 2, 0xa000);
+    src.add_handle(100, 0x14, "Key", "\\REGISTRY\\MACHINE\\SOFTWARE", 3);
+    src.add_handle(100, 0x18, "File", "\\Device\\NamedPipe\\x", 2);
+    src.rows.back().timed_out = true;
+    src.add_handle(200, 0x20, "File", "C:\\data\\shared.db", 2, 0xa000);
+    src.add_handle(200, 0x24, "File", "C:\\secret.txt", 2);
+    src.rows.back().accessible = false;
+    src.add_handle(300, 0x30, "File", "C:\\data\\shared.db", 2, 0xa000);
+    src.inaccessible_pids.insert(300);
+    src.start_times[100] = 111;
+}
+
+std::string render(const HandleList& rows) {
+    std::string s;
+    for (const auto& h : rows) {
+        s += std::to_string(h.pid) + " " + h.process_name + " " + h.user + " " + h.handle_type + " " +
+            h.object_name + " " + std::to_string(h.handle_value) + "\n";
+    }
+    return s;
+}
+
+std::string record(FakeHandleSource& src) {
+    RecordingHandleSource recorder(src);
+    lsofwin::enumerate_handles(recorder, FilterOptions{});
+    std::string bytes;
+    {
+        lsofwin::OutputBuffer out(lsofwin::string_writer(bytes));
+        recorder.write(out);
+    }
+    return bytes;
+}
+
+} // anonymous namespace
+
+TEST(replay_gives_the_same_rows_as_the_recorded_scan) {
+    FakeHandleSource src;
+    fill_source(src);
+    std::string bytes = record(src);
+
+    ReplayHandleSource replay;
+    std::string error;
+    CHECK(replay.open(bytes.data(), bytes.size(), error));
+    CHECK_EQ(replay.handle_count(), static_cast<uint64_t>(6));
+    CHECK_EQ(replay.process_start_time(100), static_cast<uint64_t>(111));
+    CHECK_EQ(replay.type_names().size(), static_cast<size_t>(4));
+
+    FakeHandleSource live;
+    fill_source(live);
+    CHECK_EQ(render(lsofwin::enumerate_handles(replay, FilterOptions{})),
+        render(lsofwin::enumerate_handles(live, FilterOptions{})));
+}
+
+TEST(replay_applies_filters_the_recording_did_not_use) {
+    FakeHandleSource src;
+    fill_source(src);
+    std::string bytes = record(src);
+    int resolves = src.resolve_calls.load();
+
+    ReplayHandleSource replay;
+    std::string error;
+    CHECK(replay.open(bytes.data(), bytes.size(), error));
+
+    // PID 200's handle to the shared file was answered from the object cache
+    // while recording; replaying -p 200 still finds its name
+    FilterOptions by_pid;
+    by_pid.filter_pids = { 200 };
+    FakeHandleSource live;
+    fill_source(live);
+    CHECK_EQ(render(lsofwin::enumerate_handles(replay, by_pid)),
+        render(lsofwin::enumerate_handles(live, by_pid)));
+    CHECK(render(lsofwin::enumerate_handles(replay, by_pid)).find("shared.db") != std::string::npos);
+
+    FilterOptions by_type;
+    by_type.filter_types = { "Key" };
+    by_type.threads = 4;
+    CHECK_EQ(render(lsofwin::enumerate_handles(replay, by_type)),
+        render(lsofwin::enumerate_handles(live, by_type)));
+
+    FilterOptions by_dir;
+    by_dir.filter_dirs = { { "c:/DATA", false } };
+    CHECK_EQ(lsofwin::enumerate_handles(replay, by_dir).size(), static_cast<size_t>(2));
+
+    CHECK_EQ(src.resolve_calls.load(), resolves); // Replay never touches the source
+}
+
+TEST(replay_rejects_damaged_recordings) {
+    FakeHandleSource src;
+    fill_source(src);
+    std::string bytes = record(src);
+    ReplayHandleSource replay;
+    std::string error;
+
+    CHECK(!replay.open(bytes.data(), 16, error));
+    CHECK(!error.empty());
+
+    std::string bad_magic = bytes;
+    bad_magic[0] = 'X';
+    CHECK(!replay.open(bad_magic.data(), bad_magic.size(), error));
+
+    std::string truncated = bytes.substr(0, bytes.size() - 8);
+    CHECK(!replay.open(truncated.data(), truncated.size(), error));
+    CHECK(error.find("out of bounds") != std::string::npos);
+
+    // A --binary result is not a recording
+    std::string binary = lsofwin::format_binary({});
+    CHECK(!replay.open(binary.data(), binary.size(), error));
+}
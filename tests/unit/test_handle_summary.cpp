@@ -0,0 +1,168 @@
+#include "test_framework.h"
+#include "fake_handle_source.h"
+#include "handle_enumerator.h"
+#include "handle_summary.h"
+
+#include <string>
+
+using lsofwin::FilterOptions;
+using lsofwin::GroupKey;
+using lsofwin::HandleSummary;
+using lsofwin_test::FakeHandleSource;
+
+namespace {
+
+// Two users, three processes; index 4 is missing from the type table.
+void fill_source(FakeHandleSource& src) {
+    src.types_by_index = { "", "", "File", "Key" };
+    src.add_process(100, "notepad.exe", "HOST\\alice");
+    src.add_process(200, "chrome.exe", "HOST\\alice");
+    src.add_process(300, "svchost.exe", "NT AUTHORITY\\SYSTEM");
+    src.add_handle(100, 0x4, "File", "C:\\notes.txt", 2);
+    src.add_handle(100, 0x8, "Key", "\\REGISTRY\\MACHINE", 3);
+    for (uintptr_t h = 0; h < 5; ++h) src.add_handle(200, 0x10 + 4 * h, "File", "C:\\cache\\" + std::to_string(h), 2);
+    src.add_handle(200, 0x40, "Section", "", 4);
+    src.add_handle(300, 0x4, "File", "C:\\Windows\\log.etl", 2);
+    src.add_handle(300, 0x8, "Key", "\\REGISTRY\\USER", 3);
+    src.add_handle(300, 0xc, "Key", "\\REGISTRY\\MACHINE\\SYSTEM", 3);
+}
+
+HandleSummary summarize(FakeHandleSource& src, FilterOptions opts) {
+    return lsofwin::summarize_handles(src, opts);
+}
+
+std::string render(const HandleSummary& summary, bool json, bool ndjson) {
+    std::string text;
+    FilterOptions opts;
+    opts.output_json = json;
+    opts.output_ndjson = ndjson;
+    {
+        lsofwin::OutputBuffer out(lsofwin::string_writer(text));
+        lsofwin::write_summary(out, summary, opts);
+    }
+    return text;
+}
+
+} // anonymous namespace
+
+TEST(summary_counts_by_pid_and_type_without_resolving) {
+    FakeHandleSource src;
+    fill_source(src);
+    FilterOptions opts;
+    opts.group_by = { GroupKey::Pid, GroupKey::Type };
+    auto summary = summarize(src, opts);
+
+    CHECK_EQ(summary.handles, static_cast<uint64_t>(11));
+    CHECK_EQ(summary.groups, static_cast<size_t>(6));
+    CHECK_EQ(summary.rows[0].pid, static_cast<uint32_t>(200));
+    CHECK_EQ(summary.rows[0].process_name, std::string("chrome.exe"));
+    CHECK_EQ(summary.rows[0].type, std::string("File"));
+    CHECK_EQ(summary.rows[0].count, static_cast<uint64_t>(5));
+    CHECK_EQ(summary.rows[1].pid, static_cast<uint32_t>(300));
+    CHECK_EQ(summary.rows[1].type, std::string("Key"));
+    CHECK_EQ(summary.rows[1].count, static_cast<uint64_t>(2));
+    CHECK(summary.rows[0].user.empty()); // Not grouped on
+
+    // Only the handle whose type index the table cannot name was resolved
+    CHECK_EQ(src.resolve_calls.load(), 1);
+    CHECK_EQ(summary.rows[2].pid, static_cast<uint32_t>(100)); // Ties in key order
+    bool section = false;
+    for (const auto& row : summary.rows) section |= row.type == "Section" && row.count == 1;
+    CHECK(section);
+}
+
+TEST(summary_groups_by_user_and_keeps_top_n) {
+    FakeHandleSource src;
+    fill_source(src);
+    FilterOptions opts;
+    opts.group_by = { GroupKey::User };
+    opts.summary_top = 1;
+    opts.threads = 3;
+    auto summary = summarize(src, opts);
+
+    CHECK_EQ(summary.groups, static_cast<size_t>(2));
+    CHECK_EQ(summary.rows.size(), static_cast<size_t>(1));
+    CHECK_EQ(summary.rows[0].user, std::string("HOST\\alice"));
+    CHECK_EQ(summary.rows[0].count, static_cast<uint64_t>(8));
+    CHECK_EQ(summary.handles, static_cast<uint64_t>(11));
+    CHECK_EQ(summary.rows[0].pid, static_cast<uint32_t>(0));
+
+    // Grouping by type alone never looks processes up
+    FakeHandleSource plain;
+    fill_source(plain);
+    opts.group_by = { GroupKey::Type };
+    opts.summary_top = 0;
+    summary = summarize(plain, opts);
+    CHECK_EQ(plain.process_info_calls.load(), 0);
+    CHECK_EQ(summary.rows.size(), static_cast<size_t>(3));
+
+    // -c is decided on names; without a user key no owner is looked up
+    FakeHandleSource named;
+    fill_source(named);
+    opts.group_by = { GroupKey::Pid, GroupKey::Type };
+    opts.filter_process_names = { "chrome" };
+    CHECK(!summarize(named, opts).rows.empty());
+    CHECK_EQ(named.process_info_calls.load(), 0);
+    CHECK(named.process_name_calls.load() > 0);
+
+    lsofwin::HandleCounter counter;
+    std::vector<std::string> type_names;
+    CHECK(lsofwin::count_handles(named, opts, counter, type_names));
+    CHECK_EQ(named.process_info_calls.load(), 0);
+    opts.filter_process_names.clear();
+    CHECK_EQ(summary.rows[0].type, std::string("File"));
+    CHECK_EQ(summary.rows[0].count, static_cast<uint64_t>(7));
+}
+
+TEST(summary_resolves_only_when_filters_need_names) {
+    FakeHandleSource src;
+    fill_source(src);
+    src.rows[2].accessible = false; // One of chrome's files
+    FilterOptions opts;
+    opts.group_by = { GroupKey::Pid };
+    opts.filter_file_regexes = { "^C:\\\\" };
+    opts.filter_types = { "File" };
+    auto summary = summarize(src, opts);
+
+    // -T drops the keys from their index; the section's index is unknown, so
+    // it is resolved to be filtered. -f needs every file's name, and the
+    // inaccessible one is dropped
+    CHECK_EQ(src.resolve_calls.load(), 8);
+    CHECK_EQ(summary.handles, static_cast<uint64_t>(6));
+    CHECK_EQ(summary.rows[0].process_name, std::string("chrome.exe"));
+    CHECK_EQ(summary.rows[0].count, static_cast<uint64_t>(4));
+}
+
+TEST(summary_is_written_as_table_json_and_ndjson) {
+    FakeHandleSource src;
+    fill_source(src);
+    FilterOptions opts;
+    opts.group_by = { GroupKey::Type, GroupKey::Pid };
+    opts.summary_top = 2;
+    auto summary = summarize(src, opts);
+
+    std::string table = render(summary, false, false);
+    CHECK_EQ(table.substr(0, table.find('\n')), std::string("TYPE  COMMAND      PID  COUNT"));
+    CHECK(table.find("\nFile  chrome.exe   200  5\n") != std::string::npos);
+    CHECK(table.find("11 handles in 6 groups, top 2 shown\n") != std::string::npos);
+
+    CHECK_EQ(render(summary, false, true),
+        std::string("{\"type\":\"File\",\"command\":\"chrome.exe\",\"pid\":200,\"count\":5}\n"
+                    "{\"type\":\"Key\",\"command\":\"svchost.exe\",\"pid\":300,\"count\":2}\n"));
+    std::string json = render(summary, true, false);
+    CHECK(json.compare(0, 39, "[\n  {\n    \"type\": \"File\",\n    \"command\"") == 0);
+    CHECK(json.find("\"count\": 2\n  }\n]\n") != std::string::npos);
+
+    CHECK_EQ(render(HandleSummary{}, true, false), std::string("[\n]\n"));
+}
+
+TEST(parse_group_keys_accepts_subsets_in_order) {
+    std::vector<GroupKey> keys;
+    std::string error;
+    CHECK(lsofwin::parse_group_keys("user,pid", keys, error));
+    CHECK(keys == std::vector<GroupKey>({ GroupKey::User, GroupKey::Pid }));
+    CHECK(!lsofwin::parse_group_keys("pid,name", keys, error));
+    CHECK(error.find("name") != std::string::npos);
+    CHECK(!lsofwin::parse_group_keys("type,type", keys, error));
+    CHECK(!lsofwin::parse_group_keys(",", keys, error));
+}
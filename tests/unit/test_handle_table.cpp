@@ -0,0 +1,145 @@
+#include "test_framework.h"
+#include "fake_handle_source.h"
+#include "handle_enumerator.h"
+#include "handle_table.h"
+
+#include <string>
+
+using lsofwin::FilterOptions;
+using lsofwin::HandleInfo;
+using lsofwin::HandleTable;
+using lsofwin_test::FakeHandleSource;
+
+namespace {
+
+HandleInfo make_row(uint32_t pid, const std::string& cmd, const std::string& type,
+    const std::string& name, uintptr_t value) {
+    HandleInfo h;
+    h.pid = pid;
+    h.process_name = cmd;
+    h.user = "HOST\\user";
+    h.handle_type = type;
+    h.object_name = name;
+    h.handle_value = value;
+    return h;
+}
+
+void check_same(const HandleInfo& a, const HandleInfo& b) {
+    CHECK_EQ(a.pid, b.pid);
+    CHECK_EQ(a.process_name, b.process_name);
+    CHECK_EQ(a.user, b.user);
+    CHECK_EQ(a.handle_type, b.handle_type);
+    CHECK_EQ(a.object_name, b.object_name);
+    CHECK_EQ(a.handle_value, b.handle_value);
+    CHECK_EQ(a.granted_access, b.granted_access);
+    CHECK_EQ(a.attributes, b.attributes);
+    CHECK_EQ(a.object, b.object);
+}
+
+} // anonymous namespace
+
+TEST(handle_table_stores_process_fields_once) {
+    HandleTable table;
+    table.push_back(make_row(100, "notepad.exe", "File", "C:\\a.txt", 0x4));
+    table.push_back(make_row(100, "notepad.exe", "File", "C:\\a.txt", 0x8));
+    table.push_back(make_row(200, "explorer.exe", "Key", "\\REGISTRY\\MACHINE", 0x4));
+    table.push_back(make_row(100, "notepad.exe", "Event", "", 0xc));
+
+    CHECK_EQ(table.size(), static_cast<size_t>(4));
+    CHECK_EQ(table.processes().size(), static_cast<size_t>(2));
+    CHECK_EQ(table.name_column()[0], table.name_column()[1]);
+    CHECK_EQ(table.process_column()[3], table.process_column()[0]);
+
+    auto row = table[2];
+    CHECK_EQ(row.pid(), 200u);
+    CHECK_EQ(row.process_name(), std::string_view("explorer.exe"));
+    CHECK_EQ(row.user(), std::string_view("HOST\\user"));
+    CHECK_EQ(row.handle_type(), std::string_view("Key"));
+    CHECK_EQ(row.object_name(), std::string_view("\\REGISTRY\\MACHINE"));
+    CHECK_EQ(row.handle_value(), static_cast<uintptr_t>(0x4));
+    CHECK_EQ(table[3].object_name(), std::string_view());
+}
+
+TEST(handle_table_keeps_reused_pids_apart) {
+    HandleTable table;
+    table.push_back(make_row(100, "old.exe", "File", "x", 0x4));
+    table.push_back(make_row(100, "new.exe", "File", "y", 0x4));
+    CHECK_EQ(table.processes().size(), static_cast<size_t>(2));
+    CHECK_EQ(table[0].process_name(), std::string_view("old.exe"));
+    CHECK_EQ(table[1].process_name(), std::string_view("new.exe"));
+}
+
+TEST(handle_table_overwrites_and_compacts_in_place) {
+    HandleTable table;
+    table.push_back(make_row(100, "old.exe", "File", "C:\\old.txt", 0x4));
+    table.push_back(make_row(200, "keep.exe", "File", "C:\\keep.txt", 0x8));
+    auto replacement = make_row(300, "new.exe", "Key", "\\REGISTRY\\USER", 0xc);
+    replacement.granted_access = 0x20019;
+    table.set(0, replacement);
+    check_same(table[0].to_info(), replacement);
+
+    // The old row's strings and process linger until compact()
+    CHECK(table.strings().find("C:\\old.txt") != lsofwin::StringPool::NotFound);
+    CHECK_EQ(table.processes().size(), static_cast<size_t>(3));
+    table.compact();
+    CHECK(table.strings().find("C:\\old.txt") == lsofwin::StringPool::NotFound);
+    CHECK_EQ(table.processes().size(), static_cast<size_t>(2));
+    CHECK_EQ(table.size(), static_cast<size_t>(2));
+    check_same(table[0].to_info(), replacement);
+    check_same(table[1].to_info(), make_row(200, "keep.exe", "File", "C:\\keep.txt", 0x8));
+}
+
+TEST(handle_table_append_and_list_view_round_trip) {
+    lsofwin::HandleList rows = {
+        make_row(4, "System", "File", "C:\\pagefile.sys", 0x4),
+        make_row(100, "notepad.exe", "File", "C:\\a.txt", 0x8),
+        make_row(100, "notepad.exe", "Key", "\\REGISTRY\\USER", 0xc),
+        make_row(200, "explorer.exe", "File", "C:\\a.txt", 0x10),
+    };
+    rows[1].granted_access = 0x0012019f;
+    rows[2].attributes = 0x2;
+    rows[3].object = 0xffffa000;
+    HandleTable first, second;
+    first.push_back(rows[0]);
+    first.push_back(rows[1]);
+    second.push_back(rows[2]);
+    second.push_back(rows[3]);
+    first.append(second);
+
+    auto list = first.to_list();
+    CHECK_EQ(list.size(), rows.size());
+    for (size_t i = 0; i < rows.size(); ++i) check_same(list[i], rows[i]);
+
+    size_t seen = 0;
+    for (auto row : first) {
+        CHECK_EQ(row.object_name(), std::string_view(rows[seen].object_name));
+        ++seen;
+    }
+    CHECK_EQ(seen, rows.size());
+    CHECK_EQ(first.processes().size(), static_cast<size_t>(3));
+    CHECK(first.memory_bytes() > 0);
+}
+
+TEST(enumerate_handle_table_matches_handle_list) {
+    FakeHandleSource src;
+    for (uint32_t p = 1; p <= 20; ++p) {
+        src.add_process(p * 4, "proc" + std::to_string(p % 3) + ".exe", "HOST\\user");
+        for (uint32_t h = 1; h <= 30; ++h) {
+            src.add_handle(p * 4, h * 4, h % 4 ? "File" : "Key",
+                "C:\\dir" + std::to_string(h % 5) + "\\file" + std::to_string(h) + ".txt", 0, 0x1000 * p + h);
+            src.rows.back().raw.granted_access = 0x00120089 + h;
+            src.rows.back().raw.attributes = h % 3;
+        }
+    }
+
+    for (int threads : { 1, 4 }) {
+        FilterOptions opts;
+        opts.threads = threads;
+        opts.filter_file_regexes = { "dir[12]" };
+        auto list = lsofwin::enumerate_handles(src, opts);
+        auto table = lsofwin::enumerate_handle_table(src, opts);
+        CHECK_EQ(table.size(), list.size());
+        for (size_t i = 0; i < list.size(); ++i) check_same(table[i].to_info(), list[i]);
+        CHECK_EQ(table.processes().size(), static_cast<size_t>(20));
+    }
+}
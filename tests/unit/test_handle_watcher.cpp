@@ -0,0 +1,158 @@
+#include "test_framework.h"
+#include "fake_handle_source.h"
+#include "handle_watcher.h"
+
+#include <string>
+#include <vector>
+
+using lsofwin::FilterOptions;
+using lsofwin::HandleEvent;
+using lsofwin::HandleWatcher;
+using lsofwin_test::FakeHandleSource;
+
+namespace {
+
+void fill_sample(FakeHandleSource& src) {
+    src.add_process(100, "notepad.exe", "HOST\\alice");
+    src.add_process(200, "explorer.exe", "HOST\\bob");
+    src.start_times[100] = 1000;
+    src.start_times[200] = 2000;
+    src.add_handle(100, 0x4, "File", "C:\\Users\\alice\\notes.txt", 0, 0xa000);
+    src.add_handle(100, 0x8, "Key", "\\REGISTRY\\MACHINE\\SOFTWARE", 0, 0xa008);
+    src.add_handle(200, 0x4, "File", "C:\\Windows\\explorer.exe", 0, 0xb000);
+}
+
+// Render events as "+pid:value:name" / "-pid:value:name"
+std::vector<std::string> poll(HandleWatcher& watcher) {
+    std::vector<HandleEvent> events;
+    CHECK(watcher.poll(events));
+    std::vector<std::string> out;
+    for (const auto& e : events) {
+        out.push_back((e.kind == HandleEvent::Kind::Open ? "+" : "-") + std::to_string(e.handle.pid) +
+            ":" + std::to_string(e.handle.handle_value) + ":" + e.handle.object_name);
+    }
+    return out;
+}
+
+void remove_handle(FakeHandleSource& src, uint32_t pid, uintptr_t value) {
+    for (auto it = src.rows.begin(); it != src.rows.end(); ++it) {
+        if (it->raw.pid == pid && it->raw.handle_value == value) {
+            src.rows.erase(it);
+            return;
+        }
+    }
+}
+
+} // anonymous namespace
+
+TEST(watcher_first_poll_opens_everything_then_goes_quiet) {
+    FakeHandleSource src;
+    fill_sample(src);
+    FilterOptions opts;
+    HandleWatcher watcher(src, opts);
+
+    auto first = poll(watcher);
+    CHECK_EQ(first.size(), static_cast<size_t>(3));
+    CHECK_EQ(first[0], std::string("+100:4:C:\\Users\\alice\\notes.txt"));
+    CHECK_EQ(watcher.matching_handles(), static_cast<size_t>(3));
+    CHECK_EQ(src.resolve_calls.load(), 3);
+    CHECK_EQ(src.process_info_calls.load(), 2);
+
+    // Nothing changed: no events, nothing resolved or looked up again
+    CHECK(poll(watcher).empty());
+    CHECK(poll(watcher).empty());
+    CHECK_EQ(src.resolve_calls.load(), 3);
+    CHECK_EQ(src.process_info_calls.load(), 2);
+    CHECK_EQ(watcher.last_stats().handles_seen, static_cast<uint64_t>(3));
+    CHECK_EQ(watcher.last_stats().handles_new, static_cast<uint64_t>(0));
+}
+
+TEST(watcher_reports_opens_and_closes_in_key_order) {
+    FakeHandleSource src;
+    fill_sample(src);
+    FilterOptions opts;
+    HandleWatcher watcher(src, opts);
+    poll(watcher);
+
+    remove_handle(src, 100, 0x8);
+    src.add_handle(100, 0xc, "File", "C:\\Users\\alice\\lock.tmp", 0, 0xa00c);
+    src.add_handle(200, 0x8, "File", "C:\\temp\\x.log", 0, 0xb008);
+
+    auto events = poll(watcher);
+    CHECK_EQ(events.size(), static_cast<size_t>(3));
+    CHECK_EQ(events[0], std::string("-100:8:\\REGISTRY\\MACHINE\\SOFTWARE"));
+    CHECK_EQ(events[1], std::string("+100:12:C:\\Users\\alice\\lock.tmp"));
+    CHECK_EQ(events[2], std::string("+200:8:C:\\temp\\x.log"));
+    CHECK_EQ(src.resolve_calls.load(), 5);
+    CHECK_EQ(watcher.matching_handles(), static_cast<size_t>(4));
+}
+
+TEST(watcher_treats_reused_pid_and_object_as_new_handles) {
+    FakeHandleSource src;
+    fill_sample(src);
+    FilterOptions opts;
+    HandleWatcher watcher(src, opts);
+    poll(watcher);
+
+    // Same handle value, different kernel object
+    src.rows[2].raw.object = 0xc000;
+    src.rows[2].name = "C:\\Windows\\other.dll";
+    auto events = poll(watcher);
+    CHECK_EQ(events.size(), static_cast<size_t>(2));
+    CHECK_EQ(events[0], std::string("-200:4:C:\\Windows\\explorer.exe"));
+    CHECK_EQ(events[1], std::string("+200:4:C:\\Windows\\other.dll"));
+
+    // PID 100 exits and the PID is reused by a new process
+    src.start_times[100] = 5000;
+    src.add_process(100, "cmd.exe", "HOST\\carol");
+    int lookups = src.process_info_calls.load();
+    events = poll(watcher);
+    CHECK_EQ(events.size(), static_cast<size_t>(4));
+    // Keys order by start time, so the old process's handles close first
+    CHECK_EQ(events[0].substr(0, 6), std::string("-100:4"));
+    CHECK_EQ(events[1].substr(0, 6), std::string("-100:8"));
+    CHECK_EQ(events[2].substr(0, 6), std::string("+100:4"));
+    CHECK_EQ(events[3].substr(0, 6), std::string("+100:8"));
+    CHECK_EQ(src.process_info_calls.load(), lookups + 1);
+}
+
+TEST(watcher_does_not_requery_filtered_out_handles) {
+    FakeHandleSource src;
+    fill_sample(src);
+    FilterOptions opts;
+    opts.filter_file_regexes = { "\\.txt$" };
+    HandleWatcher watcher(src, opts);
+
+    auto first = poll(watcher);
+    CHECK_EQ(first.size(), static_cast<size_t>(1));
+    CHECK_EQ(src.resolve_calls.load(), 3);
+    CHECK_EQ(watcher.matching_handles(), static_cast<size_t>(1));
+
+    // Closing a handle that never matched produces no event
+    remove_handle(src, 200, 0x4);
+    CHECK(poll(watcher).empty());
+    CHECK_EQ(src.resolve_calls.load(), 3);
+    // Only the process with a matching handle was looked up
+    CHECK_EQ(src.process_info_calls.load(), 1);
+}
+
+TEST(watcher_applies_pid_and_process_name_filters) {
+    FakeHandleSource src;
+    fill_sample(src);
+    {
+        FilterOptions opts;
+        opts.filter_pids = { 200 };
+        HandleWatcher watcher(src, opts);
+        auto events = poll(watcher);
+        CHECK_EQ(events.size(), static_cast<size_t>(1));
+        CHECK_EQ(events[0].substr(0, 4), std::string("+200"));
+    }
+    {
+        FilterOptions opts;
+        opts.filter_process_names = { "NOTE" };
+        HandleWatcher watcher(src, opts);
+        CHECK_EQ(poll(watcher).size(), static_cast<size_t>(2));
+        src.add_handle(200, 0x10, "File", "C:\\x", 0, 0xb010);
+        CHECK(poll(watcher).empty());
+    }
+}
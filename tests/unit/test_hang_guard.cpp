@@ -0,0 +1,207 @@
+#include "test_framework.h"
+#include "fake_handle_source.h"
+#include "handle_enumerator.h"
+#include "handle_watcher.h"
+#include "hang_guard.h"
+#include "scan_stats.h"
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+using lsofwin::FilterOptions;
+using lsofwin::HangRisk;
+using lsofwin::HangRiskClassifier;
+using lsofwin::RawHandle;
+using lsofwin::ScanDeadline;
+using lsofwin_test::FakeHandleSource;
+
+namespace {
+
+const std::vector<std::string> type_table = { "", "", "File", "Key" };
+
+RawHandle raw(uint32_t pid, uint16_t type_index, uint32_t granted_access) {
+    RawHandle h;
+    h.pid = pid;
+    h.type_index = type_index;
+    h.granted_access = granted_access;
+    return h;
+}
+
+void add_file(FakeHandleSource& src, uint32_t pid, uintptr_t value, const std::string& name,
+    uint32_t granted_access, uint32_t delay_ms = 0) {
+    src.add_handle(pid, value, "File", name, 2);
+    src.rows.back().raw.granted_access = granted_access;
+    src.rows.back().delay_ms = delay_ms;
+}
+
+} // anonymous namespace
+
+TEST(hang_risk_probes_pipe_access_masks_of_file_handles) {
+    HangRiskClassifier classifier(type_table);
+    CHECK(classifier.classify(raw(4, 2, 0x0012019f)) == HangRisk::Probe);
+    CHECK(classifier.classify(raw(4, 2, 0x00100000)) == HangRisk::Probe);
+    CHECK(classifier.classify(raw(4, 2, 0x00120089)) == HangRisk::None);   // Read-only file
+    CHECK(classifier.classify(raw(4, 3, 0x0012019f)) == HangRisk::None);   // Not a File object
+    CHECK(classifier.classify(raw(4, 9, 0x0012019f)) == HangRisk::None);   // Type not in the table
+
+    HangRiskClassifier empty;
+    CHECK(empty.classify(raw(4, 2, 0x0012019f)) == HangRisk::None);
+}
+
+TEST(hang_risk_skips_only_blocking_masks_that_timed_out) {
+    HangRiskClassifier classifier(type_table);
+    classifier.record_timeout(raw(7, 2, 0x0012019f));
+    CHECK(classifier.classify(raw(7, 2, 0x0012019f)) == HangRisk::Skip);   // Same process, same mask
+    CHECK(classifier.classify(raw(8, 2, 0x0012019f)) == HangRisk::Probe);  // Another process
+    CHECK(classifier.classify(raw(7, 2, 0x00120189)) == HangRisk::Probe);  // Another blocking mask
+
+    // Ordinary file masks are never skipped, whatever the process's history
+    classifier.record_timeout(raw(7, 2, 0x00120089));
+    classifier.record_timeout(raw(7, 2, 0x001a019f));
+    CHECK(classifier.classify(raw(7, 2, 0x00120089)) == HangRisk::None);
+    CHECK(classifier.classify(raw(7, 2, 0x00120116)) == HangRisk::None);
+    CHECK(classifier.classify(raw(7, 2, 0x00100001)) == HangRisk::None);   // SYNCHRONIZE alone is no sign
+
+    // Keys time out too, but never for that reason; they are not remembered
+    classifier.record_timeout(raw(9, 3, 0x0012019f));
+    CHECK(classifier.classify(raw(9, 2, 0x0012019f)) == HangRisk::Probe);
+
+    classifier.forget(7);
+    CHECK(classifier.classify(raw(7, 2, 0x0012019f)) == HangRisk::Probe);
+}
+
+TEST(scan_deadline_cuts_query_timeouts_to_the_time_left) {
+    auto start = ScanDeadline::Clock::time_point(std::chrono::seconds(1000));
+    ScanDeadline none;
+    CHECK(!none.active());
+    CHECK(!none.expired(start + std::chrono::hours(1)));
+    CHECK_EQ(none.query_timeout_ms(5000, start), 5000u);
+
+    ScanDeadline deadline(std::chrono::milliseconds(2000), start);
+    CHECK(deadline.active());
+    CHECK_EQ(deadline.query_timeout_ms(5000, start), 2000u);
+    CHECK_EQ(deadline.query_timeout_ms(50, start), 50u);
+    CHECK_EQ(deadline.query_timeout_ms(5000, start + std::chrono::microseconds(1999001)), 1u);
+    CHECK(!deadline.expired(start + std::chrono::milliseconds(1999)));
+    CHECK(deadline.expired(start + std::chrono::milliseconds(2000)));
+    CHECK_EQ(deadline.query_timeout_ms(5000, start), 0u);  // Stays expired
+}
+
+TEST(enumerate_probes_hang_prone_handles_without_skipping_any) {
+    FakeHandleSource src;
+    src.types_by_index = type_table;
+    src.add_process(100, "svc.exe", "SYSTEM");
+    add_file(src, 100, 0x4, "C:\\data.db", 0x00120089);
+    add_file(src, 100, 0x8, "\\Device\\NamedPipe\\a", 0x0012019f, 10000);   // Hangs
+    add_file(src, 100, 0xc, "\\Device\\NamedPipe\\b", 0x0012019f, 10000);
+    add_file(src, 100, 0x10, "C:\\app\\app.log", 0x0012019f);
+
+    FilterOptions opts;
+    for (int threads : { 1, 2 }) {
+        opts.threads = threads;
+        src.resolve_calls = 0;
+        lsofwin::ScanStats stats;
+        auto started = std::chrono::steady_clock::now();
+        auto rows = lsofwin::enumerate_handles(src, opts, nullptr, &stats);
+        CHECK(std::chrono::steady_clock::now() - started < std::chrono::seconds(2));
+
+        // Each pipe costs one probe timeout; the file with the same mask
+        // is still queried and named
+        CHECK_EQ(rows.size(), static_cast<size_t>(4));
+        CHECK_EQ(rows[0].object_name, std::string("C:\\data.db"));
+        CHECK_EQ(rows[1].object_name, std::string());
+        CHECK_EQ(rows[3].object_name, std::string("C:\\app\\app.log"));
+        CHECK_EQ(src.resolve_calls.load(), 4);
+        CHECK_EQ(stats.get(lsofwin::ScanCounter::HangRiskProbed), 3u);
+        CHECK_EQ(stats.get(lsofwin::ScanCounter::TimedOut), 2u);
+    }
+
+    // After two pipe timeouts in the process, the file still matches -f
+    opts.filter_file_regexes = { "app\\.log$" };
+    auto rows = lsofwin::enumerate_handles(src, opts);
+    CHECK_EQ(rows.size(), static_cast<size_t>(1));
+    CHECK_EQ(rows[0].handle_value, static_cast<uintptr_t>(0x10));
+}
+
+TEST(enumerate_returns_partial_results_at_the_deadline) {
+    FakeHandleSource src;
+    src.add_process(100, "svc.exe", "SYSTEM");
+    src.add_process(200, "app.exe", "SYSTEM");
+    src.add_handle(100, 0x4, "File", "C:\\a.txt");
+    src.add_handle(100, 0x8, "Event", "", 0);
+    src.rows.back().delay_ms = 10000;                      // Hangs past -t and the deadline
+    src.add_handle(100, 0xc, "File", "C:\\b.txt");
+    src.add_handle(200, 0x4, "File", "C:\\c.txt");
+
+    FilterOptions opts;
+    opts.deadline_ms = 200;
+    for (int threads : { 1, 2 }) {
+        opts.threads = threads;
+        src.resolve_calls = 0;
+        lsofwin::EnumerationStats stats;
+        auto started = std::chrono::steady_clock::now();
+        auto rows = lsofwin::enumerate_handles(src, opts, &stats);
+        CHECK(std::chrono::steady_clock::now() - started < std::chrono::seconds(2));
+        CHECK(src.last_timeout_ms.load() <= 200u);
+        CHECK(!rows.empty());
+        CHECK_EQ(rows[0].object_name, std::string("C:\\a.txt"));
+        CHECK(stats.handles_past_deadline > 0);
+        CHECK_EQ(rows.size() + stats.handles_past_deadline, static_cast<size_t>(4));
+    }
+
+    // Without a deadline -t applies as before
+    src.rows[1].delay_ms = 0;
+    opts.deadline_ms = 0;
+    opts.threads = 1;
+    opts.timeout_seconds = 1;
+    lsofwin::EnumerationStats stats;
+    CHECK_EQ(lsofwin::enumerate_handles(src, opts, &stats).size(), static_cast<size_t>(4));
+    CHECK_EQ(stats.handles_past_deadline, 0u);
+    CHECK_EQ(src.last_timeout_ms.load(), 1000u);
+}
+
+TEST(watcher_remembers_hung_handles_across_polls) {
+    FakeHandleSource src;
+    src.types_by_index = type_table;
+    src.add_process(100, "svc.exe", "SYSTEM");
+    add_file(src, 100, 0x4, "\\Device\\NamedPipe\\a", 0x0012019f, 10000);
+    FilterOptions opts;
+    lsofwin::HandleWatcher watcher(src, opts);
+    std::vector<lsofwin::HandleEvent> events;
+    CHECK(watcher.poll(events));
+    CHECK_EQ(events.size(), static_cast<size_t>(1));
+    CHECK_EQ(src.resolve_calls.load(), 1);
+
+    // A new handle like the one that hung is not queried; other masks are
+    add_file(src, 100, 0x8, "\\Device\\NamedPipe\\b", 0x0012019f, 10000);
+    add_file(src, 100, 0xc, "C:\\data.db", 0x00120089);
+    events.clear();
+    CHECK(watcher.poll(events));
+    CHECK_EQ(events.size(), static_cast<size_t>(2));
+    CHECK_EQ(events[0].handle.object_name, std::string(lsofwin::HangRiskMarker));
+    CHECK_EQ(events[1].handle.object_name, std::string("C:\\data.db"));
+    CHECK_EQ(src.resolve_calls.load(), 2);
+    CHECK_EQ(watcher.last_stats().hang_risk_skipped, 1u);
+}
+
+TEST(watcher_probes_instead_of_skipping_when_names_are_filtered) {
+    FakeHandleSource src;
+    src.types_by_index = type_table;
+    src.add_process(100, "svc.exe", "SYSTEM");
+    add_file(src, 100, 0x4, "\\Device\\NamedPipe\\a", 0x0012019f, 10000);
+    add_file(src, 100, 0x8, "\\Device\\NamedPipe\\b", 0x0012019f, 10000);
+    FilterOptions opts;
+    opts.filter_file_regexes = { "app\\.log$" };
+    lsofwin::HandleWatcher watcher(src, opts);
+    std::vector<lsofwin::HandleEvent> events;
+    CHECK(watcher.poll(events));
+    CHECK(events.empty());
+
+    // An ordinary file opened with a pipe's mask is queried and matches
+    add_file(src, 100, 0xc, "C:\\app\\app.log", 0x0012019f);
+    CHECK(watcher.poll(events));
+    CHECK_EQ(events.size(), static_cast<size_t>(1));
+    CHECK_EQ(events[0].handle.object_name, std::string("C:\\app\\app.log"));
+    CHECK_EQ(watcher.last_stats().hang_risk_skipped, 0u);
+}
@@ -0,0 +1,268 @@
+#include "test_framework.h"
+#include "fake_handle_source.h"
+#include "cli_parser.h"
+#include "index_server.h"
+
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <csignal>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+using lsofwin::ClientResult;
+using lsofwin::FilterOptions;
+using lsofwin::IndexServer;
+using Answer = lsofwin::IndexServer::Answer;
+using lsofwin_test::FakeHandleSource;
+
+namespace {
+
+void fill_sample(FakeHandleSource& src) {
+    src.add_process(100, "notepad.exe", "HOST\\alice");
+    src.add_process(200, "explorer.exe", "HOST\\bob");
+    src.add_handle(100, 0x4, "File", "C:\\Users\\alice\\notes.txt", 0, 0xa000);
+    src.add_handle(100, 0x8, "Key", "\\REGISTRY\\MACHINE\\SOFTWARE", 0, 0xa008);
+    src.add_handle(200, 0x4, "File", "C:\\Shared\\app.log", 0, 0xb000);
+}
+
+std::string test_socket_path() {
+    auto tag = std::to_string(std::chrono::steady_clock::now().time_since_epoch().count());
+#ifdef _WIN32
+    return "\\\\.\\pipe\\lsofwin-test-" + tag;
+#else
+    return "/tmp/lsofwin-test-" + tag + ".sock";
+#endif
+}
+
+// Refresh only when the test asks to
+FilterOptions server_options() {
+    FilterOptions opts;
+    opts.repeat_seconds = 3600;
+    return opts;
+}
+
+} // anonymous namespace
+
+TEST(server_answers_queries_from_its_index) {
+    FakeHandleSource src;
+    fill_sample(src);
+    auto opts = server_options();
+    IndexServer server(src, opts);
+    CHECK(server.refresh());
+    CHECK_EQ(server.indexed_handles(), static_cast<size_t>(3));
+    int resolves = src.resolve_calls.load();
+
+    std::string out, error;
+    {
+        lsofwin::OutputBuffer buffer(lsofwin::string_writer(out), 64);
+        CHECK(server.answer({ "-f", "^c:\\\\shared\\\\app\\.log$", "--ndjson" }, buffer, error) == Answer::Answered);
+    }
+    CHECK_EQ(out, std::string("{\"command\":\"explorer.exe\",\"pid\":200,\"user\":\"HOST\\\\bob\","
+        "\"type\":\"File\",\"name\":\"C:\\\\Shared\\\\app.log\"}\n"));
+    CHECK_EQ(src.resolve_calls.load(), resolves);
+
+    // Options that are not a query are refused before anything is written
+    std::string refused;
+    lsofwin::OutputBuffer buffer(lsofwin::string_writer(refused), 64);
+    CHECK(server.answer({ "-r", "5" }, buffer, error) == Answer::Rejected);
+    CHECK(server.answer({ "--bogus" }, buffer, error) == Answer::Rejected);
+    CHECK_EQ(error, std::string("Unknown option: --bogus"));
+
+    // So are options a --client run rejects, with the same message
+    CHECK(server.answer({ "--summary" }, buffer, error) == Answer::Rejected);
+    CHECK_EQ(error, std::string("Options --summary and --group-by cannot be combined with -r, --serve, "
+        "--client, --binary, --record or --decode"));
+    CHECK(server.answer({ "-o", "pid,name" }, buffer, error) == Answer::Rejected);
+    CHECK(error.find("Option -o cannot be combined with") == 0);
+    CHECK(server.answer({ "--stats" }, buffer, error) == Answer::Rejected);
+    CHECK(server.answer({ "-l" }, buffer, error) == Answer::Rejected);
+    CHECK(server.answer({ "--deadline", "1" }, buffer, error) == Answer::Rejected);
+    CHECK(server.answer({ "--record", "x.bin" }, buffer, error) == Answer::Rejected);
+    buffer.flush();
+    CHECK(refused.empty());
+}
+
+TEST(filtered_server_answers_only_queries_its_index_covers) {
+    FakeHandleSource src;
+    fill_sample(src);
+    FilterOptions opts;
+    std::string error;
+    const char* argv[] = { "lsofwin", "--serve", "-T", "File", "-c", "note", "-r", "3600" };
+    CHECK(lsofwin::parse_args(8, argv, opts, error));
+    IndexServer server(src, opts);
+    CHECK(server.refresh());
+    CHECK_EQ(server.indexed_handles(), static_cast<size_t>(1));
+
+    auto ask = [&](const std::vector<std::string>& args) {
+        std::string out;
+        lsofwin::OutputBuffer buffer(lsofwin::string_writer(out), 64);
+        return server.answer(args, buffer, error);
+    };
+    CHECK(ask({ "-T", "file", "-c", "notepad" }) == Answer::Answered);
+    CHECK(ask({ "-T", "File", "-c", "note", "-f", "\\.txt$" }) == Answer::Answered);
+
+    // Wider than the index: other types, other processes, or ORed past -c
+    CHECK(ask({ "-c", "notepad" }) == Answer::NotIndexed);
+    CHECK(ask({ "-T", "File,Key", "-c", "notepad" }) == Answer::NotIndexed);
+    CHECK(ask({ "-T", "File" }) == Answer::NotIndexed);
+    CHECK(ask({ "-T", "File", "-c", "no" }) == Answer::NotIndexed);
+    CHECK(ask({ "-T", "File", "-c", "notepad", "-p", "200", "--or" }) == Answer::NotIndexed);
+    CHECK(ask({ "-T", "File", "-p", "100" }) == Answer::NotIndexed);
+
+    // The client is told to scan for itself, before any output
+    auto path = test_socket_path();
+    lsofwin::LocalListener listener;
+    CHECK(listener.listen(path, error));
+    std::thread serving([&] { server.run(listener); });
+    std::string out;
+    CHECK(lsofwin::query_server(path, { "-c", "notepad" }, lsofwin::string_writer(out), error) ==
+        ClientResult::Unavailable);
+    CHECK(out.empty());
+    CHECK(lsofwin::query_server(path, { "-T", "File", "-c", "notepad", "-j" }, lsofwin::string_writer(out), error) ==
+        ClientResult::Answered);
+    CHECK(out.find("notes.txt") != std::string::npos);
+    server.stop();
+    serving.join();
+}
+
+TEST(client_queries_a_running_server) {
+    auto path = test_socket_path();
+    std::string out, error;
+    CHECK(lsofwin::query_server(path, {}, lsofwin::string_writer(out), error) == ClientResult::Unavailable);
+
+    FakeHandleSource src;
+    fill_sample(src);
+    auto opts = server_options();
+    IndexServer server(src, opts);
+    CHECK(server.refresh());
+    lsofwin::LocalListener listener;
+    CHECK(listener.listen(path, error));
+    std::thread serving([&] { server.run(listener); });
+
+    // A second server cannot take over a live endpoint
+    lsofwin::LocalListener second;
+    CHECK(!second.listen(path, error));
+
+    CHECK(lsofwin::query_server(path, { "-p", "100", "--ndjson" }, lsofwin::string_writer(out), error) ==
+        ClientResult::Answered);
+    CHECK(out.find("notes.txt") != std::string::npos);
+    CHECK_EQ(out.find("app.log"), std::string::npos);
+
+    CHECK(lsofwin::query_server(path, { "-x" }, lsofwin::string_writer(out), error) == ClientResult::Failed);
+    CHECK_EQ(error, std::string("Unknown option: -x"));
+
+    // A handle opened after the last refresh shows up once the index catches up
+    src.add_handle(200, 0x8, "File", "C:\\Shared\\new.log", 0, 0xb008);
+    CHECK(server.refresh());
+    out.clear();
+    CHECK(lsofwin::query_server(path, { "-f", "\\.log$", "-j" }, lsofwin::string_writer(out), error) ==
+        ClientResult::Answered);
+    CHECK(out.find("app.log") != std::string::npos);
+    CHECK(out.find("new.log") != std::string::npos);
+
+    server.stop();
+    serving.join();
+}
+
+TEST(server_drops_a_client_that_sends_nothing) {
+    auto path = test_socket_path();
+    std::string out, error;
+    FakeHandleSource src;
+    fill_sample(src);
+    auto opts = server_options();
+    IndexServer server(src, opts);
+    server.set_client_timeout(200);
+    CHECK(server.refresh());
+    lsofwin::LocalListener listener;
+    CHECK(listener.listen(path, error));
+    std::thread serving([&] { server.run(listener); });
+
+    // A client that connects and goes quiet holds the server only until the
+    // timeout; the next client is answered after it
+    lsofwin::LocalStream silent;
+    CHECK(silent.connect(path, error));
+    auto start = std::chrono::steady_clock::now();
+    CHECK(lsofwin::query_server(path, { "-p", "200" }, lsofwin::string_writer(out), error) ==
+        ClientResult::Answered);
+    CHECK(out.find("app.log") != std::string::npos);
+    CHECK(std::chrono::steady_clock::now() - start < std::chrono::seconds(3));
+
+    char header[5];
+    CHECK(silent.read_exact(header, sizeof(header)));
+    CHECK_EQ(header[0], static_cast<char>(lsofwin::IndexFrame::Error));
+
+    server.stop();
+    serving.join();
+}
+
+TEST(client_gives_up_on_a_server_that_never_answers) {
+    auto path = test_socket_path();
+    std::string out, error;
+    lsofwin::LocalListener listener;
+    CHECK(listener.listen(path, error));
+    lsofwin::LocalStream held;
+    std::thread accepting([&] { listener.accept(held); });
+
+    auto start = std::chrono::steady_clock::now();
+    CHECK(lsofwin::query_server(path, { "-p", "100" }, lsofwin::string_writer(out), error, 200) ==
+        ClientResult::Failed);
+    CHECK(std::chrono::steady_clock::now() - start < std::chrono::seconds(3));
+    CHECK_EQ(error, "The server at " + path + " stopped responding");
+    CHECK(out.empty());
+    accepting.join();
+}
+
+TEST(client_trusts_only_servers_of_its_own_user) {
+    auto path = test_socket_path();
+    std::string error;
+    lsofwin::LocalListener listener;
+    CHECK(listener.listen(path, error));
+    lsofwin::LocalStream stream;
+    CHECK(stream.connect(path, error));
+    CHECK(stream.peer_trusted());
+    stream.close();
+    listener.close();
+
+#ifndef _WIN32
+    // Another user listening first on the path: only root can stage that
+    if (::getuid() != 0) return;
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+    pid_t child = ::fork();
+    if (child == 0) {
+        int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (::setuid(65534) != 0 || ::bind(fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) != 0 ||
+            ::listen(fd, 4) != 0) {
+            ::_exit(1);
+        }
+        for (;;) ::pause();
+    }
+    bool listening = false;
+    for (int i = 0; i < 200 && !listening; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        listening = stream.connect(path, error);
+    }
+    CHECK(listening);
+    CHECK(!stream.peer_trusted());
+    stream.close();
+
+    std::string out;
+    CHECK(lsofwin::query_server(path, { "-p", "100" }, lsofwin::string_writer(out), error) ==
+        ClientResult::Unavailable);
+    CHECK(!listener.listen(path, error));
+    CHECK_EQ(error, "A process of another user is listening on " + path);
+
+    ::kill(child, SIGKILL);
+    ::waitpid(child, nullptr, 0);
+    ::unlink(path.c_str());
+#endif
+}
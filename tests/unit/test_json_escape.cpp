@@ -0,0 +1,63 @@
+#include "test_framework.h"
+#include "json_escape.h"
+
+#include <cstdio>
+#include <string>
+
+namespace {
+
+// The original per-character escaper, as the reference
+std::string reference_escape(const std::string& s) {
+    std::string result;
+    for (char c : s) {
+        switch (c) {
+        case '"':  result += "\\\""; break;
+        case '\\': result += "\\\\"; break;
+        case '\b': result += "\\b";  break;
+        case '\f': result += "\\f";  break;
+        case '\n': result += "\\n";  break;
+        case '\r': result += "\\r";  break;
+        case '\t': result += "\\t";  break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20) {
+                char buf[8];
+                snprintf(buf, sizeof(buf), "\\u%04x", static_cast<unsigned char>(c));
+                result += buf;
+            }
+            else {
+                result += c;
+            }
+            break;
+        }
+    }
+    return result;
+}
+
+std::string escape(const std::string& s) {
+    std::string out;
+    lsofwin::append_json_escaped(out, s);
+    return out;
+}
+
+} // anonymous namespace
+
+TEST(find_json_special_stops_at_first_special_byte) {
+    CHECK_EQ(lsofwin::find_json_special("C:/Windows/System32/ntdll.dll"), static_cast<size_t>(29));
+    CHECK_EQ(lsofwin::find_json_special("C:\\Windows"), static_cast<size_t>(2));
+    CHECK_EQ(lsofwin::find_json_special(""), static_cast<size_t>(0));
+    // UTF-8 bytes (>= 0x80) are not special
+    CHECK_EQ(lsofwin::find_json_special("\xc3\xa9\xc3\xa9\xc3\xa9\xc3\xa9\xc3\xa9\xc3\xa9\xc3\xa9\xc3\xa9\"x"),
+        static_cast<size_t>(16));
+}
+
+TEST(json_escape_matches_reference_for_every_byte_and_offset) {
+    for (int c = 0; c < 256; ++c) {
+        for (size_t pos : { 0, 5, 15, 16, 17, 31, 40 }) {
+            std::string s(41, 'x');
+            s[pos] = static_cast<char>(c);
+            CHECK_EQ(escape(s), reference_escape(s));
+        }
+    }
+    std::string mixed = "C:\\Users\\\"quoted\"\\line\nbreak\ttab\x01\x1f end";
+    CHECK_EQ(escape(mixed), reference_escape(mixed));
+}
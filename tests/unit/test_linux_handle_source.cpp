@@ -0,0 +1,71 @@
+#include "test_framework.h"
+#include "handle_enumerator.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstdlib>
+
+TEST(linux_source_sees_own_open_file) {
+    char path[] = "/tmp/lsofwin_test_XXXXXX";
+    int fd = mkstemp(path);
+    CHECK(fd >= 0);
+
+    lsofwin::FilterOptions opts;
+    opts.filter_pids = { static_cast<uint32_t>(getpid()) };
+    auto rows = lsofwin::enumerate_handles(opts);
+
+    bool found = false;
+    for (const auto& h : rows) {
+        if (h.object_name == path) {
+            found = true;
+            CHECK_EQ(h.handle_type, std::string("File"));
+            CHECK_EQ(h.handle_value, static_cast<uintptr_t>(fd));
+        }
+    }
+    close(fd);
+    unlink(path);
+    CHECK(found);
+}
+
+TEST(linux_source_classifies_pipes) {
+    int fds[2];
+    CHECK(pipe(fds) == 0);
+
+    lsofwin::FilterOptions opts;
+    opts.filter_pids = { static_cast<uint32_t>(getpid()) };
+    auto rows = lsofwin::enumerate_handles(opts);
+
+    int pipes = 0;
+    for (const auto& h : rows) {
+        if (h.handle_value == static_cast<uintptr_t>(fds[0]) ||
+            h.handle_value == static_cast<uintptr_t>(fds[1])) {
+            CHECK_EQ(h.handle_type, std::string("Pipe"));
+            ++pipes;
+        }
+    }
+    close(fds[0]);
+    close(fds[1]);
+    CHECK_EQ(pipes, 2);
+}
+
+TEST(linux_source_orders_rows_by_pid_then_fd) {
+    lsofwin::FilterOptions opts;
+    auto rows = lsofwin::enumerate_handles(opts);
+    CHECK(!rows.empty());
+    for (size_t i = 1; i < rows.size(); ++i) {
+        const auto& a = rows[i - 1];
+        const auto& b = rows[i];
+        CHECK(a.pid < b.pid || (a.pid == b.pid && a.handle_value < b.handle_value));
+    }
+}
+
+TEST(linux_source_shows_raw_uids_with_l) {
+    auto source = lsofwin::make_system_handle_source(true);
+    auto info = source->process_info(static_cast<uint32_t>(getpid()));
+    CHECK_EQ(info.user, std::to_string(getuid()));
+
+    auto named = lsofwin::make_system_handle_source()->process_info(static_cast<uint32_t>(getpid()));
+    CHECK(!named.user.empty());
+    CHECK_EQ(named.name, info.name);
+}
@@ -0,0 +1,37 @@
+#include "test_framework.h"
+
+#include <exception>
+#include <iostream>
+
+int main() {
+    std::cout << "=== lsofwin Unit Tests ===\n\n";
+
+    int passed = 0;
+    int failed = 0;
+    std::vector<std::string> failed_names;
+
+    for (const auto& test : lsofwin_test::registry()) {
+        try {
+            test.fn();
+            std::cout << "  PASS: " << test.name << "\n";
+            ++passed;
+        }
+        catch (const lsofwin_test::Failure& f) {
+            std::cout << "  FAIL: " << test.name << " - " << f.message << "\n";
+            failed_names.push_back(test.name);
+            ++failed;
+        }
+        catch (const std::exception& e) {
+            std::cout << "  FAIL: " << test.name << " - exception: " << e.what() << "\n";
+            failed_names.push_back(test.name);
+            ++failed;
+        }
+    }
+
+    std::cout << "\n=== Results: " << passed << " passed, " << failed << " failed, "
+              << (passed + failed) << " total ===\n";
+    for (const auto& name : failed_names) {
+        std::cout << "  - " << name << "\n";
+    }
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,158 @@
+#include "test_framework.h"
+#include "fake_handle_source.h"
+#include "metrics_exporter.h"
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+
+using lsofwin::FilterOptions;
+using lsofwin::MetricsExporter;
+using lsofwin_test::FakeHandleSource;
+
+namespace {
+
+std::chrono::system_clock::time_point at(int seconds) {
+    return std::chrono::system_clock::time_point(std::chrono::seconds(1700000000 + seconds));
+}
+
+std::string text_of(const MetricsExporter& exporter) {
+    std::string text;
+    lsofwin::OutputBuffer out(lsofwin::string_writer(text));
+    exporter.write(out);
+    return text;
+}
+
+bool contains(const std::string& text, const std::string& line) {
+    return text.find(line) != std::string::npos;
+}
+
+void fill_source(FakeHandleSource& src) {
+    src.types_by_index = { "", "", "File", "Key" };
+    src.add_process(100, "notepad.exe", "HOST\\alice");
+    src.add_process(200, "explorer.exe", "HOST\\bob");
+    src.add_handle(100, 0x4, "File", "C:\\a.txt", 2);
+    src.add_handle(100, 0x8, "Key", "\\REGISTRY\\MACHINE", 3);
+    src.add_handle(200, 0x4, "File", "C:\\b.txt", 2);
+    src.add_handle(200, 0x8, "File", "C:\\c.txt", 2);
+    src.add_handle(200, 0xc, "File", "C:\\d.txt", 2);
+}
+
+} // anonymous namespace
+
+TEST(metrics_exporter_counts_without_resolving) {
+    FakeHandleSource src;
+    fill_source(src);
+    MetricsExporter exporter(src, FilterOptions{});
+    CHECK(exporter.sample(at(0)));
+    CHECK_EQ(exporter.samples(), static_cast<uint64_t>(1));
+    CHECK_EQ(src.resolve_calls.load(), 0);
+
+    std::string text = text_of(exporter);
+    CHECK(contains(text, "# TYPE lsofwin_handles gauge\n"));
+    CHECK(contains(text, "lsofwin_handles{pid=\"100\",command=\"notepad.exe\",type=\"File\"} 1\n"));
+    CHECK(contains(text, "lsofwin_handles{pid=\"100\",command=\"notepad.exe\",type=\"Key\"} 1\n"));
+    CHECK(contains(text, "lsofwin_handles{pid=\"200\",command=\"explorer.exe\",type=\"File\"} 3\n"));
+    CHECK(contains(text, "lsofwin_process_handles{pid=\"200\",command=\"explorer.exe\"} 3\n"));
+    CHECK(contains(text, "lsofwin_type_handles{type=\"File\"} 4\n"));
+    CHECK(contains(text, "lsofwin_system_handles 5\n"));
+    CHECK(contains(text, "# UNIT lsofwin_sample_duration_seconds seconds\n"));
+    CHECK(contains(text, "lsofwin_sample_timestamp_seconds 1700000000.000\n"));
+    CHECK(!contains(text, "lsofwin_process_handle_growth{")); // Nothing to compare with yet
+    CHECK_EQ(text.compare(text.size() - 6, 6, "# EOF\n"), 0);
+}
+
+TEST(metrics_exporter_reports_growth_over_the_window) {
+    FakeHandleSource src;
+    fill_source(src);
+    MetricsExporter exporter(src, FilterOptions{}, 3);
+    CHECK(exporter.sample(at(0)));
+    src.add_handle(100, 0xc, "File", "C:\\e.txt", 2);
+    CHECK(exporter.sample(at(10)));
+    src.add_handle(100, 0x10, "File", "C:\\f.txt", 2);
+    src.add_handle(100, 0x14, "File", "C:\\g.txt", 2);
+    CHECK(exporter.sample(at(20)));
+
+    // 2 -> 5 handles over 20 seconds
+    std::string text = text_of(exporter);
+    CHECK(contains(text, "lsofwin_process_handle_growth{pid=\"100\",command=\"notepad.exe\"} 0.1500\n"));
+    CHECK(contains(text, "lsofwin_process_handle_growth{pid=\"200\",command=\"explorer.exe\"} 0.0000\n"));
+    CHECK(contains(text, "lsofwin_system_handle_growth 0.1500\n"));
+
+    // The oldest sample falls out of the ring: 3 -> 5 over 20 seconds
+    CHECK(exporter.sample(at(30)));
+    text = text_of(exporter);
+    CHECK(contains(text, "lsofwin_process_handle_growth{pid=\"100\",command=\"notepad.exe\"} 0.1000\n"));
+}
+
+TEST(metrics_exporter_starts_a_new_series_for_a_reused_pid) {
+    FakeHandleSource src;
+    fill_source(src);
+    src.start_times[200] = 1;
+    MetricsExporter exporter(src, FilterOptions{});
+    CHECK(exporter.sample(at(0)));
+    CHECK_EQ(src.process_name_calls.load(), 2);
+    CHECK_EQ(src.process_info_calls.load(), 0);     // Owners are never shown
+
+    // Same pids, no new lookups
+    CHECK(exporter.sample(at(60)));
+    CHECK_EQ(src.process_name_calls.load(), 2);
+
+    // pid 200 exits and the pid is reused by another program
+    src.start_times[200] = 2;
+    src.add_process(200, "cmd.exe", "HOST\\bob");
+    CHECK(exporter.sample(at(120)));
+    CHECK_EQ(src.process_name_calls.load(), 3);
+
+    std::string text = text_of(exporter);
+    CHECK(contains(text, "lsofwin_process_handles{pid=\"200\",command=\"cmd.exe\"} 3\n"));
+    CHECK(contains(text, "lsofwin_process_handle_growth{pid=\"100\","));
+    CHECK(!contains(text, "lsofwin_process_handle_growth{pid=\"200\","));
+}
+
+TEST(metrics_exporter_escapes_labels_and_honours_top) {
+    FakeHandleSource src;
+    fill_source(src);
+    src.add_process(300, "odd\"name\\\n.exe", "HOST\\carol");
+    src.add_handle(300, 0x4, "Key", "\\REGISTRY\\USER", 3);
+    FilterOptions opts;
+    opts.summary_top = 2;
+    MetricsExporter exporter(src, opts);
+    CHECK(exporter.sample(at(0)));
+
+    std::string text = text_of(exporter);
+    CHECK(contains(text, "lsofwin_process_handles{pid=\"100\","));
+    CHECK(contains(text, "lsofwin_process_handles{pid=\"200\","));
+    CHECK(!contains(text, "lsofwin_process_handles{pid=\"300\","));
+    CHECK(contains(text, "lsofwin_system_handles 6\n")); // Totals still cover every process
+
+    opts.summary_top = 0;
+    MetricsExporter all(src, opts);
+    CHECK(all.sample(at(0)));
+    CHECK(contains(text_of(all), "lsofwin_process_handles{pid=\"300\",command=\"odd\\\"name\\\\\\n.exe\"} 1\n"));
+}
+
+TEST(metrics_exporter_replaces_the_file_in_one_step) {
+    std::string path = "lsofwin_test_metrics.prom";
+    FakeHandleSource src;
+    fill_source(src);
+    MetricsExporter exporter(src, FilterOptions{});
+    CHECK(exporter.sample(at(0)));
+
+    std::string error;
+    CHECK(exporter.write_file(path, error));
+    CHECK(exporter.write_file(path, error)); // Over an existing file
+    std::FILE* f = std::fopen(path.c_str(), "rb");
+    CHECK(f != nullptr);
+    std::string contents;
+    char buffer[4096];
+    size_t n;
+    while ((n = std::fread(buffer, 1, sizeof(buffer), f)) > 0) contents.append(buffer, n);
+    std::fclose(f);
+    CHECK_EQ(contents, text_of(exporter));
+    CHECK(std::fopen((path + ".tmp").c_str(), "rb") == nullptr);
+    std::remove(path.c_str());
+
+    CHECK(!exporter.write_file("no_such_directory/metrics.prom", error));
+    CHECK(!error.empty());
+}
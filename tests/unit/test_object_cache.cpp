@@ -0,0 +1,132 @@
+#include "test_framework.h"
+#include "fake_handle_source.h"
+#include "handle_enumerator.h"
+#include "object_cache.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+using lsofwin::FilterOptions;
+using lsofwin::ObjectCache;
+using lsofwin::ResolvedHandle;
+using lsofwin_test::FakeHandleSource;
+
+TEST(object_cache_miss_then_hit) {
+    ObjectCache cache;
+    ResolvedHandle r;
+    CHECK(cache.acquire(0x1000, r) == ObjectCache::Lookup::Miss);
+
+    ResolvedHandle value;
+    value.type = "Section";
+    value.name = "\\BaseNamedObjects\\shared";
+    cache.publish(0x1000, value);
+
+    CHECK(cache.acquire(0x1000, r) == ObjectCache::Lookup::Hit);
+    CHECK_EQ(r.name, value.name);
+    auto st = cache.stats();
+    CHECK_EQ(st.lookups, 2u);
+    CHECK_EQ(st.hits, 1u);
+}
+
+TEST(object_cache_release_lets_next_caller_resolve) {
+    ObjectCache cache;
+    ResolvedHandle r;
+    CHECK(cache.acquire(0x2000, r) == ObjectCache::Lookup::Miss);
+    cache.release(0x2000);
+    CHECK(cache.acquire(0x2000, r) == ObjectCache::Lookup::Miss);
+}
+
+TEST(object_cache_concurrent_callers_resolve_once) {
+    ObjectCache cache;
+    std::atomic<int> misses{ 0 };
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 8; ++t) {
+        threads.emplace_back([&]() {
+            ResolvedHandle r;
+            if (cache.acquire(0x3000, r) == ObjectCache::Lookup::Miss) {
+                ++misses;
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                ResolvedHandle v;
+                v.name = "pipe";
+                cache.publish(0x3000, v);
+            }
+            else {
+                CHECK_EQ(r.name, std::string("pipe"));
+            }
+        });
+    }
+    for (auto& t : threads) t.join();
+    CHECK_EQ(misses.load(), 1);
+    CHECK_EQ(cache.stats().hits, 7u);
+}
+
+namespace {
+
+// 40 processes holding the same section and the same stuck pipe, plus one
+// private file each.
+void fill_shared_objects(FakeHandleSource& src) {
+    for (uint32_t pid = 1; pid <= 40; ++pid) {
+        src.add_process(pid, "svchost.exe", "SYSTEM");
+        src.add_handle(pid, 4, "Section", "\\Sessions\\1\\BaseNamedObjects\\shm", 0, 0xA000);
+        src.add_handle(pid, 8, "File", "\\Device\\NamedPipe\\stuck", 0, 0xB000);
+        src.rows.back().timed_out = true;
+        src.add_handle(pid, 12, "File", "C:\\p" + std::to_string(pid) + ".log", 0, 0xC000 + pid * 16);
+    }
+}
+
+} // anonymous namespace
+
+TEST(enumerate_dedupes_queries_by_object_address) {
+    FakeHandleSource src;
+    fill_shared_objects(src);
+
+    FilterOptions opts;
+    lsofwin::EnumerationStats stats;
+    auto rows = lsofwin::enumerate_handles(src, opts, &stats);
+
+    CHECK_EQ(rows.size(), static_cast<size_t>(120));
+    // 1 section + 1 pipe + 40 private files
+    CHECK_EQ(src.resolve_calls.load(), 42);
+    CHECK_EQ(stats.handles_resolved, 42u);
+    CHECK_EQ(stats.object_cache.lookups, 120u);
+    CHECK_EQ(stats.object_cache.hits, 78u);
+    CHECK_EQ(stats.object_cache.timeout_hits, 39u);
+    for (const auto& h : rows) {
+        if (h.handle_value == 4) CHECK_EQ(h.object_name, std::string("\\Sessions\\1\\BaseNamedObjects\\shm"));
+        if (h.handle_value == 8) CHECK(h.object_name.empty());
+    }
+}
+
+TEST(enumerate_cache_hits_respect_process_access) {
+    FakeHandleSource src;
+    fill_shared_objects(src);
+    src.inaccessible_pids.insert(7);
+    for (auto& r : src.rows) {
+        if (r.raw.pid == 7) r.accessible = false;
+    }
+
+    FilterOptions opts;
+    auto rows = lsofwin::enumerate_handles(src, opts);
+    CHECK_EQ(rows.size(), static_cast<size_t>(117));
+    for (const auto& h : rows) CHECK(h.pid != 7u);
+}
+
+TEST(enumerate_parallel_dedupes_and_keeps_order) {
+    FakeHandleSource src;
+    fill_shared_objects(src);
+
+    FilterOptions opts;
+    auto serial = lsofwin::enumerate_handles(src, opts);
+    src.resolve_calls = 0;
+    opts.threads = 4;
+    auto parallel = lsofwin::enumerate_handles(src, opts);
+
+    CHECK_EQ(src.resolve_calls.load(), 42);
+    CHECK_EQ(parallel.size(), serial.size());
+    for (size_t i = 0; i < serial.size(); ++i) {
+        CHECK_EQ(parallel[i].pid, serial[i].pid);
+        CHECK_EQ(parallel[i].object_name, serial[i].object_name);
+    }
+}
@@ -0,0 +1,261 @@
+#include "test_framework.h"
+#include "fake_handle_source.h"
+#include "handle_enumerator.h"
+#include "output_formatter.h"
+#include "output_sink.h"
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+using lsofwin::HandleInfo;
+using lsofwin::OutputBuffer;
+
+namespace {
+
+HandleInfo make_row(uint32_t pid, const std::string& cmd, const std::string& type,
+    const std::string& name) {
+    HandleInfo h;
+    h.pid = pid;
+    h.process_name = cmd;
+    h.user = "HOST\\user";
+    h.handle_type = type;
+    h.object_name = name;
+    return h;
+}
+
+std::string run_sink(const std::vector<HandleInfo>& rows,
+    std::unique_ptr<lsofwin::OutputSink> (*make)(OutputBuffer&, size_t), size_t arg) {
+    std::string out;
+    OutputBuffer buffer(lsofwin::string_writer(out), 64);
+    auto sink = make(buffer, arg);
+    for (const auto& h : rows) sink->write(h);
+    sink->finish();
+    return out;
+}
+
+std::unique_ptr<lsofwin::OutputSink> ndjson(OutputBuffer& out, size_t) {
+    return lsofwin::make_ndjson_sink(out);
+}
+
+std::unique_ptr<lsofwin::OutputSink> json_array(OutputBuffer& out, size_t) {
+    return lsofwin::make_json_array_sink(out);
+}
+
+} // anonymous namespace
+
+TEST(output_buffer_flushes_when_full) {
+    std::vector<size_t> writes;
+    {
+        OutputBuffer out([&](const char*, size_t n) { writes.push_back(n); }, 64);
+        out.append(std::string(32, 'a'));
+        out.append(std::string(32, 'b'));
+        CHECK(writes.empty());
+        out.append('c');
+        CHECK_EQ(writes.size(), static_cast<size_t>(1));
+        out.append(std::string(100, 'd')); // larger than the buffer: written through
+        CHECK_EQ(writes.size(), static_cast<size_t>(3));
+        CHECK_EQ(out.bytes_flushed(), 165u);
+    }
+}
+
+TEST(output_buffer_formats_numbers_and_padding_in_place) {
+    std::string out;
+    {
+        OutputBuffer buffer(lsofwin::string_writer(out), 64);
+        buffer.append_fill('.', 150);
+        buffer.append_uint(0);
+        buffer.append(' ');
+        buffer.append_uint(18446744073709551615ull);
+    }
+    CHECK_EQ(out, std::string(150, '.') + "0 18446744073709551615");
+    CHECK_EQ(lsofwin::decimal_digits(0), static_cast<size_t>(1));
+    CHECK_EQ(lsofwin::decimal_digits(4294967295u), static_cast<size_t>(10));
+}
+
+TEST(output_buffer_flushes_first_record_immediately) {
+    std::string out;
+    OutputBuffer buffer(lsofwin::string_writer(out), 1 << 16, std::chrono::milliseconds(60000));
+    buffer.append("row1\n");
+    buffer.end_record();
+    CHECK_EQ(out, std::string("row1\n"));
+    buffer.append("row2\n");
+    buffer.end_record();
+    CHECK_EQ(out, std::string("row1\n")); // Held until the interval passes
+}
+
+TEST(ndjson_sink_writes_one_escaped_object_per_line) {
+    auto out = run_sink({ make_row(4, "a\"b.exe", "File", "C:\\x\ty"), make_row(8, "c", "Key", "") },
+        ndjson, 0);
+    CHECK_EQ(out, std::string(
+        "{\"command\":\"a\\\"b.exe\",\"pid\":4,\"user\":\"HOST\\\\user\",\"type\":\"File\",\"name\":\"C:\\\\x\\ty\"}\n"
+        "{\"command\":\"c\",\"pid\":8,\"user\":\"HOST\\\\user\",\"type\":\"Key\",\"name\":\"\"}\n"));
+}
+
+TEST(json_array_sink_matches_whole_list_format) {
+    CHECK_EQ(run_sink({}, json_array, 0), std::string("[\n]\n"));
+    auto out = run_sink({ make_row(1, "a", "File", "x"), make_row(2, "b", "Key", "\x01") }, json_array, 0);
+    CHECK_EQ(out, std::string(
+        "[\n"
+        "  {\n    \"command\": \"a\",\n    \"pid\": 1,\n    \"user\": \"HOST\\\\user\",\n"
+        "    \"type\": \"File\",\n    \"name\": \"x\"\n  },\n"
+        "  {\n    \"command\": \"b\",\n    \"pid\": 2,\n    \"user\": \"HOST\\\\user\",\n"
+        "    \"type\": \"Key\",\n    \"name\": \"\\u0001\"\n  }\n"
+        "]\n"));
+}
+
+TEST(table_sink_sizes_columns_from_sample) {
+    std::vector<HandleInfo> rows = {
+        make_row(1, "a.exe", "File", "x"),
+        make_row(22, "b.exe", "Key", "y"),
+        make_row(333333, "a-much-longer-name.exe", "Event", "z"),
+    };
+    auto out = run_sink(rows, lsofwin::make_table_sink, 2);
+    CHECK_EQ(out, std::string(
+        "COMMAND  PID  USER       TYPE  NAME\n"
+        "a.exe    1    HOST\\user  File  x\n"
+        "b.exe    22   HOST\\user  Key   y\n"
+        "a-much~  333333 HOST\\user  Eve~  z\n"));
+
+    // With the whole list as the sample it is the classic table
+    CHECK_EQ(run_sink(rows, lsofwin::make_table_sink, rows.size()), lsofwin::format_table(rows));
+    CHECK_EQ(run_sink({}, lsofwin::make_table_sink, 10), std::string("No open handles found.\n"));
+}
+
+TEST(table_sink_fixed_widths_start_immediately) {
+    std::string out;
+    OutputBuffer buffer(lsofwin::string_writer(out), 1 << 16, std::chrono::milliseconds(60000));
+    auto sink = lsofwin::make_table_sink(buffer, 0);
+    sink->write(make_row(1, "a.exe", "File", "x"));
+    CHECK(out.find("a.exe") != std::string::npos);
+    CHECK_EQ(out.find("PID"), static_cast<size_t>(27));
+}
+
+TEST(table_sink_with_preset_widths_matches_sampled_table) {
+    std::vector<HandleInfo> rows = {
+        make_row(1, "a.exe", "File", "x"),
+        make_row(333333, "a-much-longer-name-than-the-column-cap.exe", "Event", "z"),
+    };
+    auto widths = lsofwin::table_widths(rows);
+    CHECK_EQ(widths.command, static_cast<size_t>(25));
+    CHECK_EQ(widths.pid, static_cast<size_t>(6));
+
+    std::string out;
+    {
+        OutputBuffer buffer(lsofwin::string_writer(out), 64);
+        auto sink = lsofwin::make_table_sink(buffer, widths);
+        for (const auto& h : rows) sink->write(h);
+        sink->finish();
+    }
+    CHECK_EQ(out, run_sink(rows, lsofwin::make_table_sink, rows.size()));
+
+    // No rows: the message instead of a bare header
+    std::string empty;
+    {
+        OutputBuffer buffer(lsofwin::string_writer(empty), 64);
+        lsofwin::make_table_sink(buffer, lsofwin::TableWidths{})->finish();
+    }
+    CHECK_EQ(empty, std::string("No open handles found.\n"));
+}
+
+TEST(output_sinks_show_the_selected_fields) {
+    auto row = make_row(4, "a.exe", "File", "C:\\x");
+    row.handle_value = 0x1c;
+    row.granted_access = 0x0012019f;
+    row.attributes = 0x2;
+    row.object = 0xffffa0;
+    auto run = [&](lsofwin::FilterOptions opts) {
+        std::string out;
+        {
+            OutputBuffer buffer(lsofwin::string_writer(out), 64);
+            auto sink = lsofwin::make_output_sink(buffer, opts);
+            sink->write(row);
+            sink->finish();
+        }
+        return out;
+    };
+    std::string object = sizeof(uintptr_t) == 8 ? "0x0000000000ffffa0" : "0x00ffffa0";
+
+    lsofwin::FilterOptions opts;
+    opts.fields = { lsofwin::OutputField::Pid, lsofwin::OutputField::Fd, lsofwin::OutputField::Type };
+    opts.table_sample_rows = 10;
+    CHECK_EQ(run(opts), std::string(
+        "PID  FD  TYPE\n"
+        "4    28  File\n"));
+
+    opts.fields = { lsofwin::OutputField::Name, lsofwin::OutputField::Access, lsofwin::OutputField::Attributes,
+        lsofwin::OutputField::Object };
+    CHECK_EQ(run(opts), std::string(
+        "NAME  ACCESS      ATTR        OBJECT\n"
+        "C:\\x  0x0012019f  0x00000002  ") + object + "\n");
+
+    opts.output_ndjson = true;
+    CHECK_EQ(run(opts), std::string(
+        "{\"name\":\"C:\\\\x\",\"access\":\"0x0012019f\",\"attr\":\"0x00000002\",\"object\":\"") + object + "\"}\n");
+
+    opts.output_ndjson = false;
+    opts.output_json = true;
+    opts.fields = { lsofwin::OutputField::Fd, lsofwin::OutputField::Command };
+    CHECK_EQ(run(opts), std::string("[\n  {\n    \"fd\": 28,\n    \"command\": \"a.exe\"\n  }\n]\n"));
+
+    // No -o: the default columns, as the plain factories write them
+    opts.fields.clear();
+    CHECK_EQ(run(opts), run_sink({ row }, json_array, 0));
+}
+
+TEST(delta_sinks_mark_opened_and_closed_rows) {
+    lsofwin::HandleEvent opened{ lsofwin::HandleEvent::Kind::Open, make_row(7, "a.exe", "File", "C:\\x") };
+    lsofwin::HandleEvent closed{ lsofwin::HandleEvent::Kind::Close, make_row(7, "a.exe", "File", "C:\\y") };
+
+    std::string table;
+    {
+        OutputBuffer buffer(lsofwin::string_writer(table), 64);
+        lsofwin::FilterOptions opts;
+        auto sink = lsofwin::make_delta_sink(buffer, opts);
+        sink->write(opened);
+        sink->write(closed);
+        sink->end_pass();
+    }
+    auto second_line = table.find('\n') + 1;
+    CHECK_EQ(table.substr(0, 9), std::string("  COMMAND"));
+    CHECK_EQ(table.substr(second_line, 7), std::string("+ a.exe"));
+    CHECK(table.find("- a.exe") != std::string::npos);
+    CHECK(table.find("C:\\y\n") != std::string::npos);
+
+    std::string json;
+    {
+        OutputBuffer buffer(lsofwin::string_writer(json), 64);
+        lsofwin::FilterOptions opts;
+        opts.output_json = true;
+        auto sink = lsofwin::make_delta_sink(buffer, opts);
+        sink->write(closed);
+        sink->end_pass();
+    }
+    CHECK_EQ(json, std::string("{\"event\":\"close\",\"command\":\"a.exe\",\"pid\":7,"
+        "\"user\":\"HOST\\\\user\",\"type\":\"File\",\"name\":\"C:\\\\y\"}\n"));
+}
+
+TEST(stream_handles_emits_rows_in_list_order) {
+    lsofwin_test::FakeHandleSource src;
+    for (uint32_t pid = 1; pid <= 200; ++pid) {
+        src.add_process(pid, "p" + std::to_string(pid), "u");
+        size_t count = pid % 50 == 0 ? 3000 : pid % 5 + 1;
+        for (uintptr_t h = 1; h <= count; ++h) src.add_handle(pid, h * 4, "File", "f" + std::to_string(h));
+    }
+
+    for (int threads : { 1, 4 }) {
+        lsofwin::FilterOptions opts;
+        opts.threads = threads;
+        auto expected = lsofwin::enumerate_handles(src, opts);
+
+        std::vector<HandleInfo> streamed;
+        lsofwin::stream_handles(src, opts, [&](const HandleInfo& h) { streamed.push_back(h); });
+        CHECK_EQ(streamed.size(), expected.size());
+        bool same = true;
+        for (size_t i = 0; i < streamed.size() && same; ++i) {
+            same = streamed[i].pid == expected[i].pid &&
+                streamed[i].handle_value == expected[i].handle_value;
+        }
+        CHECK(same);
+    }
+}
@@ -0,0 +1,88 @@
+#include "test_framework.h"
+#include "path_matcher.h"
+
+#include <cstdio>
+#include <regex>
+#include <string>
+#include <vector>
+
+using lsofwin::PathMatcher;
+
+namespace {
+
+const std::vector<std::string> sample_paths = {
+    "C:\\Users\\John\\Documents\\myfile.docx",
+    "C:\\Users\\John\\AppData\\Local\\Temp\\build.LOG",
+    "C:\\Users\\jane\\appdata\\roaming\\settings.json",
+    "C:\\Windows\\System32\\ntdll.dll",
+    "C:\\Windows\\System32\\en-US\\shell32.dll.mui",
+    "C:\\logs\\app.log.bak",
+    "C:\\logs\\trace.txt",
+    "\\REGISTRY\\MACHINE\\SOFTWARE\\Microsoft",
+    "\\Device\\NamedPipe\\lsass",
+    "\\Device\\Afd\\Endpoint",
+    "\\\\fileserver\\share\\Report 2024.xlsx",
+    "D:\\data\\1234\\log_01.txt",
+    "",
+    "a$b",
+    "tab\there",
+};
+
+const std::vector<std::string> sample_patterns = {
+    "myfile\\.docx", "\\.LOG$", "^c:\\\\windows", "^\\\\device\\\\afd\\\\endpoint$",
+    "\\.(log|txt)$", "C:\\\\Users\\\\.*\\\\AppData", "[0-9]+\\\\log_\\d{2}\\.txt",
+    "system32\\\\(en-us\\\\)?shell", "[^a-z]dll", "(?:pipe|afd)\\\\", "x*", "^$",
+    "\\$b", "a\\$", "\\t", "[A-Z]:\\\\[a-z]+\\\\app", "\\\\\\\\file.+\\.xlsx$",
+    "REGISTRY|NamedPipe", "([a-z])\\1", "\\bdll", "(?=.*log)c:", ".{40,}", "\\w+\\s\\d{4}",
+};
+
+} // anonymous namespace
+
+TEST(path_matcher_picks_literal_strategies) {
+    CHECK(PathMatcher("myfile\\.docx").strategy() == PathMatcher::Strategy::Substring);
+    CHECK_EQ(PathMatcher("myfile\\.docx").literal(), std::string("myfile.docx"));
+    CHECK(PathMatcher("\\.log$").strategy() == PathMatcher::Strategy::Suffix);
+    CHECK(PathMatcher("^C:\\\\Windows").strategy() == PathMatcher::Strategy::Prefix);
+    CHECK_EQ(PathMatcher("^C:\\\\Windows").literal(), std::string("c:\\windows"));
+    CHECK(PathMatcher("^nul$").strategy() == PathMatcher::Strategy::Exact);
+    CHECK(PathMatcher("(?:REGISTRY)").strategy() == PathMatcher::Strategy::Substring);
+}
+
+TEST(path_matcher_compiles_regex_subset_to_dfa) {
+    PathMatcher m("C:\\\\Users\\\\.*\\\\AppData");
+    CHECK(m.strategy() == PathMatcher::Strategy::Dfa);
+    CHECK_EQ(m.literal(), std::string("c:\\users\\"));
+    CHECK(PathMatcher("\\.(log|txt)$").strategy() == PathMatcher::Strategy::Dfa);
+}
+
+TEST(path_matcher_falls_back_to_std_regex) {
+    CHECK(PathMatcher("([a-z])\\1").strategy() == PathMatcher::Strategy::StdRegex);
+    CHECK(PathMatcher("\\bdll").strategy() == PathMatcher::Strategy::StdRegex);
+    CHECK(PathMatcher("(?=.*log)c:").strategy() == PathMatcher::Strategy::StdRegex);
+}
+
+TEST(path_matcher_rejects_invalid_patterns) {
+    bool threw = false;
+    try {
+        PathMatcher m("[unclosed");
+    }
+    catch (const std::regex_error&) {
+        threw = true;
+    }
+    CHECK(threw);
+}
+
+TEST(path_matcher_agrees_with_std_regex_search) {
+    for (const auto& pattern : sample_patterns) {
+        PathMatcher m(pattern);
+        std::regex re(pattern, std::regex::icase);
+        for (const auto& path : sample_paths) {
+            bool expected = std::regex_search(path, re);
+            if (m.matches(path) != expected) {
+                std::printf("    mismatch: pattern=%s path=%s expected=%d\n",
+                    pattern.c_str(), path.c_str(), expected ? 1 : 0);
+            }
+            CHECK(m.matches(path) == expected);
+        }
+    }
+}
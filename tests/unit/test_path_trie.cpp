@@ -0,0 +1,118 @@
+#include "test_framework.h"
+#include "path_trie.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+using lsofwin::DirectoryFilter;
+using lsofwin::PathComponents;
+using lsofwin::PathTrie;
+
+namespace {
+
+// Components joined with '|'
+std::string split(const std::string& path) {
+    std::string out;
+    PathComponents parts(path);
+    while (parts.next()) {
+        if (!out.empty()) out += '|';
+        out += std::string(parts.lowered());
+    }
+    return out;
+}
+
+std::vector<uint32_t> lookup(const PathTrie& trie, const std::string& path, PathTrie::Scope scope) {
+    std::vector<uint32_t> out;
+    trie.lookup(path, scope, out);
+    std::sort(out.begin(), out.end());
+    return out;
+}
+
+std::string join(const std::vector<uint32_t>& values) {
+    std::string out;
+    for (auto v : values) out += std::to_string(v) + ",";
+    return out;
+}
+
+} // anonymous namespace
+
+TEST(path_components_normalize_windows_and_posix_paths) {
+    CHECK_EQ(split("C:\\Users\\Alice\\"), std::string("c:|users|alice"));
+    CHECK_EQ(split("c:/users//alice/./x.txt"), std::string("c:|users|alice|x.txt"));
+    CHECK_EQ(split("/home/alice"), std::string("/|home|alice"));
+    CHECK_EQ(split("\\REGISTRY\\MACHINE"), std::string("/|registry|machine"));
+    CHECK_EQ(split("\\\\Server\\Share\\f"), std::string("//|server|share|f"));
+    CHECK_EQ(split("socket:[1234]"), std::string("socket:[1234]"));
+    CHECK_EQ(split(""), std::string(""));
+}
+
+TEST(directory_filter_matches_dir_children_or_subtree) {
+    DirectoryFilter top("C:\\Users\\Alice", false);
+    CHECK(top.matches("C:\\Users\\Alice"));
+    CHECK(top.matches("c:/users/alice/notes.txt"));
+    CHECK(top.matches("C:\\Users\\Alice\\Docs"));
+    CHECK(!top.matches("C:\\Users\\Alice\\Docs\\a.txt"));
+    CHECK(!top.matches("C:\\Users\\Alice2\\a.txt"));  // Sibling sharing a prefix
+    CHECK(!top.matches("C:\\Users"));
+    CHECK(!top.matches(""));
+
+    DirectoryFilter subtree("/var/log/", true);
+    CHECK(subtree.matches("/var/log/nginx/access.log"));
+    CHECK(subtree.matches("/VAR/LOG"));
+    CHECK(!subtree.matches("/var/logs/x"));
+    CHECK(!subtree.matches("var/log/x"));  // Relative is not under the root
+
+    CHECK(!DirectoryFilter().active());
+    CHECK(!DirectoryFilter().matches("C:\\x"));
+}
+
+TEST(path_trie_looks_up_exact_children_and_subtree) {
+    PathTrie trie;
+    trie.insert("C:\\Users\\Alice", 1);
+    trie.insert("C:\\Users\\Alice\\notes.txt", 2);
+    trie.insert("c:/users/alice/NOTES.TXT", 3);      // Same path, another holder
+    trie.insert("C:\\Users\\Alice\\Docs\\a.txt", 4);
+    trie.insert("C:\\Users\\Bob\\b.txt", 5);
+    trie.insert("/home/alice/x", 6);
+    CHECK_EQ(trie.size(), static_cast<size_t>(6));
+
+    CHECK_EQ(join(lookup(trie, "C:\\USERS\\alice\\notes.txt", PathTrie::Scope::Exact)), std::string("2,3,"));
+    CHECK_EQ(join(lookup(trie, "C:\\Users\\Alice", PathTrie::Scope::Children)), std::string("1,2,3,"));
+    CHECK_EQ(join(lookup(trie, "C:\\Users\\Alice\\", PathTrie::Scope::Subtree)), std::string("1,2,3,4,"));
+    CHECK_EQ(join(lookup(trie, "c:", PathTrie::Scope::Subtree)), std::string("1,2,3,4,5,"));
+    CHECK_EQ(join(lookup(trie, "/", PathTrie::Scope::Subtree)), std::string("6,"));
+    CHECK(lookup(trie, "C:\\Users\\Carol", PathTrie::Scope::Subtree).empty());
+    CHECK(lookup(trie, "C:\\Users", PathTrie::Scope::Exact).empty());
+}
+
+TEST(path_trie_erase_prunes_empty_branches) {
+    PathTrie trie;
+    size_t empty_nodes = trie.node_count();
+    trie.insert("C:\\a\\b\\c.txt", 1);
+    trie.insert("C:\\a\\b\\c.txt", 2);
+    trie.insert("C:\\a\\d.txt", 3);
+    size_t full_nodes = trie.node_count();
+
+    CHECK(!trie.erase("C:\\a\\b\\c.txt", 9));
+    CHECK(!trie.erase("C:\\nope", 1));
+    CHECK(trie.erase("c:/A/B/C.TXT", 1));
+    CHECK_EQ(trie.node_count(), full_nodes);     // Still holds value 2
+    CHECK(trie.erase("C:\\a\\b\\c.txt", 2));
+    CHECK_EQ(trie.node_count(), full_nodes - 2); // b and c.txt are gone
+    CHECK_EQ(join(lookup(trie, "C:\\a", PathTrie::Scope::Subtree)), std::string("3,"));
+
+    CHECK(trie.erase("C:\\a\\d.txt", 3));
+    CHECK_EQ(trie.node_count(), empty_nodes);
+    CHECK_EQ(trie.size(), static_cast<size_t>(0));
+
+    // Freed nodes are reused
+    trie.insert("C:\\a\\e.txt", 4);
+    CHECK_EQ(join(lookup(trie, "C:\\A", PathTrie::Scope::Children)), std::string("4,"));
+
+    // Inserting a stored value again moves it
+    trie.insert("C:\\a\\f.txt", 4);
+    CHECK_EQ(trie.size(), static_cast<size_t>(1));
+    CHECK(!trie.erase("C:\\a\\e.txt", 4));
+    CHECK_EQ(join(lookup(trie, "C:\\a\\f.txt", PathTrie::Scope::Exact)), std::string("4,"));
+}
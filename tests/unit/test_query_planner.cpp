@@ -0,0 +1,137 @@
+#include "test_framework.h"
+#include "fake_handle_source.h"
+#include "handle_enumerator.h"
+#include "query_planner.h"
+
+using lsofwin::FilterOptions;
+using lsofwin::PidIndex;
+using lsofwin_test::FakeHandleSource;
+
+namespace {
+
+// Grouped by PID like the real table, with PID 7 split into two runs
+void fill_grouped(FakeHandleSource& src) {
+    src.add_process(3, "svchost.exe", "SYSTEM");
+    src.add_process(7, "MyService.exe", "SYSTEM");
+    src.add_process(9, "notepad.exe", "HOST\\alice");
+    for (uintptr_t h = 1; h <= 4; ++h) src.add_handle(7, h * 4, "File", "C:\\a" + std::to_string(h));
+    for (uintptr_t h = 1; h <= 3; ++h) src.add_handle(3, h * 4, "Key", "\\REGISTRY\\k" + std::to_string(h));
+    for (uintptr_t h = 1; h <= 2; ++h) src.add_handle(9, h * 4, "File", "C:\\n" + std::to_string(h));
+    src.add_handle(7, 0x100, "Event", "late");
+}
+
+std::vector<lsofwin::RawHandle> table_of(FakeHandleSource& src) {
+    std::vector<lsofwin::RawHandle> table;
+    src.snapshot(table);
+    return table;
+}
+
+} // anonymous namespace
+
+TEST(pid_index_records_runs_in_table_order) {
+    FakeHandleSource src;
+    fill_grouped(src);
+    auto table = table_of(src);
+    PidIndex index(table);
+
+    CHECK_EQ(index.runs().size(), static_cast<size_t>(4));
+    CHECK_EQ(index.runs()[1].pid, 3u);
+    CHECK_EQ(index.runs()[1].begin, static_cast<size_t>(4));
+    CHECK_EQ(index.runs()[1].end, static_cast<size_t>(7));
+
+    auto pids = index.pids();
+    CHECK_EQ(pids.size(), static_cast<size_t>(3));
+    CHECK_EQ(pids[0], 3u);
+    CHECK_EQ(pids[2], 9u);
+}
+
+TEST(pid_index_finds_every_run_of_a_pid) {
+    FakeHandleSource src;
+    fill_grouped(src);
+    auto table = table_of(src);
+    PidIndex index(table);
+
+    auto runs = index.find(7);
+    CHECK_EQ(runs.size(), static_cast<size_t>(2));
+    CHECK_EQ(runs[0].begin, static_cast<size_t>(0));
+    CHECK_EQ(runs[1].begin, static_cast<size_t>(9));
+    CHECK(index.find(8).empty());
+    CHECK(PidIndex(std::vector<lsofwin::RawHandle>()).runs().empty());
+}
+
+TEST(plan_scan_selects_pid_ranges_without_process_lookups) {
+    FakeHandleSource src;
+    fill_grouped(src);
+    auto table = table_of(src);
+
+    FilterOptions opts;
+    opts.filter_pids = { 7 };
+    auto plan = lsofwin::plan_scan(PidIndex(table), src, lsofwin::FilterExpr(opts), 1);
+    CHECK_EQ(plan.ranges.size(), static_cast<size_t>(2));
+    CHECK_EQ(plan.handles, static_cast<size_t>(5));
+    CHECK_EQ(plan.processes_matched, static_cast<size_t>(1));
+    CHECK_EQ(src.process_info_calls.load(), 0);
+}
+
+TEST(plan_scan_matches_process_names_once_per_pid) {
+    FakeHandleSource src;
+    fill_grouped(src);
+    auto table = table_of(src);
+
+    FilterOptions opts;
+    opts.filter_process_names = { "myservice" };
+    auto plan = lsofwin::plan_scan(PidIndex(table), src, lsofwin::FilterExpr(opts), 2);
+    CHECK_EQ(src.process_name_calls.load(), 3);
+    CHECK_EQ(src.process_info_calls.load(), 1);    // Owner of the match only
+    CHECK_EQ(plan.handles, static_cast<size_t>(5));
+    CHECK_EQ(plan.processes.size(), static_cast<size_t>(1));
+    CHECK_EQ(plan.processes.at(7).name, std::string("MyService.exe"));
+    CHECK_EQ(plan.processes.at(7).user, std::string("SYSTEM"));
+
+    // Without owners, names alone
+    src.process_name_calls = 0;
+    src.process_info_calls = 0;
+    plan = lsofwin::plan_scan(PidIndex(table), src, lsofwin::FilterExpr(opts), 1, false);
+    CHECK_EQ(src.process_name_calls.load(), 3);
+    CHECK_EQ(src.process_info_calls.load(), 0);
+    CHECK(plan.processes.at(7).user.empty());
+
+    opts.filter_pids = { 3 };
+    CHECK(lsofwin::plan_scan(PidIndex(table), src, lsofwin::FilterExpr(opts), 1).ranges.empty());
+}
+
+TEST(split_shards_caps_range_size) {
+    auto shards = lsofwin::split_shards({ { 0, 10 }, { 20, 23 } }, 4);
+    CHECK_EQ(shards.size(), static_cast<size_t>(4));
+    CHECK_EQ(shards[2].begin, static_cast<size_t>(8));
+    CHECK_EQ(shards[2].end, static_cast<size_t>(10));
+    CHECK_EQ(shards[3].begin, static_cast<size_t>(20));
+}
+
+TEST(enumerate_process_filter_walks_only_matching_ranges) {
+    // 400 processes; only the target's handles should be walked or resolved
+    FakeHandleSource src;
+    for (uint32_t pid = 1; pid <= 400; ++pid) {
+        src.add_process(pid, pid == 250 ? "myservice.exe" : "proc" + std::to_string(pid) + ".exe", "u");
+        for (uintptr_t h = 1; h <= 50; ++h) src.add_handle(pid, h * 4, "File", "C:\\f");
+    }
+
+    for (int threads : { 1, 4 }) {
+        src.process_info_calls = 0;
+        src.process_name_calls = 0;
+        src.resolve_calls = 0;
+        FilterOptions opts;
+        opts.filter_process_names = { "MYSERVICE" };
+        opts.threads = threads;
+        lsofwin::EnumerationStats stats;
+        auto rows = lsofwin::enumerate_handles(src, opts, &stats);
+
+        CHECK_EQ(rows.size(), static_cast<size_t>(50));
+        CHECK_EQ(stats.handles_seen, 20000u);
+        CHECK_EQ(stats.handles_scanned, 50u);
+        CHECK_EQ(stats.processes_matched, 1u);
+        CHECK_EQ(src.resolve_calls.load(), 50);
+        CHECK_EQ(src.process_name_calls.load(), 400);
+        CHECK_EQ(src.process_info_calls.load(), 1);   // Only the match's owner
+    }
+}
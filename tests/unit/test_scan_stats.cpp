@@ -0,0 +1,156 @@
+#include "test_framework.h"
+#include "fake_handle_source.h"
+#include "handle_enumerator.h"
+#include "scan_stats.h"
+
+#include <string>
+
+using lsofwin::FilterOptions;
+using lsofwin::LatencyHistogram;
+using lsofwin::ScanCounter;
+using lsofwin::ScanPhase;
+using lsofwin::ScanStats;
+using lsofwin_test::FakeHandleSource;
+
+namespace {
+
+// Remembers whether the backend had the stats while it was resolving.
+class ProbeSource : public FakeHandleSource {
+public:
+    bool resolve(const lsofwin::RawHandle& entry, size_t index, uint32_t timeout_ms,
+        lsofwin::ResolvedHandle& out) override {
+        stats_during_resolve = stats;
+        return FakeHandleSource::resolve(entry, index, timeout_ms, out);
+    }
+
+    ScanStats* stats_during_resolve = nullptr;
+};
+
+// One handle for every way a row can be dropped.
+void fill_source(FakeHandleSource& src) {
+    src.types_by_index = { "", "", "File", "Key" };
+    src.add_process(100, "notepad.exe", "HOST\\alice");
+    src.add_process(200, "explorer.exe", "HOST\\bob");
+    src.add_process(300, "locked.exe", "HOST\\bob");
+    src.add_handle(100, 0x4, "File", "C:\\Users\\alice\\notes.txt", 2);
+    src.add_handle(100, 0x8, "Key", "\\REGISTRY\\MACHINE\\SOFTWARE", 3);
+    src.add_handle(100, 0xc, "File", "\\Device\\NamedPipe\\stuck", 2);
+    src.rows.back().timed_out = true;
+    src.add_handle(200, 0x4, "File", "C:\\Windows\\explorer.exe", 2, 0xa0);
+    src.add_handle(200, 0x8, "File", "C:\\secret.exe", 2);
+    src.rows.back().accessible = false;
+    src.add_handle(300, 0x4, "File", "C:\\Windows\\explorer.exe", 2, 0xa0);
+    src.inaccessible_pids.insert(300);
+}
+
+} // anonymous namespace
+
+TEST(latency_histogram_uses_power_of_two_microsecond_buckets) {
+    CHECK_EQ(LatencyHistogram::bucket_for(0), static_cast<size_t>(0));
+    CHECK_EQ(LatencyHistogram::bucket_for(999), static_cast<size_t>(0));
+    CHECK_EQ(LatencyHistogram::bucket_for(1000), static_cast<size_t>(1));
+    CHECK_EQ(LatencyHistogram::bucket_for(1999), static_cast<size_t>(1));
+    CHECK_EQ(LatencyHistogram::bucket_for(2000), static_cast<size_t>(2));
+    CHECK_EQ(LatencyHistogram::bucket_for(UINT64_MAX), LatencyHistogram::BucketCount - 1);
+    CHECK_EQ(LatencyHistogram::bucket_limit_us(0), static_cast<uint64_t>(1));
+    CHECK_EQ(LatencyHistogram::bucket_limit_us(2), static_cast<uint64_t>(4));
+    CHECK_EQ(LatencyHistogram::bucket_limit_us(LatencyHistogram::BucketCount - 1), static_cast<uint64_t>(0));
+
+    LatencyHistogram h;
+    CHECK_EQ(h.quantile_us(0.5), static_cast<uint64_t>(0));
+    for (int i = 0; i < 90; ++i) h.add(500);
+    for (int i = 0; i < 10; ++i) h.add(3000);
+    CHECK_EQ(h.count(), static_cast<uint64_t>(100));
+    CHECK_EQ(h.total_ns(), static_cast<uint64_t>(90 * 500 + 10 * 3000));
+    CHECK_EQ(h.max_ns(), static_cast<uint64_t>(3000));
+    CHECK_EQ(h.quantile_us(0.5), static_cast<uint64_t>(1));
+    CHECK_EQ(h.quantile_us(0.9), static_cast<uint64_t>(1));
+    CHECK_EQ(h.quantile_us(0.99), static_cast<uint64_t>(4));
+}
+
+TEST(phase_timer_without_stats_records_nothing) {
+    lsofwin::PhaseTimer off(nullptr, ScanPhase::Resolve);
+    CHECK_EQ(off.stop(), static_cast<uint64_t>(0));
+
+    ScanStats stats;
+    {
+        lsofwin::PhaseTimer on(&stats, ScanPhase::Resolve);
+    }
+    CHECK_EQ(stats.calls(ScanPhase::Resolve), static_cast<uint64_t>(1));
+    CHECK_EQ(stats.calls(ScanPhase::Output), static_cast<uint64_t>(0));
+}
+
+TEST(scan_stats_count_every_skipped_handle_once) {
+    ProbeSource src;
+    fill_source(src);
+    FilterOptions opts;
+    opts.filter_types = { "File" };
+    opts.filter_file_regexes = { "\\.exe$" };
+
+    ScanStats stats;
+    auto rows = lsofwin::enumerate_handles(src, opts, nullptr, &stats);
+    CHECK_EQ(rows.size(), static_cast<size_t>(1));
+
+    CHECK_EQ(stats.get(ScanCounter::HandlesSeen), static_cast<uint64_t>(6));
+    CHECK_EQ(stats.get(ScanCounter::SkippedPlan), static_cast<uint64_t>(0));
+    CHECK_EQ(stats.get(ScanCounter::SkippedType), static_cast<uint64_t>(1));
+    CHECK_EQ(stats.get(ScanCounter::AccessDenied), static_cast<uint64_t>(2));
+    CHECK_EQ(stats.get(ScanCounter::SkippedFile), static_cast<uint64_t>(2));
+    CHECK_EQ(stats.get(ScanCounter::Rows), static_cast<uint64_t>(1));
+    CHECK_EQ(stats.calls(ScanPhase::Resolve), static_cast<uint64_t>(4));
+    CHECK_EQ(stats.get(ScanCounter::CacheHits), static_cast<uint64_t>(1));
+    CHECK_EQ(stats.get(ScanCounter::TimedOut), static_cast<uint64_t>(1));
+    CHECK_EQ(stats.calls(ScanPhase::ProcessInfo), static_cast<uint64_t>(3));
+    CHECK_EQ(stats.resolve_latency(2).count(), static_cast<uint64_t>(4));
+    CHECK_EQ(stats.resolve_latency(3).count(), static_cast<uint64_t>(0));
+
+    CHECK_EQ(stats.calls(ScanPhase::Scan), static_cast<uint64_t>(1));
+    CHECK_EQ(stats.calls(ScanPhase::Snapshot), static_cast<uint64_t>(1));
+    CHECK_EQ(stats.calls(ScanPhase::Plan), static_cast<uint64_t>(1));
+    CHECK(stats.calls(ScanPhase::Filter) > 0);
+    CHECK(stats.time_ns(ScanPhase::Scan) >= stats.time_ns(ScanPhase::Snapshot));
+
+    // The backend has the stats only for the duration of the scan
+    CHECK(src.stats_during_resolve == &stats);
+    CHECK(src.stats == nullptr);
+}
+
+TEST(scan_stats_count_plan_skips_and_streamed_output) {
+    FakeHandleSource src;
+    fill_source(src);
+    FilterOptions opts;
+    opts.filter_pids = { 100 };
+    opts.threads = 4;
+
+    ScanStats stats;
+    size_t rows = 0;
+    lsofwin::stream_handles(src, opts, [&](const lsofwin::HandleInfo&) { ++rows; }, nullptr, &stats);
+    CHECK_EQ(rows, static_cast<size_t>(3));
+    CHECK_EQ(stats.get(ScanCounter::SkippedPlan), static_cast<uint64_t>(3));
+    CHECK_EQ(stats.get(ScanCounter::Rows), static_cast<uint64_t>(3));
+    CHECK(stats.calls(ScanPhase::Output) > 0);
+    CHECK_EQ(stats.calls(ScanPhase::Filter), static_cast<uint64_t>(0)); // No -f or +D to time
+}
+
+TEST(scan_stats_reports_as_text_and_json) {
+    FakeHandleSource src;
+    fill_source(src);
+    ScanStats stats;
+    lsofwin::enumerate_handles(src, FilterOptions{}, nullptr, &stats);
+
+    std::string text = stats.to_text();
+    CHECK(text.find("snapshot") != std::string::npos);
+    CHECK(text.find("access_denied") != std::string::npos);
+    CHECK(text.find("resolve by type") != std::string::npos);
+    CHECK(text.find("\n  Key ") != std::string::npos);
+    CHECK(text.find("bytes_written") == std::string::npos); // Zero counters are left out
+
+    std::string json = stats.to_json();
+    CHECK_EQ(json.front(), '{');
+    CHECK_EQ(json.back(), '}');
+    CHECK(json.find("\"rows\":4,") != std::string::npos);
+    CHECK(json.find("\"bytes_written\":0") != std::string::npos);
+    CHECK(json.find("\"scan\":{\"ms\":") != std::string::npos);
+    CHECK(json.find("{\"type\":\"File\",\"count\":4,") != std::string::npos);
+    CHECK(json.find("{\"type\":\"Key\",\"count\":1,") != std::string::npos);
+}
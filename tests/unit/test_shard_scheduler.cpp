@@ -0,0 +1,96 @@
+#include "test_framework.h"
+#include "shard_scheduler.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+using lsofwin::RawHandle;
+using lsofwin::Shard;
+
+namespace {
+
+std::vector<RawHandle> make_table(const std::vector<std::pair<uint32_t, size_t>>& pid_counts) {
+    std::vector<RawHandle> table;
+    for (const auto& pc : pid_counts) {
+        for (size_t i = 0; i < pc.second; ++i) {
+            RawHandle h;
+            h.pid = pc.first;
+            h.handle_value = (i + 1) * 4;
+            table.push_back(h);
+        }
+    }
+    return table;
+}
+
+} // anonymous namespace
+
+TEST(plan_shards_splits_at_process_boundaries) {
+    auto table = make_table({ { 1, 3 }, { 2, 1 }, { 7, 4 } });
+    auto shards = lsofwin::plan_shards(table, 100);
+    CHECK_EQ(shards.size(), static_cast<size_t>(3));
+    CHECK_EQ(shards[0].begin, static_cast<size_t>(0));
+    CHECK_EQ(shards[0].end, static_cast<size_t>(3));
+    CHECK_EQ(shards[1].end, static_cast<size_t>(4));
+    CHECK_EQ(shards[2].end, static_cast<size_t>(8));
+}
+
+TEST(plan_shards_splits_large_processes) {
+    auto table = make_table({ { 1, 2 }, { 2, 10 }, { 3, 1 } });
+    auto shards = lsofwin::plan_shards(table, 4);
+    // pid 1: [0,2)  pid 2: [2,6) [6,10) [10,12)  pid 3: [12,13)
+    CHECK_EQ(shards.size(), static_cast<size_t>(5));
+    size_t expected_begin = 0;
+    for (const auto& s : shards) {
+        CHECK_EQ(s.begin, expected_begin);
+        CHECK(s.end - s.begin <= 4);
+        CHECK_EQ(table[s.begin].pid, table[s.end - 1].pid);
+        expected_begin = s.end;
+    }
+    CHECK_EQ(expected_begin, table.size());
+}
+
+TEST(plan_shards_handles_empty_table) {
+    std::vector<RawHandle> table;
+    CHECK(lsofwin::plan_shards(table, 16).empty());
+}
+
+TEST(work_stealing_runs_every_task_once) {
+    const size_t tasks = 1000;
+    std::vector<std::atomic<int>> hits(tasks);
+    std::atomic<size_t> max_worker{ 0 };
+
+    lsofwin::run_work_stealing(tasks, 4, [&](size_t task, size_t worker) {
+        ++hits[task];
+        size_t seen = max_worker.load();
+        while (worker > seen && !max_worker.compare_exchange_weak(seen, worker)) {}
+    });
+
+    for (const auto& h : hits) CHECK_EQ(h.load(), 1);
+    CHECK(max_worker.load() < 4);
+}
+
+TEST(work_stealing_balances_skewed_tasks) {
+    // Worker 0's block holds all the slow tasks; the others must steal them
+    const size_t tasks = 64;
+    std::vector<std::atomic<int>> ran_on(tasks);
+    lsofwin::run_work_stealing(tasks, 4, [&](size_t task, size_t worker) {
+        if (task < 16) std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        ran_on[task] = static_cast<int>(worker);
+    });
+
+    bool stolen = false;
+    for (size_t t = 0; t < 16; ++t) stolen |= ran_on[t].load() != 0;
+    CHECK(stolen);
+}
+
+TEST(run_in_order_runs_every_task_once) {
+    const size_t tasks = 500;
+    std::vector<std::atomic<int>> hits(tasks);
+    lsofwin::run_in_order(tasks, 3, [&](size_t task, size_t worker) {
+        CHECK(worker < 3);
+        ++hits[task];
+    });
+    for (const auto& h : hits) CHECK_EQ(h.load(), 1);
+}
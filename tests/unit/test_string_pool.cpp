@@ -0,0 +1,33 @@
+#include "test_framework.h"
+#include "string_pool.h"
+
+#include <string>
+
+using lsofwin::StringPool;
+
+TEST(string_pool_interns_each_string_once) {
+    StringPool pool;
+    CHECK_EQ(pool.size(), static_cast<size_t>(1));
+    CHECK_EQ(pool.intern(""), StringPool::Empty);
+
+    uint32_t a = pool.intern("C:\\Windows\\");
+    uint32_t b = pool.intern("notepad.exe");
+    CHECK(a != b);
+    CHECK_EQ(pool.intern(std::string("C:\\Windows\\")), a);
+    CHECK_EQ(pool.view(a), std::string_view("C:\\Windows\\"));
+    CHECK_EQ(pool.view(b), std::string_view("notepad.exe"));
+    CHECK_EQ(pool.size(), static_cast<size_t>(3));
+    CHECK_EQ(pool.bytes(), std::string("C:\\Windows\\notepad.exe"));
+}
+
+TEST(string_pool_keeps_ids_across_growth) {
+    StringPool pool;
+    for (int i = 0; i < 5000; ++i) {
+        CHECK_EQ(pool.intern("file" + std::to_string(i)), static_cast<uint32_t>(i + 1));
+    }
+    for (int i = 0; i < 5000; ++i) {
+        CHECK_EQ(pool.intern("file" + std::to_string(i)), static_cast<uint32_t>(i + 1));
+        CHECK_EQ(pool.view(static_cast<uint32_t>(i + 1)), "file" + std::to_string(i));
+    }
+    CHECK_EQ(pool.size(), static_cast<size_t>(5001));
+}
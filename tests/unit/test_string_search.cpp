@@ -0,0 +1,38 @@
+#include "test_framework.h"
+#include "string_search.h"
+
+#include <string>
+
+using lsofwin::contains_icase;
+
+TEST(contains_icase_finds_needle_in_any_case) {
+    CHECK(contains_icase("C:\\Users\\John\\Documents\\Report.DOCX", "report.docx"));
+    CHECK(contains_icase("C:\\Users\\John\\Documents\\Report.DOCX", "c:\\users"));
+    CHECK(contains_icase("anything", ""));
+    CHECK(!contains_icase("C:\\Users\\John", "jane"));
+    CHECK(!contains_icase("ab", "abc"));
+}
+
+TEST(contains_icase_agrees_with_scalar_search_at_every_offset) {
+    // Exercise matches straddling the 16-byte SIMD blocks and the scalar tail
+    for (size_t len = 1; len <= 5; ++len) {
+        std::string needle = std::string("xyzzy").substr(0, len);
+        for (size_t pos = 0; pos + len <= 70; ++pos) {
+            std::string hay(70, '-');
+            for (size_t i = 0; i < len; ++i) {
+                hay[pos + i] = static_cast<char>(needle[i] - 32); // uppercase
+            }
+            CHECK(contains_icase(hay, needle));
+            CHECK(!contains_icase(hay.substr(0, pos + len - 1), needle));
+        }
+    }
+}
+
+TEST(anchored_icase_comparisons) {
+    CHECK(lsofwin::starts_with_icase("\\Device\\Mup\\server", "\\device\\"));
+    CHECK(!lsofwin::starts_with_icase("\\Dev", "\\device\\"));
+    CHECK(lsofwin::ends_with_icase("C:\\logs\\APP.LOG", ".log"));
+    CHECK(!lsofwin::ends_with_icase("C:\\logs\\app.log.bak", ".log"));
+    CHECK(lsofwin::equals_icase("NUL", "nul"));
+    CHECK(!lsofwin::equals_icase("NUL:", "nul"));
+}
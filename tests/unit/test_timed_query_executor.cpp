@@ -0,0 +1,84 @@
+#include "test_framework.h"
+#include "timed_query_executor.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using lsofwin::TimedQueryExecutor;
+using std::chrono::milliseconds;
+
+namespace {
+
+// A gate that fake queries block on until the test opens it.
+struct Gate {
+    std::mutex m;
+    std::condition_variable cv;
+    bool open = false;
+
+    void wait() {
+        std::unique_lock<std::mutex> lock(m);
+        cv.wait(lock, [&]() { return open; });
+    }
+    void release() {
+        { std::lock_guard<std::mutex> lock(m); open = true; }
+        cv.notify_all();
+    }
+};
+
+} // anonymous namespace
+
+TEST(executor_runs_queries_on_reused_worker) {
+    TimedQueryExecutor exec(1);
+    int sum = 0;
+    for (int i = 1; i <= 100; ++i) {
+        CHECK(exec.run([&sum, i]() { sum += i; }, milliseconds(5000)));
+    }
+    CHECK_EQ(sum, 5050);
+    auto st = exec.stats();
+    CHECK_EQ(st.completed, 100u);
+    CHECK_EQ(st.workers_started, 1u);
+}
+
+TEST(executor_replaces_hung_worker_and_keeps_going) {
+    auto gate = std::make_shared<Gate>();
+    auto finished = std::make_shared<std::atomic<bool>>(false);
+    {
+        TimedQueryExecutor exec(1);
+        CHECK(!exec.run([gate, finished]() { gate->wait(); *finished = true; }, milliseconds(20)));
+
+        int value = 0;
+        CHECK(exec.run([&value]() { value = 42; }, milliseconds(5000)));
+        CHECK_EQ(value, 42);
+
+        auto st = exec.stats();
+        CHECK_EQ(st.timed_out, 1u);
+        CHECK_EQ(st.workers_abandoned, 1u);
+        CHECK_EQ(st.workers_started, 2u);
+    }
+    // The abandoned query still owns its captures and can finish after the
+    // executor is gone.
+    gate->release();
+    for (int i = 0; i < 500 && !*finished; ++i) {
+        std::this_thread::sleep_for(milliseconds(2));
+    }
+    CHECK(*finished);
+}
+
+TEST(executor_serves_concurrent_callers) {
+    TimedQueryExecutor exec(4);
+    std::atomic<int> count{ 0 };
+    std::vector<std::thread> callers;
+    for (int t = 0; t < 4; ++t) {
+        callers.emplace_back([&]() {
+            for (int i = 0; i < 250; ++i) {
+                exec.run([&count]() { ++count; }, milliseconds(5000));
+            }
+        });
+    }
+    for (auto& t : callers) t.join();
+    CHECK_EQ(count.load(), 1000);
+    CHECK_EQ(exec.stats().workers_started, 4u);
+}
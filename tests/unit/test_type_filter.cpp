@@ -0,0 +1,93 @@
+#include "test_framework.h"
+#include "fake_handle_source.h"
+#include "handle_enumerator.h"
+#include "type_filter.h"
+
+using lsofwin::FilterOptions;
+using lsofwin::TypeFilter;
+using lsofwin_test::FakeHandleSource;
+
+namespace {
+
+const std::vector<std::string> sample_types = { "", "", "Type", "Directory", "", "Event", "File", "Key" };
+
+void fill_table(FakeHandleSource& src) {
+    src.types_by_index = sample_types;
+    src.add_process(10, "svc.exe", "SYSTEM");
+    src.add_process(20, "app.exe", "HOST\\user");
+    for (uintptr_t h = 1; h <= 40; ++h) {
+        uint16_t idx = (h % 4 == 0) ? 6 : (h % 4 == 1) ? 7 : 5;
+        const char* type = idx == 6 ? "File" : idx == 7 ? "Key" : "Event";
+        src.add_handle(h <= 20 ? 10 : 20, h * 4, type, "obj" + std::to_string(h), idx);
+    }
+    // An index missing from the table (e.g. a driver-registered type)
+    src.add_handle(20, 0x1000, "File", "late-file", 42);
+}
+
+} // anonymous namespace
+
+TEST(split_list_drops_empty_items) {
+    auto items = lsofwin::split_list("File,,Key,");
+    CHECK_EQ(items.size(), static_cast<size_t>(2));
+    CHECK_EQ(items[0], std::string("File"));
+    CHECK_EQ(items[1], std::string("Key"));
+    CHECK(lsofwin::split_list(",").empty());
+}
+
+TEST(type_filter_inactive_matches_everything) {
+    TypeFilter f({}, sample_types);
+    CHECK(!f.active());
+    CHECK(f.check(6) == TypeFilter::Decision::Match);
+    CHECK(f.check(999) == TypeFilter::Decision::Match);
+}
+
+TEST(type_filter_decides_from_index_case_insensitive) {
+    TypeFilter f({ "file", "KEY" }, sample_types);
+    CHECK(f.check(6) == TypeFilter::Decision::Match);
+    CHECK(f.check(7) == TypeFilter::Decision::Match);
+    CHECK(f.check(5) == TypeFilter::Decision::Reject);
+    CHECK(f.check(4) == TypeFilter::Decision::Unknown);
+    CHECK(f.check(500) == TypeFilter::Decision::Unknown);
+    CHECK(f.matches_name("File"));
+    CHECK(!f.matches_name("Event"));
+}
+
+TEST(enumerate_type_filter_skips_resolve_for_rejected_entries) {
+    FakeHandleSource src;
+    fill_table(src);
+
+    FilterOptions opts;
+    opts.filter_types = { "File" };
+    auto rows = lsofwin::enumerate_handles(src, opts);
+
+    // 10 File rows by index + the unknown-index row resolved and matched by name
+    CHECK_EQ(rows.size(), static_cast<size_t>(11));
+    for (const auto& h : rows) CHECK_EQ(h.handle_type, std::string("File"));
+    CHECK_EQ(src.resolve_calls.load(), 11);
+}
+
+TEST(enumerate_type_filter_drops_unknown_index_on_name_mismatch) {
+    FakeHandleSource src;
+    fill_table(src);
+
+    FilterOptions opts;
+    opts.filter_types = { "Key" };
+    auto rows = lsofwin::enumerate_handles(src, opts);
+    CHECK_EQ(rows.size(), static_cast<size_t>(10));
+    CHECK_EQ(src.resolve_calls.load(), 11);
+}
+
+TEST(enumerate_type_filter_skips_processes_without_matches) {
+    FakeHandleSource src;
+    src.types_by_index = sample_types;
+    src.add_process(1, "a.exe", "u");
+    src.add_process(2, "b.exe", "u");
+    src.add_handle(1, 4, "Event", "", 5);
+    src.add_handle(2, 4, "File", "C:\\x", 6);
+
+    FilterOptions opts;
+    opts.filter_types = { "File" };
+    auto rows = lsofwin::enumerate_handles(src, opts);
+    CHECK_EQ(rows.size(), static_cast<size_t>(1));
+    CHECK_EQ(src.process_info_calls.load(), 1);
+}
@@ -0,0 +1,135 @@
+#include "test_framework.h"
+#include "utf16_transcode.h"
+
+#include <cstdint>
+#include <string>
+
+using lsofwin::append_utf8;
+using lsofwin::utf16_to_utf8;
+using lsofwin::utf8_length;
+
+namespace {
+
+// Straightforward reference: decode code points, then encode each one.
+std::string reference_utf8(const std::u16string& s) {
+    std::string out;
+    for (size_t i = 0; i < s.size(); ++i) {
+        uint32_t cp = s[i];
+        if (cp >= 0xD800 && cp <= 0xDBFF && i + 1 < s.size() && s[i + 1] >= 0xDC00 && s[i + 1] <= 0xDFFF) {
+            cp = 0x10000 + ((cp - 0xD800) << 10) + (s[i + 1] - 0xDC00);
+            ++i;
+        }
+        else if (cp >= 0xD800 && cp <= 0xDFFF) {
+            cp = 0xFFFD;
+        }
+
+        if (cp < 0x80) {
+            out += static_cast<char>(cp);
+        }
+        else if (cp < 0x800) {
+            out += static_cast<char>(0xC0 | (cp >> 6));
+            out += static_cast<char>(0x80 | (cp & 0x3F));
+        }
+        else if (cp < 0x10000) {
+            out += static_cast<char>(0xE0 | (cp >> 12));
+            out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (cp & 0x3F));
+        }
+        else {
+            out += static_cast<char>(0xF0 | (cp >> 18));
+            out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+            out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (cp & 0x3F));
+        }
+    }
+    return out;
+}
+
+std::string transcode(const std::u16string& s) {
+    std::string out(3 * s.size() + 16, '#');
+    char* end = utf16_to_utf8(s, &out[0]);
+    out.resize(static_cast<size_t>(end - out.data()));
+    return out;
+}
+
+// Deterministic xorshift so failures reproduce.
+struct Rng {
+    uint64_t state;
+    uint32_t next() {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return static_cast<uint32_t>(state >> 32);
+    }
+};
+
+// Mostly ASCII runs, like real paths, with every other kind of unit mixed in.
+char16_t random_unit(Rng& rng) {
+    uint32_t kind = rng.next() % 100;
+    if (kind < 70) return static_cast<char16_t>(0x20 + rng.next() % 0x5F);
+    if (kind < 73) return static_cast<char16_t>(rng.next() % 0x80);        // Including NUL and controls
+    if (kind < 80) return static_cast<char16_t>(0x80 + rng.next() % 0x780);
+    if (kind < 88) return static_cast<char16_t>(0x800 + rng.next() % (0xD800 - 0x800));
+    if (kind < 92) return static_cast<char16_t>(0xE000 + rng.next() % 0x2000);
+    if (kind < 96) return static_cast<char16_t>(0xD800 + rng.next() % 0x400);  // High surrogate
+    return static_cast<char16_t>(0xDC00 + rng.next() % 0x400);                // Low surrogate
+}
+
+} // anonymous namespace
+
+TEST(utf16_to_utf8_converts_each_length_class) {
+    CHECK_EQ(transcode(u""), std::string());
+    CHECK_EQ(transcode(u"C:\\Windows\\System32\\ntdll.dll"), std::string("C:\\Windows\\System32\\ntdll.dll"));
+    CHECK_EQ(transcode(u"caf\u00e9"), std::string("caf\xc3\xa9"));
+    CHECK_EQ(transcode(u"\u65e5\u672c"), std::string("\xe6\x97\xa5\xe6\x9c\xac"));
+    CHECK_EQ(transcode(u"\U0001F600"), std::string("\xf0\x9f\x98\x80"));
+    CHECK_EQ(utf8_length(u"a\u00e9\u65e5\U0001F600"), static_cast<size_t>(1 + 2 + 3 + 4));
+}
+
+TEST(utf16_to_utf8_replaces_unpaired_surrogates) {
+    const char16_t lone_high[] = { u'a', 0xD83D, u'b', 0 };
+    const char16_t lone_low[] = { 0xDE00, u'x', 0 };
+    const char16_t high_at_end[] = { u'x', 0xD83D, 0 };
+    const char16_t reversed[] = { 0xDE00, 0xD83D, 0 };
+    CHECK_EQ(transcode(lone_high), std::string("a\xef\xbf\xbd" "b"));
+    CHECK_EQ(transcode(lone_low), std::string("\xef\xbf\xbdx"));
+    CHECK_EQ(transcode(high_at_end), std::string("x\xef\xbf\xbd"));
+    CHECK_EQ(transcode(reversed), std::string("\xef\xbf\xbd\xef\xbf\xbd"));
+    CHECK_EQ(utf8_length(reversed), static_cast<size_t>(6));
+}
+
+TEST(utf16_to_utf8_handles_non_ascii_at_every_block_offset) {
+    // A 40-unit ASCII path with one non-ASCII unit moved across both SSE2 blocks
+    for (size_t pos = 0; pos < 40; ++pos) {
+        std::u16string s(40, u'p');
+        s[pos] = 0x00e9;
+        std::string expected = reference_utf8(s);
+        CHECK_EQ(transcode(s), expected);
+        CHECK_EQ(utf8_length(s), expected.size());
+    }
+}
+
+TEST(utf16_to_utf8_matches_reference_on_random_input) {
+    Rng rng{ 0x9E3779B97F4A7C15ull };
+    for (int iteration = 0; iteration < 20000; ++iteration) {
+        size_t len = rng.next() % (iteration < 10000 ? 40 : 300);
+        std::u16string s;
+        for (size_t i = 0; i < len; ++i) s += random_unit(rng);
+
+        std::string expected = reference_utf8(s);
+        std::string got = transcode(s);
+        if (got != expected || utf8_length(s) != expected.size()) {
+            CHECK_EQ(got, expected);
+            CHECK_EQ(utf8_length(s), expected.size());
+            return;
+        }
+    }
+}
+
+TEST(append_utf8_appends_exactly) {
+    std::string out = "prefix:";
+    append_utf8(out, u"\\??\\C:\\Zo\u00eb");
+    CHECK_EQ(out, std::string("prefix:\\??\\C:\\Zo\xc3\xab"));
+    append_utf8(out, u"");
+    CHECK_EQ(out.size(), static_cast<size_t>(7 + 9 + 2));
+}